@@ -7,8 +7,40 @@
 
 #include "PrintDeviceSDK_API.h"
 #include "SDKManager.h"
-#include <QMutexLocker>
+#include "SDKSessionManager.h"
 #include <QString>
+#include <QJsonDocument>
+#include <cstring>
+
+namespace {
+
+// 句柄转换为会话；NULL为默认会话，已销毁或无效的句柄返回nullptr
+SDKManager* toSession(SdkSessionHandle session) {
+    if (!session) {
+        return SDKManager::instance();
+    }
+    SDKManager* manager = reinterpret_cast<SDKManager*>(session);
+    return SDKSessionManager::instance()->contains(manager) ? manager : nullptr;
+}
+
+// 毫米转协议微米；负数、NaN和超出SDK_MOVE_MAX_MM的值返回false
+bool toMicrometers(double mm, quint32& um) {
+    if (!(mm >= 0.0 && mm <= SDK_MOVE_MAX_MM)) {
+        return false;
+    }
+    um = static_cast<quint32>(qRound64(mm * 1000.0));
+    return true;
+}
+
+int copyJson(const QJsonObject& object, char* buffer, int bufferSize) {
+    QByteArray json = QJsonDocument(object).toJson(QJsonDocument::Compact);
+    if (buffer && bufferSize > json.size()) {
+        memcpy(buffer, json.constData(), json.size() + 1);
+    }
+    return json.size();
+}
+
+} // namespace
 
 // ==================== 初始化和资源管理 ====================
 
@@ -26,19 +58,18 @@ void ReleaseSDK() {
 }
 
 void RegisterEventCallback(SdkEventCallback callback) {
+    RegisterEventCallbackEx(callback, SDK_EVENT_MASK_DEFAULT);
+}
+
+void RegisterEventCallbackEx(SdkEventCallback callback, unsigned int eventMask) {
     // 注册事件回调函数
-    QMutexLocker lock(&g_callbackMutex);
-    g_sdkCallback = callback;
+    SDKManager::instance()->setEventCallback(callback, eventMask);
 }
 
 // ==================== 连接管理 ====================
 
 int ConnectByTCP(const char* ip, unsigned short port) {
-    if (!ip) {
-        return -1;
-    }
-    
-    return SDKManager::instance()->connectByTCP(QString(ip), port);
+    return SessionConnectByTCP(nullptr, ip, port);
 }
 
 int ConnectBySerial(const char* port_name, unsigned int baud_rate) {
@@ -48,81 +79,252 @@ int ConnectBySerial(const char* port_name, unsigned int baud_rate) {
 }
 
 void Disconnect() {
-    SDKManager::instance()->disconnect();
+    SessionDisconnect(nullptr);
 }
 
 int IsConnected() {
-    return SDKManager::instance()->isConnected() ? 1 : 0;
+    return SessionIsConnected(nullptr);
+}
+
+void SetAutoReconnect(int enable, int min_delay_ms, int max_delay_ms) {
+    SessionSetAutoReconnect(nullptr, enable, min_delay_ms, max_delay_ms);
 }
 
 // ==================== 运动控制 ====================
 
 int MoveTo(double x, double y, double z, double speed) {
-    // 绝对移动：分别移动各轴到指定坐标
-    // 注意：原项目中主要是相对移动，这里实现为调用各轴移动
-    int result = 0;
-    
-    if (x != 0) {
-        result |= SDKManager::instance()->moveXAxis(x, true);
+    return SessionMoveTo(nullptr, x, y, z, speed);
+}
+
+int MoveBy(double dx, double dy, double dz, double speed) {
+    return SessionMoveBy(nullptr, dx, dy, dz, speed);
+}
+
+int GoHome() {
+    return SessionGoHome(nullptr);
+}
+
+// ==================== 打印控制 ====================
+
+int LoadPrintData(const char* data) {
+    return SessionLoadPrintData(nullptr, data);
+}
+
+int StartPrint() {
+    return SessionStartPrint(nullptr);
+}
+
+int PausePrint() {
+    return SessionPausePrint(nullptr);
+}
+
+int ResumePrint() {
+    return SessionResumePrint(nullptr);
+}
+
+int StopPrint() {
+    return SessionStopPrint(nullptr);
+}
+
+// ==================== 运行指标 ====================
+
+int GetMetricsSnapshot(char* buffer, int bufferSize) {
+    return SessionGetMetricsSnapshot(nullptr, buffer, bufferSize);
+}
+
+void ResetMetrics() {
+    SessionResetMetrics(nullptr);
+}
+
+// ==================== 时间线追踪 ====================
+
+void StartTrace() {
+    SDKManager::instance()->startTrace();
+}
+
+int StopTrace(const char* file_path) {
+    QString path = file_path ? QString::fromUtf8(file_path) : QString();
+    return SDKManager::instance()->stopTrace(path) ? 0 : -1;
+}
+
+// ==================== 抓包 ====================
+
+int StartCapture(const char* file_path) {
+    return SessionStartCapture(nullptr, file_path);
+}
+
+void StopCapture() {
+    SessionStopCapture(nullptr);
+}
+
+// ==================== 多设备会话 ====================
+
+SdkSessionHandle CreateSession(const char* name, const char* log_dir) {
+    QString sessionName = name ? QString::fromUtf8(name) : QString();
+    QString logDir = log_dir ? QString::fromUtf8(log_dir) : QString();
+    SDKManager* session = SDKSessionManager::instance()->createSession(sessionName);
+    if (session && !session->init(logDir)) {
+        SDKSessionManager::instance()->destroySession(session);
+        session = nullptr;
     }
-    if (y != 0) {
-        result |= SDKManager::instance()->moveYAxis(y, true);
+    return reinterpret_cast<SdkSessionHandle>(session);
+}
+
+void DestroySession(SdkSessionHandle session) {
+    // 默认会话由ReleaseSDK释放
+    if (session) {
+        SDKSessionManager::instance()->destroySession(reinterpret_cast<SDKManager*>(session));
     }
-    if (z != 0) {
-        result |= SDKManager::instance()->moveZAxis(z, true);
+}
+
+void SetIoThreadCount(int count) {
+    SDKSessionManager::instance()->setIoThreadCount(count);
+}
+
+void SessionRegisterEventCallback(SdkSessionHandle session, SdkSessionEventCallback callback, unsigned int eventMask, void* userData) {
+    if (SDKManager* manager = toSession(session)) {
+        manager->setSessionEventCallback(callback, userData, eventMask);
+    }
+}
+
+int SessionConnectByTCP(SdkSessionHandle session, const char* ip, unsigned short port) {
+    SDKManager* manager = toSession(session);
+    if (!manager || !ip) {
+        return -1;
     }
     
+    return manager->connectByTCP(QString(ip), port);
+}
+
+void SessionDisconnect(SdkSessionHandle session) {
+    if (SDKManager* manager = toSession(session)) {
+        manager->disconnect();
+    }
+}
+
+int SessionIsConnected(SdkSessionHandle session) {
+    SDKManager* manager = toSession(session);
+    return (manager && manager->isConnected()) ? 1 : 0;
+}
+
+void SessionSetAutoReconnect(SdkSessionHandle session, int enable, int min_delay_ms, int max_delay_ms) {
+    if (SDKManager* manager = toSession(session)) {
+        manager->setAutoReconnect(enable != 0, min_delay_ms, max_delay_ms);
+    }
+}
+
+int SessionMoveTo(SdkSessionHandle session, double x, double y, double z, double speed) {
+    // 绝对移动：只移动坐标非0的轴（毫米），速度由下位机参数决定
+    Q_UNUSED(speed);
+    SDKManager* manager = toSession(session);
+    if (!manager) {
+        return -1;
+    }
+
+    // 先校验全部坐标，避免部分轴已下发后才发现越界
+    MoveAxisPos target;
+    if (!toMicrometers(x, target.xPos) || !toMicrometers(y, target.yPos) || !toMicrometers(z, target.zPos)) {
+        return SDK_ERR_MOVE_OUT_OF_RANGE;
+    }
+
+    int result = 0;
+    if (target.xPos != 0) {
+        result |= manager->move2AbsXAxis(MoveAxisPos(target.xPos, 0, 0));
+    }
+    if (target.yPos != 0) {
+        result |= manager->move2AbsYAxis(MoveAxisPos(0, target.yPos, 0));
+    }
+    if (target.zPos != 0) {
+        result |= manager->move2AbsZAxis(MoveAxisPos(0, 0, target.zPos));
+    }
     return result;
 }
 
-int MoveBy(double dx, double dy, double dz, double speed) {
+int SessionMoveBy(SdkSessionHandle session, double dx, double dy, double dz, double speed) {
     // 相对移动：各轴相对当前位置移动
+    Q_UNUSED(speed);
+    SDKManager* manager = toSession(session);
+    if (!manager) {
+        return -1;
+    }
     int result = 0;
     
     if (dx != 0) {
-        result |= SDKManager::instance()->moveXAxis(dx, false);
+        result |= manager->move2RelXAxis(dx);
     }
     if (dy != 0) {
-        result |= SDKManager::instance()->moveYAxis(dy, false);
+        result |= manager->move2RelYAxis(dy);
     }
     if (dz != 0) {
-        result |= SDKManager::instance()->moveZAxis(dz, false);
+        result |= manager->move2RelZAxis(dz);
     }
     
     return result;
 }
 
-int GoHome() {
+int SessionGoHome(SdkSessionHandle session) {
     // 所有轴回原点
     // axisFlag = 7 表示 X(1) + Y(2) + Z(4) = 全部轴
-    return SDKManager::instance()->resetAxis(7);
+    SDKManager* manager = toSession(session);
+    return manager ? manager->resetAxis(7) : -1;
 }
 
-// ==================== 打印控制 ====================
-
-int LoadPrintData(const char* data) {
-    if (!data) {
+int SessionLoadPrintData(SdkSessionHandle session, const char* data) {
+    SDKManager* manager = toSession(session);
+    if (!manager || !data) {
         return -1;
     }
     
     // data参数为图像文件路径
     QString path = QString::fromUtf8(data);
-    return SDKManager::instance()->loadImageData(path);
+    return manager->loadImageData(path);
 }
 
-int StartPrint() {
-    return SDKManager::instance()->startPrint();
+int SessionStartPrint(SdkSessionHandle session) {
+    SDKManager* manager = toSession(session);
+    return manager ? manager->startPrint() : -1;
 }
 
-int PausePrint() {
-    return SDKManager::instance()->pausePrint();
+int SessionPausePrint(SdkSessionHandle session) {
+    SDKManager* manager = toSession(session);
+    return manager ? manager->pausePrint() : -1;
 }
 
-int ResumePrint() {
-    return SDKManager::instance()->resumePrint();
+int SessionResumePrint(SdkSessionHandle session) {
+    SDKManager* manager = toSession(session);
+    return manager ? manager->resumePrint() : -1;
 }
 
-int StopPrint() {
-    return SDKManager::instance()->stopPrint();
+int SessionStopPrint(SdkSessionHandle session) {
+    SDKManager* manager = toSession(session);
+    return manager ? manager->stopPrint() : -1;
+}
+
+int SessionGetMetricsSnapshot(SdkSessionHandle session, char* buffer, int bufferSize) {
+    SDKManager* manager = toSession(session);
+    return copyJson(manager ? manager->metricsSnapshot() : QJsonObject(), buffer, bufferSize);
+}
+
+void SessionResetMetrics(SdkSessionHandle session) {
+    if (SDKManager* manager = toSession(session)) {
+        manager->resetMetrics();
+    }
+}
+
+int SessionStartCapture(SdkSessionHandle session, const char* file_path) {
+    SDKManager* manager = toSession(session);
+    if (!manager || !file_path) {
+        return -1;
+    }
+    return manager->startCapture(QString::fromUtf8(file_path)) ? 0 : -1;
 }
 
+void SessionStopCapture(SdkSessionHandle session) {
+    if (SDKManager* manager = toSession(session)) {
+        manager->stopCapture();
+    }
+}
+
+int GetSessionsMetricsSnapshot(char* buffer, int bufferSize) {
+    return copyJson(SDKSessionManager::instance()->metricsSnapshot(), buffer, bufferSize);
+}
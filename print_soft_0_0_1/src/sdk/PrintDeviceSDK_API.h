@@ -1,50 +1,21 @@
 ﻿#ifndef PRINT_DEVICE_SDK_API_H
 #define PRINT_DEVICE_SDK_API_H
 
+#include "motioncontrolsdk_event.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-// 用于导出/导入函数的宏
-#ifdef PRINTDEVICESDK_EXPORTS
+// 用于导出/导入函数的宏；BUILD_STATIC时直接编译源文件（基准测试等工具）
+#if defined(BUILD_STATIC)
+#define SDK_API
+#elif defined(PRINTDEVICESDK_EXPORTS)
 #define SDK_API __declspec(dllexport)
 #else
 #define SDK_API __declspec(dllimport)
 #endif
 
-// --- 事件回调定义 ---
-
-///**
-// * @brief SDK事件类型枚举
-// */
-//typedef enum {
-//    EVENT_TYPE_GENERAL,     // 普通信息事件 (如: "Connected", "Disconnected")
-//    EVENT_TYPE_ERROR,       // 错误事件
-//    EVENT_TYPE_PRINT_STATUS,// 打印状态更新 (如: 进度, 层数)
-//    EVENT_TYPE_MOVE_STATUS, // 运动状态更新 (如: "Moving", "Idle")
-//    EVENT_TYPE_LOG          // 内部日志事件
-//} SdkEventType;
-//
-///**
-// * @brief SDK事件结构体
-// */
-//typedef struct {
-//    SdkEventType type;      // 事件类型
-//    int code;               // 状态/错误码
-//    const char* message;    // 事件消息
-//    double value1;          // 附加数据1 (例如: 打印进度, X坐标)
-//    double value2;          // 附加数据2 (例如: 当前层, Y坐标)
-//    double value3;          // 附加数据3 (例如: 总层数, Z坐标)
-//} SdkEvent;
-
-extern SdkEvent;
-
-/**
- * @brief 回调函数指针类型
- */
-typedef void(*SdkEventCallback)(const SdkEvent* event);
-
-
 // --- API 函数声明 ---
 
 /**
@@ -60,11 +31,20 @@ SDK_API int InitSDK(const char* log_dir);
 SDK_API void ReleaseSDK();
 
 /**
- * @brief 注册事件回调函数
+ * @brief 注册事件回调函数（订阅除报文事件外的全部事件）
  * @param callback 回调函数指针
  */
 SDK_API void RegisterEventCallback(SdkEventCallback callback);
 
+/**
+ * @brief 注册事件回调函数并指定订阅的事件类型
+ * @param callback 回调函数指针
+ * @param eventMask SDK_EVENT_MASK(type)按位组合；报文事件(SEND_MSG/RECV_MSG)需显式订阅，
+ *                  其原始字节通过event->data/dataLen给出
+ * @note 全部事件（含RECV_MSG）都在调用InitSDK的线程中回调
+ */
+SDK_API void RegisterEventCallbackEx(SdkEventCallback callback, unsigned int eventMask);
+
 /**
  * @brief 通过TCP连接设备
  * @param ip 设备IP地址
@@ -92,10 +72,28 @@ SDK_API void Disconnect();
  */
 SDK_API int IsConnected();
 
+/**
+ * @brief 设置断线自动重连（默认开启）
+ * @param enable 非0开启
+ * @param min_delay_ms 首次重连延时（毫秒），之后按带抖动的指数退避增长
+ * @param max_delay_ms 最大重连延时（毫秒）
+ * @note 尚未写入socket的命令保留，重连后按原顺序发送；图像传输从最早未确认的帧继续。
+ *       断线前已发出的命令不重发，等待应答的命令按超时失败，需要时由调用方重新下发
+ */
+SDK_API void SetAutoReconnect(int enable, int min_delay_ms, int max_delay_ms);
+
 // --- 运动控制 ---
 
+// 绝对移动坐标为负、非数值或超出协议范围
+#define SDK_ERR_MOVE_OUT_OF_RANGE (-2)
+// 绝对坐标上限（毫米），协议坐标为无符号32位微米
+#define SDK_MOVE_MAX_MM 4294967.0
+
 /**
- * @brief 移动到绝对坐标
+ * @brief 移动到绝对坐标（毫米）
+ * @note 按轴下发：只移动坐标非0的轴，为0的轴保持不动；回到0点请使用GoHome。
+ *       坐标须在[0, SDK_MOVE_MAX_MM]内，任一轴越界时不下发任何命令
+ * @return 0 成功, -1 未连接或发送失败, SDK_ERR_MOVE_OUT_OF_RANGE 坐标越界
  */
 SDK_API int MoveTo(double x, double y, double z, double speed);
 
@@ -142,6 +140,138 @@ SDK_API int ResumePrint();
  */
 SDK_API int StopPrint();
 
+// --- 运行指标 ---
+
+/**
+ * @brief 获取运行指标快照（紧凑JSON，UTF-8）
+ * @param buffer 输出缓冲区，可为NULL（只查询所需长度）
+ * @param bufferSize 缓冲区大小（含结尾'\0'）
+ * @return JSON长度（不含结尾'\0'）；大于等于bufferSize时未写入，应按返回值+1重新分配后再调用
+ */
+SDK_API int GetMetricsSnapshot(char* buffer, int bufferSize);
+
+/**
+ * @brief 清零运行指标
+ */
+SDK_API void ResetMetrics();
+
+// --- 时间线追踪 ---
+
+/**
+ * @brief 开始记录命令流水线时间线（清空之前的记录）
+ */
+SDK_API void StartTrace();
+
+/**
+ * @brief 停止记录并导出为Chrome trace-event JSON
+ * @param file_path 输出文件路径（UTF-8），可为NULL（只停止不导出）
+ * @return 0 成功, -1 文件写入失败
+ */
+SDK_API int StopTrace(const char* file_path);
+
+// --- 抓包 ---
+
+/**
+ * @brief 开始抓取socket原始收发数据，可用wire_replay工具离线回放
+ * @param file_path 输出文件路径（UTF-8）
+ * @return 0 成功, -1 SDK未初始化或文件无法创建
+ */
+SDK_API int StartCapture(const char* file_path);
+
+/**
+ * @brief 结束抓包
+ */
+SDK_API void StopCapture();
+
+// --- 多设备会话 ---
+// 以上接口作用于默认会话（InitSDK初始化的设备）；以下Session*接口作用于指定会话，
+// session为NULL时同样表示默认会话。各会话的连接共用少量I/O线程。
+
+/**
+ * @brief 创建设备会话，需在运行Qt事件循环的线程中调用
+ * @param name 会话名（UTF-8），可为NULL（自动命名）；不能与已有会话重名
+ * @param log_dir 日志文件存放目录，可为NULL；日志为全部会话共用
+ * @return 会话句柄，失败返回NULL
+ */
+SDK_API SdkSessionHandle CreateSession(const char* name, const char* log_dir);
+
+/**
+ * @brief 断开并销毁会话，返回后不会再收到该会话的事件
+ * @param session CreateSession返回的句柄
+ */
+SDK_API void DestroySession(SdkSessionHandle session);
+
+/**
+ * @brief 设置共享I/O线程数上限（默认4，也可通过环境变量PRINT_SDK_IO_THREADS设置）
+ * @param count 线程数，<=0恢复默认值；只影响之后建立的连接
+ */
+SDK_API void SetIoThreadCount(int count);
+
+/**
+ * @brief 注册会话的事件回调
+ * @param session 会话句柄
+ * @param callback 回调函数指针，回调参数中带有会话句柄和userData
+ * @param eventMask 订阅的事件类型，同RegisterEventCallbackEx
+ * @param userData 原样传回回调的用户数据
+ */
+SDK_API void SessionRegisterEventCallback(SdkSessionHandle session, SdkSessionEventCallback callback, unsigned int eventMask, void* userData);
+
+/**
+ * @brief 通过TCP连接会话对应的设备
+ * @return 0 表示调用成功, -1 句柄无效或参数错误
+ */
+SDK_API int SessionConnectByTCP(SdkSessionHandle session, const char* ip, unsigned short port);
+
+/**
+ * @brief 断开会话的设备连接
+ */
+SDK_API void SessionDisconnect(SdkSessionHandle session);
+
+/**
+ * @brief 查询会话的连接状态
+ * @return 1 已连接, 0 未连接或句柄无效
+ */
+SDK_API int SessionIsConnected(SdkSessionHandle session);
+
+/**
+ * @brief 设置会话的断线自动重连，参数同SetAutoReconnect
+ */
+SDK_API void SessionSetAutoReconnect(SdkSessionHandle session, int enable, int min_delay_ms, int max_delay_ms);
+
+/**
+ * @brief 会话版MoveTo，坐标语义和返回值同MoveTo；句柄无效返回-1
+ */
+SDK_API int SessionMoveTo(SdkSessionHandle session, double x, double y, double z, double speed);
+SDK_API int SessionMoveBy(SdkSessionHandle session, double dx, double dy, double dz, double speed);
+SDK_API int SessionGoHome(SdkSessionHandle session);
+SDK_API int SessionLoadPrintData(SdkSessionHandle session, const char* data);
+SDK_API int SessionStartPrint(SdkSessionHandle session);
+SDK_API int SessionPausePrint(SdkSessionHandle session);
+SDK_API int SessionResumePrint(SdkSessionHandle session);
+SDK_API int SessionStopPrint(SdkSessionHandle session);
+
+/**
+ * @brief 获取会话的运行指标快照，缓冲区约定同GetMetricsSnapshot
+ */
+SDK_API int SessionGetMetricsSnapshot(SdkSessionHandle session, char* buffer, int bufferSize);
+
+/**
+ * @brief 清零会话的运行指标
+ */
+SDK_API void SessionResetMetrics(SdkSessionHandle session);
+
+/**
+ * @brief 会话抓包，参数同StartCapture/StopCapture
+ */
+SDK_API int SessionStartCapture(SdkSessionHandle session, const char* file_path);
+SDK_API void SessionStopCapture(SdkSessionHandle session);
+
+/**
+ * @brief 获取全部会话的运行指标快照：{"process": 进程级（默认会话及I/O线程）, "sessions": {会话名: 快照}}
+ * @return 缓冲区约定同GetMetricsSnapshot
+ */
+SDK_API int GetSessionsMetricsSnapshot(char* buffer, int bufferSize);
+
 
 #ifdef __cplusplus
 }
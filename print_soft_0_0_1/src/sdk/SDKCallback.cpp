@@ -7,15 +7,13 @@
 #include "SDKManager.h"
 #include "TcpClient.h"
 #include "ProtocolPrint.h"
+#include "PendingRequestTable.h"
+#include "CLogManager.h"
+#include "TraceRecorder.h"
 #include <QMutexLocker>
 #include <QMetaObject>
 #include <QString>
 
-// ==================== 全局变量定义 ====================
-
-SdkEventCallback g_sdkCallback = nullptr;
-QMutex g_callbackMutex;
-QByteArray g_messageBuffer;
 class ProtocolPrint;
 
 // ==================== TCP事件处理 ====================
@@ -24,10 +22,16 @@ void SDKManager::onRecvData(QByteArray data)
 {
     if (m_protocol) 
 {
-        // 将接收到的数据交给协议处理器解码
+		// 接收报文事件与其他事件一样在应用线程回调：先于本次解码结果排队，保持原有先后顺序；
+		// 未订阅时不投递
+		if (isEventSubscribed(EVENT_TYPE_RECV_MSG))
+		{
+			QMetaObject::invokeMethod(this, [this, data]() {
+				sendDataEvent(EVENT_TYPE_RECV_MSG, data);
+			}, Qt::QueuedConnection);
+		}
+        // 将接收到的数据交给协议处理器解码（socket线程），结果经SigResultBatch成批排队到应用线程
         m_protocol->HandleRecvDatagramData1(data);
-		// 发送接收报文数据
-		sendEvent(EVENT_TYPE_RECV_MSG, 0, data.toHex().toUpper());
     }
 }
 
@@ -47,6 +51,14 @@ void SDKManager::onStateChanged(QAbstractSocket::SocketState state)
 	{
         // 连接成功
         sendEvent(EVENT_TYPE_GENERAL, 0, "motion_sdk_moudle connected_2_dev");
+
+        // 此后意外断线时保留发送队列并自动重连
+        m_wantConnected = true;
+        m_tcpClient->setKeepQueueOnDisconnect(m_autoReconnect);
+        if (m_outageTimer.isValid())
+		{
+            finishOutage();
+        }
         
         // 启动心跳机制
         m_heartbeatTimeout = 0;
@@ -67,6 +79,26 @@ void SDKManager::onStateChanged(QAbstractSocket::SocketState state)
 	{
         // 连接断开
         sendEvent(EVENT_TYPE_GENERAL, 0, "motion_sdk_moudle disconnected_from_dev");
+
+        if (m_wantConnected && m_autoReconnect)
+		{
+            // 意外断线（含重连失败）：发送队列和图像任务保留，稍后重连
+            scheduleReconnect();
+        }
+		else
+		{
+            // 发送队列已随断线清空，未完成的图像任务无法继续
+            if (m_imgJob.active)
+			{
+                finishImageJob(false, "Connection lost");
+            }
+
+            // 断线后不会再收到应答
+            if (m_pendingRequests)
+			{
+                m_pendingRequests->failAll(QStringLiteral("disconnected"));
+            }
+        }
         
         // 停止心跳定时器
         if (m_heartbeatSendTimer) 
@@ -118,9 +150,79 @@ void SDKManager::onCmdReply(int cmd, uchar errCode, QByteArray arr)
     }
 }
 
-void SDKManager::onFaileHandleReTransport(QByteArray& arr)
+void SDKManager::onFaileHandleReTransport(const QByteArray& arr)
+{
+	//arr是下位机的失败回复包而不是原请求，不能原样发回；打印数据帧的否认由onPrintDataAck按序号重发
+	ushort code = arr.size() >= 6 ? ((uchar)arr.at(5) << 8) | (uchar)arr.at(4) : 0;
+	LOG_INFO(QString(u8"lrz_motion_sdk cmd_failed_resp: 0x%1, data: %2")
+		.arg(QString::number(code, 16).toUpper())
+		.arg(QString(arr.toHex(' ').toUpper())));
+
+	QString msg = QString("Device rejected command: 0x%1").arg(code, 0, 16);
+	sendEvent(EVENT_TYPE_ERROR, code, msg.toUtf8().constData());
+}
+
+void SDKManager::onProtocolResults(const QVector<ProtocolResult>& results)
 {
-	sendCommand(arr);
+	// release之后才到达的批次
+	if (!m_initialized)
+	{
+		return;
+	}
+
+	TRACE_SCOPE("handle_results", "results", results.size());
+	bool pump = false;
+	for (const ProtocolResult& result : results)
+	{
+		switch (result.kind)
+		{
+		case ProtocolResult::Res_HeartBeat:
+			onHeartbeat();
+			break;
+		case ProtocolResult::Res_CmdReply:
+			onCmdReply(result.funCode, 0, result.data);
+			break;
+		case ProtocolResult::Res_CmdResult:
+			m_pendingRequests->complete(result.cmdType, result.funCode, result.ok, result.data);
+			break;
+		case ProtocolResult::Res_PrintDataAck:
+			pump |= onPrintDataAck(result.seq, result.ok);
+			break;
+		case ProtocolResult::Res_CmdFailed:
+			onFaileHandleReTransport(result.data);
+			break;
+		case ProtocolResult::Res_AxisData:
+			onHandleRecvFunOper(result.packParam);
+			onHandleRecvDataOper(result.funCode, result.axisPos);
+			break;
+		default:
+			break;
+		}
+	}
+
+	if (pump)
+	{
+		onPumpImagePackets();
+	}
+}
+
+bool SDKManager::onPrintDataAck(quint32 seq, bool ok)
+{
+	if (!m_imgJob.active)
+	{
+		return false;
+	}
+
+	if (ok)
+	{
+		m_imgJob.window.onAck(seq);
+	}
+	else
+	{
+		LOG_INFO(QString(u8"lrz_motion_sdk print_data_nak seq: %1").arg(seq));
+		m_imgJob.window.onNak(seq);
+	}
+	return true;
 }
 
 
@@ -7,7 +7,14 @@
 #include "SDKManager.h"
 #include "TcpClient.h"
 #include "ProtocolPrint.h"
+#include "PendingRequestTable.h"
+#include "MetricsRegistry.h"
+#include "CLogManager.h"
 #include <QTimer>
+#include <QRandomGenerator>
+
+//退避延时指数上限，避免移位溢出
+#define RECONNECT_MAX_SHIFT 16
 
 // ==================== TCP连接管理 ====================
 
@@ -18,6 +25,13 @@ int SDKManager::connectByTCP(const QString& ip, unsigned short port)
         return -1;
     }
     
+    // 重新指定设备时结束之前的重连
+    if (m_reconnectTimer)
+	{
+        m_reconnectTimer->stop();
+    }
+    m_reconnectAttempt = 0;
+
     // 设置IP和端口
     m_tcpClient->setIpAndPort(ip, port);
     
@@ -44,6 +58,18 @@ void SDKManager::disconnect()
         m_heartbeatCheckTimer->stop();
     }
     
+    // 主动断开不再重连，断线期间保留的数据和任务一并结束
+    m_wantConnected = false;
+    if (m_reconnectTimer)
+	{
+        m_reconnectTimer->stop();
+    }
+    m_tcpClient->setKeepQueueOnDisconnect(false);
+    if (m_outageTimer.isValid())
+	{
+        abortOutage("Disconnected");
+    }
+    
     // 断开TCP连接
     m_tcpClient->disconnectFromHost();
 }
@@ -56,3 +82,99 @@ bool SDKManager::isConnected() const
     return false;
 }
 
+
+void SDKManager::setAutoReconnect(bool enable, int minDelayMs /*= RECONNECT_MIN_DELAY_MS*/, int maxDelayMs /*= RECONNECT_MAX_DELAY_MS*/)
+{
+    m_autoReconnect = enable;
+    m_reconnectMinMs = qMax(1, minDelayMs);
+    m_reconnectMaxMs = qMax(m_reconnectMinMs, maxDelayMs);
+
+    if (!m_tcpClient)
+	{
+        return;
+    }
+    m_tcpClient->setKeepQueueOnDisconnect(enable && m_wantConnected);
+
+    if (!enable && m_outageTimer.isValid())
+	{
+        m_reconnectTimer->stop();
+        m_wantConnected = false;
+        abortOutage("Connection lost");
+    }
+}
+
+// ==================== 断线重连 ====================
+
+void SDKManager::scheduleReconnect()
+{
+    if (!m_outageTimer.isValid())
+	{
+        // 刚断线：图像任务暂停（窗口保留），未应答的请求由各自的超时处理
+        m_outageTimer.start();
+        // 传输层断线时已丢弃图像帧，这里只剩控制/运动命令；图像帧重连后由窗口重发，两者不重复计数
+        m_outageQueuedBytes = m_tcpClient->pendingBytes();
+        m_reconnectAttempt = 0;
+        if (m_retransTimer)
+		{
+            m_retransTimer->stop();
+        }
+        m_metrics->counter("connection.outages").add();
+    }
+
+    // 带抖动的指数退避：[delay/2, delay]，多个客户端同时断线时错开重连
+    int shift = qMin(m_reconnectAttempt, RECONNECT_MAX_SHIFT);
+    qint64 delay = qMin<qint64>(m_reconnectMaxMs, static_cast<qint64>(m_reconnectMinMs) << shift);
+    delay = delay / 2 + QRandomGenerator::global()->bounded(static_cast<int>(delay / 2) + 1);
+    m_reconnectAttempt++;
+    m_reconnectTimer->start(static_cast<int>(delay));
+
+    LOG_WARN(QString(u8"motion_moudle_sdk %1 connection lost, reconnect #%2 in %3 ms").arg(m_name).arg(m_reconnectAttempt).arg(delay));
+    sendEvent(EVENT_TYPE_GENERAL, m_reconnectAttempt, "motion_sdk_moudle reconnecting_2_dev", static_cast<double>(delay));
+}
+
+void SDKManager::finishOutage()
+{
+    qint64 outageNs = m_outageTimer.nsecsElapsed();
+    m_outageTimer.invalidate();
+    m_reconnectAttempt = 0;
+
+    // 未确认的图像帧（含断线时仍在发送队列中的）从窗口起始序号按序重发
+    qint64 requeuedBytes = 0;
+    int requeuedFrames = 0;
+    if (m_imgJob.active)
+	{
+        requeuedFrames = m_imgJob.window.requeueAll(&requeuedBytes);
+    }
+
+    m_metrics->histogram("connection.outage").record(outageNs);
+    m_metrics->counter("connection.reconnects").add();
+    m_metrics->counter("connection.replayed_bytes").add(m_outageQueuedBytes + requeuedBytes);
+    m_metrics->counter("connection.replayed_frames").add(requeuedFrames);
+
+    LOG_INFO(QString(u8"motion_moudle_sdk %1 reconnected after %2 ms, replay %3 queued bytes, %4 image frames")
+        .arg(m_name).arg(outageNs / 1000000).arg(m_outageQueuedBytes).arg(requeuedFrames));
+    sendEvent(EVENT_TYPE_GENERAL, 0, "motion_sdk_moudle reconnected_2_dev", static_cast<double>(outageNs / 1000000));
+    m_outageQueuedBytes = 0;
+
+    if (m_imgJob.active)
+	{
+        m_retransTimer->start();
+        onPumpImagePackets();
+    }
+}
+
+void SDKManager::abortOutage(const char* reason)
+{
+    m_outageTimer.invalidate();
+    m_outageQueuedBytes = 0;
+    m_reconnectAttempt = 0;
+
+    if (m_imgJob.active)
+	{
+        finishImageJob(false, reason);
+    }
+    if (m_pendingRequests)
+	{
+        m_pendingRequests->failAll(QStringLiteral("disconnected"));
+    }
+}
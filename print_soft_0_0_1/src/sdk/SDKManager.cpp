@@ -7,25 +7,72 @@
 #include "SDKManager.h"
 #include "TcpClient.h"
 #include "ProtocolPrint.h"
+#include "ImagePacketizer.h"
+#include "PendingRequestTable.h"
 #include "CLogManager.h"
+#include "MetricsRegistry.h"
+#include "TraceRecorder.h"
 #include <QTimer>
 #include "spdlog/spdlog.h"
 
-// ==================== 单例实现 ====================
+// ==================== 日志转发 ====================
+
+/**
+ * @brief 把警告及以上的日志以EVENT_TYPE_LOG事件转给上层日志栏
+ * @details 在日志线程中回调，与写文件共用同一队列；上层收到后不应再写入日志，否则同一条日志会写两次。
+ *          日志为进程共用，只转给默认会话
+ */
+class SdkLogForwarder : public CLogOutputCallBack
+{
+public:
+	virtual void outputLog(const LogData_t& logData)
+	{
+		if (logData.level < ELogWarning || !SDKManager::instance()->isEventSubscribed(EVENT_TYPE_LOG))
+		{
+			return;
+		}
+		QString msg = QString("[%1] %2").arg(logData.strModule).arg(logData.strLog);
+		SDKManager::instance()->sendEvent(EVENT_TYPE_LOG, logData.level, msg.toUtf8().constData());
+	}
+};
+
+static SdkLogForwarder s_logForwarder;
+
+// ==================== 默认会话 ====================
 
 SDKManager* SDKManager::instance() {
-    static SDKManager manager;
+    static SDKManager manager(SDK_DEFAULT_SESSION_NAME);
     return &manager;
 }
 
+bool SDKManager::isDefaultSession() const {
+    // 不调用instance()：其他会话可能在默认会话析构后才释放
+    return !m_ownMetrics && m_name == SDK_DEFAULT_SESSION_NAME;
+}
+
 
 // ==================== 构造和析构 ====================
 
-SDKManager::SDKManager() 
-    : m_initialized(false)
+SDKManager::SDKManager(const QString& name /*= QString()*/, std::unique_ptr<MetricsRegistry> metrics /*= nullptr*/)
+    : m_name(name)
+    , m_ownMetrics(std::move(metrics))
+    , m_metrics(m_ownMetrics ? m_ownMetrics.get() : MetricsRegistry::global())
+    , m_initialized(false)
     , m_heartbeatTimeout(0) 
+    , m_autoReconnect(true)
+    , m_reconnectMinMs(RECONNECT_MIN_DELAY_MS)
+    , m_reconnectMaxMs(RECONNECT_MAX_DELAY_MS)
+    , m_wantConnected(false)
+    , m_reconnectAttempt(0)
+    , m_outageQueuedBytes(0)
+    , m_eventCallback(nullptr)
+    , m_sessionCallback(nullptr)
+    , m_callbackUserData(nullptr)
+    , m_eventMask(SDK_EVENT_MASK_DEFAULT)
 {
-    // 私有构造函数
+    // 热路径指标在构造时取得
+    m_resentFrames = &m_metrics->counter("image.retransmit_frames");
+    m_resentBytes = &m_metrics->counter("image.retransmit_bytes");
 }
 
 SDKManager::~SDKManager() {
@@ -50,24 +97,35 @@ bool SDKManager::init(const QString& log_dir)
 	{
 		CLogManager::getInstance()->startLog(log_dir);
 	}
-	LOG_INFO(QString(u8"motion_moudle_sdk_init"));
+	if (isDefaultSession())
+	{
+		CLogManager::getInstance()->setLogOutputCallBack(&s_logForwarder);
+	}
+	LOG_INFO(QString(u8"motion_moudle_sdk_init %1").arg(m_name));
 
 
-    // 创建TCP客户端和协议处理器
-    m_tcpClient = std::make_unique<TcpClient>();
-    m_protocol = std::make_unique<ProtocolPrint>();
+    // 创建TCP客户端和协议处理器，收发统计写入本会话的注册表
+    m_tcpClient = std::make_unique<TcpClient>(nullptr, TcpClient::defaultBackend(), m_metrics);
+    m_protocol = std::make_unique<ProtocolPrint>(nullptr, m_metrics);
+	LOG_INFO(QString(u8"motion_moudle_sdk transport backend: %1")
+		.arg(m_tcpClient->backend() == Transport_Epoll ? "epoll" : "qt"));
     
     // 连接TCP客户端信号
-    connect(m_tcpClient.get(), &TcpClient::sigNewData, this, &SDKManager::onRecvData);
+    // 分帧、校验和解码在socket线程完成，应用线程只接收解码后的结果
+    connect(m_tcpClient.get(), &TcpClient::sigNewData, this, &SDKManager::onRecvData, Qt::DirectConnection);
+    // 重连后不能把新连接的数据当作上一连接残留半帧的后续
+    connect(m_tcpClient.get(), &TcpClient::sigConnectionOpened, m_protocol.get(), &ProtocolPrint::resetDecoder, Qt::DirectConnection);
     connect(m_tcpClient.get(), &TcpClient::sigError, this, &SDKManager::onTcpError);
     connect(m_tcpClient.get(), &TcpClient::sigSocketStateChanged, this, &SDKManager::onStateChanged);
+    connect(m_tcpClient.get(), &TcpClient::sigBytesWritten, this, &SDKManager::onPumpImagePackets);
+    connect(m_tcpClient.get(), &TcpClient::sigSendReady, this, &SDKManager::onPumpImagePackets);
     
     // 连接协议处理器信号
-    connect(m_protocol.get(), &ProtocolPrint::SigHeartBeat, this, &SDKManager::onHeartbeat);
-    connect(m_protocol.get(), &ProtocolPrint::SigCmdReply, this, &SDKManager::onCmdReply);
-	connect(m_protocol.get(), &ProtocolPrint::SigPackFailRetransport, this, &SDKManager::onHeartbeat);
-	connect(m_protocol.get(), &ProtocolPrint::SigHandleFunOper1, this, &SDKManager::onHandleRecvFunOper);
-	connect(m_protocol.get(), &ProtocolPrint::SigHandleFunOper2, this, &SDKManager::onHandleRecvDataOper);
+    // 解码结果在socket线程发出，每次接收排队一次
+    connect(m_protocol.get(), &ProtocolPrint::SigResultBatch, this, &SDKManager::onProtocolResults, Qt::QueuedConnection);
+
+	// 请求/应答关联表
+	m_pendingRequests = std::make_unique<PendingRequestTable>(nullptr, m_metrics);
 
     
     // 设置协议的串口（实际上是TCP客户端）
@@ -82,6 +140,19 @@ bool SDKManager::init(const QString& log_dir)
     
     connect(m_heartbeatSendTimer.get(), &QTimer::timeout, this, &SDKManager::onSendHeartbeat);
     connect(m_heartbeatCheckTimer.get(), &QTimer::timeout, this, &SDKManager::onCheckHeartbeat);
+
+    // 图像传输期间周期检查超时未确认的帧
+    m_retransTimer = std::make_unique<QTimer>();
+    m_retransTimer->setInterval(RETRANS_TIMEOUT_MS / 4);
+    connect(m_retransTimer.get(), &QTimer::timeout, this, &SDKManager::onPumpImagePackets);
+
+    // 断线后按退避延时重连
+    m_reconnectTimer = std::make_unique<QTimer>();
+    m_reconnectTimer->setSingleShot(true);
+    connect(m_reconnectTimer.get(), &QTimer::timeout, this, [this]() {
+        m_metrics->counter("connection.reconnect_attempts").add();
+        m_tcpClient->connectToHost();
+    });
     
     m_initialized = true;
     return true;
@@ -91,6 +162,11 @@ void SDKManager::release() {
     if (!m_initialized) {
         return;  // 未初始化，无需释放
     }
+
+	if (isDefaultSession())
+	{
+		CLogManager::getInstance()->setLogOutputCallBack(nullptr);
+	}
     
     // 停止心跳定时器
     if (m_heartbeatSendTimer && m_heartbeatSendTimer->isActive()) {
@@ -100,72 +176,209 @@ void SDKManager::release() {
         m_heartbeatCheckTimer->stop();
     }
     
-    // 断开连接
+    // 断开连接，不再重连
+    m_wantConnected = false;
+    m_outageTimer.invalidate();
+    if (m_reconnectTimer) {
+        m_reconnectTimer->stop();
+    }
     if (m_tcpClient) {
+        m_tcpClient->setKeepQueueOnDisconnect(false);
         m_tcpClient->disconnectFromHost();
     }
     
     // 清理资源
+    m_imgJob = ImageSendJob();
+    m_imgPacketizer.reset();
+    m_pendingRequests.reset();
+    m_retransTimer.reset();
+    m_reconnectTimer.reset();
     m_heartbeatSendTimer.reset();
     m_heartbeatCheckTimer.reset();
-    m_protocol.reset();
+    // 先停socket线程，再释放在该线程中解码的协议对象
     m_tcpClient.reset();
+    m_protocol.reset();
     
     m_initialized = false;
 }
 
 // ==================== 辅助函数 ====================
 
-//fc + dataArr
-void SDKManager::sendCommand(int code, const QByteArray& data) 
+// 根据功能码选择发送通道：打印启停和心跳走控制通道，打印数据走批量通道，其余为运动通道
+static ESendLane laneOfFunCode(ProtocolPrint::FunCode fc)
 {
-    if (!m_tcpClient) 
+	switch (fc)
 	{
-        return;
-    }
-    
-	// 使用协议打包数据
-	// 根据FunCode确定ECmdType
-	auto fc = static_cast<ProtocolPrint::FunCode>(code);
-	ProtocolPrint::ECmdType ct = ProtocolPrint::ECmdType::CtrlCmd; // 默认为控制命令
+	case ProtocolPrint::Ctrl_StartPrint:
+	case ProtocolPrint::Ctrl_PasusePrint:
+	case ProtocolPrint::Ctrl_ContinuePrint:
+	case ProtocolPrint::Ctrl_StopPrint:
+	case ProtocolPrint::Get_Breath:
+		return Lane_Control;
+	default:
+		break;
+	}
 
-	// 根据FunCode范围确定命令类型
-	if (fc >= ProtocolPrint::SetParam_CleanPos && fc <= ProtocolPrint::SetParam_End)
+	if (fc >= ProtocolPrint::Print_AxisMovePos && fc <= ProtocolPrint::Print_End)
 	{
-		ct = ProtocolPrint::ECmdType::SetParamCmd;
+		return Lane_Bulk;
 	}
-	else if (fc >= ProtocolPrint::Get_AxisPos && fc <= ProtocolPrint::Get_End)
+	return Lane_Motion;
+}
+
+// 根据FunCode范围确定命令类型
+static ProtocolPrint::ECmdType cmdTypeOfFunCode(ProtocolPrint::FunCode fc)
+{
+	if (fc >= ProtocolPrint::SetParam_CleanPos && fc <= ProtocolPrint::SetParam_End)
 	{
-		ct = ProtocolPrint::ECmdType::GetCmd;
+		return ProtocolPrint::ECmdType::SetParamCmd;
 	}
-	else if (fc >= ProtocolPrint::Ctrl_StartPrint && fc <= ProtocolPrint::Ctrl_End)
+	else if (fc >= ProtocolPrint::Get_AxisPos && fc <= ProtocolPrint::Get_End)
 	{
-		ct = ProtocolPrint::ECmdType::CtrlCmd;
+		return ProtocolPrint::ECmdType::GetCmd;
 	}
 	else if (fc >= ProtocolPrint::Print_AxisMovePos && fc <= ProtocolPrint::Print_End)
 	{
-		ct = ProtocolPrint::ECmdType::PrintCommCmd;
+		return ProtocolPrint::ECmdType::PrintCommCmd;
 	}
+	return ProtocolPrint::ECmdType::CtrlCmd; // 默认为控制命令
+}
 
-	QByteArray packet = ProtocolPrint::GetSendDatagram(ct, fc, data);
+//fc + dataArr
+void SDKManager::sendCommand(int code, const QByteArray& data) 
+{
+	postCommand(code, data);
+}
+
+bool SDKManager::postCommand(int code, const QByteArray& data)
+{
+    if (!m_tcpClient) 
+	{
+        return false;
+    }
+    
+	TRACE_SCOPE("postCommand", "fun_code", code);
+	// 使用协议打包数据
+	auto fc = static_cast<ProtocolPrint::FunCode>(code);
+	QByteArray packet = ProtocolPrint::GetSendDatagram(cmdTypeOfFunCode(fc), fc, data);
     
     // 发送数据
-    m_tcpClient->sendData(packet);
-	LOG_INFO(QString(u8"lrz_motion_sdk print_protocol_moudle cur_send_data: %1").arg(QString(packet.toHex().toUpper())));
+    if (!m_tcpClient->sendData(packet, laneOfFunCode(fc)))
+	{
+		LOG_INFO(QString(u8"lrz_motion_sdk send_queue_full, drop cmd: 0x%1").arg(QString::number(code, 16).toUpper()));
+		sendEvent(EVENT_TYPE_ERROR, -1, "Send queue full");
+		return false;
+	}
+	// 整包16进制只在调试级别生成，发布版本编译期移除
+	LOG_DEBUG(QString(u8"lrz_motion_sdk print_protocol_moudle cur_send_data: %1").arg(QString(packet.toHex().toUpper())));
 
 	//std::shared_ptr<spdlog::logger> mylogger = spdlog::get("spdlog");
 	//mylogger->info( packet.toHex().toUpper());
 
-	sendEvent(EVENT_TYPE_SEND_MSG, 0, packet.toHex().toUpper().constData());
+	sendDataEvent(EVENT_TYPE_SEND_MSG, packet);
+	return true;
+}
 
+quint64 SDKManager::sendCommandAsync(int code, const QByteArray& data, CommandReplyCallback callback, int timeoutMs)
+{
+	auto fc = static_cast<ProtocolPrint::FunCode>(code);
+	int ct = cmdTypeOfFunCode(fc);
+
+	//应答在SDK线程的事件循环中处理，先发送再登记不会丢失应答
+	if (!m_pendingRequests || !postCommand(code, data))
+	{
+		CommandReply reply;
+		reply.cmdType = ct;
+		reply.funCode = code;
+		reply.error = QStringLiteral("send failed");
+		if (callback)
+		{
+			callback(reply);
+		}
+		return 0;
+	}
+	return m_pendingRequests->add(ct, code, timeoutMs, std::move(callback));
+}
+
+QFuture<CommandReply> SDKManager::sendCommandFuture(int code, const QByteArray& data, int timeoutMs)
+{
+	auto fc = static_cast<ProtocolPrint::FunCode>(code);
+	int ct = cmdTypeOfFunCode(fc);
+
+	if (!m_pendingRequests || !postCommand(code, data))
+	{
+		CommandReply reply;
+		reply.cmdType = ct;
+		reply.funCode = code;
+		reply.error = QStringLiteral("send failed");
+
+		QFutureInterface<CommandReply> failed;
+		failed.reportStarted();
+		failed.reportResult(reply);
+		failed.reportFinished();
+		return failed.future();
+	}
+	return m_pendingRequests->addFuture(ct, code, timeoutMs);
+}
+
+QJsonObject SDKManager::metricsSnapshot() const
+{
+	return m_metrics->snapshot();
+}
+
+void SDKManager::resetMetrics()
+{
+	m_metrics->reset();
+}
+
+void SDKManager::startTrace()
+{
+	TraceRecorder::start();
+}
+
+bool SDKManager::stopTrace(const QString& filePath)
+{
+	TraceRecorder::stop();
+	if (filePath.isEmpty())
+	{
+		return true;
+	}
+
+	quint64 dropped = TraceRecorder::droppedEvents();
+	if (dropped > 0)
+	{
+		LOG_WARN(QString(u8"lrz_motion_sdk trace buffer full, %1 events dropped").arg(dropped));
+	}
+	return TraceRecorder::exportToFile(filePath);
+}
+
+bool SDKManager::startCapture(const QString& filePath)
+{
+	if (!m_tcpClient)
+	{
+		return false;
+	}
+	return m_tcpClient->startCapture(filePath);
+}
+
+void SDKManager::stopCapture()
+{
+	if (m_tcpClient)
+	{
+		m_tcpClient->stopCapture();
+	}
 }
 
 //重发数据
 void SDKManager::sendCommand(const QByteArray& data /*= QByteArray()*/)
 {
 	// 重发失败数据
-	m_tcpClient->sendData(data);
-	sendEvent(EVENT_TYPE_SEND_MSG, 0, data.toHex().toUpper().constData());
+	if (!m_tcpClient->sendData(data))
+	{
+		sendEvent(EVENT_TYPE_ERROR, -1, "Send queue full");
+		return;
+	}
+	sendDataEvent(EVENT_TYPE_SEND_MSG, data);
 
 }
 
@@ -211,57 +424,100 @@ void SDKManager::sendCommand(int code, const MoveAxisPos& posData)
 	senddata[11] = posData.zPos >> 24 & 0xFF;
 
 
-	// 根据FunCode确定ECmdType
-	auto fc = static_cast<ProtocolPrint::FunCode>(code);
-	ProtocolPrint::ECmdType ct = ProtocolPrint::ECmdType::CtrlCmd; // 默认为控制命令
-
-	// 根据FunCode范围确定命令类型
-	if (fc >= ProtocolPrint::SetParam_CleanPos && fc <= ProtocolPrint::SetParam_End)
-	{
-		ct = ProtocolPrint::ECmdType::SetParamCmd;
-	}
-	else if (fc >= ProtocolPrint::Get_AxisPos && fc <= ProtocolPrint::Get_End)
-	{
-		ct = ProtocolPrint::ECmdType::GetCmd;
-	}
-	else if (fc >= ProtocolPrint::Ctrl_StartPrint && fc <= ProtocolPrint::Ctrl_End)
-	{
-		ct = ProtocolPrint::ECmdType::CtrlCmd;
-	}
-	else if (fc >= ProtocolPrint::Print_AxisMovePos && fc <= ProtocolPrint::Print_End)
-	{
-		ct = ProtocolPrint::ECmdType::PrintCommCmd;
-	}
-
-	// 使用协议打包数据
-	QByteArray packet = ProtocolPrint::GetSendDatagram(ct, fc, senddata);
-	m_tcpClient->sendData(packet);
-	sendEvent(EVENT_TYPE_SEND_MSG, 0, packet.toHex().toUpper().constData());
-
+	postCommand(code, senddata);
 }
 
 void SDKManager::sendEvent(SdkEventType type, int code, const char* message, double v1, double v2, double v3) 
 {
-    QMutexLocker lock(&g_callbackMutex);
+    if (!isEventSubscribed(type))
+	{
+        return;  // 没有回调订阅该事件
+    }
+
+    QMutexLocker lock(&m_callbackMutex);
     
-    if (!g_sdkCallback) 
+    if (!m_eventCallback && !m_sessionCallback) 
 	{
         return;  // 没有注册回调函数
     }
     
-    // 保存消息到全局缓冲区以确保生命周期
-    g_messageBuffer = QByteArray(message);
+    // 保存消息到会话缓冲区以确保生命周期
+    m_messageBuffer = QByteArray(message);
     
     // 构造事件结构
     SdkEvent event;
     event.type = type;
     event.code = code;
-    event.message = g_messageBuffer.constData();
+    event.message = m_messageBuffer.constData();
     event.value1 = v1;
     event.value2 = v2;
     event.value3 = v3;
+    event.data = nullptr;
+    event.dataLen = 0;
     
     // 调用回调函数
-    g_sdkCallback(&event);
+    dispatchEvent(event);
+}
+
+void SDKManager::sendDataEvent(SdkEventType type, const QByteArray& data)
+{
+    // 报文事件每帧触发，未订阅时连锁都不加
+    if (!isEventSubscribed(type))
+	{
+        return;
+    }
+
+    QMutexLocker lock(&m_callbackMutex);
+
+    if (!m_eventCallback && !m_sessionCallback)
+	{
+        return;
+    }
+
+    // data由调用方持有至回调返回，不拷贝也不转换格式
+    SdkEvent event;
+    event.type = type;
+    event.code = 0;
+    event.message = "";
+    event.value1 = 0.0;
+    event.value2 = 0.0;
+    event.value3 = 0.0;
+    event.data = reinterpret_cast<const unsigned char*>(data.constData());
+    event.dataLen = data.size();
+
+    dispatchEvent(event);
+}
+
+void SDKManager::dispatchEvent(const SdkEvent& event)
+{
+    if (m_sessionCallback)
+	{
+        // 默认会话对应C接口中的NULL句柄
+        SdkSessionHandle handle = isDefaultSession() ? nullptr : reinterpret_cast<SdkSessionHandle>(this);
+        m_sessionCallback(handle, &event, m_callbackUserData);
+    }
+	else
+	{
+        m_eventCallback(&event);
+    }
+}
+
+void SDKManager::setEventCallback(SdkEventCallback callback, quint32 eventMask)
+{
+    QMutexLocker lock(&m_callbackMutex);
+    m_eventCallback = callback;
+    m_sessionCallback = nullptr;
+    m_callbackUserData = nullptr;
+    m_eventMask.storeRelease(eventMask);
+}
+
+void SDKManager::setSessionEventCallback(SdkSessionEventCallback callback, void* userData, quint32 eventMask)
+{
+    // 返回后旧回调不会再被调用，调用方可以释放userData
+    QMutexLocker lock(&m_callbackMutex);
+    m_eventCallback = nullptr;
+    m_sessionCallback = callback;
+    m_callbackUserData = userData;
+    m_eventMask.storeRelease(eventMask);
 }
 
@@ -1,7 +1,7 @@
 ﻿/**
  * @file SDKManager.h
  * @brief SDK内部管理类头文件
- * @details 负责管理所有核心对象、通信和信号槽连接，采用单例模式
+ * @details 负责管理所有核心对象、通信和信号槽连接；每台设备一个会话对象，instance()为默认会话
  */
 
 #ifndef SDK_MANAGER_H
@@ -11,43 +11,100 @@
 #include <QObject>
 #include <QMutex>
 #include <QAbstractSocket>
+#include <QElapsedTimer>
+#include <QAtomicInteger>
+#include <QImage>
+#include <QVector>
+#include <QJsonObject>
 #include <memory>
+#include "PrintSource.h"
+#include "RetransmitWindow.h"
+#include "MetricsRegistry.h"
+
+//默认会话名，SDKSessionManager不会创建同名会话
+#define SDK_DEFAULT_SESSION_NAME "default"
+
+//断线自动重连的默认退避范围（毫秒）
+#define RECONNECT_MIN_DELAY_MS 500
+#define RECONNECT_MAX_DELAY_MS 30000
 
 // 前向声明
 class TcpClient;
 class ProtocolPrint;
+class ImagePacketizer;
+class PendingRequestTable;
 class QTimer;
+struct ProtocolResult;
 
 //extern struct PackParam;
 
+/**
+ * @brief 图像发送任务状态
+ */
+struct ImageSendJob
+{
+	std::unique_ptr<PrintSource> source;	///< 数据源（分包器从其游标按需读取）
+	QImage image;						///< 解码模式下持有像素数据，source直接引用其内存
+	QElapsedTimer timer;				///< 任务耗时
+	QByteArray pendingFrame;			///< 因发送队列满未能入队的帧，下次优先发送
+	quint32 pendingSeq = 0;				///< pendingFrame的序号
+	RetransmitWindow window;			///< 已发送未确认的帧，只重发被否认或超时的帧
+	int totalPackets = 0;				///< 总分包数
+	quint16 width = 0;					///< 图像宽
+	quint16 height = 0;					///< 图像高
+	bool active = false;				///< 任务进行中
+};
+
 // 导入事件类型定义
 #include "motionControlSDK.h"
 // 导入事件类型定义
 
-// 全局回调相关（在SDKCallback.cpp中定义）
-extern SdkEventCallback g_sdkCallback;
-extern QMutex g_callbackMutex;
-extern QByteArray g_messageBuffer;
-
 
 /**
  * @class SDKManager
- * @brief SDK内部管理类
+ * @brief SDK内部管理类（一台设备的会话）
  * 
  * 职责：
  * - 管理TCP客户端和协议处理器
  * - 提供设备连接和控制接口
  * - 处理信号槽连接和事件分发
  * - 管理心跳机制
+ *
+ * 每个会话有独立的发送队列、请求表、事件回调和指标注册表，socket I/O在IoThreadPool的共享线程中进行。
+ * 多设备时由SDKSessionManager创建会话；instance()为默认会话，供单设备的C接口和motionControlSDK使用。
  */
 class SDKManager : public QObject {
     Q_OBJECT
 
 public:
     /**
-     * @brief 获取单例实例
+     * @brief 获取默认会话（指标写入全局注册表）
      */
     static SDKManager* instance();
+
+    /**
+     * @brief 构造会话，须在有Qt事件循环的线程中创建和使用
+     * @param name 会话名（日志和指标快照中区分设备）
+     * @param metrics 本会话的指标注册表，为空时使用全局注册表
+     */
+    explicit SDKManager(const QString& name = QString(), std::unique_ptr<MetricsRegistry> metrics = nullptr);
+
+    ~SDKManager();
+
+    /**
+     * @brief 会话名
+     */
+    const QString& name() const { return m_name; }
+
+    /**
+     * @brief 本会话的指标注册表
+     */
+    MetricsRegistry* metrics() const { return m_metrics; }
+
+    /**
+     * @brief 是否为instance()返回的默认会话
+     */
+    bool isDefaultSession() const;
     
     // ==================== 生命周期管理 ====================
     
@@ -83,6 +140,22 @@ public:
      * @return true=已连接, false=未连接
      */
     bool isConnected() const;
+
+    /**
+     * @brief 设置断线自动重连（默认开启）
+     * @details 连接建立后意外断开时按带抖动的指数退避重连；尚未写入socket的命令保留，
+     *          重连后按原顺序发送，未确认的图像帧从窗口起始序号重发，图像任务继续。
+     *          断线前已写入socket的命令不重发（设备是否已执行无法确定），等待应答的请求按各自超时失败
+     * @param enable 是否自动重连，关闭时正在进行的重连立即结束
+     * @param minDelayMs 首次重连延时
+     * @param maxDelayMs 最大重连延时
+     */
+    void setAutoReconnect(bool enable, int minDelayMs = RECONNECT_MIN_DELAY_MS, int maxDelayMs = RECONNECT_MAX_DELAY_MS);
+
+    /**
+     * @brief 是否正处于意外断线后的重连中
+     */
+    bool isReconnecting() const { return m_outageTimer.isValid(); }
     
     // ==================== 运动控制（实现在SDKMotion.cpp） ====================
     
@@ -154,6 +227,22 @@ public:
 	 * @return 目标位置（微米单位）
 	 */
 	MoveAxisPos getCurrentPosition() const;
+
+	/**
+	 * @brief 单轴位置转换为协议数据（4字节，小端序，微米）
+	 * @param position 位置值（微米单位）
+	 * @param axis 轴标识（'X', 'Y', 'Z'），用于日志
+	 * @return 协议数据
+	 */
+	static QByteArray positionToByteArray(quint32 position, char axis);
+
+	/**
+	 * @brief 完整位置转换为协议数据（12字节：X(4)+Y(4)+Z(4)，小端序，微米）
+	 * @param pos 位置数据（微米单位）
+	 * @return 协议数据
+	 */
+	static QByteArray fullPositionToByteArray(const MoveAxisPos& pos);
+
     // ==================== 打印控制（实现在SDKPrint.cpp） ====================
     
     /**
@@ -189,9 +278,10 @@ public:
     /**
      * @brief 加载图像数据
      * @param imagePath 图像文件路径
+     * @param mode 传输方式
      * @return 0=成功, -1=失败
      */
-    int loadImageData(const QString& imagePath);
+    int loadImageData(const QString& imagePath, ImageTransferMode mode = IMAGE_TRANSFER_RAW);
 
 	// ==================== 打印参数控制（实现在SDKPrintParam.cpp） ====================
 
@@ -231,6 +321,59 @@ public:
 	 * @param data 附加数据
 	 */
 	void sendCommand(const QByteArray& data = QByteArray());
+
+	/**
+	 * @brief 发送协议命令，应答/超时/失败时回调
+	 * @param code 功能码
+	 * @param data 附加数据
+	 * @param callback 完成回调
+	 * @param timeoutMs 应答超时时间（毫秒）
+	 * @return 请求id，0表示未能发送
+	 */
+	quint64 sendCommandAsync(int code, const QByteArray& data, CommandReplyCallback callback, int timeoutMs);
+
+	/**
+	 * @brief 发送协议命令，返回应答/超时/失败时完成的QFuture
+	 * @param code 功能码
+	 * @param data 附加数据
+	 * @param timeoutMs 应答超时时间（毫秒）
+	 */
+	QFuture<CommandReply> sendCommandFuture(int code, const QByteArray& data, int timeoutMs);
+
+	/**
+	 * @brief 当前运行指标快照（收发帧数/字节、队列深度、解析错误、重发、命令往返时间）
+	 * @return JSON对象，格式见MetricsRegistry::snapshot
+	 */
+	QJsonObject metricsSnapshot() const;
+
+	/**
+	 * @brief 清零所有运行指标
+	 */
+	void resetMetrics();
+
+	/**
+	 * @brief 开始记录命令流水线时间线（清空之前的记录）
+	 */
+	void startTrace();
+
+	/**
+	 * @brief 停止记录并导出为Chrome trace-event JSON
+	 * @param filePath 输出文件路径，为空时只停止不导出
+	 * @return true=成功
+	 */
+	bool stopTrace(const QString& filePath);
+
+	/**
+	 * @brief 开始抓取socket原始收发数据，供wire_replay离线回放
+	 * @param filePath 输出文件路径
+	 * @return true=成功
+	 */
+	bool startCapture(const QString& filePath);
+
+	/**
+	 * @brief 结束抓包
+	 */
+	void stopCapture();
     
     /**
      * @brief 发送事件到回调函数
@@ -244,11 +387,46 @@ public:
     void sendEvent(SdkEventType type, int code, const char* message, 
                    double v1 = 0.0, double v2 = 0.0, double v3 = 0.0);
 
+	/**
+	 * @brief 发送携带原始报文的事件（SEND_MSG/RECV_MSG），由使用方自行格式化
+	 * @param type 事件类型
+	 * @param data 原始报文，未订阅该类型时不做任何处理
+	 */
+	void sendDataEvent(SdkEventType type, const QByteArray& data);
+
+	/**
+	 * @brief 是否有回调订阅了该事件类型
+	 */
+	bool isEventSubscribed(SdkEventType type) const
+	{
+		return (m_eventMask.loadAcquire() & SDK_EVENT_MASK(type)) != 0;
+	}
+
+	/**
+	 * @brief 注册本会话的事件回调（替换之前注册的回调）
+	 * @param callback 回调函数，为空时取消
+	 * @param eventMask 订阅的事件类型，SDK_EVENT_MASK(type)按位组合
+	 */
+	void setEventCallback(SdkEventCallback callback, quint32 eventMask);
+
+	/**
+	 * @brief 注册本会话的事件回调，回调参数带会话句柄和用户数据（替换之前注册的回调）
+	 * @param callback 回调函数，为空时取消
+	 * @param userData 原样传给回调
+	 * @param eventMask 订阅的事件类型
+	 */
+	void setSessionEventCallback(SdkSessionEventCallback callback, void* userData, quint32 eventMask);
+
+	/**
+	 * @brief 修改订阅的事件类型，不改变回调
+	 */
+	void setEventMask(quint32 eventMask) { m_eventMask.storeRelease(eventMask); }
+
 private slots:
     // ==================== 信号处理（实现在SDKCallback.cpp） ====================
     
     /**
-     * @brief 接收到数据
+     * @brief 接收到数据（在socket线程中直接调用，解码结果成批投递到onProtocolResults）
      */
     void onRecvData(QByteArray data);
     
@@ -285,7 +463,13 @@ private slots:
 	/**
 	 * @brief 失败操作命令重发
 	 */
-	void onFaileHandleReTransport(QByteArray& arr);
+	void onFaileHandleReTransport(const QByteArray& arr);
+
+	/**
+	 * @brief 打印数据帧确认/否认（只更新重传窗口，由调用方续发分包）
+	 * @return 有进行中的图像任务
+	 */
+	bool onPrintDataAck(quint32 seq, bool ok);
 
 	/**
 	 * @brief 处理功能操作指令
@@ -297,12 +481,18 @@ private slots:
 	 */
 	void onHandleRecvDataOper(int code, const MoveAxisPos& pos);
 
+	/**
+	 * @brief 继续生成并发送图像分包（socket写出数据或发送队列回落时触发）
+	 */
+	void onPumpImagePackets();
+
 
 private:
     /**
-     * @brief 私有构造函数（单例模式）
+     * @brief 分发协议线程解码出的一批结果（应用线程）
+     * @details 同一批中的多个打印数据确认只续发一次分包
      */
-    SDKManager();
+    void onProtocolResults(const QVector<ProtocolResult>& results);
     
     // ==================== PackParam处理辅助方法 ====================
     
@@ -329,11 +519,42 @@ private:
      * @param packData 数据包参数
      */
     void handlePrintCommCmdResponse(const PackParam& packData);
-    
+
     /**
-     * @brief 析构函数
+     * @brief 打包并发送协议命令
+     * @param code 功能码
+     * @param data 附加数据
+     * @return false=未初始化或发送队列满
      */
-    ~SDKManager();
+    bool postCommand(int code, const QByteArray& data);
+
+    /**
+     * @brief 结束当前图像发送任务并上报结果
+     * @param ok 是否全部入队
+     * @param reason 失败原因
+     */
+    void finishImageJob(bool ok, const char* reason = nullptr);
+
+    /**
+     * @brief 意外断线：进入断线状态（首次）并安排下一次重连
+     */
+    void scheduleReconnect();
+
+    /**
+     * @brief 重连成功：恢复图像传输并记录断线时长和补发数据量
+     */
+    void finishOutage();
+
+    /**
+     * @brief 放弃重连：结束图像任务，未应答的请求全部失败
+     * @param reason 失败原因
+     */
+    void abortOutage(const char* reason);
+
+    /**
+     * @brief 调用已注册的回调（调用方持有m_callbackMutex且已确认有回调）
+     */
+    void dispatchEvent(const SdkEvent& event);
     
     // 禁止拷贝和赋值
     SDKManager(const SDKManager&) = delete;
@@ -341,11 +562,15 @@ private:
 
     // ==================== 成员变量 ====================
     
+    QString m_name;                                 ///< 会话名
+    std::unique_ptr<MetricsRegistry> m_ownMetrics;  ///< 本会话独占的指标注册表（默认会话为空）
+    MetricsRegistry* m_metrics;                     ///< 本会话的指标注册表
     bool m_initialized;                             ///< 初始化标志
     std::unique_ptr<TcpClient> m_tcpClient;         ///< TCP客户端
     std::unique_ptr<ProtocolPrint> m_protocol;      ///< 协议处理器
     std::unique_ptr<QTimer> m_heartbeatSendTimer;   ///< 心跳发送定时器
     std::unique_ptr<QTimer> m_heartbeatCheckTimer;  ///< 心跳检查定时器
+    std::unique_ptr<QTimer> m_retransTimer;         ///< 图像帧超时重发检查定时器
     QMutex m_heartbeatMutex;                        ///< 心跳互斥锁
     int m_heartbeatTimeout;                         ///< 心跳超时计数
 
@@ -354,6 +579,29 @@ private:
 
 	PackParam m_curParam;							/// 
 
+	std::unique_ptr<PendingRequestTable> m_pendingRequests;	///< 已发送未应答的请求
+	std::unique_ptr<ImagePacketizer> m_imgPacketizer;	///< 图像流式分包器（缓冲池跨任务复用）
+	ImageSendJob m_imgJob;							///< 当前图像发送任务
+
+	bool m_autoReconnect;							///< 断线自动重连
+	int m_reconnectMinMs;							///< 首次重连延时
+	int m_reconnectMaxMs;							///< 最大重连延时
+	bool m_wantConnected;							///< 已建立过连接且未主动断开，意外断线时需要重连
+	int m_reconnectAttempt;							///< 本次断线已重连次数
+	std::unique_ptr<QTimer> m_reconnectTimer;		///< 重连延时定时器（单次）
+	QElapsedTimer m_outageTimer;					///< 断线时长，有效表示正处于断线重连中
+	qint64 m_outageQueuedBytes;						///< 断线时发送队列中保留的字节数
+
+	MetricCounter* m_resentFrames;					///< image.retransmit_frames
+	MetricCounter* m_resentBytes;					///< image.retransmit_bytes
+
+	QMutex m_callbackMutex;							///< 保护事件回调和消息缓冲
+	SdkEventCallback m_eventCallback;				///< 事件回调
+	SdkSessionEventCallback m_sessionCallback;		///< 带会话句柄的事件回调（与m_eventCallback二选一）
+	void* m_callbackUserData;						///< m_sessionCallback的用户数据
+	QByteArray m_messageBuffer;						///< 回调期间消息文本的存储
+	QAtomicInteger<quint32> m_eventMask;			///< 已订阅的事件类型，SDK_EVENT_MASK(type)按位组合
+
 
 };
 
@@ -65,7 +65,7 @@ MoveAxisPos SDKManager::getCurrentPosition() const
  * 数据流程：
  * 1. 设备发送位置数据（协议格式）
  * 2. ProtocolPrint解析为MoveAxisPos（微米）
- * 3. 通过信号SigHandleFunOper2传递到这里
+ * 3. 随SigResultBatch成批投递，由onProtocolResults分发到这里
  * 4. 更新m_curAxisData
  * 5. 通过sendEvent发送到上层（转换为mm）
  */
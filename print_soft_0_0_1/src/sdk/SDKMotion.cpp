@@ -26,7 +26,7 @@
   * - 单位：微米
   * - 范围：0 ~ 4294967295 微米（约4294mm）
   */
-static QByteArray positionToByteArray(quint32 position, char axis)
+QByteArray SDKManager::positionToByteArray(quint32 position, char axis)
 {
 	QByteArray data;
 	QDataStream stream(&data, QIODevice::WriteOnly);
@@ -35,17 +35,11 @@ static QByteArray positionToByteArray(quint32 position, char axis)
 	// 写入位置（4字节，大端序）
 	stream << position;
 
-	// 转换为毫米用于日志
-	double pos_mm = static_cast<double>(position) / 1000.0;
-
-	LOG_INFO(QString(u8"%1轴 位置数据: %2 μm (%3 mm)")
-		.arg(axis)
-		.arg(position)
-		.arg(pos_mm, 0, 'f', 3));
+	// 每次下发都会调用，只在调试等级输出，参数在等级判断通过后才构造
+	LOGB_DEBUG(u8"%1轴 位置数据: %2 μm", axis, position);
 
 	// 打印十六进制（用于调试）
-	QString hex = data.toHex(' ').toUpper();
-	LOG_INFO(QString(u8"%1轴 协议数据(Hex): %2").arg(axis).arg(hex));
+	LOG_DEBUG(QString(u8"%1轴 协议数据(Hex): %2").arg(axis).arg(QString(data.toHex(' ').toUpper())));
 
 	return data;
 }
@@ -60,7 +54,7 @@ static QByteArray positionToByteArray(quint32 position, char axis)
  * - Byte 4-7:  Y坐标（4字节无符号整数，大端序，微米）
  * - Byte 8-11: Z坐标（4字节无符号整数，大端序，微米）
  */
-static QByteArray fullPositionToByteArray(const MoveAxisPos& pos)
+QByteArray SDKManager::fullPositionToByteArray(const MoveAxisPos& pos)
 {
 	QByteArray data;
 	QDataStream stream(&data, QIODevice::WriteOnly);
@@ -71,18 +65,10 @@ static QByteArray fullPositionToByteArray(const MoveAxisPos& pos)
 	stream << pos.yPos;
 	stream << pos.zPos;
 
-	// 转换为毫米用于日志
-	double x_mm, y_mm, z_mm;
-	pos.toMillimeters(x_mm, y_mm, z_mm);
-
-	LOG_INFO(QString(u8"完整位置 转换为协议数据:"));
-	LOG_INFO(QString(u8"  X = %1 mm (%2 μm)").arg(x_mm, 0, 'f', 3).arg(pos.xPos));
-	LOG_INFO(QString(u8"  Y = %1 mm (%2 μm)").arg(y_mm, 0, 'f', 3).arg(pos.yPos));
-	LOG_INFO(QString(u8"  Z = %1 mm (%2 μm)").arg(z_mm, 0, 'f', 3).arg(pos.zPos));
+	LOGB_DEBUG(u8"完整位置 转换为协议数据: X = %1 μm, Y = %2 μm, Z = %3 μm", pos.xPos, pos.yPos, pos.zPos);
 
 	// 打印十六进制（用于调试）
-	QString hex = data.toHex(' ').toUpper();
-	LOG_INFO(QString(u8"完整位置 协议数据(12字节 Hex): %1").arg(hex));
+	LOG_DEBUG(QString(u8"完整位置 协议数据(12字节 Hex): %1").arg(QString(data.toHex(' ').toUpper())));
 
 	return data;
 }
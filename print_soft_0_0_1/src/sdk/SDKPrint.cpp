@@ -7,9 +7,13 @@
 #include "SDKManager.h"
 #include "TcpClient.h"
 #include "ProtocolPrint.h"
+#include "ImagePacketizer.h"
+#include "MetricsRegistry.h"
 
 #include <QFile>
 #include <QImage>
+#include <QImageReader>
+#include "utils.h"
 
 // ==================== 打印控制 ====================
 
@@ -68,32 +72,19 @@ int SDKManager::resetPrint()
     return 0;
 }
 
-int SDKManager::loadImageData(const QString& imagePath) 
+int SDKManager::loadImageData(const QString& imagePath, ImageTransferMode mode /*= IMAGE_TRANSFER_RAW*/) 
 {
     if (!isConnected()) 
 	{
         return -1;
     }
-    
-    // 加载图像文件
-    QImage img(imagePath);
-    if (img.isNull()) 
-	{
-        sendEvent(EVENT_TYPE_ERROR, -1, "Failed to load image");
-        return -1;
-    }
-    
-    // 读取原始文件数据
-    QFile file(imagePath);
-    if (!file.open(QIODevice::ReadOnly)) 
+
+    if (m_imgJob.active)
 	{
-        sendEvent(EVENT_TYPE_ERROR, -1, "Failed to open image file");
+        sendEvent(EVENT_TYPE_ERROR, -1, "Image transfer in progress");
         return -1;
     }
     
-    QByteArray rawData = file.readAll().toHex();
-    file.close();
-    
     // 根据文件扩展名确定图像类型
     quint8 imgType = 0x01; // 默认JPG
     if (imagePath.endsWith(".png", Qt::CaseInsensitive)) 
@@ -104,29 +95,186 @@ int SDKManager::loadImageData(const QString& imagePath)
 	{
         imgType = 0x03;  // BMP
     } 
-	else if (imagePath.endsWith(".raw", Qt::CaseInsensitive)) 
+	else if (imagePath.endsWith(".raw", Qt::CaseInsensitive) || imagePath.endsWith(".bin", Qt::CaseInsensitive)) 
 	{
-        imgType = 0x04;  // RAW
+        imgType = 0x04;  // RAW（已光栅化数据，无文件头）
     }
-    
-    // 使用协议打包图像数据
-    // 图像会被分包成多个数据包
-    QList<QByteArray> packets = ProtocolPrint::GetSendImgDatagram(
-        img.width(), img.height(), imgType, rawData);
-    
-    // 发送所有数据包
-    for (const auto& packet : packets) 
+
+    // 只读取文件头获取图像尺寸，不解码像素；RAW数据没有文件头，尺寸由下位机按层参数确定
+    QImageReader reader(imagePath);
+    QSize imgSize = reader.size();
+    if (!imgSize.isValid())
 	{
-        m_tcpClient->sendData(packet);
+        if (imgType != 0x04 || mode != IMAGE_TRANSFER_RAW)
+		{
+            sendEvent(EVENT_TYPE_ERROR, -1, "Failed to load image");
+            return -1;
+        }
+        imgSize = QSize(0, 0);
     }
-    
-    // 发送成功事件
-    QString msg = QString("Image data sent: %1 packets, size: %2x%3")
-        .arg(packets.size())
-        .arg(img.width())
-        .arg(img.height());
-    sendEvent(EVENT_TYPE_GENERAL, 0, msg.toUtf8().constData());
-    
+
+    ImageSendJob job;
+    job.timer.start();
+
+    if (mode == IMAGE_TRANSFER_DECODED)
+	{
+        // 只解码一次，分包器直接读取像素内存
+        job.image = reader.read();
+        if (job.image.isNull())
+		{
+            sendEvent(EVENT_TYPE_ERROR, -1, "Failed to load image");
+            return -1;
+        }
+        imgSize = job.image.size();
+        imgType = 0x04;
+        job.source = PrintSource::fromData(QByteArray::fromRawData(
+            reinterpret_cast<const char*>(job.image.constBits()), job.image.sizeInBytes()));
+    }
+	else if (mode == IMAGE_TRANSFER_HEX)
+	{
+        // 兼容旧下位机：整个文件转16进制文本
+        QFile file(imagePath);
+        if (!file.open(QIODevice::ReadOnly)) 
+		{
+            sendEvent(EVENT_TYPE_ERROR, -1, "Failed to open image file");
+            return -1;
+        }
+        job.source = PrintSource::fromData(file.readAll().toHex());
+    }
+	else
+	{
+        // 原始字节：内存映射文件，分包时直接从映射读取，已发送的窗口随即释放
+        job.source = PrintSource::openFile(imagePath);
+        if (!job.source) 
+		{
+            sendEvent(EVENT_TYPE_ERROR, -1, "Failed to open image file");
+            return -1;
+        }
+    }
+
+    if (!m_imgPacketizer)
+	{
+        m_imgPacketizer = std::make_unique<ImagePacketizer>();
+    }
+
+    job.totalPackets = ImagePacketizer::packetCount(job.source->size());
+    job.width = imgSize.width();
+    job.height = imgSize.height();
+    job.active = true;
+    m_imgJob = std::move(job);
+    m_imgPacketizer->begin(m_imgJob.source.get(), m_imgJob.width, m_imgJob.height, imgType);
+    m_imgJob.window.reset(0);
+    m_retransTimer->start();
+
+    onPumpImagePackets();
     return 0;
 }
 
+void SDKManager::onPumpImagePackets()
+{
+    // 断线期间暂停，重连后由finishOutage续发
+    if (!m_imgJob.active || m_outageTimer.isValid())
+	{
+        return;
+    }
+
+    RetransmitWindow& window = m_imgJob.window;
+    qint64 nowMs = m_imgJob.timer.elapsed();
+
+    // 先重发被否认或超时的帧，只重发这些帧
+    QList<quint32> dueSeqs;
+    QList<QByteArray> dueFrames = window.peekDue(nowMs, &dueSeqs);
+    for (int i = 0; i < dueFrames.size(); i++)
+	{
+        if (!m_tcpClient->sendData(dueFrames[i], Lane_Bulk))
+		{
+            // 发送队列满，剩余的保持待重发，下次继续，不消耗重发次数
+            return;
+        }
+        window.commitRetry(dueSeqs[i], nowMs);
+        m_resentFrames->add();
+        m_resentBytes->add(dueFrames[i].size());
+    }
+
+    if (window.exhausted())
+	{
+        finishImageJob(false, "Retransmit limit exceeded");
+        return;
+    }
+
+    // 窗口未满时继续发送新帧
+    while (window.canSend())
+	{
+        QByteArray frame;
+        quint32 seq = 0;
+        if (!m_imgJob.pendingFrame.isEmpty())
+		{
+            frame.swap(m_imgJob.pendingFrame);
+            seq = m_imgJob.pendingSeq;
+        }
+		else if (!m_imgPacketizer->next(frame, &seq))
+		{
+            // 已读完，或缓冲池全部在途（等待下一次写出后再继续）
+            break;
+        }
+
+        if (!m_tcpClient->sendData(frame, Lane_Bulk))
+		{
+            // 发送队列超过高水位，等待sigSendReady
+            m_imgJob.pendingFrame.swap(frame);
+            m_imgJob.pendingSeq = seq;
+            return;
+        }
+        window.onSent(seq, frame, nowMs);
+    }
+
+    if (m_imgPacketizer->hasError())
+	{
+        finishImageJob(false, "Failed to read image data");
+    }
+	else if (m_imgPacketizer->atEnd() && m_imgJob.pendingFrame.isEmpty() && window.isEmpty())
+	{
+        // 全部帧均已被确认
+        finishImageJob(true);
+    }
+}
+
+void SDKManager::finishImageJob(bool ok, const char* reason /*= nullptr*/)
+{
+    if (m_retransTimer)
+	{
+        m_retransTimer->stop();
+    }
+
+    int packets = m_imgPacketizer ? m_imgPacketizer->packetIndex() : 0;
+    qint64 bytes = m_imgPacketizer ? m_imgPacketizer->bytesConsumed() : 0;
+    if (m_imgPacketizer)
+	{
+        m_imgPacketizer->reset();
+    }
+
+    ImageSendJob job = std::move(m_imgJob);
+    m_imgJob = ImageSendJob();
+    m_metrics->counter(ok ? "image.jobs_completed" : "image.jobs_failed").add();
+
+    if (!ok)
+	{
+        QString msg = QString("Image transfer aborted: %1, %2/%3 packets acknowledged")
+            .arg(reason ? reason : "unknown")
+            .arg(job.window.baseSeq())
+            .arg(job.totalPackets);
+        sendEvent(EVENT_TYPE_ERROR, -1, msg.toUtf8().constData());
+        return;
+    }
+
+    // 发送成功事件（附带数据量、耗时和进程峰值内存）
+    QString msg = QString("Image data sent: %1 packets (%2 retransmitted), size: %3x%4, bytes: %5, elapsed: %6 ms, peak RSS: %7 MB")
+        .arg(packets)
+        .arg(job.window.retransmitCount())
+        .arg(job.width)
+        .arg(job.height)
+        .arg(bytes)
+        .arg(job.timer.elapsed())
+        .arg(Utils::peakRssBytes() / (1024.0 * 1024.0), 0, 'f', 1);
+    sendEvent(EVENT_TYPE_GENERAL, 0, msg.toUtf8().constData());
+}
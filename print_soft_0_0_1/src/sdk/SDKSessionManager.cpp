@@ -0,0 +1,155 @@
+﻿/**
+ * @file SDKSessionManager.cpp
+ * @brief 多设备会话管理实现
+ */
+
+#include "SDKSessionManager.h"
+#include "SDKManager.h"
+#include "IoThreadPool.h"
+#include "MetricsRegistry.h"
+#include "CLogManager.h"
+
+SDKSessionManager* SDKSessionManager::instance() {
+    static SDKSessionManager manager;
+    return &manager;
+}
+
+SDKSessionManager::SDKSessionManager()
+    : m_nextId(1)
+{
+}
+
+SDKSessionManager::~SDKSessionManager()
+{
+    destroyAll();
+}
+
+SDKManager* SDKSessionManager::createSession(const QString& name)
+{
+    QMutexLocker lock(&m_mutex);
+
+    QString sessionName = name;
+    if (sessionName.isEmpty())
+    {
+        // 自动命名跳过已被显式使用的名称
+        sessionName = QString("device_%1").arg(m_nextId);
+        while (findSessionLocked(sessionName))
+        {
+            sessionName = QString("device_%1").arg(++m_nextId);
+        }
+    }
+    else if (sessionName == SDK_DEFAULT_SESSION_NAME || findSessionLocked(sessionName))
+    {
+        return nullptr;
+    }
+
+    // 每个会话独立的指标注册表
+    std::unique_ptr<SDKManager> session = std::make_unique<SDKManager>(sessionName, std::make_unique<MetricsRegistry>());
+    SDKManager* result = session.get();
+    m_sessions[m_nextId++] = std::move(session);
+    LOG_INFO(QString(u8"motion_moudle_sdk session %1 created, %2 sessions").arg(sessionName).arg(m_sessions.size()));
+    return result;
+}
+
+void SDKSessionManager::destroySession(SDKManager* session)
+{
+    std::unique_ptr<SDKManager> removed;
+    {
+        QMutexLocker lock(&m_mutex);
+        for (auto it = m_sessions.begin(); it != m_sessions.end(); ++it)
+        {
+            if (it->second.get() == session)
+            {
+                removed = std::move(it->second);
+                m_sessions.erase(it);
+                break;
+            }
+        }
+    }
+
+    // 在锁外释放：release会等待I/O线程删除连接对象
+    if (removed)
+    {
+        removed->setSessionEventCallback(nullptr, nullptr, 0);
+        removed->release();
+    }
+}
+
+void SDKSessionManager::destroyAll()
+{
+    std::map<quint64, std::unique_ptr<SDKManager>> sessions;
+    {
+        QMutexLocker lock(&m_mutex);
+        sessions.swap(m_sessions);
+    }
+    for (auto& item : sessions)
+    {
+        item.second->setSessionEventCallback(nullptr, nullptr, 0);
+        item.second->release();
+    }
+}
+
+bool SDKSessionManager::contains(const SDKManager* session) const
+{
+    QMutexLocker lock(&m_mutex);
+    for (const auto& item : m_sessions)
+    {
+        if (item.second.get() == session)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+SDKManager* SDKSessionManager::findSession(const QString& name) const
+{
+    QMutexLocker lock(&m_mutex);
+    return findSessionLocked(name);
+}
+
+SDKManager* SDKSessionManager::findSessionLocked(const QString& name) const
+{
+    for (const auto& item : m_sessions)
+    {
+        if (item.second->name() == name)
+        {
+            return item.second.get();
+        }
+    }
+    return nullptr;
+}
+
+QList<SDKManager*> SDKSessionManager::sessions() const
+{
+    QMutexLocker lock(&m_mutex);
+    QList<SDKManager*> result;
+    for (const auto& item : m_sessions)
+    {
+        result.append(item.second.get());
+    }
+    return result;
+}
+
+QJsonObject SDKSessionManager::metricsSnapshot() const
+{
+    QJsonObject sessions;
+    {
+        // 快照只读注册表（原子变量），不访问会话的其他状态
+        QMutexLocker lock(&m_mutex);
+        for (const auto& item : m_sessions)
+        {
+            sessions.insert(item.second->name(), item.second->metrics()->snapshot());
+        }
+    }
+
+    QJsonObject result;
+    result.insert("process", MetricsRegistry::global()->snapshot());
+    result.insert("sessions", sessions);
+    return result;
+}
+
+void SDKSessionManager::setIoThreadCount(int count)
+{
+    IoThreadPool::instance()->setMaxThreads(count);
+}
@@ -0,0 +1,92 @@
+﻿/**
+ * @file SDKSessionManager.h
+ * @brief 多设备会话管理
+ * @details 一个进程同时连接多台设备：每台设备一个SDKManager会话，
+ *          各会话的socket I/O共用IoThreadPool中的少量线程
+ */
+
+#ifndef SDK_SESSION_MANAGER_H
+#define SDK_SESSION_MANAGER_H
+
+#include <QMutex>
+#include <QString>
+#include <QList>
+#include <QJsonObject>
+#include <map>
+#include <memory>
+
+class SDKManager;
+
+/**
+ * @class SDKSessionManager
+ * @brief 创建、查找和销毁设备会话
+ *
+ * 会话在调用createSession的线程中创建，该线程须运行Qt事件循环，并在同一线程中销毁。
+ * 查找和指标快照线程安全。默认会话（SDKManager::instance()）不由本类管理。
+ */
+class SDKSessionManager
+{
+public:
+    static SDKSessionManager* instance();
+
+    /**
+     * @brief 创建会话，使用前需调用SDKManager::init
+     * @param name 会话名，为空时自动命名为device_N；不能与已有会话或默认会话重名
+     * @return 会话，重名时返回nullptr
+     */
+    SDKManager* createSession(const QString& name);
+
+    /**
+     * @brief 断开并销毁会话，返回后不会再有该会话的事件回调
+     * @param session createSession返回的会话
+     */
+    void destroySession(SDKManager* session);
+
+    /**
+     * @brief 销毁全部会话
+     */
+    void destroyAll();
+
+    /**
+     * @brief 会话是否存在（用于校验外部传入的句柄）
+     */
+    bool contains(const SDKManager* session) const;
+
+    /**
+     * @brief 按名称查找会话
+     * @return 不存在时返回nullptr
+     */
+    SDKManager* findSession(const QString& name) const;
+
+    /**
+     * @brief 当前全部会话，按创建顺序
+     */
+    QList<SDKManager*> sessions() const;
+
+    /**
+     * @brief 全部会话的指标快照
+     * @return {process: 全局注册表（默认会话及I/O线程）, sessions: {会话名: 该会话的快照}}
+     */
+    QJsonObject metricsSnapshot() const;
+
+    /**
+     * @brief 设置共享I/O线程数上限，只影响之后新建的线程
+     * @param count <=0时恢复默认值
+     */
+    void setIoThreadCount(int count);
+
+private:
+    SDKSessionManager();
+    ~SDKSessionManager();
+
+    SDKManager* findSessionLocked(const QString& name) const;
+
+    SDKSessionManager(const SDKSessionManager&) = delete;
+    SDKSessionManager& operator=(const SDKSessionManager&) = delete;
+
+    mutable QMutex m_mutex;
+    std::map<quint64, std::unique_ptr<SDKManager>> m_sessions;  ///< 键为创建序号，保持创建顺序
+    quint64 m_nextId;
+};
+
+#endif // SDK_SESSION_MANAGER_H
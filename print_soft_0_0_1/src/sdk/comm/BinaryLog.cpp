@@ -0,0 +1,345 @@
+﻿#include "BinaryLog.h"
+#include <deque>
+
+//记录/定义标签
+#define BINLOG_TAG_DEFINE 'D'
+#define BINLOG_TAG_THREAD 'T'
+#define BINLOG_TAG_RECORD 'R'
+
+namespace
+{
+	//调用点注册表，只追加；id即下标
+	QMutex s_siteMutex;
+	std::deque<BinLogSite> s_sites;
+
+	void putVarint(QByteArray& out, quint64 value)
+	{
+		while (value >= 0x80)
+		{
+			out.append(static_cast<char>((value & 0x7F) | 0x80));
+			value >>= 7;
+		}
+		out.append(static_cast<char>(value));
+	}
+
+	quint64 zigzag(qint64 value)
+	{
+		return (static_cast<quint64>(value) << 1) ^ static_cast<quint64>(value >> 63);
+	}
+
+	qint64 unzigzag(quint64 value)
+	{
+		return static_cast<qint64>(value >> 1) ^ -static_cast<qint64>(value & 1);
+	}
+
+	void putBytes(QByteArray& out, const char* data, int len)
+	{
+		putVarint(out, static_cast<quint64>(len));
+		out.append(data, len);
+	}
+
+	void putFixed64(QByteArray& out, quint64 value)
+	{
+		uchar buf[8];
+		qToLittleEndian(value, buf);
+		out.append(reinterpret_cast<const char*>(buf), 8);
+	}
+}
+
+quint16 BinaryLog::registerSite(int level, const char* file, int line, const char* format)
+{
+	QMutexLocker locker(&s_siteMutex);
+
+	const char* filename = file;
+	for (const char* p = file; *p; ++p)
+	{
+		if (*p == '/' || *p == '\\')
+		{
+			filename = p + 1;
+		}
+	}
+
+	BinLogSite site;
+	site.level = level;
+	site.file = filename;
+	site.line = line;
+	site.format = format;
+	s_sites.push_back(site);
+	return static_cast<quint16>(s_sites.size() - 1);
+}
+
+BinLogSite BinaryLog::site(quint16 id)
+{
+	QMutexLocker locker(&s_siteMutex);
+	if (id >= s_sites.size())
+	{
+		BinLogSite unknown = { 0, "", 0, "" };
+		return unknown;
+	}
+	return s_sites[id];
+}
+
+QString BinaryLog::render(const QString& format, const quint8* types, const quint64* args, int count)
+{
+	QString text = format;
+	for (int i = 0; i < count; i++)
+	{
+		switch (types[i])
+		{
+		case BinArg_Int:
+			text = text.arg(static_cast<qint64>(args[i]));
+			break;
+		case BinArg_UInt:
+			text = text.arg(args[i]);
+			break;
+		case BinArg_Double:
+		{
+			double d;
+			memcpy(&d, &args[i], sizeof(d));
+			text = text.arg(d);
+			break;
+		}
+		case BinArg_Char:
+			text = text.arg(QChar(static_cast<ushort>(args[i])));
+			break;
+		default:
+			text = text.arg(QStringLiteral("?"));
+			break;
+		}
+	}
+	return text;
+}
+
+QByteArray BinaryLogWriter::begin(qint64 startEpochMs, quint64 startNs)
+{
+	m_defined.clear();
+	m_threads.clear();
+	m_lastNs = startNs;
+
+	QByteArray header(BINLOG_FILE_MAGIC, BINLOG_FILE_MAGIC_SIZE);
+	putFixed64(header, static_cast<quint64>(startEpochMs));
+	putFixed64(header, startNs);
+	return header;
+}
+
+void BinaryLogWriter::append(QByteArray& out, const BinLogRecord& rec)
+{
+	if (rec.fmtId >= m_defined.size())
+	{
+		m_defined.resize(rec.fmtId + 1);
+	}
+	if (!m_defined[rec.fmtId])
+	{
+		//参数类型取自该id的第一条记录，同一调用点的类型不会变化
+		BinLogSite site = BinaryLog::site(rec.fmtId);
+		out.append(BINLOG_TAG_DEFINE);
+		putVarint(out, rec.fmtId);
+		out.append(static_cast<char>(site.level));
+		putVarint(out, static_cast<quint64>(site.line));
+		putBytes(out, site.file, static_cast<int>(strlen(site.file)));
+		putBytes(out, site.format, static_cast<int>(strlen(site.format)));
+		out.append(static_cast<char>(rec.argCount));
+		out.append(reinterpret_cast<const char*>(rec.types), rec.argCount);
+		m_defined[rec.fmtId] = true;
+	}
+
+	quint32 threadIndex;
+	auto it = m_threads.constFind(rec.thread);
+	if (it == m_threads.constEnd())
+	{
+		threadIndex = static_cast<quint32>(m_threads.size());
+		m_threads.insert(rec.thread, threadIndex);
+		out.append(BINLOG_TAG_THREAD);
+		putVarint(out, threadIndex);
+		putVarint(out, rec.thread);
+	}
+	else
+	{
+		threadIndex = it.value();
+	}
+
+	//多个生产者的记录不严格按时间入队，时间差可能为负
+	out.append(BINLOG_TAG_RECORD);
+	putVarint(out, rec.fmtId);
+	putVarint(out, zigzag(static_cast<qint64>(rec.tsNs - m_lastNs)));
+	m_lastNs = rec.tsNs;
+	putVarint(out, threadIndex);
+	for (int i = 0; i < rec.argCount; i++)
+	{
+		switch (rec.types[i])
+		{
+		case BinArg_Int:
+			putVarint(out, zigzag(static_cast<qint64>(rec.args[i])));
+			break;
+		case BinArg_Double:
+			putFixed64(out, rec.args[i]);
+			break;
+		default:
+			putVarint(out, rec.args[i]);
+			break;
+		}
+	}
+}
+
+bool BinaryLogReader::open(const QByteArray& data)
+{
+	m_data = data;
+	m_pos = 0;
+	m_formats.clear();
+	m_threads.clear();
+	m_error.clear();
+
+	if (m_data.size() < BINLOG_FILE_HEADER_SIZE || !m_data.startsWith(BINLOG_FILE_MAGIC))
+	{
+		m_error = QStringLiteral("not a binary log file");
+		return false;
+	}
+
+	const uchar* p = reinterpret_cast<const uchar*>(m_data.constData()) + BINLOG_FILE_MAGIC_SIZE;
+	m_startEpochMs = static_cast<qint64>(qFromLittleEndian<quint64>(p));
+	m_startNs = qFromLittleEndian<quint64>(p + 8);
+	m_lastNs = m_startNs;
+	m_pos = BINLOG_FILE_HEADER_SIZE;
+	return true;
+}
+
+bool BinaryLogReader::readVarint(quint64& value)
+{
+	value = 0;
+	for (int shift = 0; shift < 64; shift += 7)
+	{
+		if (m_pos >= m_data.size())
+		{
+			return false;
+		}
+		uchar byte = static_cast<uchar>(m_data.at(m_pos++));
+		value |= static_cast<quint64>(byte & 0x7F) << shift;
+		if (!(byte & 0x80))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+bool BinaryLogReader::readBytes(QByteArray& value)
+{
+	quint64 len;
+	if (!readVarint(len) || len > static_cast<quint64>(m_data.size() - m_pos))
+	{
+		return false;
+	}
+	value = m_data.mid(m_pos, static_cast<int>(len));
+	m_pos += static_cast<int>(len);
+	return true;
+}
+
+bool BinaryLogReader::next(BinLogEntry& entry)
+{
+	while (m_pos < m_data.size())
+	{
+		char tag = m_data.at(m_pos++);
+		if (tag == BINLOG_TAG_DEFINE)
+		{
+			quint64 id, line;
+			QByteArray file, format;
+			if (!readVarint(id) || m_pos >= m_data.size())
+			{
+				return truncated();
+			}
+			Format def;
+			def.level = static_cast<uchar>(m_data.at(m_pos++));
+			if (!readVarint(line) || !readBytes(file) || !readBytes(format) || m_pos >= m_data.size())
+			{
+				return truncated();
+			}
+			int argCount = static_cast<uchar>(m_data.at(m_pos++));
+			if (argCount > BINLOG_MAX_ARGS || argCount > m_data.size() - m_pos)
+			{
+				return truncated();
+			}
+			for (int i = 0; i < argCount; i++)
+			{
+				def.types.append(static_cast<quint8>(m_data.at(m_pos++)));
+			}
+			def.line = static_cast<int>(line);
+			def.file = QString::fromUtf8(file);
+			def.format = QString::fromUtf8(format);
+			m_formats.insert(static_cast<quint32>(id), def);
+		}
+		else if (tag == BINLOG_TAG_THREAD)
+		{
+			quint64 index, thread;
+			if (!readVarint(index) || !readVarint(thread))
+			{
+				return truncated();
+			}
+			m_threads.insert(static_cast<quint32>(index), thread);
+		}
+		else if (tag == BINLOG_TAG_RECORD)
+		{
+			quint64 id, dts, threadIndex;
+			if (!readVarint(id) || !readVarint(dts) || !readVarint(threadIndex))
+			{
+				return truncated();
+			}
+			auto fmt = m_formats.constFind(static_cast<quint32>(id));
+			if (fmt == m_formats.constEnd())
+			{
+				m_error = QString("record refers to undefined format %1 at offset %2").arg(id).arg(m_pos);
+				return false;
+			}
+
+			quint64 args[BINLOG_MAX_ARGS] = { 0 };
+			int argCount = fmt->types.size();
+			bool ok = true;
+			for (int i = 0; i < argCount && ok; i++)
+			{
+				if (fmt->types[i] == BinArg_Double)
+				{
+					ok = m_pos + 8 <= m_data.size();
+					if (ok)
+					{
+						args[i] = qFromLittleEndian<quint64>(reinterpret_cast<const uchar*>(m_data.constData()) + m_pos);
+						m_pos += 8;
+					}
+				}
+				else
+				{
+					ok = readVarint(args[i]);
+					if (ok && fmt->types[i] == BinArg_Int)
+					{
+						args[i] = static_cast<quint64>(unzigzag(args[i]));
+					}
+				}
+			}
+			if (!ok)
+			{
+				return truncated();
+			}
+
+			m_lastNs += static_cast<quint64>(unzigzag(dts));
+			entry.epochMs = m_startEpochMs + static_cast<qint64>(m_lastNs - m_startNs) / 1000000;
+			entry.thread = m_threads.value(static_cast<quint32>(threadIndex));
+			entry.level = fmt->level;
+			entry.file = fmt->file;
+			entry.line = fmt->line;
+			entry.text = BinaryLog::render(fmt->format, fmt->types.constData(), args, argCount);
+			return true;
+		}
+		else
+		{
+			m_error = QString("unknown tag 0x%1 at offset %2").arg(static_cast<uchar>(tag), 2, 16, QChar('0')).arg(m_pos - 1);
+			return false;
+		}
+	}
+
+	return false;
+}
+
+bool BinaryLogReader::truncated()
+{
+	m_error = QString("truncated record at offset %1").arg(m_pos);
+	m_pos = m_data.size();
+	return false;
+}
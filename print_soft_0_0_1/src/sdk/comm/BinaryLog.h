@@ -0,0 +1,248 @@
+﻿#pragma once
+#include <QtCore/QtCore>
+#include <chrono>
+#include <cstring>
+#include <type_traits>
+#include "motioncontrolsdk_global.h"
+
+//单条二进制日志最多携带的参数个数
+#define BINLOG_MAX_ARGS 6
+//二进制日志文件头魔数
+#define BINLOG_FILE_MAGIC "PMBLOG01"
+#define BINLOG_FILE_MAGIC_SIZE 8
+//文件头长度：魔数(8) + 起始墙钟毫秒(8) + 起始单调时钟纳秒(8)
+#define BINLOG_FILE_HEADER_SIZE 24
+
+//参数类型（每个调用点的参数类型固定，写入文件时只在格式定义中记录一次）
+enum BinLogArgType
+{
+	BinArg_Int = 1,		//有符号整数，文件中为zigzag变长编码
+	BinArg_UInt,		//无符号整数，文件中为变长编码
+	BinArg_Double,		//浮点数，文件中为8字节小端
+	BinArg_Char			//字符，按整数编码，渲染为字符
+};
+
+/**  热路径写入日志队列的定长记录，不含任何需要分配内存的成员  **/
+struct BinLogRecord
+{
+	quint16 fmtId;						//调用点格式id
+	quint8 argCount;					//参数个数
+	quint8 types[BINLOG_MAX_ARGS];		//参数类型 BinLogArgType
+	quint64 tsNs;						//单调时钟纳秒
+	quint64 thread;						//线程id
+	quint64 args[BINLOG_MAX_ARGS];		//参数原始值（浮点数按位保存）
+};
+
+/**  调用点静态信息，首次执行时注册  **/
+struct BinLogSite
+{
+	int level;
+	const char* file;
+	int line;
+	const char* format;		//QString::arg风格模板：%1 %2 ...
+};
+
+/**  解码后的一条日志  **/
+struct BinLogEntry
+{
+	qint64 epochMs = 0;		//墙钟毫秒
+	quint64 thread = 0;
+	int level = 0;
+	QString file;
+	int line = 0;
+	QString text;
+};
+
+/**
+*  @author
+*  @class       BinaryLog
+*  @brief       延迟格式化的二进制日志：调用点注册静态格式id，热路径只记录id、时间戳和参数原始值
+*
+*  文本渲染放到日志线程（文本模式）或离线解码工具（二进制模式）中进行。
+*  文件格式（小端）：
+*    文件头  魔数"PMBLOG01" + 起始墙钟毫秒(i64) + 起始单调时钟纳秒(u64)
+*    'D'     格式定义：id, 等级, 行号, 文件名, 模板, 参数个数, 参数类型（每个id首次出现前写一次）
+*    'T'     线程定义：序号, 线程id
+*    'R'     日志记录：id, 时间差(zigzag), 线程序号, 参数
+*  除浮点数外所有整数均为LEB128变长编码。
+*/
+class MOTIONCONTROLSDK_EXPORT BinaryLog
+{
+public:
+	/**
+	*  @brief       注册调用点（线程安全，每个调用点只在首次执行时调用一次）
+	*  @param[in]    level: 日志等级  file/line: 源位置  format: 模板，需为静态字符串
+	*  @param[out]
+	*  @return       格式id
+	*/
+	static quint16 registerSite(int level, const char* file, int line, const char* format);
+
+	//已注册的调用点
+	static BinLogSite site(quint16 id);
+
+	//单调时钟纳秒
+	static quint64 nowNs()
+	{
+		return static_cast<quint64>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count());
+	}
+
+	//把参数原始值填入记录
+	static void pack(BinLogRecord& rec)
+	{
+		Q_UNUSED(rec);
+	}
+
+	template <typename T, typename... Rest>
+	static void pack(BinLogRecord& rec, const T& value, const Rest&... rest)
+	{
+		static_assert(std::is_arithmetic<T>::value || std::is_enum<T>::value, "binary log arguments must be numbers");
+		packArg(rec, rec.argCount++, value, ArgKind<T>());
+		pack(rec, rest...);
+	}
+
+	/**
+	*  @brief       按模板渲染一条日志文本
+	*  @param[in]    format: 模板  types/args/count: 参数
+	*  @param[out]
+	*  @return
+	*/
+	static QString render(const QString& format, const quint8* types, const quint64* args, int count);
+
+private:
+	//参数类别，按类别重载packArg，每个分支只对匹配的类型实例化
+	enum ArgCategory
+	{
+		ArgCat_Enum,
+		ArgCat_Float,
+		ArgCat_Char,
+		ArgCat_Signed,
+		ArgCat_Unsigned
+	};
+
+	template <typename T>
+	using ArgKind = std::integral_constant<int,
+		std::is_enum<T>::value ? ArgCat_Enum :
+		std::is_floating_point<T>::value ? ArgCat_Float :
+		std::is_same<T, char>::value ? ArgCat_Char :
+		std::is_signed<T>::value ? ArgCat_Signed : ArgCat_Unsigned>;
+
+	//枚举（含enum class）按底层整数类型记录，底层为char时也按整数渲染
+	template <typename T>
+	static void packArg(BinLogRecord& rec, int i, T value, std::integral_constant<int, ArgCat_Enum>)
+	{
+		typedef typename std::underlying_type<T>::type Underlying;
+		packArg(rec, i, static_cast<Underlying>(value),
+			std::integral_constant<int, std::is_signed<Underlying>::value ? ArgCat_Signed : ArgCat_Unsigned>());
+	}
+
+	template <typename T>
+	static void packArg(BinLogRecord& rec, int i, T value, std::integral_constant<int, ArgCat_Float>)
+	{
+		double d = static_cast<double>(value);
+		rec.types[i] = BinArg_Double;
+		memcpy(&rec.args[i], &d, sizeof(d));
+	}
+
+	template <typename T>
+	static void packArg(BinLogRecord& rec, int i, T value, std::integral_constant<int, ArgCat_Char>)
+	{
+		rec.types[i] = BinArg_Char;
+		rec.args[i] = static_cast<uchar>(value);
+	}
+
+	template <typename T>
+	static void packArg(BinLogRecord& rec, int i, T value, std::integral_constant<int, ArgCat_Signed>)
+	{
+		rec.types[i] = BinArg_Int;
+		rec.args[i] = static_cast<quint64>(static_cast<qint64>(value));
+	}
+
+	template <typename T>
+	static void packArg(BinLogRecord& rec, int i, T value, std::integral_constant<int, ArgCat_Unsigned>)
+	{
+		rec.types[i] = BinArg_UInt;
+		rec.args[i] = static_cast<quint64>(value);
+	}
+};
+
+/**
+*  @author
+*  @class       BinaryLogWriter
+*  @brief       把BinLogRecord编码为二进制日志文件内容（日志线程使用）
+*/
+class MOTIONCONTROLSDK_EXPORT BinaryLogWriter
+{
+public:
+	/**
+	*  @brief       开始新文件，返回文件头并清空已写出的定义
+	*  @param[in]    startEpochMs/startNs: 同一时刻的墙钟毫秒和单调时钟纳秒
+	*  @param[out]
+	*  @return
+	*/
+	QByteArray begin(qint64 startEpochMs, quint64 startNs);
+
+	/**
+	*  @brief       追加一条记录（必要时先追加其格式/线程定义）
+	*  @param[in]
+	*  @param[out]   out: 输出缓冲
+	*  @return
+	*/
+	void append(QByteArray& out, const BinLogRecord& rec);
+
+private:
+	QVector<bool> m_defined;				//已写出定义的格式id
+	QHash<quint64, quint32> m_threads;		//线程id -> 文件内序号
+	quint64 m_lastNs = 0;
+};
+
+/**
+*  @author
+*  @class       BinaryLogReader
+*  @brief       解析二进制日志文件（离线解码工具使用）
+*/
+class MOTIONCONTROLSDK_EXPORT BinaryLogReader
+{
+public:
+	/**
+	*  @brief       载入文件内容并校验文件头
+	*  @param[in]
+	*  @param[out]
+	*  @return       false=不是二进制日志文件
+	*/
+	bool open(const QByteArray& data);
+
+	/**
+	*  @brief       读取下一条日志
+	*  @param[in]
+	*  @param[out]   entry: 解码结果
+	*  @return       false=已到末尾或文件损坏（见errorString）
+	*/
+	bool next(BinLogEntry& entry);
+
+	QString errorString() const { return m_error; }
+
+private:
+	struct Format
+	{
+		int level = 0;
+		QString file;
+		int line = 0;
+		QString format;
+		QVector<quint8> types;
+	};
+
+	bool readVarint(quint64& value);
+	bool readBytes(QByteArray& value);
+	bool truncated();
+
+private:
+	QByteArray m_data;
+	int m_pos = 0;
+	qint64 m_startEpochMs = 0;
+	quint64 m_startNs = 0;
+	quint64 m_lastNs = 0;
+	QHash<quint32, Format> m_formats;
+	QHash<quint32, quint64> m_threads;
+	QString m_error;
+};
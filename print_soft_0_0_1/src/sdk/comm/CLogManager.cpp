@@ -1,29 +1,74 @@
 ﻿#include "CLogManager.h"
+#include <QtConcurrent/QtConcurrent>
+#ifdef Q_OS_WIN
+#include <windows.h>
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
 
 #define LOG_FILE_MAX_SIZE 10*1024*1024
+//轮转后的日志段文件名：log_yyyyMMddhhmmsszzz.txt，压缩后追加LOG_COMPRESSED_SUFFIX
+#define LOG_ROTATED_PREFIX "log_"
+#define LOG_ROTATED_SUFFIX ".txt"
+#define LOG_COMPRESSED_SUFFIX ".qz"
+//默认保留的轮转日志段个数，0表示不限制
+#define LOG_RETAIN_MAX_FILES 50
 #define LOG_FILE_NAME_1 "/print_motion_moudle.txt"
+#define LOG_BIN_FILE_PREFIX "/print_motion_moudle_"
+#define LOG_BIN_FILE_SUFFIX ".blog"
 #define LOG_FILE_UTF8_HEADER1 0xEF
 #define LOG_FILE_UTF8_HEADER2 0xBB
 #define LOG_FILE_UTF8_HEADER3 0xBF
 
+//日志队列容量（条）
+#define LOG_RING_CAPACITY 8192
+//延迟格式化日志队列容量（条）
+#define LOG_BIN_RING_CAPACITY 8192
+//每批最多取出的日志条数
+#define LOG_BATCH_MAX_RECORDS 512
+//默认落盘周期（毫秒）
+#define LOG_SYNC_INTERVAL_MS 1000
+//队列为空时日志线程的休眠时间（毫秒）
+#define LOG_IDLE_SLEEP_MS 5
+
 
 static QMutex gMutex;
 CLogManager* CLogManager::m_pInstance = NULL;
+std::atomic<int> CLogManager::s_logLevel(ELogDebug);
 CLogManager::CLogManager(QObject* parent)
 :QObject(parent),
 CLogThreadCallBack(),
 m_bWriteable(true), 
 m_logFile0(this),
-m_logThread(this, this)
+m_bStop(false),
+m_logThread(this, this),
+m_logRing(LOG_RING_CAPACITY),
+m_binRing(LOG_BIN_RING_CAPACITY),
+m_bBinaryMode(false),
+m_startEpochMs(0),
+m_startNs(0),
+m_overflowPolicy(ELogOverflowCount),
+m_syncIntervalMs(LOG_SYNC_INTERVAL_MS),
+m_droppedPending(0),
+m_droppedTotal(0),
+m_logFileSize(0),
+m_maxFileBytes(LOG_FILE_MAX_SIZE),
+m_nextRotateBytes(LOG_FILE_MAX_SIZE),
+m_binFileSize(0),
+m_bCompressRotated(false),
+m_retainMaxFiles(LOG_RETAIN_MAX_FILES),
+m_retainMaxBytes(0)
 {
     m_cUTF8[0] = LOG_FILE_UTF8_HEADER1;
     m_cUTF8[1] = LOG_FILE_UTF8_HEADER2;
     m_cUTF8[2] = LOG_FILE_UTF8_HEADER3;
-    m_lstLogData.clear();
-    m_bStop = false;
 
 	DBOutputCallBack* dboutput = new DBOutputCallBack;
 	m_pLogOutputCallBack = dboutput;
+
+	// 压缩和清理串行执行，同一时刻只处理一个日志段
+	m_rotatePool.setMaxThreadCount(1);
 }
 
 
@@ -77,6 +122,16 @@ void CLogManager::startLog(const QString& strLogPath)
     {
         qDebug() << "Create log file 0 failed.";
     }
+    m_logFileSize = m_logFile0.size();
+
+    m_startNs = BinaryLog::nowNs();
+    m_startEpochMs = QDateTime::currentMSecsSinceEpoch();
+
+    // 二进制日志每次启动一个文件，文件头记录时间基准；写满m_maxFileBytes后和文本日志一样轮转
+    if (m_bBinaryMode)
+    {
+        openBinLog();
+    }
 
     m_bStop = false;
     m_logThread.start();
@@ -91,6 +146,10 @@ void CLogManager::stopLog()
 	}
    
     m_logFile0.close();
+    m_binFile.close();
+
+    // 等待后台压缩/清理结束
+    m_rotatePool.waitForDone();
 }
 
 
@@ -108,11 +167,8 @@ void CLogManager::log(ClientLogLevel_t level, const char* module, const char* fo
     logData.thread = QThread::currentThreadId();
     logData.level = level;
     logData.strLog = QString::fromLatin1(buffer);
-    QString strLogData = formatLog(logData);
-   
-    m_logWriteLock.lockForWrite();
-    m_lstLogData.append(logData);
-    m_logWriteLock.unlock();
+
+    pushLog(std::move(logData));
 }
 
 void CLogManager::logA(ClientLogLevel_t level, const char* module, const char* format, ...)
@@ -132,9 +188,7 @@ void CLogManager::logA(ClientLogLevel_t level, const char* module, const char* f
     QString strLogData = formatLog(logData);
     qDebug() << strLogData;
 
-    m_logWriteLock.lockForWrite();
-    m_lstLogData.append(logData);
-    m_logWriteLock.unlock();
+    pushLog(std::move(logData));
 }
 
 void CLogManager::log(ClientLogLevel_t level, const char* module,const wchar_t* format, ...)
@@ -151,11 +205,8 @@ void CLogManager::log(ClientLogLevel_t level, const char* module,const wchar_t*
     logData.thread = QThread::currentThreadId();
     logData.level = level;
     logData.strLog = QString::fromWCharArray(buffer);
-    QString strLogData = formatLog(logData);
- 
-    m_logWriteLock.lockForWrite();
-    m_lstLogData.append(logData);
-    m_logWriteLock.unlock();
+
+    pushLog(std::move(logData));
 }
 
 void CLogManager::logW(ClientLogLevel_t level, const char* module,const wchar_t* format, ...)
@@ -175,9 +226,7 @@ void CLogManager::logW(ClientLogLevel_t level, const char* module,const wchar_t*
     QString strLogData = formatLog(logData);
     qDebug() << strLogData;
 
-    m_logWriteLock.lockForWrite();
-    m_lstLogData.append(logData);
-    m_logWriteLock.unlock();
+    pushLog(std::move(logData));
 }
 
 void CLogManager::setWriteable(bool bWriteable)
@@ -195,52 +244,284 @@ void CLogManager::setLogOutputCallBack(CLogOutputCallBack* pLogOutputCallBack)
     m_pLogOutputCallBack = pLogOutputCallBack;
 }
 
-void CLogManager::writeLog(const QString& strLog)
+void CLogManager::setOverflowPolicy(LogOverflowPolicy_t policy)
 {
-    QFile *pFile = NULL;
-    qint64 iSize = 0;
+    m_overflowPolicy.store(policy, std::memory_order_relaxed);
+}
 
-	iSize = m_logFile0.size();
-	if (iSize >= LOG_FILE_MAX_SIZE)      // log0.txt已达到最大长度, 切换到log1.txt
-	{
-		m_logFile0.close();
-		QString strNewFileName = m_strLogFilePath + "/" + QDateTime::currentDateTime().toString("log_yyyyMMddhhmmss") + ".txt";
-		bool bRet = m_logFile0.copy(strNewFileName);
-		if (!bRet)
-		{
-			qDebug() << "copy strNewFileName failed.";
-		}
-		m_logFile0.resize(0);
-		if (!m_logFile0.open(QIODevice::Append | QIODevice::Text))
-		{
-			qDebug() << "Create m_logFile0 failed.";
-		}
-		pFile = &m_logFile0;
-	}
-	else
+void CLogManager::setSyncInterval(int intervalMs)
+{
+    m_syncIntervalMs.store(intervalMs, std::memory_order_relaxed);
+}
+
+void CLogManager::setBinaryMode(bool bBinary)
+{
+    m_bBinaryMode = bBinary;
+}
+
+template <typename T>
+bool CLogManager::pushRecord(MpscRingBuffer<T>& ring, T&& record)
+{
+    if (ring.tryPush(std::move(record)))
+    {
+        return true;
+    }
+
+    int policy = m_overflowPolicy.load(std::memory_order_relaxed);
+    if (policy == ELogOverflowBlock)
+    {
+        // 日志线程未运行时队列不会被取空，退化为丢弃
+        while (m_logThread.isRunning() && !m_bStop.load(std::memory_order_relaxed))
+        {
+            QThread::yieldCurrentThread();
+            if (ring.tryPush(std::move(record)))
+            {
+                return true;
+            }
+        }
+    }
+
+    m_droppedTotal.fetch_add(1, std::memory_order_relaxed);
+    if (policy != ELogOverflowDrop)
+    {
+        m_droppedPending.fetch_add(1, std::memory_order_relaxed);
+    }
+    return false;
+}
+
+void CLogManager::pushLog(LogData_t&& logData)
+{
+    pushRecord(m_logRing, std::move(logData));
+}
+
+void CLogManager::pushBinary(const BinLogRecord& rec)
+{
+    BinLogRecord copy = rec;
+    pushRecord(m_binRing, std::move(copy));
+}
+
+static void syncFile(QFile& file)
+{
+    if (!file.isOpen())
+    {
+        return;
+    }
+
+    file.flush();
+#ifdef Q_OS_WIN
+    ::FlushFileBuffers(reinterpret_cast<HANDLE>(_get_osfhandle(file.handle())));
+#else
+    ::fsync(file.handle());
+#endif
+}
+
+void CLogManager::setRotation(qint64 maxFileBytes, bool bCompress)
+{
+    m_maxFileBytes = maxFileBytes;
+    m_nextRotateBytes = maxFileBytes;
+    m_bCompressRotated = bCompress;
+}
+
+void CLogManager::setRetention(int maxFiles, qint64 maxTotalBytes)
+{
+    m_retainMaxFiles = maxFiles;
+    m_retainMaxBytes = maxTotalBytes;
+}
+
+// 压缩一个已轮转的日志段：先写临时文件再改名，成功后删除原文件
+static void compressLogSegment(const QString& strPath)
+{
+    QFile src(strPath);
+    if (!src.open(QIODevice::ReadOnly))
+    {
+        return;
+    }
+    QByteArray packed = qCompress(src.readAll());
+    src.close();
+
+    QString strTarget = strPath + LOG_COMPRESSED_SUFFIX;
+    QSaveFile dst(strTarget);
+    if (!dst.open(QIODevice::WriteOnly) || dst.write(packed) != packed.size() || !dst.commit())
+    {
+        qDebug() << "compress log segment failed:" << strPath;
+        return;
+    }
+    QFile::remove(strPath);
+}
+
+// 按个数/总字节数删除最旧的日志段（文件名含时间戳，按名称排序即按时间排序）；strActive为正在写的文件，不参与清理
+static void enforceLogRetention(const QString& strDir, const QStringList& filters, const QString& strActive,
+    int maxFiles, qint64 maxTotalBytes)
+{
+    if (maxFiles <= 0 && maxTotalBytes <= 0)
+    {
+        return;
+    }
+
+    QFileInfoList segments = QDir(strDir).entryInfoList(filters, QDir::Files, QDir::Name);
+    if (!strActive.isEmpty())
+    {
+        QString strActivePath = QFileInfo(strActive).absoluteFilePath();
+        for (int i = segments.size() - 1; i >= 0; --i)
+        {
+            if (segments.at(i).absoluteFilePath() == strActivePath)
+            {
+                segments.removeAt(i);
+            }
+        }
+    }
+
+    qint64 totalBytes = 0;
+    for (const QFileInfo& info : segments)
+    {
+        totalBytes += info.size();
+    }
+
+    int count = segments.size();
+    for (const QFileInfo& info : segments)
+    {
+        bool bOverCount = maxFiles > 0 && count > maxFiles;
+        bool bOverBytes = maxTotalBytes > 0 && totalBytes > maxTotalBytes;
+        if (!bOverCount && !bOverBytes)
+        {
+            break;
+        }
+        if (QFile::remove(info.absoluteFilePath()))
+        {
+            --count;
+            totalBytes -= info.size();
+        }
+    }
+}
+
+void CLogManager::rotateLog()
+{
+    // 改名前落盘，轮转出去的日志段内容完整
+    syncFile(m_logFile0);
+    m_logFile0.close();
+
+    QString strRotated = m_strLogFilePath + "/" + LOG_ROTATED_PREFIX
+        + QDateTime::currentDateTime().toString("yyyyMMddhhmmsszzz") + LOG_ROTATED_SUFFIX;
+    if (!QFile::rename(m_logFile0.fileName(), strRotated))
+    {
+        // 改名失败（如文件被其他程序占用）时继续写原文件，再写满一段后重试
+        qDebug() << "rename log file failed:" << strRotated;
+        strRotated.clear();
+    }
+
+    if (!m_logFile0.open(QIODevice::Append | QIODevice::Text))
+    {
+        qDebug() << "Create m_logFile0 failed.";
+    }
+    // 记录真实大小（改名失败时文件仍有内容，不能再写BOM）
+    m_logFileSize = m_logFile0.size();
+    m_nextRotateBytes = strRotated.isEmpty() ? m_logFileSize + m_maxFileBytes : m_maxFileBytes;
+
+    QStringList filters;
+    filters << QString(LOG_ROTATED_PREFIX "*" LOG_ROTATED_SUFFIX)
+            << QString(LOG_ROTATED_PREFIX "*" LOG_ROTATED_SUFFIX LOG_COMPRESSED_SUFFIX);
+    retireSegment(strRotated, filters, QString());
+}
+
+void CLogManager::retireSegment(const QString& strSegment, const QStringList& filters, const QString& strActive)
+{
+    // 压缩和清理放到后台线程，日志线程只做改名和重新打开
+    bool bCompress = m_bCompressRotated && !strSegment.isEmpty();
+    QString strDir = m_strLogFilePath;
+    int maxFiles = m_retainMaxFiles;
+    qint64 maxTotalBytes = m_retainMaxBytes;
+    QtConcurrent::run(&m_rotatePool, [=]()
+    {
+        if (bCompress)
+        {
+            compressLogSegment(strSegment);
+        }
+        enforceLogRetention(strDir, filters, strActive, maxFiles, maxTotalBytes);
+    });
+}
+
+void CLogManager::openBinLog()
+{
+    // 每个二进制日志段自带文件头和格式定义，可单独解码
+    qint64 startEpochMs = QDateTime::currentMSecsSinceEpoch();
+    m_binFile.setFileName(m_strLogFilePath + LOG_BIN_FILE_PREFIX
+        + QDateTime::fromMSecsSinceEpoch(startEpochMs).toString("yyyyMMddhhmmsszzz") + LOG_BIN_FILE_SUFFIX);
+    if (!m_binFile.open(QIODevice::WriteOnly))
+    {
+        qDebug() << "Create binary log file failed.";
+        m_binFileSize = 0;
+        return;
+    }
+
+    QByteArray header = m_binWriter.begin(startEpochMs, BinaryLog::nowNs());
+    m_binFile.write(header);
+    m_binFileSize = header.size();
+}
+
+void CLogManager::rotateBinLog()
+{
+    // 二进制日志文件名本身带时间戳，关闭即成为一个日志段，无需改名
+    syncFile(m_binFile);
+    m_binFile.close();
+    QString strSegment = m_binFile.fileName();
+
+    openBinLog();
+
+    // LOG_BIN_FILE_PREFIX以路径分隔符开头，去掉后作为文件名过滤条件
+    QStringList filters;
+    filters << QString(LOG_BIN_FILE_PREFIX "*" LOG_BIN_FILE_SUFFIX).mid(1)
+            << QString(LOG_BIN_FILE_PREFIX "*" LOG_BIN_FILE_SUFFIX LOG_COMPRESSED_SUFFIX).mid(1);
+    retireSegment(strSegment, filters, m_binFile.fileName());
+}
+
+void CLogManager::writeBinLog(const QByteArray& binBatch)
+{
+    m_binFile.write(binBatch);
+    m_binFile.flush();
+    m_binFileSize += binBatch.size();
+
+    // 写入后再轮转：本批记录已按当前文件的格式定义编码，下一批从新文件头开始
+    if (m_binFileSize >= m_maxFileBytes)
+    {
+        rotateBinLog();
+    }
+}
+
+void CLogManager::writeLog(const QByteArray& batch)
+{
+	if (m_logFileSize >= m_nextRotateBytes)      // 当前日志文件已达到最大长度，改名轮转
 	{
-		pFile = &m_logFile0;
+		rotateLog();
 	}
 
     // 不存在自动创建
-    if (!pFile->exists())
+    if (!m_logFile0.isOpen())
     {
-        if (!pFile->open(QIODevice::Append | QIODevice::Text))
+        if (!m_logFile0.open(QIODevice::Append | QIODevice::Text))
         {
             qDebug() << "Create pFile failed.";
+            return;
         }
+        m_logFileSize = m_logFile0.size();
     }
 
     // 设置文件格式为带BOM utf8格式
-    if(iSize == 0)
+    if (m_logFileSize == 0)
     {
-        pFile->write(m_cUTF8, 3);
+        m_logFile0.write(m_cUTF8, 3);
+        m_logFileSize += 3;
     }
 
-    QTextStream out(pFile);
-    out.setCodec("UTF-8");
-    out << strLog << "\n";
-    pFile->flush();
+    // 整批日志一次写入，交给系统缓存，落盘由syncLogFile按周期执行
+    m_logFile0.write(batch);
+    m_logFile0.flush();
+    m_logFileSize += batch.size();
+}
+
+void CLogManager::syncLogFile()
+{
+    syncFile(m_logFile0);
+    syncFile(m_binFile);
 }
 
 QString CLogManager::formatLog(const LogData_t& logData)
@@ -255,63 +536,129 @@ QString CLogManager::formatLog(const LogData_t& logData)
     return strLogData;
 }
 
+int CLogManager::drainLog(QByteArray& batch, QByteArray& binBatch)
+{
+    int count = 0;
+    LogData_t logData;
+    BinLogRecord rec;
+    // 回调对象可能由其他线程替换，每批只取一次
+    CLogOutputCallBack* pOutput = m_pLogOutputCallBack.load();
+
+    quint64 dropped = m_droppedPending.exchange(0, std::memory_order_relaxed);
+    if (dropped > 0 && m_bWriteable)
+    {
+        LogData_t note;
+        note.strModule = "CLogManager";
+        note.thread = QThread::currentThreadId();
+        note.level = ELogWarning;
+        note.strLog = QString("log queue full, %1 records dropped").arg(dropped);
+        batch += formatLog(note).toUtf8();
+        batch += '\n';
+    }
+
+    while (count < LOG_BATCH_MAX_RECORDS && m_logRing.tryPop(logData))
+    {
+        ++count;
+
+        if (m_bWriteable)   // 写日志
+        {
+            batch += formatLog(logData).toUtf8();
+            batch += '\n';
+        }
+
+        if (pOutput != NULL)   // 消息输出栏输出日志
+        {
+            pOutput->outputLog(logData);
+        }
+    }
+
+    int binCount = 0;
+    bool bBinaryFile = m_bBinaryMode && m_binFile.isOpen();
+    while (binCount < LOG_BATCH_MAX_RECORDS && m_binRing.tryPop(rec))
+    {
+        ++binCount;
+
+        // 二进制模式只编码不渲染，文本由log_decoder离线生成，也不经过输出回调
+        if (bBinaryFile)
+        {
+            m_binWriter.append(binBatch, rec);
+            continue;
+        }
+
+        BinLogSite site = BinaryLog::site(rec.fmtId);
+        logData.dt = QDateTime::fromMSecsSinceEpoch(m_startEpochMs + static_cast<qint64>(rec.tsNs - m_startNs) / 1000000);
+        logData.strModule = QString::fromLatin1(site.file) + QLatin1Char('-') + QString::number(site.line);
+        logData.thread = reinterpret_cast<Qt::HANDLE>(static_cast<quintptr>(rec.thread));
+        logData.level = static_cast<ClientLogLevel_t>(site.level);
+        logData.strLog = BinaryLog::render(QString::fromUtf8(site.format), rec.types, rec.args, rec.argCount);
+
+        if (m_bWriteable)
+        {
+            batch += formatLog(logData).toUtf8();
+            batch += '\n';
+        }
+
+        if (pOutput != NULL)
+        {
+            pOutput->outputLog(logData);
+        }
+    }
+
+    return count + binCount;
+}
+
 void CLogManager::logRun(CLogThread* pLogThread)
 {
+    QByteArray batch;
+    QByteArray binBatch;
+    QElapsedTimer syncTimer;
+    syncTimer.start();
+    bool bUnsynced = false;
+
     while(1)
     {
-        LogData_t logData;
-        if(m_logWriteLock.tryLockForRead(10))
+        // 先读停止标志再取队列，停止前入队的日志都能写出
+        bool bStop = m_bStop.load();
+
+        batch.clear();
+        binBatch.clear();
+        int count = drainLog(batch, binBatch);
+        if (!batch.isEmpty())
         {
-            if(m_lstLogData.size() > 0)
-            {
-                logData = m_lstLogData.first();
-                m_lstLogData.removeFirst();
-                m_logWriteLock.unlock();
-
-                if (m_bWriteable)   // 写日志
-                {
-                    writeLog(formatLog(logData));
-                }
-
-                if (m_pLogOutputCallBack != NULL)   // 消息输出栏输出日志
-                {
-                    m_pLogOutputCallBack->outputLog(logData);
-                }
-            }
-            else
-            {
-                m_logWriteLock.unlock();
-                pLogThread->sleep(30);
-            }
+            writeLog(batch);
+            bUnsynced = true;
+        }
+        if (!binBatch.isEmpty())
+        {
+            writeBinLog(binBatch);
+            bUnsynced = true;
         }
 
-        if(m_bStop)         // 全部读取缓存的数据，然后退出
+        int syncIntervalMs = m_syncIntervalMs.load(std::memory_order_relaxed);
+        if (bUnsynced && syncIntervalMs >= 0 && syncTimer.elapsed() >= syncIntervalMs)
         {
-            m_logWriteLock.lockForRead();
-            while(m_lstLogData.size() > 0)
+            syncLogFile();
+            syncTimer.restart();
+            bUnsynced = false;
+        }
+
+        if (count == 0)
+        {
+            if (bStop)         // 缓存的数据已全部写出，退出
             {
-                logData = m_lstLogData.first();
-                m_lstLogData.removeFirst();
-
-                if(m_bWriteable)
-                {
-                    writeLog(formatLog(logData));
-                }
-
-                //if (m_pLogOutputCallBack != NULL)   // 消息输出栏输出日志
-                //{
-                //    m_pLogOutputCallBack->outputLog(logData);
-                //}
+                break;
             }
-
-            m_logWriteLock.unlock();
-
-            return;
+            pLogThread->sleep(LOG_IDLE_SLEEP_MS);
         }
     }
+
+    if (bUnsynced)
+    {
+        syncLogFile();
+    }
 }
 
-void writeLog(ClientLogLevel level, QString msg, const char* file, int line)
+void CLogManager::logMessage(ClientLogLevel_t level, const char* file, int line, const QString& msg)
 {
 	char key;
 #ifdef _MSC_VER
@@ -321,15 +668,24 @@ void writeLog(ClientLogLevel level, QString msg, const char* file, int line)
 #endif
 	const char* filename = strrchr(file, key) ? strrchr(file, key) + 1 : file;
 
-	QString strSop = msg.left(2040);
-	wchar_t sop[2048] = { 0 };
-	strSop.toWCharArray(sop);
-	QString title;
-	title += filename;
-	title += "-";
-	title += QString::number(line);
+	LogData_t logData;
+	logData.dt = QDateTime::currentDateTime();
+	logData.strModule = QString::fromLatin1(filename) + QLatin1Char('-') + QString::number(line);
+	logData.thread = QThread::currentThreadId();
+	logData.level = level;
+	logData.strLog = msg;
+
+	pushLog(std::move(logData));
+}
+
+void writeLog(ClientLogLevel level, const QString& msg, const char* file, int line)
+{
+	if (!CLogManager::isLevelEnabled(level))
+	{
+		return;
+	}
 
-	CLogManager::getInstance()->log(level, title.toLocal8Bit().data(), sop);
+	CLogManager::getInstance()->logMessage(level, file, line, msg);
 }
 
 void DBOutputCallBack::outputLog(const LogData_t& logData)
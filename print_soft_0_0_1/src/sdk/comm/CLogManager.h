@@ -1,14 +1,66 @@
 ﻿#pragma once
 
 #include <QtCore/QtCore>
+#include <atomic>
+#include "motioncontrolsdk_global.h"
 #include "CLogThread.h"
+#include "MpscRingBuffer.h"
+#include "BinaryLog.h"
+
+//编译期最低日志等级（数值同ClientLogLevel），低于该等级的日志语句在编译时整体移除。
+//可在工程中预定义覆盖，默认release保留警告及以上，debug全部保留
+#ifndef LOG_COMPILE_MIN_LEVEL
+#ifdef QT_NO_DEBUG
+#define LOG_COMPILE_MIN_LEVEL 3
+#else
+#define LOG_COMPILE_MIN_LEVEL 1
+#endif
+#endif
+
+//先判断运行期等级，再对msg求值；被过滤时不构造任何参数
+#define LOG_AT_LEVEL(level, msg) \
+	do { if (CLogManager::isLevelEnabled(level)) { writeLog(level, msg, __FILE__, __LINE__); } } while (0)
+
+//编译期移除：msg仍参与语法检查，但不会生成代码
+#define LOG_DISCARD(msg) \
+	do { if (false) { (void)(msg); } } while (0)
 
 //日志宏定义
-#define LOG_ERROR(msg)     writeLog(ELogError, msg, __FILE__, __LINE__)
-#define LOG_WARN(msg)      writeLog(ELogWarning, msg, __FILE__, __LINE__)
-#define LOG_INFO(msg)      writeLog(ELogInfo, msg, __FILE__, __LINE__)
-#define LOG_DEBUG(msg)     writeLog(ELogDebug, msg, __FILE__, __LINE__)
-#define LOG_FATAL(msg)     writeLog(ELogFatal, msg, __FILE__, __LINE__)
+#if LOG_COMPILE_MIN_LEVEL <= 1
+#define LOG_DEBUG(msg)     LOG_AT_LEVEL(ELogDebug, msg)
+#else
+#define LOG_DEBUG(msg)     LOG_DISCARD(msg)
+#endif
+
+#if LOG_COMPILE_MIN_LEVEL <= 2
+#define LOG_INFO(msg)      LOG_AT_LEVEL(ELogInfo, msg)
+#else
+#define LOG_INFO(msg)      LOG_DISCARD(msg)
+#endif
+
+#if LOG_COMPILE_MIN_LEVEL <= 3
+#define LOG_WARN(msg)      LOG_AT_LEVEL(ELogWarning, msg)
+#else
+#define LOG_WARN(msg)      LOG_DISCARD(msg)
+#endif
+
+#define LOG_ERROR(msg)     LOG_AT_LEVEL(ELogError, msg)
+#define LOG_FATAL(msg)     LOG_AT_LEVEL(ELogFatal, msg)
+
+//延迟格式化日志：fmt为QString::arg风格的静态模板，参数只能是数值/字符。
+//调用点首次执行时注册格式id，之后只记录id、时间戳和参数原始值，文本由日志线程或离线解码工具生成
+#define LOG_BIN(level, fmt, ...) \
+	do { \
+		if (LOG_COMPILE_MIN_LEVEL <= (level) && CLogManager::isLevelEnabled(level)) { \
+			static const quint16 s_binLogId = BinaryLog::registerSite(level, __FILE__, __LINE__, fmt); \
+			CLogManager::getInstance()->logBinary(s_binLogId, __VA_ARGS__); \
+		} \
+	} while (0)
+
+#define LOGB_DEBUG(fmt, ...)   LOG_BIN(ELogDebug, fmt, __VA_ARGS__)
+#define LOGB_INFO(fmt, ...)    LOG_BIN(ELogInfo, fmt, __VA_ARGS__)
+#define LOGB_WARN(fmt, ...)    LOG_BIN(ELogWarning, fmt, __VA_ARGS__)
+#define LOGB_ERROR(fmt, ...)   LOG_BIN(ELogError, fmt, __VA_ARGS__)
 
 //日志输出等级
 typedef enum ClientLogLevel
@@ -21,6 +73,14 @@ typedef enum ClientLogLevel
 	ELogFatal
 } ClientLogLevel_t;
 
+//日志队列满时的处理方式
+typedef enum LogOverflowPolicy
+{
+	ELogOverflowDrop = 0,		//直接丢弃新日志
+	ELogOverflowCount,			//丢弃新日志并计数，写线程在日志中补记丢弃条数（默认）
+	ELogOverflowBlock			//调用线程让出CPU直到有空位，协议/通信线程不要使用
+} LogOverflowPolicy_t;
+
 //日志内容信息
 typedef struct LogData 
 {
@@ -59,15 +119,18 @@ public:
 *  @author      
 *  @class       CLogManager 
 *  @brief       日志管理类
+*
+*  进程内唯一的日志后端：SDK与上层程序共用同一个实例（由SDK导出），
+*  LOG_*宏、LOG_BIN宏以及spdlog调用点（见CLogSpdlogSink）都写入同一队列，由同一个日志线程写出到同一组文件。
 */
-class CLogManager : public QObject, public CLogThreadCallBack
+class MOTIONCONTROLSDK_EXPORT CLogManager : public QObject, public CLogThreadCallBack
 {
     Q_OBJECT
 public:
     static CLogManager* getInstance();
 
 	/** 
-	*  @brief       开启日志 
+	*  @brief       开启日志（已开启时直接返回，进程内只打开一组日志文件） 
 	*  @param[in]    strLogPath: 文字存储路径
 	*  @param[out]   
 	*  @return                    
@@ -100,21 +163,120 @@ public:
     bool getWriteable();
 
 	/** 
-	*  @brief       设置日志额外处理回调对象
+	*  @brief       设置日志额外处理回调对象（在日志线程中回调，可随时替换，nullptr表示不回调）
 	*  @param[in]    
 	*  @param[out]   
 	*  @return                    
 	*/
     void setLogOutputCallBack(CLogOutputCallBack* pLogOutputCallBack);
 
+	/** 
+	*  @brief       设置日志队列满时的处理方式 
+	*  @param[in]    
+	*  @param[out]   
+	*  @return                    
+	*/
+    void setOverflowPolicy(LogOverflowPolicy_t policy);
+
+	/** 
+	*  @brief       设置落盘(fsync)周期 
+	*  @param[in]    intervalMs: 0=每批写入后落盘, <0=不主动落盘，由系统回写
+	*  @param[out]   
+	*  @return                    
+	*/
+    void setSyncInterval(int intervalMs);
+
+	/** 
+	*  @brief       设置日志轮转（需在startLog前调用，文本日志和二进制日志共用） 
+	*  @param[in]    maxFileBytes: 当前文件达到该大小后改名为log_时间戳.txt并重新打开；
+	*                              二进制日志关闭当前.blog并新建一个带时间戳的文件
+	*                bCompress: 轮转出的日志段是否在后台压缩(qCompress格式，.qz)
+	*  @param[out]   
+	*  @return                    
+	*/
+    void setRotation(qint64 maxFileBytes, bool bCompress);
+
+	/** 
+	*  @brief       设置轮转日志段的保留策略（需在startLog前调用） 
+	*  @param[in]    maxFiles: 最多保留的日志段个数  maxTotalBytes: 日志段总字节数上限；0表示不限制
+	*                文本日志段和.blog日志段分别按该策略清理，正在写的文件不计入
+	*  @param[out]   
+	*  @return                    
+	*/
+    void setRetention(int maxFiles, qint64 maxTotalBytes);
+
+	/** 
+	*  @brief       设置运行期最低日志等级，低于该等级的LOG_*语句不对参数求值 
+	*  @param[in]    
+	*  @param[out]   
+	*  @return                    
+	*/
+    static void setLogLevel(ClientLogLevel_t level) { s_logLevel.store(level, std::memory_order_relaxed); }
+    static ClientLogLevel_t logLevel() { return static_cast<ClientLogLevel_t>(s_logLevel.load(std::memory_order_relaxed)); }
+
+	//该等级是否输出（LOG_*宏在求值参数前调用）
+    static bool isLevelEnabled(ClientLogLevel_t level) { return level >= s_logLevel.load(std::memory_order_relaxed); }
+
+	/** 
+	*  @brief       写入一条已格式化好的日志（LOG_*宏使用，不再经过printf格式化） 
+	*  @param[in]    file: 源文件名  line: 行号
+	*  @param[out]   
+	*  @return                    
+	*/
+    void logMessage(ClientLogLevel_t level, const char* file, int line, const QString& msg);
+
+	/** 
+	*  @brief       写入一条延迟格式化日志（LOG_BIN宏使用） 
+	*  @param[in]    fmtId: BinaryLog::registerSite返回的格式id  args: 数值参数
+	*  @param[out]   
+	*  @return                    
+	*/
+    template <typename... Args>
+    void logBinary(quint16 fmtId, const Args&... args)
+    {
+        static_assert(sizeof...(Args) <= BINLOG_MAX_ARGS, "too many binary log arguments");
+        BinLogRecord rec;
+        rec.fmtId = fmtId;
+        rec.argCount = 0;
+        rec.tsNs = BinaryLog::nowNs();
+        rec.thread = static_cast<quint64>(reinterpret_cast<quintptr>(QThread::currentThreadId()));
+        BinaryLog::pack(rec, args...);
+        pushBinary(rec);
+    }
+
+	/** 
+	*  @brief       设置延迟格式化日志的输出方式（需在startLog前调用） 
+	*  @param[in]    bBinary: true=写入二进制文件(.blog)，用log_decoder离线转换为文本；
+	*                         false=由日志线程渲染为文本写入普通日志文件
+	*  @param[out]   
+	*  @return                    
+	*/
+    void setBinaryMode(bool bBinary);
+    bool getBinaryMode() const { return m_bBinaryMode; }
+
+	//因队列满被丢弃的日志条数
+    quint64 droppedCount() const { return m_droppedTotal.load(std::memory_order_relaxed); }
+
 protected:
 	virtual void logRun(CLogThread* pLogThread);
 
 private:
 	CLogManager(QObject* parent = 0);
 	~CLogManager(void);
-	void writeLog(const QString& strLog);
+	void writeLog(const QByteArray& batch);
 	QString formatLog(const LogData_t& logData);
+	void pushLog(LogData_t&& logData);
+	void pushBinary(const BinLogRecord& rec);
+	int drainLog(QByteArray& batch, QByteArray& binBatch);
+	template <typename T>
+	bool pushRecord(MpscRingBuffer<T>& ring, T&& record);
+	void syncLogFile();
+	void rotateLog();
+	void openBinLog();
+	void rotateBinLog();
+	void writeBinLog(const QByteArray& binBatch);
+	//后台压缩已轮转的日志段并按保留策略清理同类日志段
+	void retireSegment(const QString& strSegment, const QStringList& filters, const QString& strActive);
 
 	// 单例内存回收类
 	class CGarbo
@@ -134,28 +296,64 @@ private:
 
 private:
     static CLogManager* m_pInstance;
+    static std::atomic<int> s_logLevel;
     bool m_bWriteable;
     QFile m_logFile0;
     char m_cUTF8[3];
-    bool m_bStop;
+    std::atomic<bool> m_bStop;
 
 	//多线程对象
     CLogThread m_logThread;
 
-	//读写锁
-    QReadWriteLock m_logWriteLock;
+	//日志数据队列（多线程写入，日志线程批量取出）
+    MpscRingBuffer<LogData_t> m_logRing;
 
-	//日志数据队列
-    QList<LogData_t> m_lstLogData;
+	//延迟格式化日志队列
+    MpscRingBuffer<BinLogRecord> m_binRing;
+
+	//延迟格式化日志输出：二进制文件 / 渲染为文本
+    bool m_bBinaryMode;
+    QFile m_binFile;
+    BinaryLogWriter m_binWriter;
+
+	//startLog时刻的墙钟毫秒与单调时钟纳秒，用于把记录时间戳换算为日期时间
+    qint64 m_startEpochMs;
+    quint64 m_startNs;
+
+	//队列满处理方式
+    std::atomic<int> m_overflowPolicy;
+
+	//落盘周期（毫秒）
+    std::atomic<int> m_syncIntervalMs;
+
+	//尚未补记到日志中的丢弃条数 / 累计丢弃条数
+    std::atomic<quint64> m_droppedPending;
+    std::atomic<quint64> m_droppedTotal;
 
 	//扩展日志输出回调对象
-    CLogOutputCallBack* m_pLogOutputCallBack;
+    std::atomic<CLogOutputCallBack*> m_pLogOutputCallBack;
 
 	//当前操作日志文件名称
     QString m_strLogFilePath;
+
+	//当前日志文件已写字节数（避免每批写入都查询文件大小）
+    qint64 m_logFileSize;
+
+	//轮转与保留策略
+    qint64 m_maxFileBytes;
+	//下次轮转的文件大小：改名失败后推迟一个m_maxFileBytes再重试
+    qint64 m_nextRotateBytes;
+	//当前二进制日志文件已写字节数
+    qint64 m_binFileSize;
+    bool m_bCompressRotated;
+    int m_retainMaxFiles;
+    qint64 m_retainMaxBytes;
+
+	//后台压缩/清理轮转日志段
+    QThreadPool m_rotatePool;
 };
 
-extern "C" void writeLog(ClientLogLevel level, QString msg, const char* file, int line);
+extern "C" MOTIONCONTROLSDK_EXPORT void writeLog(ClientLogLevel level, const QString& msg, const char* file, int line);
 
 /**
 *  @author
@@ -0,0 +1,82 @@
+﻿#pragma once
+
+#include <mutex>
+#include <spdlog/spdlog.h>
+#include <spdlog/sinks/base_sink.h>
+#include <spdlog/details/null_mutex.h>
+#include "CLogManager.h"
+
+//spdlog调用点使用的logger名称（spdlog::get(LOG_SPDLOG_NAME)）
+#define LOG_SPDLOG_NAME "spdlog"
+
+/**
+*  @author
+*  @class       CLogSpdlogSink
+*  @brief       把spdlog日志转入CLogManager的sink，spdlog调用点与LOG_*宏共用同一队列、日志线程和日志文件
+*
+*  CLogManager本身线程安全，sink不再加锁，也不使用spdlog的格式化器（时间、线程、等级由CLogManager统一格式化）。
+*  只有头文件：spdlog以静态库链接时每个模块有各自的logger注册表，
+*  install()需要在使用spdlog的模块（SDK、上层程序）中各调用一次，注册到该模块自己的注册表中。
+*/
+class CLogSpdlogSink : public spdlog::sinks::base_sink<spdlog::details::null_mutex>
+{
+public:
+	/**
+	*  @brief       注册名为LOG_SPDLOG_NAME的logger并设为默认logger（可重复调用）
+	*  @param[in]
+	*  @param[out]
+	*  @return
+	*/
+	static void install()
+	{
+		static std::once_flag s_once;
+		std::call_once(s_once, []()
+		{
+			auto logger = std::make_shared<spdlog::logger>(LOG_SPDLOG_NAME, std::make_shared<CLogSpdlogSink>());
+			//等级过滤由CLogManager的运行期等级决定
+			logger->set_level(spdlog::level::trace);
+			spdlog::drop(LOG_SPDLOG_NAME);
+			spdlog::set_default_logger(logger);
+		});
+	}
+
+protected:
+	void sink_it_(const spdlog::details::log_msg& msg) override
+	{
+		ClientLogLevel_t level = toLogLevel(msg.level);
+		if (level == ELogNone || !CLogManager::isLevelEnabled(level))
+		{
+			return;
+		}
+
+		QString text = QString::fromUtf8(msg.payload.data(), static_cast<int>(msg.payload.size()));
+		const char* file = msg.source.filename ? msg.source.filename : LOG_SPDLOG_NAME;
+		CLogManager::getInstance()->logMessage(level, file, msg.source.line, text);
+	}
+
+	//写出由日志线程负责
+	void flush_() override
+	{
+	}
+
+private:
+	static ClientLogLevel_t toLogLevel(spdlog::level::level_enum level)
+	{
+		switch (level)
+		{
+		case spdlog::level::trace:
+		case spdlog::level::debug:
+			return ELogDebug;
+		case spdlog::level::info:
+			return ELogInfo;
+		case spdlog::level::warn:
+			return ELogWarning;
+		case spdlog::level::err:
+			return ELogError;
+		case spdlog::level::critical:
+			return ELogFatal;
+		default:
+			return ELogNone;
+		}
+	}
+};
@@ -0,0 +1,67 @@
+﻿#include "Crc16.h"
+
+//Modbus crc16 反射多项式
+#define CRC16_POLY 0xA001
+//每轮处理的字节数
+#define CRC16_SLICE 8
+
+namespace
+{
+	/**  slice-by-8 查表：table[0]为标准逐字节表，table[k]为该字节后再经过k个0字节的结果  **/
+	struct Crc16Tables
+	{
+		quint16 table[CRC16_SLICE][256];
+
+		Crc16Tables()
+		{
+			for (int i = 0; i < 256; i++)
+			{
+				quint16 crc = static_cast<quint16>(i);
+				for (int bit = 0; bit < 8; bit++)
+				{
+					crc = (crc & 1) ? static_cast<quint16>((crc >> 1) ^ CRC16_POLY) : static_cast<quint16>(crc >> 1);
+				}
+				table[0][i] = crc;
+			}
+
+			for (int k = 1; k < CRC16_SLICE; k++)
+			{
+				for (int i = 0; i < 256; i++)
+				{
+					quint16 prev = table[k - 1][i];
+					table[k][i] = static_cast<quint16>((prev >> 8) ^ table[0][prev & 0xFF]);
+				}
+			}
+		}
+	};
+
+	//静态初始化，避免函数内静态变量每次调用的守卫判断
+	const Crc16Tables s_crcTables;
+}
+
+
+quint16 Crc16::update(quint16 state, const uchar* data, int len)
+{
+	const quint16 (*t)[256] = s_crcTables.table;
+	quint32 crc = state;
+
+	//每次处理8字节：前2字节与crc异或后查表，后6字节直接查表
+	while (len >= CRC16_SLICE)
+	{
+		crc ^= static_cast<quint32>(data[0]) | (static_cast<quint32>(data[1]) << 8);
+		crc = t[7][crc & 0xFF] ^ t[6][crc >> 8]
+			^ t[5][data[2]] ^ t[4][data[3]]
+			^ t[3][data[4]] ^ t[2][data[5]]
+			^ t[1][data[6]] ^ t[0][data[7]];
+		data += CRC16_SLICE;
+		len -= CRC16_SLICE;
+	}
+
+	//剩余不足8字节逐字节处理
+	while (len-- > 0)
+	{
+		crc = (crc >> 8) ^ t[0][(crc ^ *data++) & 0xFF];
+	}
+
+	return static_cast<quint16>(crc);
+}
@@ -0,0 +1,42 @@
+﻿#pragma once
+#include <QtCore/QtCore>
+
+/**
+*  @author
+*  @class       Crc16
+*  @brief       Modbus CRC16（反射多项式0xA001，初值0xFFFF），slice-by-8查表实现
+*
+*  支持增量计算：state = update(state, data, len) 可分段累加，
+*  组包时先算帧头再算数据区，无需先拷贝到连续缓冲区。
+*  结果与 Utils::MakeCRCCheckBytewise 逐字节查表实现一致。
+*/
+class Crc16
+{
+public:
+	//初始状态
+	static const quint16 InitValue = 0xFFFF;
+
+	/**
+	*  @brief       在已有状态上继续累加一段数据
+	*  @param[in]    state: 上一段的结果（首段传InitValue）  data: 数据  len: 长度
+	*  @param[out]
+	*  @return       新的crc状态
+	*/
+	static quint16 update(quint16 state, const uchar* data, int len);
+
+	static quint16 update(quint16 state, const QByteArray& data)
+	{
+		return update(state, reinterpret_cast<const uchar*>(data.constData()), data.size());
+	}
+
+	/**
+	*  @brief       一次性计算整段数据的crc
+	*  @param[in]
+	*  @param[out]
+	*  @return
+	*/
+	static quint16 compute(const uchar* data, int len)
+	{
+		return update(InitValue, data, len);
+	}
+};
@@ -0,0 +1,388 @@
+﻿#include "MetricsRegistry.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+	const quint64 kMaxValue = (Q_UINT64_C(1) << METRICS_HIST_MAX_BITS) - 1;
+	const quint64 kKeyUsed = Q_UINT64_C(1) << 32;
+
+	quint64 makeKey(int cmdType, int funCode)
+	{
+		return kKeyUsed | (static_cast<quint64>(cmdType & 0xFFFF) << 16) | static_cast<quint64>(funCode & 0xFFFF);
+	}
+
+	template <typename T>
+	T& findOrCreate(std::map<QString, std::unique_ptr<T>>& metrics, const QString& name)
+	{
+		std::unique_ptr<T>& metric = metrics[name];
+		if (!metric)
+		{
+			metric.reset(new T);
+		}
+		return *metric;
+	}
+
+	QString hex4(int value)
+	{
+		return "0x" + QString("%1").arg(value & 0xFFFF, 4, 16, QChar('0')).toUpper();
+	}
+}
+
+// ==================== LatencyHistogram ====================
+
+LatencyHistogram::LatencyHistogram()
+{
+	reset();
+}
+
+int LatencyHistogram::bucketIndex(quint64 ns)
+{
+	if (ns > kMaxValue)
+	{
+		ns = kMaxValue;
+	}
+	if (ns < 2 * METRICS_HIST_SUB_BUCKETS)
+	{
+		return static_cast<int>(ns);
+	}
+	//最高位之下保留SUB_BITS位作为子桶，下标随值单调连续
+	int shift = (63 - qCountLeadingZeroBits(ns)) - METRICS_HIST_SUB_BITS;
+	return (shift << METRICS_HIST_SUB_BITS) + static_cast<int>(ns >> shift);
+}
+
+quint64 LatencyHistogram::bucketValue(int index)
+{
+	if (index < 2 * METRICS_HIST_SUB_BUCKETS)
+	{
+		return static_cast<quint64>(index);
+	}
+	int shift = (index >> METRICS_HIST_SUB_BITS) - 1;
+	quint64 sub = static_cast<quint64>((index & (METRICS_HIST_SUB_BUCKETS - 1)) + METRICS_HIST_SUB_BUCKETS);
+	return (sub << shift) + ((Q_UINT64_C(1) << shift) - 1);
+}
+
+void LatencyHistogram::record(quint64 ns)
+{
+	m_buckets[bucketIndex(ns)].fetch_add(1, std::memory_order_relaxed);
+	m_count.fetch_add(1, std::memory_order_relaxed);
+	m_sum.fetch_add(ns, std::memory_order_relaxed);
+
+	quint64 cur = m_min.load(std::memory_order_relaxed);
+	while (ns < cur && !m_min.compare_exchange_weak(cur, ns, std::memory_order_relaxed))
+	{
+	}
+	cur = m_max.load(std::memory_order_relaxed);
+	while (ns > cur && !m_max.compare_exchange_weak(cur, ns, std::memory_order_relaxed))
+	{
+	}
+}
+
+LatencyHistogram::Snapshot LatencyHistogram::snapshot() const
+{
+	//逐桶读取期间可能有新记录，总数以桶内计数之和为准
+	quint64 counts[METRICS_HIST_BUCKETS];
+	Snapshot snap;
+	for (int i = 0; i < METRICS_HIST_BUCKETS; i++)
+	{
+		counts[i] = m_buckets[i].load(std::memory_order_relaxed);
+		snap.count += counts[i];
+	}
+	if (snap.count == 0)
+	{
+		return snap;
+	}
+
+	snap.min = m_min.load(std::memory_order_relaxed);
+	snap.max = m_max.load(std::memory_order_relaxed);
+	snap.mean = static_cast<double>(m_sum.load(std::memory_order_relaxed)) / qMax<quint64>(1, m_count.load(std::memory_order_relaxed));
+
+	//最近秩：第ceil(q*count)个样本所在桶
+	const double quantiles[] = { 0.50, 0.90, 0.99, 0.999 };
+	quint64* outputs[] = { &snap.p50, &snap.p90, &snap.p99, &snap.p999 };
+	int q = 0;
+	quint64 seen = 0;
+	for (int i = 0; i < METRICS_HIST_BUCKETS && q < 4; i++)
+	{
+		seen += counts[i];
+		while (q < 4 && seen >= static_cast<quint64>(std::ceil(quantiles[q] * snap.count)))
+		{
+			*outputs[q] = qMin(bucketValue(i), snap.max);
+			q++;
+		}
+	}
+	return snap;
+}
+
+void LatencyHistogram::reset()
+{
+	for (int i = 0; i < METRICS_HIST_BUCKETS; i++)
+	{
+		m_buckets[i].store(0, std::memory_order_relaxed);
+	}
+	m_count.store(0, std::memory_order_relaxed);
+	m_sum.store(0, std::memory_order_relaxed);
+	m_min.store(std::numeric_limits<quint64>::max(), std::memory_order_relaxed);
+	m_max.store(0, std::memory_order_relaxed);
+}
+
+// ==================== KeyedMetrics ====================
+
+KeyedMetrics::KeyedMetrics()
+{
+	for (Slot& s : m_slots)
+	{
+		s.key.store(0, std::memory_order_relaxed);
+		s.frames.store(0, std::memory_order_relaxed);
+		s.bytes.store(0, std::memory_order_relaxed);
+		s.histogram.store(nullptr, std::memory_order_relaxed);
+	}
+}
+
+KeyedMetrics::~KeyedMetrics()
+{
+	for (Slot& s : m_slots)
+	{
+		delete s.histogram.load(std::memory_order_relaxed);
+	}
+}
+
+KeyedMetrics::Slot* KeyedMetrics::slot(int cmdType, int funCode)
+{
+	const quint64 key = makeKey(cmdType, funCode);
+	quint32 index = (static_cast<quint32>(key) * 2654435761u) >> 24;
+	for (int probe = 0; probe < METRICS_KEY_SLOTS; probe++)
+	{
+		Slot& s = m_slots[(index + probe) & (METRICS_KEY_SLOTS - 1)];
+		quint64 cur = s.key.load(std::memory_order_acquire);
+		if (cur == key)
+		{
+			return &s;
+		}
+		if (cur == 0)
+		{
+			//抢占空位；失败时可能被同一个键抢先占用
+			if (s.key.compare_exchange_strong(cur, key, std::memory_order_acq_rel) || cur == key)
+			{
+				return &s;
+			}
+		}
+	}
+	m_overflow.add();
+	return nullptr;
+}
+
+void KeyedMetrics::addFrame(int cmdType, int funCode, qint64 bytes)
+{
+	Slot* s = slot(cmdType, funCode);
+	if (s)
+	{
+		s->frames.fetch_add(1, std::memory_order_relaxed);
+		s->bytes.fetch_add(static_cast<quint64>(bytes), std::memory_order_relaxed);
+	}
+}
+
+void KeyedMetrics::recordLatency(int cmdType, int funCode, quint64 ns)
+{
+	Slot* s = slot(cmdType, funCode);
+	if (!s)
+	{
+		return;
+	}
+	s->frames.fetch_add(1, std::memory_order_relaxed);
+
+	LatencyHistogram* histogram = s->histogram.load(std::memory_order_acquire);
+	if (!histogram)
+	{
+		//首次记录时分配，并发分配时保留先写入的一个
+		LatencyHistogram* created = new LatencyHistogram;
+		if (s->histogram.compare_exchange_strong(histogram, created, std::memory_order_acq_rel))
+		{
+			histogram = created;
+		}
+		else
+		{
+			delete created;
+		}
+	}
+	histogram->record(ns);
+}
+
+QVector<KeyedMetrics::Entry> KeyedMetrics::entries() const
+{
+	QVector<Entry> result;
+	for (const Slot& s : m_slots)
+	{
+		quint64 key = s.key.load(std::memory_order_acquire);
+		if (key == 0)
+		{
+			continue;
+		}
+		Entry entry;
+		entry.cmdType = static_cast<int>((key >> 16) & 0xFFFF);
+		entry.funCode = static_cast<int>(key & 0xFFFF);
+		entry.frames = s.frames.load(std::memory_order_relaxed);
+		entry.bytes = s.bytes.load(std::memory_order_relaxed);
+		if (LatencyHistogram* histogram = s.histogram.load(std::memory_order_acquire))
+		{
+			entry.hasLatency = true;
+			entry.latency = histogram->snapshot();
+		}
+		result.append(entry);
+	}
+
+	std::sort(result.begin(), result.end(), [](const Entry& a, const Entry& b) {
+		return a.cmdType != b.cmdType ? a.cmdType < b.cmdType : a.funCode < b.funCode;
+	});
+	return result;
+}
+
+void KeyedMetrics::reset()
+{
+	//保留已占用的键，避免与并发的查找冲突
+	for (Slot& s : m_slots)
+	{
+		s.frames.store(0, std::memory_order_relaxed);
+		s.bytes.store(0, std::memory_order_relaxed);
+		if (LatencyHistogram* histogram = s.histogram.load(std::memory_order_acquire))
+		{
+			histogram->reset();
+		}
+	}
+	m_overflow.reset();
+}
+
+// ==================== MetricsRegistry ====================
+
+MetricsRegistry::MetricsRegistry()
+{
+	m_uptime.start();
+}
+
+MetricsRegistry::~MetricsRegistry()
+{
+}
+
+MetricsRegistry* MetricsRegistry::global()
+{
+	static MetricsRegistry registry;
+	return &registry;
+}
+
+MetricCounter& MetricsRegistry::counter(const QString& name)
+{
+	QMutexLocker locker(&m_mutex);
+	return findOrCreate(m_counters, name);
+}
+
+MetricGauge& MetricsRegistry::gauge(const QString& name)
+{
+	QMutexLocker locker(&m_mutex);
+	return findOrCreate(m_gauges, name);
+}
+
+LatencyHistogram& MetricsRegistry::histogram(const QString& name)
+{
+	QMutexLocker locker(&m_mutex);
+	return findOrCreate(m_histograms, name);
+}
+
+KeyedMetrics& MetricsRegistry::keyed(const QString& name)
+{
+	QMutexLocker locker(&m_mutex);
+	return findOrCreate(m_keyed, name);
+}
+
+QJsonObject MetricsRegistry::histogramJson(const LatencyHistogram::Snapshot& snap)
+{
+	QJsonObject obj;
+	obj["count"] = static_cast<double>(snap.count);
+	obj["min_us"] = snap.min / 1000.0;
+	obj["mean_us"] = snap.mean / 1000.0;
+	obj["p50_us"] = snap.p50 / 1000.0;
+	obj["p90_us"] = snap.p90 / 1000.0;
+	obj["p99_us"] = snap.p99 / 1000.0;
+	obj["p999_us"] = snap.p999 / 1000.0;
+	obj["max_us"] = snap.max / 1000.0;
+	return obj;
+}
+
+QJsonObject MetricsRegistry::snapshot() const
+{
+	QMutexLocker locker(&m_mutex);
+
+	QJsonObject counters;
+	for (const auto& item : m_counters)
+	{
+		counters[item.first] = static_cast<double>(item.second->value());
+	}
+
+	QJsonObject gauges;
+	for (const auto& item : m_gauges)
+	{
+		QJsonObject gauge;
+		gauge["value"] = static_cast<double>(item.second->value());
+		gauge["max"] = static_cast<double>(item.second->max());
+		gauges[item.first] = gauge;
+	}
+
+	QJsonObject histograms;
+	for (const auto& item : m_histograms)
+	{
+		histograms[item.first] = histogramJson(item.second->snapshot());
+	}
+
+	QJsonObject keyed;
+	for (const auto& item : m_keyed)
+	{
+		QJsonArray rows;
+		for (const KeyedMetrics::Entry& entry : item.second->entries())
+		{
+			QJsonObject row;
+			row["cmd_type"] = hex4(entry.cmdType);
+			row["fun_code"] = hex4(entry.funCode);
+			row["frames"] = static_cast<double>(entry.frames);
+			row["bytes"] = static_cast<double>(entry.bytes);
+			if (entry.hasLatency)
+			{
+				row["latency"] = histogramJson(entry.latency);
+			}
+			rows.append(row);
+		}
+		keyed[item.first] = rows;
+		if (item.second->overflow() > 0)
+		{
+			counters[item.first + ".overflow"] = static_cast<double>(item.second->overflow());
+		}
+	}
+
+	QJsonObject result;
+	result["uptime_ms"] = static_cast<double>(m_uptime.elapsed());
+	result["counters"] = counters;
+	result["gauges"] = gauges;
+	result["histograms"] = histograms;
+	result["keyed"] = keyed;
+	return result;
+}
+
+void MetricsRegistry::reset()
+{
+	QMutexLocker locker(&m_mutex);
+	for (auto& item : m_counters)
+	{
+		item.second->reset();
+	}
+	for (auto& item : m_gauges)
+	{
+		item.second->reset();
+	}
+	for (auto& item : m_histograms)
+	{
+		item.second->reset();
+	}
+	for (auto& item : m_keyed)
+	{
+		item.second->reset();
+	}
+}
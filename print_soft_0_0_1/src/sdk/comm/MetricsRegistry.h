@@ -0,0 +1,219 @@
+﻿#pragma once
+#include <QtCore/QtCore>
+#include <atomic>
+#include <map>
+#include <memory>
+#include "motioncontrolsdk_global.h"
+
+//直方图每个数量级的子桶数为2^METRICS_HIST_SUB_BITS，相对误差约3%
+#define METRICS_HIST_SUB_BITS 5
+#define METRICS_HIST_SUB_BUCKETS (1 << METRICS_HIST_SUB_BITS)
+//可记录的最大值为2^METRICS_HIST_MAX_BITS-1纳秒（约18分钟），超出的记入最后一个桶
+#define METRICS_HIST_MAX_BITS 40
+#define METRICS_HIST_BUCKETS ((METRICS_HIST_MAX_BITS - METRICS_HIST_SUB_BITS + 1) * METRICS_HIST_SUB_BUCKETS)
+//按命令类型+命令字分类的表容量（开放寻址，满后新键的记录计入overflow）
+#define METRICS_KEY_SLOTS 256
+
+/**  单调递增计数器  **/
+class MOTIONCONTROLSDK_EXPORT MetricCounter
+{
+public:
+	MetricCounter() : m_value(0) {}
+
+	void add(quint64 n = 1) { m_value.fetch_add(n, std::memory_order_relaxed); }
+	quint64 value() const { return m_value.load(std::memory_order_relaxed); }
+	void reset() { m_value.store(0, std::memory_order_relaxed); }
+
+private:
+	Q_DISABLE_COPY(MetricCounter)
+	std::atomic<quint64> m_value;
+};
+
+/**  瞬时值（队列深度等），同时记录历史最大值  **/
+class MOTIONCONTROLSDK_EXPORT MetricGauge
+{
+public:
+	MetricGauge() : m_value(0), m_max(0) {}
+
+	void set(qint64 value)
+	{
+		m_value.store(value, std::memory_order_relaxed);
+		updateMax(value);
+	}
+
+	void add(qint64 delta)
+	{
+		updateMax(m_value.fetch_add(delta, std::memory_order_relaxed) + delta);
+	}
+
+	qint64 value() const { return m_value.load(std::memory_order_relaxed); }
+	qint64 max() const { return m_max.load(std::memory_order_relaxed); }
+
+	void reset()
+	{
+		m_max.store(value(), std::memory_order_relaxed);
+	}
+
+private:
+	void updateMax(qint64 value)
+	{
+		qint64 cur = m_max.load(std::memory_order_relaxed);
+		while (value > cur && !m_max.compare_exchange_weak(cur, value, std::memory_order_relaxed))
+		{
+		}
+	}
+
+	Q_DISABLE_COPY(MetricGauge)
+	std::atomic<qint64> m_value;
+	std::atomic<qint64> m_max;
+};
+
+/**
+*  @author
+*  @class       LatencyHistogram
+*  @brief       HDR风格的对数-线性延迟直方图（纳秒）
+*
+*  小于2^(SUB_BITS+1)的值每个值一个桶，之上每个2的幂区间再等分为2^SUB_BITS个子桶，
+*  桶固定分配，记录只有几次原子加，不加锁不分配内存。分位数取所在桶的上界。
+*/
+class MOTIONCONTROLSDK_EXPORT LatencyHistogram
+{
+public:
+	/**  直方图快照（纳秒）  **/
+	struct Snapshot
+	{
+		quint64 count = 0;
+		quint64 min = 0;
+		quint64 max = 0;
+		double mean = 0;
+		quint64 p50 = 0;
+		quint64 p90 = 0;
+		quint64 p99 = 0;
+		quint64 p999 = 0;
+	};
+
+	LatencyHistogram();
+
+	//记录一次耗时（线程安全）
+	void record(quint64 ns);
+
+	Snapshot snapshot() const;
+
+	void reset();
+
+	//值所在桶的下标
+	static int bucketIndex(quint64 ns);
+
+	//桶内可表示的最大值
+	static quint64 bucketValue(int index);
+
+private:
+	Q_DISABLE_COPY(LatencyHistogram)
+	std::atomic<quint64> m_buckets[METRICS_HIST_BUCKETS];
+	std::atomic<quint64> m_count;
+	std::atomic<quint64> m_sum;
+	std::atomic<quint64> m_min;
+	std::atomic<quint64> m_max;
+};
+
+/**
+*  @author
+*  @class       KeyedMetrics
+*  @brief       按命令类型+命令字分类的帧数/字节数，可附带每类的延迟直方图
+*
+*  固定容量的开放寻址表，新键通过CAS占用空位，查找和累加均无锁；直方图在某类首次记录延迟时分配。
+*/
+class MOTIONCONTROLSDK_EXPORT KeyedMetrics
+{
+public:
+	/**  单类统计快照  **/
+	struct Entry
+	{
+		int cmdType = 0;
+		int funCode = 0;
+		quint64 frames = 0;
+		quint64 bytes = 0;
+		bool hasLatency = false;
+		LatencyHistogram::Snapshot latency;
+	};
+
+	KeyedMetrics();
+	~KeyedMetrics();
+
+	//累加一帧
+	void addFrame(int cmdType, int funCode, qint64 bytes);
+
+	//记录一次延迟，同时计为一帧
+	void recordLatency(int cmdType, int funCode, quint64 ns);
+
+	//已出现的全部分类
+	QVector<Entry> entries() const;
+
+	//表满后未能记录的次数
+	quint64 overflow() const { return m_overflow.value(); }
+
+	void reset();
+
+private:
+	struct Slot
+	{
+		std::atomic<quint64> key;		//0=空位，否则为 (cmdType<<16 | funCode) | 1<<32
+		std::atomic<quint64> frames;
+		std::atomic<quint64> bytes;
+		std::atomic<LatencyHistogram*> histogram;
+	};
+
+	Slot* slot(int cmdType, int funCode);
+
+private:
+	Q_DISABLE_COPY(KeyedMetrics)
+	Slot m_slots[METRICS_KEY_SLOTS];
+	MetricCounter m_overflow;
+};
+
+/**
+*  @author
+*  @class       MetricsRegistry
+*  @brief       进程内指标注册表：计数器、瞬时值、延迟直方图和按命令分类的统计
+*
+*  按名称注册，同名返回同一对象，对象在注册表生命周期内地址不变。注册时加锁，
+*  热路径应在初始化时取得引用并缓存，之后的更新都是无锁原子操作。
+*  名称约定为 模块.指标，如 protocol.crc_errors、tcp.queue_depth.bulk。
+*/
+class MOTIONCONTROLSDK_EXPORT MetricsRegistry
+{
+public:
+	MetricsRegistry();
+	~MetricsRegistry();
+
+	//SDK默认使用的全局注册表
+	static MetricsRegistry* global();
+
+	MetricCounter& counter(const QString& name);
+	MetricGauge& gauge(const QString& name);
+	LatencyHistogram& histogram(const QString& name);
+	KeyedMetrics& keyed(const QString& name);
+
+	/**
+	*  @brief       生成全部指标的快照（延迟单位微秒）
+	*  @param[in]
+	*  @param[out]
+	*  @return       {uptime_ms, counters{}, gauges{name:{value,max}}, histograms{name:{count,min_us,mean_us,p50_us,...}},
+	*                keyed{name:[{cmd_type,fun_code,frames,bytes[,latency]}]}}
+	*/
+	QJsonObject snapshot() const;
+
+	//计数器和直方图清零，瞬时值保留当前值、最大值从当前值重新开始
+	void reset();
+
+	static QJsonObject histogramJson(const LatencyHistogram::Snapshot& snap);
+
+private:
+	Q_DISABLE_COPY(MetricsRegistry)
+	mutable QMutex m_mutex;
+	QElapsedTimer m_uptime;
+	std::map<QString, std::unique_ptr<MetricCounter>> m_counters;
+	std::map<QString, std::unique_ptr<MetricGauge>> m_gauges;
+	std::map<QString, std::unique_ptr<LatencyHistogram>> m_histograms;
+	std::map<QString, std::unique_ptr<KeyedMetrics>> m_keyed;
+};
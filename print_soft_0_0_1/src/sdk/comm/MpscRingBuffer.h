@@ -0,0 +1,126 @@
+﻿#pragma once
+#include <QtCore/QtCore>
+#include <atomic>
+#include <memory>
+#include <utility>
+
+/**
+*  @author
+*  @class       MpscRingBuffer
+*  @brief       有界无锁多生产者单消费者环形队列
+*
+*  每个槽位带一个序号：生产者用CAS抢占写游标后写入槽位，再发布序号；
+*  消费者只在序号表明槽位已写完时取出。生产者之间只竞争一个原子变量，
+*  队列满时tryPush立即返回false，不会阻塞调用线程。
+*  tryPop只能在唯一的消费线程中调用。
+*/
+template <typename T>
+class MpscRingBuffer
+{
+public:
+	/**
+	*  @brief       构造
+	*  @param[in]    capacity: 容量，向上取整为2的幂
+	*  @param[out]
+	*  @return
+	*/
+	explicit MpscRingBuffer(int capacity)
+	{
+		quint64 cap = 2;
+		while (cap < static_cast<quint64>(capacity))
+		{
+			cap <<= 1;
+		}
+		m_mask = cap - 1;
+		m_cells.reset(new Cell[cap]);
+		for (quint64 i = 0; i < cap; ++i)
+		{
+			m_cells[i].seq.store(i, std::memory_order_relaxed);
+		}
+	}
+
+	/**
+	*  @brief       入队（任意线程）
+	*  @param[in]    value: 元素，成功时被移走
+	*  @param[out]
+	*  @return       false=队列已满，value保持不变
+	*/
+	bool tryPush(T&& value)
+	{
+		Cell* cell = nullptr;
+		quint64 pos = m_enqueuePos.load(std::memory_order_relaxed);
+		for (;;)
+		{
+			cell = &m_cells[pos & m_mask];
+			quint64 seq = cell->seq.load(std::memory_order_acquire);
+			qint64 dif = static_cast<qint64>(seq) - static_cast<qint64>(pos);
+			if (dif == 0)
+			{
+				if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+				{
+					break;
+				}
+			}
+			else if (dif < 0)
+			{
+				return false;
+			}
+			else
+			{
+				pos = m_enqueuePos.load(std::memory_order_relaxed);
+			}
+		}
+		cell->value = std::move(value);
+		cell->seq.store(pos + 1, std::memory_order_release);
+		return true;
+	}
+
+	/**
+	*  @brief       出队（仅消费线程）
+	*  @param[in]
+	*  @param[out]   value: 取出的元素
+	*  @return       false=队列为空（或队首槽位尚未写完）
+	*/
+	bool tryPop(T& value)
+	{
+		quint64 pos = m_dequeuePos.load(std::memory_order_relaxed);
+		Cell* cell = &m_cells[pos & m_mask];
+		quint64 seq = cell->seq.load(std::memory_order_acquire);
+		if (static_cast<qint64>(seq) - static_cast<qint64>(pos + 1) < 0)
+		{
+			return false;
+		}
+		value = std::move(cell->value);
+		cell->seq.store(pos + m_mask + 1, std::memory_order_release);
+		m_dequeuePos.store(pos + 1, std::memory_order_relaxed);
+		return true;
+	}
+
+	//容量
+	int capacity() const { return static_cast<int>(m_mask + 1); }
+
+	//近似元素个数（并发写入时仅供统计）
+	int sizeApprox() const
+	{
+		quint64 head = m_enqueuePos.load(std::memory_order_relaxed);
+		quint64 tail = m_dequeuePos.load(std::memory_order_relaxed);
+		return head > tail ? static_cast<int>(head - tail) : 0;
+	}
+
+private:
+	struct Cell
+	{
+		std::atomic<quint64> seq;
+		T value;
+	};
+
+	MpscRingBuffer(const MpscRingBuffer&) = delete;
+	MpscRingBuffer& operator=(const MpscRingBuffer&) = delete;
+
+private:
+	std::unique_ptr<Cell[]> m_cells;
+	quint64 m_mask = 0;
+	//生产者写游标与消费者读游标分处不同缓存行，避免互相失效
+	alignas(64) std::atomic<quint64> m_enqueuePos{ 0 };
+	alignas(64) std::atomic<quint64> m_dequeuePos{ 0 };
+};
@@ -0,0 +1,279 @@
+﻿#include "TraceRecorder.h"
+#include <memory>
+#include <vector>
+
+std::atomic<bool> TraceRecorder::s_enabled(false);
+
+namespace
+{
+	/**  单个线程的事件缓冲区，只由所属线程写入；线程退出后归还，进程结束前不释放  **/
+	struct ThreadBuffer
+	{
+		int tid = 0;						//时间线中的线程序号
+		QByteArray name;					//受s_bufferMutex保护
+		bool inUse = false;					//受s_bufferMutex保护，所属线程退出后为false
+		std::unique_ptr<TraceEvent[]> events;
+		std::atomic<int> count;
+		std::atomic<quint32> generation;
+		std::atomic<quint64> dropped;
+	};
+
+	QMutex s_bufferMutex;
+	std::vector<std::unique_ptr<ThreadBuffer>> s_buffers;
+	//每次开始追踪加一，各线程写入时发现代数号变化即复位自己的缓冲区
+	std::atomic<quint32> s_generation(0);
+	std::atomic<quint64> s_startNs(0);
+	int s_nextTid = 0;						//受s_bufferMutex保护
+
+	/**  线程退出时归还缓冲区，线程频繁创建销毁（线程池伸缩）时缓冲区数量不随之增长  **/
+	struct ThreadBufferHolder
+	{
+		ThreadBuffer* buffer = nullptr;
+
+		~ThreadBufferHolder()
+		{
+			if (buffer)
+			{
+				QMutexLocker locker(&s_bufferMutex);
+				buffer->inUse = false;
+			}
+		}
+	};
+	thread_local ThreadBufferHolder t_holder;
+
+	ThreadBuffer* localBuffer()
+	{
+		if (t_holder.buffer)
+		{
+			return t_holder.buffer;
+		}
+
+		QThread* thread = QThread::currentThread();
+		QByteArray name = thread ? thread->objectName().toUtf8() : QByteArray();
+		quint32 generation = s_generation.load(std::memory_order_acquire);
+
+		QMutexLocker locker(&s_bufferMutex);
+
+		//复用已退出线程的缓冲区；其中仍有本次追踪记录的保留到导出
+		ThreadBuffer* buffer = nullptr;
+		for (const auto& item : s_buffers)
+		{
+			if (!item->inUse && (item->generation.load(std::memory_order_relaxed) != generation ||
+				item->count.load(std::memory_order_relaxed) == 0))
+			{
+				buffer = item.get();
+				break;
+			}
+		}
+		if (!buffer)
+		{
+			std::unique_ptr<ThreadBuffer> created(new ThreadBuffer);
+			created->events.reset(new TraceEvent[TRACE_THREAD_EVENTS]);
+			buffer = created.get();
+			s_buffers.push_back(std::move(created));
+		}
+
+		buffer->inUse = true;
+		buffer->count.store(0, std::memory_order_relaxed);
+		buffer->dropped.store(0, std::memory_order_relaxed);
+		buffer->generation.store(generation, std::memory_order_relaxed);
+		buffer->tid = ++s_nextTid;
+		buffer->name = name.isEmpty() ? "thread " + QByteArray::number(buffer->tid) : name;
+		t_holder.buffer = buffer;
+		return buffer;
+	}
+
+	void appendJsonString(QByteArray& out, const QByteArray& value)
+	{
+		out.append('"');
+		for (char c : value)
+		{
+			if (c == '"' || c == '\\')
+			{
+				out.append('\\');
+			}
+			out.append(c);
+		}
+		out.append('"');
+	}
+
+	//纳秒 -> 微秒（Chrome trace的时间单位）
+	void appendMicros(QByteArray& out, qint64 ns)
+	{
+		out.append(QByteArray::number(ns / 1000.0, 'f', 3));
+	}
+}
+
+void TraceRecorder::start()
+{
+	s_startNs.store(nowNs(), std::memory_order_relaxed);
+	s_generation.fetch_add(1, std::memory_order_release);
+	s_enabled.store(true, std::memory_order_relaxed);
+}
+
+void TraceRecorder::stop()
+{
+	s_enabled.store(false, std::memory_order_relaxed);
+}
+
+void TraceRecorder::setThreadName(const char* name)
+{
+	ThreadBuffer* buffer = localBuffer();
+	QMutexLocker locker(&s_bufferMutex);
+	buffer->name = name;
+}
+
+void TraceRecorder::record(const TraceEvent& event)
+{
+	ThreadBuffer* buffer = localBuffer();
+
+	quint32 generation = s_generation.load(std::memory_order_acquire);
+	if (buffer->generation.load(std::memory_order_relaxed) != generation)
+	{
+		buffer->count.store(0, std::memory_order_relaxed);
+		buffer->dropped.store(0, std::memory_order_relaxed);
+		buffer->generation.store(generation, std::memory_order_release);
+	}
+
+	int count = buffer->count.load(std::memory_order_relaxed);
+	if (count >= TRACE_THREAD_EVENTS)
+	{
+		buffer->dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+	buffer->events[count] = event;
+	buffer->count.store(count + 1, std::memory_order_release);
+}
+
+void TraceRecorder::instant(const char* name, const char* argName0, qint64 argValue0, const char* argName1, qint64 argValue1)
+{
+	TraceEvent event = { name, 'i', nowNs(), 0, 0, { argName0, argName1 }, { argValue0, argValue1 } };
+	record(event);
+}
+
+void TraceRecorder::complete(const char* name, quint64 startNs, quint64 durNs, const char* argName0, qint64 argValue0, const char* argName1, qint64 argValue1)
+{
+	TraceEvent event = { name, 'X', startNs, durNs, 0, { argName0, argName1 }, { argValue0, argValue1 } };
+	record(event);
+}
+
+void TraceRecorder::asyncBegin(const char* name, quint64 id, const char* argName0, qint64 argValue0, const char* argName1, qint64 argValue1)
+{
+	TraceEvent event = { name, 'b', nowNs(), 0, id, { argName0, argName1 }, { argValue0, argValue1 } };
+	record(event);
+}
+
+void TraceRecorder::asyncEnd(const char* name, quint64 id)
+{
+	TraceEvent event = { name, 'e', nowNs(), 0, id, { nullptr, nullptr }, { 0, 0 } };
+	record(event);
+}
+
+quint64 TraceRecorder::droppedEvents()
+{
+	quint32 generation = s_generation.load(std::memory_order_acquire);
+	quint64 dropped = 0;
+
+	QMutexLocker locker(&s_bufferMutex);
+	for (const auto& buffer : s_buffers)
+	{
+		if (buffer->generation.load(std::memory_order_acquire) == generation)
+		{
+			dropped += buffer->dropped.load(std::memory_order_relaxed);
+		}
+	}
+	return dropped;
+}
+
+QByteArray TraceRecorder::exportJson()
+{
+	const quint32 generation = s_generation.load(std::memory_order_acquire);
+	const qint64 startNs = static_cast<qint64>(s_startNs.load(std::memory_order_relaxed));
+	const QByteArray pid = QByteArray::number(QCoreApplication::applicationPid());
+
+	QByteArray out;
+	out.append("{\"traceEvents\":[");
+	bool first = true;
+
+	QMutexLocker locker(&s_bufferMutex);
+	for (const auto& buffer : s_buffers)
+	{
+		//本次追踪中没有写入过的线程，缓冲区里是上一次的记录
+		if (buffer->generation.load(std::memory_order_acquire) != generation)
+		{
+			continue;
+		}
+		int count = buffer->count.load(std::memory_order_acquire);
+		if (count == 0)
+		{
+			continue;
+		}
+
+		const QByteArray tid = QByteArray::number(buffer->tid);
+		out.append(first ? "\n" : ",\n");
+		first = false;
+		out.append("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":").append(pid).append(",\"tid\":").append(tid);
+		out.append(",\"args\":{\"name\":");
+		appendJsonString(out, buffer->name);
+		out.append("}}");
+
+		for (int i = 0; i < count; i++)
+		{
+			const TraceEvent& event = buffer->events[i];
+			out.append(",\n{\"name\":");
+			appendJsonString(out, event.name);
+			out.append(",\"cat\":\"sdk\",\"ph\":\"").append(event.phase).append("\",\"ts\":");
+			appendMicros(out, static_cast<qint64>(event.tsNs) - startNs);
+			if (event.phase == 'X')
+			{
+				out.append(",\"dur\":");
+				appendMicros(out, static_cast<qint64>(event.durNs));
+			}
+			else if (event.phase == 'i')
+			{
+				out.append(",\"s\":\"t\"");
+			}
+			else
+			{
+				out.append(",\"id\":\"0x").append(QByteArray::number(event.id, 16)).append('"');
+			}
+			out.append(",\"pid\":").append(pid).append(",\"tid\":").append(tid);
+
+			if (event.argNames[0] || event.argNames[1])
+			{
+				out.append(",\"args\":{");
+				bool firstArg = true;
+				for (int a = 0; a < TRACE_MAX_ARGS; a++)
+				{
+					if (!event.argNames[a])
+					{
+						continue;
+					}
+					if (!firstArg)
+					{
+						out.append(',');
+					}
+					firstArg = false;
+					appendJsonString(out, event.argNames[a]);
+					out.append(':').append(QByteArray::number(event.args[a]));
+				}
+				out.append('}');
+			}
+			out.append('}');
+		}
+	}
+
+	out.append("\n],\"displayTimeUnit\":\"ns\"}\n");
+	return out;
+}
+
+bool TraceRecorder::exportToFile(const QString& filePath)
+{
+	QFile file(filePath);
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+	{
+		return false;
+	}
+	QByteArray json = exportJson();
+	return file.write(json) == json.size();
+}
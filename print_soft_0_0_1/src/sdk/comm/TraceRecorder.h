@@ -0,0 +1,143 @@
+﻿#pragma once
+#include <QtCore/QtCore>
+#include <atomic>
+#include <chrono>
+#include "motioncontrolsdk_global.h"
+
+//每个线程缓冲区可记录的事件数，写满后丢弃并计数
+#define TRACE_THREAD_EVENTS 65536
+//每个事件最多携带的参数个数
+#define TRACE_MAX_ARGS 2
+
+#define TRACE_CONCAT_IMPL(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_IMPL(a, b)
+
+//作用域耗时事件：从定义处到作用域结束，可附带最多两个数值参数
+#define TRACE_SCOPE(name, ...) \
+	TraceScope TRACE_CONCAT(traceScope_, __LINE__)(name, ##__VA_ARGS__)
+
+//瞬时事件；未开启时只有一次原子读，不对参数求值
+#define TRACE_INSTANT(name, ...) \
+	do { if (TraceRecorder::isEnabled()) { TraceRecorder::instant(name, ##__VA_ARGS__); } } while (0)
+
+//跨线程的异步区间（同一id的begin/end配对）
+#define TRACE_ASYNC_BEGIN(name, id, ...) \
+	do { if (TraceRecorder::isEnabled()) { TraceRecorder::asyncBegin(name, id, ##__VA_ARGS__); } } while (0)
+
+#define TRACE_ASYNC_END(name, id) \
+	do { if (TraceRecorder::isEnabled()) { TraceRecorder::asyncEnd(name, id); } } while (0)
+
+/**  线程缓冲区中的一条事件，名称和参数名须为静态字符串  **/
+struct TraceEvent
+{
+	const char* name;
+	char phase;								//'X'耗时 'i'瞬时 'b'/'e'异步开始/结束
+	quint64 tsNs;
+	quint64 durNs;
+	quint64 id;								//异步事件id
+	const char* argNames[TRACE_MAX_ARGS];	//nullptr=无此参数
+	qint64 args[TRACE_MAX_ARGS];
+};
+
+/**
+*  @author
+*  @class       TraceRecorder
+*  @brief       命令流水线的时间线追踪，导出为Chrome trace-event JSON（chrome://tracing、Perfetto可直接打开）
+*
+*  每个线程首次记录时分配自己的定长缓冲区，写入只由本线程进行，不加锁；开始/清空通过代数号让各线程
+*  在下一次写入时自行复位缓冲区。线程退出后缓冲区归还，由之后新建的线程复用。未开启时每个追踪点只有一次relaxed原子读，可保留在发布版本中。
+*  导出在停止后进行，期间仍在写入的事件可能不完整地出现在结果中。
+*/
+class MOTIONCONTROLSDK_EXPORT TraceRecorder
+{
+public:
+	static bool isEnabled()
+	{
+		return s_enabled.load(std::memory_order_relaxed);
+	}
+
+	//清空之前的记录并开始追踪
+	static void start();
+
+	static void stop();
+
+	//单调时钟纳秒
+	static quint64 nowNs()
+	{
+		return static_cast<quint64>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count());
+	}
+
+	//设置当前线程在时间线中显示的名称（非Qt线程使用；Qt线程默认取QThread::objectName）
+	static void setThreadName(const char* name);
+
+	static void instant(const char* name, const char* argName0 = nullptr, qint64 argValue0 = 0,
+		const char* argName1 = nullptr, qint64 argValue1 = 0);
+
+	static void complete(const char* name, quint64 startNs, quint64 durNs, const char* argName0 = nullptr, qint64 argValue0 = 0,
+		const char* argName1 = nullptr, qint64 argValue1 = 0);
+
+	static void asyncBegin(const char* name, quint64 id, const char* argName0 = nullptr, qint64 argValue0 = 0,
+		const char* argName1 = nullptr, qint64 argValue1 = 0);
+
+	static void asyncEnd(const char* name, quint64 id);
+
+	/**
+	*  @brief       导出当前记录为Chrome trace-event JSON
+	*  @param[in]
+	*  @param[out]
+	*  @return       {"traceEvents":[...],"displayTimeUnit":"ns"}，时间戳单位微秒、从开始追踪时计
+	*/
+	static QByteArray exportJson();
+
+	/**
+	*  @brief       导出到文件
+	*  @param[in]    filePath: 输出路径
+	*  @param[out]
+	*  @return       false=文件写入失败
+	*/
+	static bool exportToFile(const QString& filePath);
+
+	//因缓冲区写满而丢弃的事件数
+	static quint64 droppedEvents();
+
+private:
+	static void record(const TraceEvent& event);
+
+	static std::atomic<bool> s_enabled;
+};
+
+/**  RAII作用域事件，构造时未开启追踪则析构时也不记录  **/
+class TraceScope
+{
+public:
+	explicit TraceScope(const char* name, const char* argName0 = nullptr, qint64 argValue0 = 0,
+		const char* argName1 = nullptr, qint64 argValue1 = 0)
+		:m_name(name)
+		,m_startNs(TraceRecorder::isEnabled() ? TraceRecorder::nowNs() : 0)
+	{
+		if (m_startNs)
+		{
+			m_argNames[0] = argName0;
+			m_argNames[1] = argName1;
+			m_args[0] = argValue0;
+			m_args[1] = argValue1;
+		}
+	}
+
+	~TraceScope()
+	{
+		if (m_startNs && TraceRecorder::isEnabled())
+		{
+			TraceRecorder::complete(m_name, m_startNs, TraceRecorder::nowNs() - m_startNs,
+				m_argNames[0], m_args[0], m_argNames[1], m_args[1]);
+		}
+	}
+
+private:
+	Q_DISABLE_COPY(TraceScope)
+	const char* m_name;
+	quint64 m_startNs;
+	const char* m_argNames[TRACE_MAX_ARGS];
+	qint64 m_args[TRACE_MAX_ARGS];
+};
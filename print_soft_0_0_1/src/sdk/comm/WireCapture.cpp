@@ -0,0 +1,208 @@
+﻿#include "WireCapture.h"
+#include <QtConcurrent/QtConcurrent>
+#include <chrono>
+
+namespace
+{
+	quint64 monotonicNs()
+	{
+		return static_cast<quint64>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count());
+	}
+
+	void putVarint(QByteArray& out, quint64 value)
+	{
+		while (value >= 0x80)
+		{
+			out.append(static_cast<char>((value & 0x7F) | 0x80));
+			value >>= 7;
+		}
+		out.append(static_cast<char>(value));
+	}
+
+	void putFixed64(QByteArray& out, quint64 value)
+	{
+		uchar buf[8];
+		qToLittleEndian(value, buf);
+		out.append(reinterpret_cast<const char*>(buf), 8);
+	}
+}
+
+WireCapture::WireCapture()
+	:m_active(false)
+	,m_capturedBytes(0)
+{
+	//单线程保证换出的缓存按提交顺序写入
+	m_writePool.setMaxThreadCount(1);
+}
+
+WireCapture::~WireCapture()
+{
+	close();
+}
+
+bool WireCapture::open(const QString& filePath)
+{
+	close();
+
+	QMutexLocker locker(&m_mutex);
+	m_file.setFileName(filePath);
+	if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+	{
+		return false;
+	}
+
+	m_lastNs = monotonicNs();
+	m_buffer.clear();
+	m_buffer.reserve(WIRECAP_FLUSH_SIZE * 2);
+	m_buffer.append(WIRECAP_FILE_MAGIC, WIRECAP_FILE_MAGIC_SIZE);
+	putFixed64(m_buffer, static_cast<quint64>(QDateTime::currentMSecsSinceEpoch()));
+	putFixed64(m_buffer, m_lastNs);
+	m_capturedBytes.store(0, std::memory_order_relaxed);
+	m_bOpen = true;
+	m_active.store(true, std::memory_order_relaxed);
+	return true;
+}
+
+void WireCapture::close()
+{
+	m_active.store(false, std::memory_order_relaxed);
+
+	QMutexLocker locker(&m_mutex);
+	if (!m_bOpen)
+	{
+		return;
+	}
+	m_bOpen = false;
+	flush();
+	locker.unlock();
+
+	//等待已提交的缓存全部写完再关闭文件
+	m_writePool.waitForDone();
+	m_file.close();
+}
+
+void WireCapture::append(EWireDirection direction, const char* data, qint64 len)
+{
+	if (len <= 0)
+	{
+		return;
+	}
+
+	QMutexLocker locker(&m_mutex);
+	//加锁后再判断，close之后到达的数据不再写入
+	if (!m_bOpen)
+	{
+		return;
+	}
+
+	//时间在锁内获取，文件中的记录按时间递增
+	quint64 nowNs = monotonicNs();
+	m_buffer.append(static_cast<char>(direction));
+	putVarint(m_buffer, nowNs - m_lastNs);
+	putVarint(m_buffer, static_cast<quint64>(len));
+	m_buffer.append(data, static_cast<int>(len));
+	m_lastNs = nowNs;
+	m_capturedBytes.fetch_add(static_cast<quint64>(len), std::memory_order_relaxed);
+
+	if (m_buffer.size() >= WIRECAP_FLUSH_SIZE)
+	{
+		flush();
+	}
+}
+
+void WireCapture::flush()
+{
+	if (m_buffer.isEmpty())
+	{
+		return;
+	}
+
+	//锁内只交换缓存，文件写入在后台线程完成
+	QByteArray chunk;
+	chunk.swap(m_buffer);
+	QFile* pFile = &m_file;
+	QtConcurrent::run(&m_writePool, [pFile, chunk]()
+	{
+		pFile->write(chunk);
+	});
+}
+
+bool WireCaptureReader::open(const QByteArray& data)
+{
+	m_data = data;
+	m_error.clear();
+
+	if (m_data.size() < WIRECAP_FILE_HEADER_SIZE || !m_data.startsWith(WIRECAP_FILE_MAGIC))
+	{
+		m_pos = 0;
+		m_error = QStringLiteral("not a wire capture file");
+		return false;
+	}
+
+	const uchar* p = reinterpret_cast<const uchar*>(m_data.constData()) + WIRECAP_FILE_MAGIC_SIZE;
+	m_startEpochMs = static_cast<qint64>(qFromLittleEndian<quint64>(p));
+	rewind();
+	return true;
+}
+
+void WireCaptureReader::rewind()
+{
+	m_pos = WIRECAP_FILE_HEADER_SIZE;
+	m_offsetNs = 0;
+}
+
+bool WireCaptureReader::readVarint(quint64& value)
+{
+	value = 0;
+	for (int shift = 0; shift < 64; shift += 7)
+	{
+		if (m_pos >= m_data.size())
+		{
+			return false;
+		}
+		uchar byte = static_cast<uchar>(m_data.at(m_pos++));
+		value |= static_cast<quint64>(byte & 0x7F) << shift;
+		if (!(byte & 0x80))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+bool WireCaptureReader::next(WireChunk& chunk)
+{
+	if (m_pos >= m_data.size())
+	{
+		return false;
+	}
+
+	char tag = m_data.at(m_pos++);
+	if (tag != Wire_Inbound && tag != Wire_Outbound)
+	{
+		m_error = QString("unknown direction 0x%1 at offset %2").arg(static_cast<uchar>(tag), 2, 16, QChar('0')).arg(m_pos - 1);
+		m_pos = m_data.size();
+		return false;
+	}
+
+	quint64 dts, len;
+	if (!readVarint(dts) || !readVarint(len) || len > static_cast<quint64>(m_data.size() - m_pos))
+	{
+		return truncated();
+	}
+
+	m_offsetNs += dts;
+	chunk.direction = static_cast<EWireDirection>(tag);
+	chunk.offsetNs = m_offsetNs;
+	chunk.data = m_data.mid(m_pos, static_cast<int>(len));
+	m_pos += static_cast<int>(len);
+	return true;
+}
+
+bool WireCaptureReader::truncated()
+{
+	m_error = QString("truncated record at offset %1").arg(m_pos);
+	m_pos = m_data.size();
+	return false;
+}
@@ -0,0 +1,128 @@
+﻿#pragma once
+#include <QtCore/QtCore>
+#include <atomic>
+#include "motioncontrolsdk_global.h"
+
+//抓包文件头魔数
+#define WIRECAP_FILE_MAGIC "PMWCAP01"
+#define WIRECAP_FILE_MAGIC_SIZE 8
+//文件头长度：魔数(8) + 起始墙钟毫秒(8) + 起始单调时钟纳秒(8)
+#define WIRECAP_FILE_HEADER_SIZE 24
+//写缓存超过该长度时交给后台线程写入文件
+#define WIRECAP_FLUSH_SIZE (64*1024)
+
+/**  数据方向  **/
+enum EWireDirection
+{
+	Wire_Inbound = 'I',		//从socket读到的数据
+	Wire_Outbound = 'O'		//写入socket的数据
+};
+
+/**  抓包文件中的一段数据  **/
+struct WireChunk
+{
+	EWireDirection direction = Wire_Inbound;
+	quint64 offsetNs = 0;		//距抓包开始的单调时钟纳秒
+	QByteArray data;
+};
+
+/**
+*  @author
+*  @class       WireCapture
+*  @brief       传输层原始收发数据抓包，写入紧凑的二进制文件，供离线回放复现现场问题
+*
+*  文件格式（小端）：
+*    文件头  魔数"PMWCAP01" + 起始墙钟毫秒(i64) + 起始单调时钟纳秒(u64)
+*    记录    方向('I'/'O') + 距上一条的时间差(ns) + 长度 + 原始数据
+*  时间差和长度为LEB128变长编码。未开启时record只有一次原子读；开启后在socket线程中
+*  只做内存拷贝，累积到WIRECAP_FLUSH_SIZE后在锁内换出缓存，由单线程写文件池按顺序写入，
+*  socket线程不做文件IO。
+*/
+class MOTIONCONTROLSDK_EXPORT WireCapture
+{
+public:
+	WireCapture();
+	~WireCapture();
+
+	/**
+	*  @brief       开始抓包（已在抓包时先结束之前的文件）
+	*  @param[in]    filePath: 输出文件路径
+	*  @param[out]
+	*  @return       false=文件无法创建
+	*/
+	bool open(const QString& filePath);
+
+	//结束抓包，写出缓存，等待后台写完后关闭文件
+	void close();
+
+	bool isOpen() const { return m_active.load(std::memory_order_relaxed); }
+
+	//记录一段收发数据（线程安全）
+	void record(EWireDirection direction, const char* data, qint64 len)
+	{
+		if (isOpen())
+		{
+			append(direction, data, len);
+		}
+	}
+
+	//已记录的数据字节数（不含文件头和记录头）
+	quint64 capturedBytes() const { return m_capturedBytes.load(std::memory_order_relaxed); }
+
+private:
+	void append(EWireDirection direction, const char* data, qint64 len);
+	void flush();
+
+private:
+	Q_DISABLE_COPY(WireCapture)
+	std::atomic<bool> m_active;
+	std::atomic<quint64> m_capturedBytes;
+	QMutex m_mutex;
+	QFile m_file;				//打开后只在m_writePool线程中写入
+	bool m_bOpen = false;		//受m_mutex保护，socket线程不直接访问m_file
+	QByteArray m_buffer;
+	QThreadPool m_writePool;
+	quint64 m_lastNs = 0;
+};
+
+/**
+*  @author
+*  @class       WireCaptureReader
+*  @brief       解析抓包文件（回放工具使用）
+*/
+class MOTIONCONTROLSDK_EXPORT WireCaptureReader
+{
+public:
+	/**
+	*  @brief       载入文件内容并校验文件头
+	*  @param[in]
+	*  @param[out]
+	*  @return       false=不是抓包文件
+	*/
+	bool open(const QByteArray& data);
+
+	/**
+	*  @brief       读取下一段数据
+	*  @param[in]
+	*  @param[out]   chunk: 解析结果
+	*  @return       false=已到末尾或文件损坏（见errorString）
+	*/
+	bool next(WireChunk& chunk);
+
+	//回到第一条记录
+	void rewind();
+
+	qint64 startEpochMs() const { return m_startEpochMs; }
+	QString errorString() const { return m_error; }
+
+private:
+	bool readVarint(quint64& value);
+	bool truncated();
+
+private:
+	QByteArray m_data;
+	int m_pos = 0;
+	qint64 m_startEpochMs = 0;
+	quint64 m_offsetNs = 0;
+	QString m_error;
+};
@@ -1,4 +1,13 @@
 ﻿#include "utils.h"
+#include "Crc16.h"
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#endif
 //获取short类型的高字节
 #define HI_OF_SHORT(X) (X >> 8)
 //获取short类型的低字节
@@ -36,7 +45,7 @@ QByteArray Utils::Text2HexByteArr(const QString& text)
 }
 
 
-bool Utils::CheckCRC(uchar* data, int datalen)
+bool Utils::CheckCRC(const uchar* data, int datalen)
 {
 	ushort crc = MakeCRCCheck(data, datalen - 2);
 	uchar lo = LO_OF_SHORT(crc);
@@ -52,7 +61,36 @@ bool Utils::CheckCRC(uchar* data, int datalen)
 	}
 }
 
-ushort Utils::MakeCRCCheck(uchar* data, int datalen)
+ushort Utils::MakeCRCCheck(const uchar* data, int datalen)
+{
+	return Crc16::compute(data, datalen);
+}
+
+qint64 Utils::peakRssBytes()
+{
+#ifdef Q_OS_WIN
+	PROCESS_MEMORY_COUNTERS counters;
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+	{
+		return static_cast<qint64>(counters.PeakWorkingSetSize);
+	}
+	return 0;
+#else
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) == 0)
+	{
+#ifdef Q_OS_MACOS
+		return static_cast<qint64>(usage.ru_maxrss);
+#else
+		//linux下单位为KB
+		return static_cast<qint64>(usage.ru_maxrss) * 1024;
+#endif
+	}
+	return 0;
+#endif
+}
+
+ushort Utils::MakeCRCCheckBytewise(const uchar* data, int datalen)
 {
 	unsigned char byCRCHi = 0xff;
 	unsigned char byCRCLo = 0xff;
@@ -51,9 +51,16 @@ public:
 	// 组装协议报文
 	QList<QByteArray> assemblePackets(quint16 width, quint16 height, quint8 imageType, const QByteArray &hexData);
 
-	bool CheckCRC(uchar* data, int datalen);
+	bool CheckCRC(const uchar* data, int datalen);
 
-	ushort MakeCRCCheck(uchar* data, int datalen);
+	// crc16校验值（slice-by-8实现，见Crc16）
+	ushort MakeCRCCheck(const uchar* data, int datalen);
+
+	// 原逐字节双表实现，结果与MakeCRCCheck一致，保留用于对照和基准测试
+	ushort MakeCRCCheckBytewise(const uchar* data, int datalen);
+
+	// 进程峰值常驻内存（字节），获取失败返回0
+	static qint64 peakRssBytes();
 
 private:
 	/**  crc高字节  **/
@@ -0,0 +1,649 @@
+﻿#include "EpollTransport.h"
+#include "IoThreadPool.h"
+#include "CLogManager.h"
+#include "TraceRecorder.h"
+
+#ifdef Q_OS_LINUX
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#endif
+
+//epoll线程命令
+#define EPOLL_CMD_CONNECT		0x01
+#define EPOLL_CMD_DISCONNECT	0x02
+#define EPOLL_CMD_FLUSH			0x04
+
+//默认socket收发缓冲区大小，与Qt实现的socket写缓存上限一致
+#define EPOLL_DEFAULT_SNDBUF (256*1024)
+#define EPOLL_DEFAULT_RCVBUF (256*1024)
+//单次writev最多帧数/字节数
+#define EPOLL_WRITEV_MAX_FRAMES 64
+#define EPOLL_WRITEV_MAX_BYTES (256*1024)
+//单次read缓冲区大小
+#define EPOLL_READ_CHUNK (64*1024)
+//每次可读事件最多读取的字节数，超出后返回事件循环，剩余数据由水平触发的EPOLLIN再次通知
+#define EPOLL_READ_MAX_PER_WAKEUP (256*1024)
+
+EpollTransport::EpollTransport(EpollTransportCallBack* pCallBack, WireCapture* capture /*= nullptr*/, MetricsRegistry* metrics /*= MetricsRegistry::global()*/)
+	:m_pCallBack(pCallBack)
+	,m_capture(capture)
+	,m_loop(nullptr)
+	,m_commands(0)
+	,m_state(QAbstractSocket::UnconnectedState)
+	,m_keepQueue(false)
+	,m_sendBufSize(EPOLL_DEFAULT_SNDBUF)
+	,m_recvBufSize(EPOLL_DEFAULT_RCVBUF)
+	,m_sendLists(metrics)
+{
+#ifdef Q_OS_LINUX
+	m_readBuf.resize(EPOLL_READ_CHUNK);
+	m_loop = IoThreadPool::instance()->acquireLoop();
+#endif
+}
+
+EpollTransport::~EpollTransport()
+{
+	//从epoll线程移除后不会再有回调
+	if (m_loop)
+	{
+		m_loop->detach(this);
+		IoThreadPool::instance()->releaseLoop(m_loop);
+		m_loop = nullptr;
+	}
+}
+
+bool EpollTransport::isSupported()
+{
+#ifdef Q_OS_LINUX
+	return true;
+#else
+	return false;
+#endif
+}
+
+void EpollTransport::setIpPort(const QString& strIp, ushort port)
+{
+	QMutexLocker lock(&m_paramMutex);
+	m_destinationIp = strIp;
+	m_port = port;
+}
+
+void EpollTransport::setSocketBufferSize(int sendBuf, int recvBuf)
+{
+	QMutexLocker lock(&m_paramMutex);
+	m_sendBufSize = sendBuf;
+	m_recvBufSize = recvBuf;
+}
+
+void EpollTransport::connectToHost()
+{
+	QString host;
+	{
+		QMutexLocker lock(&m_paramMutex);
+		host = m_destinationIp;
+	}
+
+	//设备地址通常为IP，直接使用；主机名解析失败时留空，由epoll线程按HostNotFoundError上报
+	QHostAddress address;
+	if (!address.setAddress(host))
+	{
+		QHostInfo info = QHostInfo::fromName(host);
+		if (info.error() == QHostInfo::NoError && !info.addresses().isEmpty())
+		{
+			address = info.addresses().first();
+		}
+	}
+
+	{
+		QMutexLocker lock(&m_paramMutex);
+		m_connectAddress = address.isNull() ? QString() : address.toString();
+	}
+	if (!m_loop)
+	{
+		if (m_pCallBack)
+		{
+			m_pCallBack->onTransportError(QAbstractSocket::SocketResourceError);
+		}
+		return;
+	}
+	wake(EPOLL_CMD_CONNECT);
+}
+
+void EpollTransport::disconnectFromHost()
+{
+	wake(EPOLL_CMD_DISCONNECT);
+}
+
+void EpollTransport::setKeepQueueOnDisconnect(bool bKeep)
+{
+	m_keepQueue.store(bKeep);
+	//取消保留时由epoll线程丢弃断开期间积压的数据
+	if (!bKeep)
+	{
+		wake(EPOLL_CMD_FLUSH);
+	}
+}
+
+bool EpollTransport::isConnected() const
+{
+	return m_state.load() == QAbstractSocket::ConnectedState;
+}
+
+bool EpollTransport::sendData(const QByteArray& data, ESendLane lane)
+{
+	bool bWasEmpty;
+	{
+		QMutexLocker lock(&m_sendMutex);
+		bWasEmpty = m_sendLists.isEmpty();
+		if (!m_sendLists.enqueue(data, lane))
+		{
+			return false;
+		}
+	}
+
+	//队列中已有数据时epoll线程必然还会再取，不必重复唤醒
+	if (bWasEmpty)
+	{
+		wake(EPOLL_CMD_FLUSH);
+	}
+	return true;
+}
+
+void EpollTransport::setSendWaterMark(qint64 highWater, qint64 lowWater)
+{
+	QMutexLocker lock(&m_sendMutex);
+	m_sendLists.setWaterMark(highWater, lowWater);
+}
+
+qint64 EpollTransport::pendingBytes() const
+{
+	QMutexLocker lock(&m_sendMutex);
+	return m_sendLists.pendingBytes();
+}
+
+SendLaneStats EpollTransport::laneStats(ESendLane lane) const
+{
+	QMutexLocker lock(&m_sendMutex);
+	return m_sendLists.stats(lane);
+}
+
+#ifdef Q_OS_LINUX
+
+void EpollTransport::wake(int command)
+{
+	//命令合并：只有命令由无变有时才加入epoll线程的就绪表，其余合并到m_commands中
+	if (m_commands.fetch_or(command) == 0 && m_loop)
+	{
+		m_loop->post(this);
+	}
+}
+
+void EpollTransport::onEvents(quint32 flags)
+{
+	if (m_sockFd < 0)
+	{
+		return;
+	}
+
+	if (m_state.load() == QAbstractSocket::ConnectingState)
+	{
+		if (flags & (EPOLLOUT | EPOLLERR | EPOLLHUP))
+		{
+			onConnectFinished();
+		}
+		return;
+	}
+
+	if (flags & (EPOLLIN | EPOLLERR | EPOLLHUP | EPOLLRDHUP))
+	{
+		readAvailable();
+	}
+	if (m_sockFd >= 0 && (flags & EPOLLOUT))
+	{
+		flushSendQueue();
+	}
+}
+
+void EpollTransport::processCommands()
+{
+	int commands = m_commands.exchange(0);
+	if (commands & EPOLL_CMD_DISCONNECT)
+	{
+		closeSocket();
+	}
+	if (commands & EPOLL_CMD_CONNECT)
+	{
+		openSocket();
+	}
+	if (commands & EPOLL_CMD_FLUSH)
+	{
+		//正在连接时保留队列，连接成功后发送；已断开且不等待重连则丢弃待发送数据
+		int state = m_state.load();
+		if (state == QAbstractSocket::ConnectedState)
+		{
+			flushSendQueue();
+		}
+		else if (state == QAbstractSocket::UnconnectedState && !m_keepQueue.load())
+		{
+			clearSendQueue();
+		}
+	}
+}
+
+void EpollTransport::shutdown()
+{
+	//析构时关闭，不再回调
+	if (m_sockFd >= 0)
+	{
+		epoll_ctl(m_loop->epollFd(), EPOLL_CTL_DEL, m_sockFd, nullptr);
+		::close(m_sockFd);
+		m_sockFd = -1;
+	}
+}
+
+void EpollTransport::openSocket()
+{
+	if (m_sockFd >= 0)
+	{
+		return;
+	}
+
+	QByteArray host;
+	QByteArray service;
+	int sendBuf, recvBuf;
+	{
+		QMutexLocker lock(&m_paramMutex);
+		host = m_connectAddress.toLatin1();
+		service = QByteArray::number(m_port);
+		sendBuf = m_sendBufSize;
+		recvBuf = m_recvBufSize;
+	}
+
+	setState(QAbstractSocket::HostLookupState);
+	addrinfo hints;
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	hints.ai_flags = AI_NUMERICHOST | AI_NUMERICSERV;
+	addrinfo* result = nullptr;
+	if (getaddrinfo(host.constData(), service.constData(), &hints, &result) != 0 || !result)
+	{
+		setState(QAbstractSocket::UnconnectedState);
+		if (m_pCallBack)
+		{
+			m_pCallBack->onTransportError(QAbstractSocket::HostNotFoundError);
+		}
+		return;
+	}
+
+	m_sockFd = ::socket(result->ai_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_TCP);
+	if (m_sockFd < 0)
+	{
+		int err = errno;
+		freeaddrinfo(result);
+		fail(err);
+		return;
+	}
+
+	//小包（控制命令、应答）不等待合并；缓冲区需在connect前设置才能影响窗口协商
+	int one = 1;
+	setsockopt(m_sockFd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+	if (sendBuf > 0)
+	{
+		setsockopt(m_sockFd, SOL_SOCKET, SO_SNDBUF, &sendBuf, sizeof(sendBuf));
+	}
+	if (recvBuf > 0)
+	{
+		setsockopt(m_sockFd, SOL_SOCKET, SO_RCVBUF, &recvBuf, sizeof(recvBuf));
+	}
+
+	int ret = ::connect(m_sockFd, result->ai_addr, result->ai_addrlen);
+	int err = errno;
+	freeaddrinfo(result);
+	if (ret < 0 && err != EINPROGRESS)
+	{
+		fail(err);
+		return;
+	}
+
+	epoll_event ev;
+	memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP;
+	ev.data.ptr = this;
+	epoll_ctl(m_loop->epollFd(), EPOLL_CTL_ADD, m_sockFd, &ev);
+	m_bWantWrite = true;
+
+	setState(QAbstractSocket::ConnectingState);
+	if (ret == 0)
+	{
+		onConnectFinished();
+	}
+}
+
+void EpollTransport::onConnectFinished()
+{
+	int err = 0;
+	socklen_t len = sizeof(err);
+	if (getsockopt(m_sockFd, SOL_SOCKET, SO_ERROR, &err, &len) < 0)
+	{
+		err = errno;
+	}
+	if (err != 0)
+	{
+		fail(err);
+		return;
+	}
+
+	setState(QAbstractSocket::ConnectedState);
+	//连接建立前入队的数据
+	flushSendQueue();
+}
+
+void EpollTransport::closeSocket()
+{
+	if (m_sockFd < 0)
+	{
+		return;
+	}
+
+	epoll_ctl(m_loop->epollFd(), EPOLL_CTL_DEL, m_sockFd, nullptr);
+	::close(m_sockFd);
+	m_sockFd = -1;
+	m_bWantWrite = false;
+
+	//未写完的控制/运动帧在新连接上从头重发；不等待重连则丢弃待发送数据
+	m_outOffset = 0;
+	if (!m_keepQueue.load())
+	{
+		clearSendQueue();
+	}
+	else
+	{
+		dropBulkFrames();
+	}
+	setState(QAbstractSocket::UnconnectedState);
+}
+
+void EpollTransport::fail(int err)
+{
+	QAbstractSocket::SocketError socketError;
+	switch (err)
+	{
+	case ECONNREFUSED:
+		socketError = QAbstractSocket::ConnectionRefusedError;
+		break;
+	case ECONNRESET:
+	case EPIPE:
+		socketError = QAbstractSocket::RemoteHostClosedError;
+		break;
+	case ETIMEDOUT:
+		socketError = QAbstractSocket::SocketTimeoutError;
+		break;
+	case ENETUNREACH:
+	case EHOSTUNREACH:
+		socketError = QAbstractSocket::NetworkError;
+		break;
+	default:
+		socketError = QAbstractSocket::UnknownSocketError;
+		break;
+	}
+
+	LOG_WARN(QString(u8"epoll_transport socket error, errno: %1").arg(err));
+	if (m_pCallBack)
+	{
+		m_pCallBack->onTransportError(socketError);
+	}
+
+	if (m_sockFd >= 0)
+	{
+		closeSocket();
+	}
+	else
+	{
+		setState(QAbstractSocket::UnconnectedState);
+	}
+}
+
+void EpollTransport::readAvailable()
+{
+	//限制单次读取量，持续收数据时同一loop上的其他连接和命令/发送处理不被饿死
+	qint64 readBytes = 0;
+	while (m_sockFd >= 0 && readBytes < EPOLL_READ_MAX_PER_WAKEUP)
+	{
+		ssize_t n = ::read(m_sockFd, m_readBuf.data(), m_readBuf.size());
+		if (n > 0)
+		{
+			readBytes += n;
+			TRACE_INSTANT("wire_read", "bytes", n);
+			if (m_capture)
+			{
+				m_capture->record(Wire_Inbound, m_readBuf.constData(), n);
+			}
+			if (m_pCallBack)
+			{
+				m_pCallBack->onTransportData(QByteArray(m_readBuf.constData(), static_cast<int>(n)));
+			}
+			continue;
+		}
+
+		if (n == 0)
+		{
+			//对端关闭
+			if (m_pCallBack)
+			{
+				m_pCallBack->onTransportError(QAbstractSocket::RemoteHostClosedError);
+			}
+			closeSocket();
+			return;
+		}
+
+		if (errno == EINTR)
+		{
+			continue;
+		}
+		if (errno != EAGAIN && errno != EWOULDBLOCK)
+		{
+			fail(errno);
+		}
+		return;
+	}
+}
+
+void EpollTransport::flushSendQueue()
+{
+	if (m_sockFd < 0 || m_state.load() != QAbstractSocket::ConnectedState)
+	{
+		return;
+	}
+
+	bool notifyReady = false;
+	qint64 written = 0;
+	iovec iov[EPOLL_WRITEV_MAX_FRAMES];
+
+	while (true)
+	{
+		//上一批全部写入内核后才取新数据：控制/运动命令最多落后内核发送缓冲区中的数据
+		if (m_outFrames.isEmpty())
+		{
+			QMutexLocker lock(&m_sendMutex);
+			m_sendLists.takeFrames(m_outFrames, EPOLL_WRITEV_MAX_FRAMES, EPOLL_WRITEV_MAX_BYTES, true, &m_outLanes);
+			notifyReady |= m_sendLists.consumeReadyNotify();
+		}
+		if (m_outFrames.isEmpty())
+		{
+			setWriteInterest(false);
+			break;
+		}
+
+		int count = m_outFrames.size();
+		for (int i = 0; i < count; i++)
+		{
+			const QByteArray& frame = m_outFrames.at(i);
+			int offset = (i == 0) ? m_outOffset : 0;
+			iov[i].iov_base = const_cast<char*>(frame.constData()) + offset;
+			iov[i].iov_len = static_cast<size_t>(frame.size() - offset);
+		}
+
+		ssize_t n;
+		{
+			TRACE_SCOPE("wire_write", "frames", count);
+			n = ::writev(m_sockFd, iov, count);
+		}
+		if (n < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+			{
+				//内核发送缓冲区已满，等待EPOLLOUT
+				setWriteInterest(true);
+				break;
+			}
+			fail(errno);
+			return;
+		}
+
+		written += n;
+
+		//按内核实际接受的字节抓包
+		if (m_capture && m_capture->isOpen())
+		{
+			qint64 left = n;
+			for (int i = 0; i < count && left > 0; i++)
+			{
+				qint64 part = qMin<qint64>(left, static_cast<qint64>(iov[i].iov_len));
+				m_capture->record(Wire_Outbound, static_cast<const char*>(iov[i].iov_base), part);
+				left -= part;
+			}
+		}
+
+		//移除已完整写出的帧
+		qint64 remain = n;
+		int done = 0;
+		while (done < m_outFrames.size())
+		{
+			qint64 left = m_outFrames.at(done).size() - m_outOffset;
+			if (remain < left)
+			{
+				m_outOffset += static_cast<int>(remain);
+				break;
+			}
+			remain -= left;
+			m_outOffset = 0;
+			done++;
+		}
+		m_outFrames.remove(0, done);
+		m_outLanes.remove(0, done);
+	}
+
+	if (written > 0 && m_pCallBack)
+	{
+		m_pCallBack->onTransportBytesWritten(written);
+	}
+	if (notifyReady && m_pCallBack)
+	{
+		m_pCallBack->onTransportSendReady();
+	}
+}
+
+void EpollTransport::clearSendQueue()
+{
+	m_outFrames.clear();
+	m_outLanes.clear();
+	m_outOffset = 0;
+
+	bool notifyReady = false;
+	{
+		QMutexLocker lock(&m_sendMutex);
+		m_sendLists.clear();
+		notifyReady = m_sendLists.consumeReadyNotify();
+	}
+
+	if (notifyReady && m_pCallBack)
+	{
+		m_pCallBack->onTransportSendReady();
+	}
+}
+
+void EpollTransport::dropBulkFrames()
+{
+	//图像帧已在上层重传窗口中，重连后由窗口按序号重发，这里保留会重复发送
+	for (int i = m_outFrames.size() - 1; i >= 0; i--)
+	{
+		if (m_outLanes.at(i) == Lane_Bulk)
+		{
+			m_outFrames.remove(i);
+			m_outLanes.remove(i);
+		}
+	}
+
+	bool notifyReady = false;
+	{
+		QMutexLocker lock(&m_sendMutex);
+		m_sendLists.clearLane(Lane_Bulk);
+		notifyReady = m_sendLists.consumeReadyNotify();
+	}
+
+	if (notifyReady && m_pCallBack)
+	{
+		m_pCallBack->onTransportSendReady();
+	}
+}
+
+void EpollTransport::setWriteInterest(bool bWrite)
+{
+	if (m_sockFd < 0 || m_bWantWrite == bWrite)
+	{
+		return;
+	}
+
+	epoll_event ev;
+	memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN | EPOLLRDHUP | (bWrite ? EPOLLOUT : 0);
+	ev.data.ptr = this;
+	epoll_ctl(m_loop->epollFd(), EPOLL_CTL_MOD, m_sockFd, &ev);
+	m_bWantWrite = bWrite;
+}
+
+void EpollTransport::setState(QAbstractSocket::SocketState state)
+{
+	if (m_state.exchange(state) == state)
+	{
+		return;
+	}
+	if (m_pCallBack)
+	{
+		m_pCallBack->onTransportState(state);
+	}
+}
+
+#else
+
+void EpollTransport::wake(int command)
+{
+	Q_UNUSED(command);
+}
+
+void EpollTransport::onEvents(quint32 flags)
+{
+	Q_UNUSED(flags);
+}
+
+void EpollTransport::processCommands()
+{
+}
+
+void EpollTransport::shutdown()
+{
+}
+
+#endif
@@ -0,0 +1,134 @@
+﻿#pragma once
+#include <QtCore/QtCore>
+#include <QtNetwork/QAbstractSocket>
+#include <QtNetwork/QHostInfo>
+#include <atomic>
+#include "SendLaneQueue.h"
+#include "WireCapture.h"
+
+class EpollLoop;
+
+/**
+*  @author
+*  @class       EpollTransportCallBack
+*  @brief       EpollTransport事件回调类（均在epoll线程中回调）
+*/
+class EpollTransportCallBack
+{
+public:
+	EpollTransportCallBack() { };
+	virtual ~EpollTransportCallBack() { };
+
+	virtual void onTransportData(const QByteArray& data) { Q_UNUSED(data); };
+	virtual void onTransportState(QAbstractSocket::SocketState state) { Q_UNUSED(state); };
+	virtual void onTransportError(QAbstractSocket::SocketError socketError) { Q_UNUSED(socketError); };
+	virtual void onTransportBytesWritten(qint64 bytes) { Q_UNUSED(bytes); };
+	virtual void onTransportSendReady() { };
+};
+
+/**
+*  @author
+*  @class       EpollTransport
+*  @brief       基于epoll的tcp传输（仅Linux），供TcpClient在运行期替换QTcpSocket实现
+*
+*  非阻塞socket + 共享epoll线程（由IoThreadPool分配，多个连接共用一个EpollLoop）：
+*  - sendData只加锁入队，队列由空变为非空时投递一次命令唤醒epoll线程，不经过Qt事件循环；
+*  - 发送时按通道优先级取整帧，用writev一次写出多帧，不做合并拷贝；写不完时等待EPOLLOUT；
+*  - 连接后设置TCP_NODELAY和收发缓冲区大小。
+*  接口语义与TcpClientImpl一致：断开时丢弃待发送数据（setKeepQueueOnDisconnect后保留到重连），超过高水位拒绝入队并在回落后通知。
+*/
+class EpollTransport
+{
+public:
+	/**
+	*  @brief       构造并加入共享的epoll线程
+	*  @param[in]    pCallBack: 事件回调  capture: 收发数据抓包（由调用方持有，可为nullptr）  metrics: 发送队列指标写入的注册表
+	*  @param[out]
+	*  @return
+	*/
+	explicit EpollTransport(EpollTransportCallBack* pCallBack, WireCapture* capture = nullptr, MetricsRegistry* metrics = MetricsRegistry::global());
+	~EpollTransport();
+
+	//当前平台是否支持（非Linux平台始终返回false）
+	static bool isSupported();
+
+	//是否已加入epoll线程（epoll实例或线程创建失败时为false，不能使用）
+	bool isValid() const { return m_loop != nullptr; }
+
+	//以下接口线程安全，可在任意线程调用
+	void setIpPort(const QString& strIp, ushort port);
+	//主机名在调用线程中解析，不阻塞共享的epoll线程
+	void connectToHost();
+	void disconnectFromHost();
+	bool isConnected() const;
+	bool sendData(const QByteArray& data, ESendLane lane);
+	void setSendWaterMark(qint64 highWater, qint64 lowWater);
+	qint64 pendingBytes() const;
+	SendLaneStats laneStats(ESendLane lane) const;
+
+	/**
+	*  @brief       断开后是否保留待发送数据，保留的数据在重新连接后按原顺序发送；批量通道不保留
+	*  @param[in]    bKeep: false=断开时丢弃（默认）
+	*  @param[out]
+	*  @return
+	*/
+	void setKeepQueueOnDisconnect(bool bKeep);
+
+	/**
+	*  @brief       设置socket收发缓冲区大小（字节，下次连接时生效）
+	*  @param[in]    sendBuf/recvBuf: <=0表示使用系统默认值
+	*  @param[out]
+	*  @return
+	*/
+	void setSocketBufferSize(int sendBuf, int recvBuf);
+
+private:
+	friend class EpollLoop;
+
+	//以下由EpollLoop在epoll线程中调用
+	void onEvents(quint32 flags);
+	void processCommands();
+	void shutdown();
+
+	void wake(int command);
+	void openSocket();
+	void closeSocket();
+	void onConnectFinished();
+	void readAvailable();
+	void flushSendQueue();
+	void clearSendQueue();
+	void dropBulkFrames();
+	void setWriteInterest(bool bWrite);
+	void setState(QAbstractSocket::SocketState state);
+	void fail(int err);
+
+private:
+	EpollTransportCallBack* m_pCallBack;
+	WireCapture* m_capture;
+	EpollLoop* m_loop;
+	int m_sockFd = -1;
+
+	//其他线程投递给epoll线程的命令（位掩码）
+	std::atomic<int> m_commands;
+	std::atomic<int> m_state;
+	std::atomic<bool> m_keepQueue;
+
+	//连接参数
+	mutable QMutex m_paramMutex;
+	QString m_destinationIp;
+	QString m_connectAddress;				//connectToHost解析出的IP，epoll线程只做数字地址转换
+	ushort m_port = 0;
+	int m_sendBufSize;
+	int m_recvBufSize;
+
+	//发送队列
+	mutable QMutex m_sendMutex;
+	SendLaneQueue m_sendLists;
+
+	//以下只在epoll线程中访问
+	QVector<QByteArray> m_outFrames;		//已从队列取出但未完全写出的帧
+	QVector<ESendLane> m_outLanes;			//m_outFrames中各帧所属通道
+	int m_outOffset = 0;					//第一帧已写出的字节数
+	bool m_bWantWrite = false;				//是否已注册EPOLLOUT
+	QByteArray m_readBuf;
+};
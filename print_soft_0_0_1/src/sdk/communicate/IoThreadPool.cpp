@@ -0,0 +1,352 @@
+﻿#include "IoThreadPool.h"
+#include "EpollTransport.h"
+#include "MetricsRegistry.h"
+#include "CLogManager.h"
+#include "TraceRecorder.h"
+
+#ifdef Q_OS_LINUX
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+//单次epoll_wait最多取出的事件数
+#define EPOLL_LOOP_MAX_EVENTS 64
+
+// ==================== EpollLoop ====================
+
+EpollLoop::EpollLoop(const QString& name)
+	:m_name(name)
+	,m_stop(false)
+{
+#ifdef Q_OS_LINUX
+	m_epollFd = epoll_create1(EPOLL_CLOEXEC);
+	m_wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (m_epollFd < 0 || m_wakeFd < 0)
+	{
+		LOG_ERROR(QString(u8"epoll_transport init failed, errno: %1").arg(errno));
+		return;
+	}
+
+	//eventfd以data.ptr=nullptr注册，与连接的socket区分
+	epoll_event ev;
+	memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN;
+	ev.data.ptr = nullptr;
+	epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_wakeFd, &ev);
+
+	m_thread = std::thread(&EpollLoop::run, this);
+#endif
+}
+
+EpollLoop::~EpollLoop()
+{
+#ifdef Q_OS_LINUX
+	if (m_thread.joinable())
+	{
+		m_stop.store(true);
+		wakeup();
+		m_thread.join();
+	}
+	if (m_wakeFd >= 0)
+	{
+		::close(m_wakeFd);
+	}
+	if (m_epollFd >= 0)
+	{
+		::close(m_epollFd);
+	}
+#endif
+}
+
+void EpollLoop::post(EpollTransport* transport)
+{
+	{
+		QMutexLocker lock(&m_readyMutex);
+		m_ready.append(transport);
+	}
+	wakeup();
+}
+
+void EpollLoop::detach(EpollTransport* transport)
+{
+	if (!m_thread.joinable() || isLoopThread())
+	{
+		transport->shutdown();
+		QMutexLocker lock(&m_readyMutex);
+		m_ready.removeAll(transport);
+		return;
+	}
+
+	QSemaphore done;
+	{
+		QMutexLocker lock(&m_readyMutex);
+		m_detaching.append({ transport, &done });
+	}
+	wakeup();
+	done.acquire();
+}
+
+#ifdef Q_OS_LINUX
+
+void EpollLoop::wakeup()
+{
+	quint64 one = 1;
+	ssize_t ret = ::write(m_wakeFd, &one, sizeof(one));
+	Q_UNUSED(ret);
+}
+
+void EpollLoop::run()
+{
+	TraceRecorder::setThreadName(m_name.toLatin1().constData());
+	epoll_event events[EPOLL_LOOP_MAX_EVENTS];
+	QVector<EpollTransport*> ready;
+	QVector<DetachRequest> detaching;
+	while (!m_stop.load())
+	{
+		int n = epoll_wait(m_epollFd, events, EPOLL_LOOP_MAX_EVENTS, -1);
+		if (n < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			LOG_ERROR(QString(u8"epoll_transport epoll_wait failed, errno: %1").arg(errno));
+			break;
+		}
+
+		for (int i = 0; i < n; i++)
+		{
+			EpollTransport* transport = static_cast<EpollTransport*>(events[i].data.ptr);
+			if (!transport)
+			{
+				quint64 count;
+				while (::read(m_wakeFd, &count, sizeof(count)) > 0)
+				{
+				}
+				continue;
+			}
+			transport->onEvents(events[i].events);
+		}
+
+		//socket事件处理完后再执行命令和移除，同一批事件中不会出现已移除的连接
+		{
+			QMutexLocker lock(&m_readyMutex);
+			ready.swap(m_ready);
+			detaching.swap(m_detaching);
+			for (const DetachRequest& request : detaching)
+			{
+				ready.removeAll(request.transport);
+			}
+		}
+		for (EpollTransport* transport : ready)
+		{
+			transport->processCommands();
+		}
+		ready.clear();
+
+		for (const DetachRequest& request : detaching)
+		{
+			request.transport->shutdown();
+			request.done->release();
+		}
+		detaching.clear();
+	}
+}
+
+#else
+
+void EpollLoop::wakeup()
+{
+}
+
+void EpollLoop::run()
+{
+}
+
+#endif
+
+// ==================== IoThreadPool ====================
+
+IoThreadPool::IoThreadPool()
+{
+	m_maxThreads = qEnvironmentVariableIntValue(IO_THREADS_ENV);
+	if (m_maxThreads <= 0)
+	{
+		m_maxThreads = qBound(1, QThread::idealThreadCount(), IO_POOL_DEFAULT_THREADS);
+	}
+}
+
+IoThreadPool* IoThreadPool::instance()
+{
+	//不析构：进程退出时仍可能有会话在静态对象析构中释放连接
+	static IoThreadPool* pool = new IoThreadPool;
+	return pool;
+}
+
+void IoThreadPool::setMaxThreads(int count)
+{
+	QMutexLocker lock(&m_mutex);
+	if (count <= 0)
+	{
+		count = qBound(1, QThread::idealThreadCount(), IO_POOL_DEFAULT_THREADS);
+	}
+	m_maxThreads = count;
+}
+
+int IoThreadPool::maxThreads() const
+{
+	QMutexLocker lock(&m_mutex);
+	return m_maxThreads;
+}
+
+int IoThreadPool::threadCount() const
+{
+	QMutexLocker lock(&m_mutex);
+	return m_qtWorkers.size() + m_epollWorkers.size();
+}
+
+int IoThreadPool::pickWorker(const QVector<Worker>& workers) const
+{
+	int best = -1;
+	for (int i = 0; i < workers.size(); i++)
+	{
+		if (best < 0 || workers[i].users < workers[best].users)
+		{
+			best = i;
+		}
+	}
+	if (workers.size() < m_maxThreads && (best < 0 || workers[best].users > 0))
+	{
+		return -1;
+	}
+	return best;
+}
+
+QThread* IoThreadPool::acquireThread()
+{
+	QMutexLocker lock(&m_mutex);
+	int index = pickWorker(m_qtWorkers);
+	if (index < 0)
+	{
+		QThread* thread = new QThread;
+		thread->setObjectName(QString("tcp_io_%1").arg(m_createdThreads++));
+		QObject* context = new QObject;
+		context->moveToThread(thread);
+		thread->start();
+		m_qtWorkers.append({ thread, context, nullptr, 0 });
+		index = m_qtWorkers.size() - 1;
+	}
+	m_qtWorkers[index].users++;
+	updateGauges();
+	return m_qtWorkers[index].thread;
+}
+
+void IoThreadPool::releaseThread(QThread* thread, QObject* object /*= nullptr*/)
+{
+	//调用方仍占用该线程，其context在此期间不会被删除
+	QObject* context = nullptr;
+	{
+		QMutexLocker lock(&m_mutex);
+		for (const Worker& worker : m_qtWorkers)
+		{
+			if (worker.thread == thread)
+			{
+				context = worker.context;
+				break;
+			}
+		}
+	}
+	if (!context)
+	{
+		return;
+	}
+
+	if (object)
+	{
+		QMetaObject::invokeMethod(context, [object]() {
+			delete object;
+		}, Qt::BlockingQueuedConnection);
+	}
+
+	Worker idle = { nullptr, nullptr, nullptr, 0 };
+	{
+		QMutexLocker lock(&m_mutex);
+		for (int i = 0; i < m_qtWorkers.size(); i++)
+		{
+			if (m_qtWorkers[i].thread == thread && --m_qtWorkers[i].users == 0)
+			{
+				idle = m_qtWorkers[i];
+				m_qtWorkers.remove(i);
+				break;
+			}
+		}
+		updateGauges();
+	}
+
+	//线程上已没有连接，退出事件循环
+	if (idle.thread)
+	{
+		idle.thread->quit();
+		idle.thread->wait();
+		delete idle.context;
+		delete idle.thread;
+	}
+}
+
+EpollLoop* IoThreadPool::acquireLoop()
+{
+	QMutexLocker lock(&m_mutex);
+	int index = pickWorker(m_epollWorkers);
+	if (index < 0)
+	{
+		EpollLoop* loop = new EpollLoop(QString("epoll_io_%1").arg(m_createdThreads++));
+		if (!loop->isValid())
+		{
+			delete loop;
+			return nullptr;
+		}
+		m_epollWorkers.append({ nullptr, nullptr, loop, 0 });
+		index = m_epollWorkers.size() - 1;
+	}
+	m_epollWorkers[index].users++;
+	updateGauges();
+	return m_epollWorkers[index].loop;
+}
+
+void IoThreadPool::releaseLoop(EpollLoop* loop)
+{
+	EpollLoop* idle = nullptr;
+	{
+		QMutexLocker lock(&m_mutex);
+		for (int i = 0; i < m_epollWorkers.size(); i++)
+		{
+			if (m_epollWorkers[i].loop == loop && --m_epollWorkers[i].users == 0)
+			{
+				idle = loop;
+				m_epollWorkers.remove(i);
+				break;
+			}
+		}
+		updateGauges();
+	}
+	delete idle;
+}
+
+void IoThreadPool::updateGauges()
+{
+	static MetricGauge& threads = MetricsRegistry::global()->gauge("io.threads");
+	static MetricGauge& connections = MetricsRegistry::global()->gauge("io.connections");
+	int users = 0;
+	for (const Worker& worker : m_qtWorkers)
+	{
+		users += worker.users;
+	}
+	for (const Worker& worker : m_epollWorkers)
+	{
+		users += worker.users;
+	}
+	threads.set(m_qtWorkers.size() + m_epollWorkers.size());
+	connections.set(users);
+}
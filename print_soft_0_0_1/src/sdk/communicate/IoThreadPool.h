@@ -0,0 +1,146 @@
+﻿#pragma once
+#include <QtCore/QtCore>
+#include <atomic>
+#include <thread>
+
+class EpollTransport;
+
+//共享I/O线程数上限的环境变量，未设置时为 min(CPU核数, IO_POOL_DEFAULT_THREADS)
+#define IO_THREADS_ENV "PRINT_SDK_IO_THREADS"
+#define IO_POOL_DEFAULT_THREADS 4
+
+/**
+*  @author
+*  @class       EpollLoop
+*  @brief       一个epoll线程，由多个EpollTransport共享
+*
+*  各连接的socket以data.ptr=EpollTransport*注册到同一个epoll；其他线程给连接投递命令时，
+*  只有该连接命令由无变有时才加入就绪表并写一次eventfd，epoll线程在处理完socket事件后统一执行命令。
+*/
+class EpollLoop
+{
+public:
+	explicit EpollLoop(const QString& name);
+
+	//须在所有连接detach之后析构
+	~EpollLoop();
+
+	bool isValid() const { return m_epollFd >= 0 && m_wakeFd >= 0; }
+
+	int epollFd() const { return m_epollFd; }
+
+	/**
+	*  @brief       连接有新命令，加入就绪表并唤醒epoll线程（任意线程）
+	*  @param[in]
+	*  @param[out]
+	*  @return
+	*/
+	void post(EpollTransport* transport);
+
+	/**
+	*  @brief       移除连接：在epoll线程中关闭其socket，返回后epoll线程不会再访问该连接
+	*  @param[in]
+	*  @param[out]
+	*  @return
+	*/
+	void detach(EpollTransport* transport);
+
+private:
+	void run();
+	void wakeup();
+	bool isLoopThread() const { return std::this_thread::get_id() == m_thread.get_id(); }
+
+private:
+	Q_DISABLE_COPY(EpollLoop)
+	QString m_name;
+	std::thread m_thread;
+	int m_epollFd = -1;
+	int m_wakeFd = -1;
+	std::atomic<bool> m_stop;
+
+	struct DetachRequest
+	{
+		EpollTransport* transport;
+		QSemaphore* done;
+	};
+
+	QMutex m_readyMutex;
+	QVector<EpollTransport*> m_ready;		//有待执行命令的连接
+	QVector<DetachRequest> m_detaching;		//等待移除的连接
+};
+
+/**
+*  @author
+*  @class       IoThreadPool
+*  @brief       进程内共享的socket I/O线程
+*
+*  所有设备会话的连接共用少量I/O线程，而不是每个连接一个线程：Qt实现共用QThread事件循环，
+*  epoll实现共用EpollLoop。线程数不超过上限时优先给新连接分配新线程，之后分配给连接数最少的线程；
+*  某个线程上的连接全部释放后该线程退出。线程安全。
+*/
+class IoThreadPool
+{
+public:
+	static IoThreadPool* instance();
+
+	/**
+	*  @brief       设置I/O线程数上限，只影响之后新建的线程
+	*  @param[in]    count: <=0时恢复默认值
+	*  @param[out]
+	*  @return
+	*/
+	void setMaxThreads(int count);
+
+	int maxThreads() const;
+
+	/**
+	*  @brief       为一个Qt实现的连接分配事件循环线程
+	*  @param[in]
+	*  @param[out]
+	*  @return       运行中的线程，不再使用时调用releaseThread
+	*/
+	QThread* acquireThread();
+
+	/**
+	*  @brief       释放acquireThread分配的线程
+	*  @param[in]    object: 非空时先在该线程中同步删除（移入该线程的连接对象），返回后不会再执行其槽函数
+	*  @param[out]
+	*  @return
+	*/
+	void releaseThread(QThread* thread, QObject* object = nullptr);
+
+	/**
+	*  @brief       为一个epoll实现的连接分配epoll线程
+	*  @param[in]
+	*  @param[out]
+	*  @return       nullptr=epoll创建失败；不再使用时调用releaseLoop
+	*/
+	EpollLoop* acquireLoop();
+	void releaseLoop(EpollLoop* loop);
+
+	//当前运行的I/O线程数
+	int threadCount() const;
+
+private:
+	IoThreadPool();
+
+	struct Worker
+	{
+		QThread* thread;
+		QObject* context;	//属于thread，用于在该线程中执行删除
+		EpollLoop* loop;
+		int users;			//分配到该线程的连接数
+	};
+
+	//选择连接数最少的线程，未达上限且所有线程都有连接时返回-1（新建线程）
+	int pickWorker(const QVector<Worker>& workers) const;
+	void updateGauges();
+
+private:
+	Q_DISABLE_COPY(IoThreadPool)
+	mutable QMutex m_mutex;
+	int m_maxThreads;
+	int m_createdThreads = 0;
+	QVector<Worker> m_qtWorkers;
+	QVector<Worker> m_epollWorkers;
+};
@@ -0,0 +1,216 @@
+﻿#include "SendLaneQueue.h"
+
+//发送队列默认高水位/低水位
+#define SEND_QUEUE_HIGH_WATER (8*1024*1024)
+#define SEND_QUEUE_LOW_WATER (2*1024*1024)
+
+
+SendLaneQueue::SendLaneQueue(MetricsRegistry* metrics /*= MetricsRegistry::global()*/)
+	:m_highWater(SEND_QUEUE_HIGH_WATER)
+	,m_lowWater(SEND_QUEUE_LOW_WATER)
+{
+	m_clock.start();
+
+	const char* laneNames[Lane_Count] = { "control", "motion", "bulk" };
+	for (int i = 0; i < Lane_Count; i++)
+	{
+		m_depthGauge[i] = &metrics->gauge(QString("tcp.queue_depth.%1").arg(laneNames[i]));
+		m_waitHistogram[i] = &metrics->histogram(QString("tcp.queue_wait.%1").arg(laneNames[i]));
+	}
+	m_pendingGauge = &metrics->gauge("tcp.queue_bytes");
+	m_rejectedCounter = &metrics->counter("tcp.queue_rejected");
+	m_txBytesCounter = &metrics->counter("tcp.tx_bytes");
+}
+
+void SendLaneQueue::setWaterMark(qint64 highWater, qint64 lowWater)
+{
+	m_highWater = highWater;
+	m_lowWater = qMin(lowWater, highWater);
+}
+
+bool SendLaneQueue::enqueue(const QByteArray& data, ESendLane lane)
+{
+	SendLaneStats& stats = m_stats[lane];
+
+	//控制通道永远接收；其他通道超过高水位拒绝（队列为空时总是接收，避免单个大包永远无法发送）
+	if (lane != Lane_Control && m_pendingBytes > 0 && m_pendingBytes + data.size() > m_highWater)
+	{
+		m_backpressured = true;
+		stats.rejected++;
+		m_rejectedCounter->add();
+		return false;
+	}
+
+	m_lanes[lane].enqueue({ data, m_clock.nsecsElapsed() });
+	m_pendingBytes += data.size();
+	stats.depth++;
+	stats.bytes += data.size();
+	stats.enqueued++;
+	m_depthGauge[lane]->set(stats.depth);
+	m_pendingGauge->set(m_pendingBytes);
+	return true;
+}
+
+qint64 SendLaneQueue::takeBatch(QByteArray& batch, QByteArray& single, int maxBatch, bool bulkAllowed)
+{
+	//resize(0)保留已reserve的容量，避免每批重新分配
+	batch.resize(0);
+	single.clear();
+
+	const int laneEnd = bulkAllowed ? Lane_Count : Lane_Bulk;
+	const qint64 nowNs = m_clock.nsecsElapsed();
+	qint64 taken = 0;
+	bool full = false;
+
+	for (int i = 0; i < laneEnd && !full; i++)
+	{
+		ESendLane lane = static_cast<ESendLane>(i);
+		QQueue<Item>& queue = m_lanes[i];
+		while (!queue.isEmpty())
+		{
+			int size = queue.head().data.size();
+
+			//大包单独发送，不做拷贝
+			if (taken == 0 && size >= maxBatch)
+			{
+				Item item = queue.dequeue();
+				onDequeued(lane, item, nowNs);
+				single = item.data;
+				taken = size;
+				full = true;
+				break;
+			}
+
+			//高优先级通道的数据放不下时不再取低优先级通道，保证严格优先级
+			if (batch.size() + size > maxBatch)
+			{
+				full = true;
+				break;
+			}
+
+			Item item = queue.dequeue();
+			onDequeued(lane, item, nowNs);
+			batch.append(item.data);
+			taken += size;
+		}
+	}
+
+	onTaken(taken);
+	return taken;
+}
+
+qint64 SendLaneQueue::takeFrames(QVector<QByteArray>& frames, int maxFrames, qint64 maxBytes, bool bulkAllowed, QVector<ESendLane>* lanes /*= nullptr*/)
+{
+	const int laneEnd = bulkAllowed ? Lane_Count : Lane_Bulk;
+	const qint64 nowNs = m_clock.nsecsElapsed();
+	qint64 taken = 0;
+	int count = 0;
+	bool full = false;
+
+	for (int i = 0; i < laneEnd && !full; i++)
+	{
+		ESendLane lane = static_cast<ESendLane>(i);
+		QQueue<Item>& queue = m_lanes[i];
+		while (!queue.isEmpty())
+		{
+			//放不下时不再取低优先级通道，保证严格优先级
+			if (count >= maxFrames || (count > 0 && taken + queue.head().data.size() > maxBytes))
+			{
+				full = true;
+				break;
+			}
+
+			Item item = queue.dequeue();
+			onDequeued(lane, item, nowNs);
+			taken += item.data.size();
+			frames.append(item.data);
+			if (lanes)
+			{
+				lanes->append(lane);
+			}
+			count++;
+		}
+	}
+
+	onTaken(taken);
+	return taken;
+}
+
+void SendLaneQueue::clear()
+{
+	for (int i = 0; i < Lane_Count; i++)
+	{
+		m_lanes[i].clear();
+		m_stats[i].depth = 0;
+		m_stats[i].bytes = 0;
+		m_depthGauge[i]->set(0);
+	}
+	m_pendingBytes = 0;
+	m_pendingGauge->set(0);
+}
+
+qint64 SendLaneQueue::clearLane(ESendLane lane)
+{
+	qint64 dropped = m_stats[lane].bytes;
+	m_lanes[lane].clear();
+	m_stats[lane].depth = 0;
+	m_stats[lane].bytes = 0;
+	m_depthGauge[lane]->set(0);
+	m_pendingBytes -= dropped;
+	m_pendingGauge->set(m_pendingBytes);
+	return dropped;
+}
+
+bool SendLaneQueue::isEmpty() const
+{
+	return !hasUrgent() && m_lanes[Lane_Bulk].isEmpty();
+}
+
+bool SendLaneQueue::hasUrgent() const
+{
+	return !m_lanes[Lane_Control].isEmpty() || !m_lanes[Lane_Motion].isEmpty();
+}
+
+bool SendLaneQueue::consumeReadyNotify()
+{
+	if (m_backpressured && m_pendingBytes <= m_lowWater)
+	{
+		m_backpressured = false;
+		return true;
+	}
+	return false;
+}
+
+SendLaneStats SendLaneQueue::stats(ESendLane lane) const
+{
+	return m_stats[lane];
+}
+
+void SendLaneQueue::onDequeued(ESendLane lane, const Item& item, qint64 nowNs)
+{
+	SendLaneStats& stats = m_stats[lane];
+	qint64 waitUs = (nowNs - item.enqueueNs) / 1000;
+
+	stats.depth--;
+	stats.bytes -= item.data.size();
+	stats.dequeued++;
+	stats.totalWaitUs += waitUs;
+	if (waitUs > stats.maxWaitUs)
+	{
+		stats.maxWaitUs = waitUs;
+	}
+	m_depthGauge[lane]->set(stats.depth);
+	m_waitHistogram[lane]->record(static_cast<quint64>(nowNs - item.enqueueNs));
+}
+
+void SendLaneQueue::onTaken(qint64 taken)
+{
+	if (taken == 0)
+	{
+		return;
+	}
+	//取出即交给socket写出，按线上字节计
+	m_pendingBytes -= taken;
+	m_pendingGauge->set(m_pendingBytes);
+	m_txBytesCounter->add(static_cast<quint64>(taken));
+}
@@ -0,0 +1,128 @@
+﻿#pragma once
+#include <QtCore/QtCore>
+#include "MetricsRegistry.h"
+
+/**  发送通道，数值越小优先级越高  **/
+enum ESendLane
+{
+	Lane_Control = 0,		//紧急/控制命令（开始、暂停、停止打印、心跳）
+	Lane_Motion,			//运动及参数命令
+	Lane_Bulk,				//打印图像等大批量数据
+	Lane_Count
+};
+
+/**  单个通道统计  **/
+struct SendLaneStats
+{
+	qint64 depth = 0;			//当前排队帧数
+	qint64 bytes = 0;			//当前排队字节数
+	quint64 enqueued = 0;		//累计入队帧数
+	quint64 dequeued = 0;		//累计出队帧数
+	quint64 rejected = 0;		//因高水位拒绝的帧数
+	qint64 totalWaitUs = 0;		//累计排队等待时间（微秒）
+	qint64 maxWaitUs = 0;		//最大排队等待时间（微秒）
+};
+
+/**
+*  @author
+*  @class       SendLaneQueue
+*  @brief       多通道严格优先级发送队列（非线程安全，由调用方加锁）
+*/
+class SendLaneQueue
+{
+public:
+	/**
+	*  @brief       构造
+	*  @param[in]    metrics: 队列深度/字节数/排队时间写入的指标注册表（tcp.*）
+	*  @param[out]
+	*  @return
+	*/
+	explicit SendLaneQueue(MetricsRegistry* metrics = MetricsRegistry::global());
+
+	/**
+	*  @brief       设置高/低水位（字节），控制通道不受高水位限制
+	*  @param[in]
+	*  @param[out]
+	*  @return
+	*/
+	void setWaterMark(qint64 highWater, qint64 lowWater);
+
+	/**
+	*  @brief       入队
+	*  @param[in]    data: 完整报文  lane: 发送通道
+	*  @param[out]
+	*  @return       false=超过高水位被拒绝
+	*/
+	bool enqueue(const QByteArray& data, ESendLane lane);
+
+	/**
+	*  @brief       按优先级取出一批数据：控制 > 运动 > 批量
+	*  @param[in]    maxBatch: 合并后最大长度  bulkAllowed: 是否允许取批量通道
+	*  @param[out]   batch: 合并后的小包  single: 超过maxBatch的单个大包（不拷贝）
+	*  @return       取出的字节数，0表示没有可发送的数据
+	*/
+	qint64 takeBatch(QByteArray& batch, QByteArray& single, int maxBatch, bool bulkAllowed);
+
+	/**
+	*  @brief       按同样的优先级规则取出一批整帧，不合并不拷贝（供writev分散写使用）
+	*  @param[in]    maxFrames: 最多帧数  maxBytes: 最多字节数（第一帧不受限制）  bulkAllowed: 是否允许取批量通道
+	*  @param[out]   frames: 追加取出的帧  lanes: 可选，追加每帧所属通道
+	*  @return       取出的字节数，0表示没有可发送的数据
+	*/
+	qint64 takeFrames(QVector<QByteArray>& frames, int maxFrames, qint64 maxBytes, bool bulkAllowed, QVector<ESendLane>* lanes = nullptr);
+
+	void clear();
+
+	/**
+	*  @brief       丢弃单个通道的待发送数据
+	*  @param[in]    lane: 发送通道
+	*  @param[out]
+	*  @return       丢弃的字节数
+	*/
+	qint64 clearLane(ESendLane lane);
+
+	bool isEmpty() const;
+
+	//控制/运动通道是否有待发送数据
+	bool hasUrgent() const;
+
+	qint64 pendingBytes() const { return m_pendingBytes; }
+
+	/**
+	*  @brief       拒绝入队后回落到低水位时返回一次true
+	*  @param[in]
+	*  @param[out]
+	*  @return
+	*/
+	bool consumeReadyNotify();
+
+	SendLaneStats stats(ESendLane lane) const;
+
+private:
+	struct Item
+	{
+		QByteArray data;
+		qint64 enqueueNs;
+	};
+
+	void onDequeued(ESendLane lane, const Item& item, qint64 nowNs);
+
+	//出队后更新待发送字节数及对应指标
+	void onTaken(qint64 taken);
+
+private:
+	QQueue<Item> m_lanes[Lane_Count];
+	SendLaneStats m_stats[Lane_Count];
+	QElapsedTimer m_clock;
+	qint64 m_pendingBytes = 0;
+	qint64 m_highWater;
+	qint64 m_lowWater;
+	bool m_backpressured = false;
+
+	//指标（注册表中的对象，地址不变）
+	MetricGauge* m_depthGauge[Lane_Count];
+	LatencyHistogram* m_waitHistogram[Lane_Count];
+	MetricGauge* m_pendingGauge;
+	MetricCounter* m_rejectedCounter;
+	MetricCounter* m_txBytesCounter;
+};
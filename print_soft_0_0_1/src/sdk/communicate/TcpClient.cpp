@@ -1,41 +1,106 @@
 ﻿#include "TcpClient.h"
+#include "IoThreadPool.h"
+#include "CLogManager.h"
+#include "TraceRecorder.h"
 
-TcpClient::TcpClient(QObject* parent /*= 0*/)
+//socket内部写缓存上限，超过后等待bytesWritten再继续
+#define SOCKET_WRITE_WINDOW (256*1024)
+//小包合并后单次write的最大长度
+#define COALESCE_MAX_SIZE (64*1024)
+
+TcpClient::TcpClient(QObject* parent /*= 0*/, ETransportBackend backend /*= defaultBackend()*/, MetricsRegistry* metrics /*= MetricsRegistry::global()*/)
 	:QObject(parent)
+	,m_backend(backend)
+	,m_workThread(nullptr)
+	,m_impl(nullptr)
+	,m_epoll(nullptr)
+	,m_txFrames(&metrics->keyed("frames.tx"))
 {
-	m_workThread = new QThread;
-	m_impl = new TcpClientImpl;
 	qRegisterMetaType<QAbstractSocket::SocketState>("QAbstractSocket::SocketState");
 	qRegisterMetaType<QAbstractSocket::SocketError>("QAbstractSocket::SocketError");
 
-	connect(m_workThread, SIGNAL(finished()), m_workThread, SLOT(deleteLater()));
-	connect(m_workThread, SIGNAL(finished()), m_impl, SLOT(deleteLater()));
+	if (m_backend == Transport_Epoll && !EpollTransport::isSupported())
+	{
+		LOG_WARN(QString(u8"motion_moudle_sdk epoll transport unsupported on this platform, use qt transport"));
+		m_backend = Transport_Qt;
+	}
+
+	//epoll实现的信号在epoll线程中发出，除sigNewData外均按接收者线程排队
+	if (m_backend == Transport_Epoll)
+	{
+		m_epoll = new EpollTransport(this, &m_capture, metrics);
+		if (m_epoll->isValid())
+		{
+			return;
+		}
+		LOG_WARN(QString(u8"motion_moudle_sdk epoll loop unavailable, use qt transport"));
+		delete m_epoll;
+		m_epoll = nullptr;
+		m_backend = Transport_Qt;
+	}
+
+	//多个连接共用I/O线程
+	m_workThread = IoThreadPool::instance()->acquireThread();
+	m_impl = new TcpClientImpl(metrics);
+	m_impl->setCapture(&m_capture);
 
 	connect(m_impl, &TcpClientImpl::sigNewData, this, &TcpClient::sigNewData, Qt::DirectConnection);
+	connect(m_impl, &TcpClientImpl::sigSocketState, this, [this](QAbstractSocket::SocketState state) {
+		if (state == QAbstractSocket::ConnectedState)
+		{
+			emit sigConnectionOpened();
+		}
+	}, Qt::DirectConnection);
 	connect(m_impl, &TcpClientImpl::sigError, this, &TcpClient::sigError);
 	connect(m_impl, &TcpClientImpl::sigSocketState, this, &TcpClient::sigSocketStateChanged);
+	connect(m_impl, &TcpClientImpl::sigSendReady, this, &TcpClient::sigSendReady);
+	connect(m_impl, &TcpClientImpl::sigBytesWritten, this, &TcpClient::sigBytesWritten);
 
 	m_impl->moveToThread(m_workThread);
-
-	m_workThread->start(); 
 }
 
 TcpClient::~TcpClient()
 {
-	if (m_workThread->isRunning())
+	//先从epoll线程移除，之后不会再有回调
+	delete m_epoll;
+	m_epoll = nullptr;
+
+	//线程与其他连接共用，在该线程中同步删除实现对象，返回后不会再有回调
+	if (m_workThread)
 	{
-		m_workThread->quit();
-		m_workThread->wait();
+		IoThreadPool::instance()->releaseThread(m_workThread, m_impl);
+		m_impl = nullptr;
+		m_workThread = nullptr;
 	}
 }
 
+ETransportBackend TcpClient::defaultBackend()
+{
+	QByteArray name = qgetenv(TRANSPORT_BACKEND_ENV).trimmed().toLower();
+	if (name == "epoll")
+	{
+		return Transport_Epoll;
+	}
+	return Transport_Qt;
+}
+
 void TcpClient::setIpAndPort(QString strIp, ushort port)
 {
+	if (m_epoll)
+	{
+		m_epoll->setIpPort(strIp, port);
+		return;
+	}
 	m_impl->setIpPort(strIp, port);
 }
 
 void TcpClient::connectToHost()
 {
+	if (m_epoll)
+	{
+		m_epoll->connectToHost();
+		return;
+	}
 	QMetaObject::invokeMethod(m_impl, [=]() {
 		m_impl->onConnect();
 	}, Qt::QueuedConnection);
@@ -43,6 +108,11 @@ void TcpClient::connectToHost()
 
 void TcpClient::disconnectFromHost()
 {
+	if (m_epoll)
+	{
+		m_epoll->disconnectFromHost();
+		return;
+	}
 	QMetaObject::invokeMethod(m_impl, [=]() {
 		m_impl->onDisconnect();
 	}, Qt::QueuedConnection);
@@ -50,47 +120,162 @@ void TcpClient::disconnectFromHost()
 
 bool TcpClient::isConnected()
 {
+	if (m_epoll)
+	{
+		return m_epoll->isConnected();
+	}
 	bool ret = false;
 	QMetaObject::invokeMethod(m_impl, "isConnected", Qt::BlockingQueuedConnection, Q_RETURN_ARG(bool, ret));
 	return ret;
 }
 
-void TcpClient::sendData(QByteArray data)
+bool TcpClient::sendData(QByteArray data, ESendLane lane /*= Lane_Motion*/)
+{
+	bool queued = m_epoll ? m_epoll->sendData(data, lane) : m_impl->sendData(data, lane);
+	if (queued && data.size() >= 6)
+	{
+		//请求帧的命令类型和命令字为大端
+		const uchar* head = reinterpret_cast<const uchar*>(data.constData());
+		m_txFrames->addFrame((head[2] << 8) | head[3], (head[4] << 8) | head[5], data.size());
+		TRACE_INSTANT("enqueue", "fun_code", (head[4] << 8) | head[5], "lane", lane);
+	}
+	return queued;
+}
+
+bool TcpClient::startCapture(const QString& filePath)
+{
+	return m_capture.open(filePath);
+}
+
+void TcpClient::stopCapture()
 {
+	m_capture.close();
+}
+
+void TcpClient::setSendWaterMark(qint64 highWater, qint64 lowWater)
+{
+	if (m_epoll)
+	{
+		m_epoll->setSendWaterMark(highWater, lowWater);
+		return;
+	}
+	m_impl->setSendWaterMark(highWater, lowWater);
+}
+
+qint64 TcpClient::pendingBytes() const
+{
+	if (m_epoll)
+	{
+		return m_epoll->pendingBytes();
+	}
+	return m_impl->pendingBytes();
+}
+
+void TcpClient::setKeepQueueOnDisconnect(bool bKeep)
+{
+	if (m_epoll)
+	{
+		m_epoll->setKeepQueueOnDisconnect(bKeep);
+		return;
+	}
 	QMetaObject::invokeMethod(m_impl, [=]() {
-		m_impl->sendData(data);
+		m_impl->onSetKeepQueue(bKeep);
 	}, Qt::QueuedConnection);
 }
 
+SendLaneStats TcpClient::laneStats(ESendLane lane) const
+{
+	if (m_epoll)
+	{
+		return m_epoll->laneStats(lane);
+	}
+	return m_impl->laneStats(lane);
+}
+
+void TcpClient::onTransportData(const QByteArray& data)
+{
+	emit sigNewData(data);
+}
+
+void TcpClient::onTransportState(QAbstractSocket::SocketState state)
+{
+	if (state == QAbstractSocket::ConnectedState)
+	{
+		emit sigConnectionOpened();
+	}
+	emit sigSocketStateChanged(state);
+}
+
+void TcpClient::onTransportError(QAbstractSocket::SocketError socketError)
+{
+	emit sigError(socketError);
+}
+
+void TcpClient::onTransportBytesWritten(qint64 bytes)
+{
+	emit sigBytesWritten(bytes);
+}
+
+void TcpClient::onTransportSendReady()
+{
+	emit sigSendReady();
+}
 
 
-TcpClientImpl::TcpClientImpl(QObject* parent /*= nullptr*/)
+
+TcpClientImpl::TcpClientImpl(MetricsRegistry* metrics /*= MetricsRegistry::global()*/, QObject* parent /*= nullptr*/)
 	:QObject(parent)
+	,m_sendLists(metrics)
 {
 	m_tcpsocket = new QTcpSocket(this);
-	m_timer = new QTimer(this);
+	m_coalesceBuf.reserve(COALESCE_MAX_SIZE);
 
 	connect(m_tcpsocket, &QTcpSocket::stateChanged, this, &TcpClientImpl::onStateChanged);
 	connect(m_tcpsocket, SIGNAL(readyRead()), this, SLOT(onReadData()), Qt::DirectConnection);
+	connect(m_tcpsocket, SIGNAL(bytesWritten(qint64)), this, SLOT(onBytesWritten(qint64)), Qt::DirectConnection);
 	connect(m_tcpsocket, SIGNAL(error(QAbstractSocket::SocketError)), this, SLOT(onError(QAbstractSocket::SocketError)));
-	connect(m_timer, SIGNAL(timeout()), this, SLOT(onTimeout()), Qt::DirectConnection);
-
-	m_timer->start(20);
 }
 
 TcpClientImpl::~TcpClientImpl()
 {
-	m_timer->stop();
-
-	m_sendLists.clear();
+	clearSendQueue();
 	delete m_tcpsocket;
-	delete m_timer;
 }
 
-void TcpClientImpl::sendData(QByteArray data)
+bool TcpClientImpl::sendData(QByteArray data, ESendLane lane)
 {
 	QMutexLocker lock(&m_sendMutex);
-	m_sendLists.push_back(data);
+
+	if (!m_sendLists.enqueue(data, lane))
+	{
+		return false;
+	}
+
+	//同一轮事件循环内的多次入队只投递一次发送
+	if (!m_flushQueued)
+	{
+		m_flushQueued = true;
+		QMetaObject::invokeMethod(this, "onFlush", Qt::QueuedConnection);
+	}
+	return true;
+}
+
+void TcpClientImpl::setSendWaterMark(qint64 highWater, qint64 lowWater)
+{
+	QMutexLocker lock(&m_sendMutex);
+	m_sendLists.setWaterMark(highWater, lowWater);
+}
+
+qint64 TcpClientImpl::pendingBytes() const
+{
+	QMutexLocker lock(&m_sendMutex);
+	return m_sendLists.pendingBytes();
+}
+
+SendLaneStats TcpClientImpl::laneStats(ESendLane lane) const
+{
+	QMutexLocker lock(&m_sendMutex);
+	return m_sendLists.stats(lane);
 }
 
 void TcpClientImpl::setIpPort(QString strIp, ushort port)
@@ -124,28 +309,119 @@ void TcpClientImpl::onReadData()
 	while (m_tcpsocket->bytesAvailable())
 	{
 		QNetworkDatagram data = m_tcpsocket->readAll();
+		TRACE_INSTANT("wire_read", "bytes", data.data().size());
+		if (m_capture)
+		{
+			m_capture->record(Wire_Inbound, data.data().constData(), data.data().size());
+		}
 		emit sigNewData(data.data());
 	}
 }
 
-void TcpClientImpl::onTimeout()
+void TcpClientImpl::onFlush()
 {
-	QMutexLocker lock(&m_sendMutex);
+	{
+		QMutexLocker lock(&m_sendMutex);
+		m_flushQueued = false;
+	}
+	flushSendQueue();
+}
+
+void TcpClientImpl::onSetKeepQueue(bool bKeep)
+{
+	m_keepQueue = bKeep;
+	//取消保留时丢弃断开期间积压的数据
+	if (!bKeep && m_tcpsocket->state() == QAbstractSocket::UnconnectedState)
+	{
+		clearSendQueue();
+	}
+}
 
-	if (m_sendLists.size() == 0)
+void TcpClientImpl::onBytesWritten(qint64 bytes)
+{
+	flushSendQueue();
+	emit sigBytesWritten(bytes);
+}
+
+void TcpClientImpl::flushSendQueue()
+{
+	QAbstractSocket::SocketState state = m_tcpsocket->state();
+	if (state != QAbstractSocket::ConnectedState)
 	{
+		//正在连接时保留队列，连接成功后发送；已断开且不等待重连则丢弃待发送数据
+		if (state == QAbstractSocket::UnconnectedState && !m_keepQueue)
+		{
+			clearSendQueue();
+		}
 		return;
 	}
 
-	if (m_tcpsocket->state() == QAbstractSocket::ConnectedState)
+	bool notifyReady = false;
+	while (true)
 	{
-		m_tcpsocket->write(m_sendLists.first());
+		//控制/运动命令只要socket写缓存未满就立即写出；
+		//批量数据只在socket写缓存清空后才写一批，使后到的停止命令最多落后一次write
+		qint64 inFlight = m_tcpsocket->bytesToWrite();
+		if (inFlight >= SOCKET_WRITE_WINDOW)
+		{
+			break;
+		}
 
-		m_sendLists.removeFirst();
+		QByteArray single;
+		qint64 takenBytes = 0;
+		{
+			QMutexLocker lock(&m_sendMutex);
+			takenBytes = m_sendLists.takeBatch(m_coalesceBuf, single, COALESCE_MAX_SIZE, inFlight == 0);
+			notifyReady |= m_sendLists.consumeReadyNotify();
+		}
+
+		if (takenBytes == 0)
+		{
+			break;
+		}
+
+		TRACE_SCOPE("wire_write", "bytes", takenBytes);
+		const QByteArray& out = single.isEmpty() ? m_coalesceBuf : single;
+		if (m_capture)
+		{
+			m_capture->record(Wire_Outbound, out.constData(), out.size());
+		}
+		m_tcpsocket->write(out);
+	}
+
+	if (notifyReady)
+	{
+		emit sigSendReady();
 	}
-	else
+}
+
+void TcpClientImpl::clearSendQueue()
+{
+	bool notifyReady = false;
 	{
+		QMutexLocker lock(&m_sendMutex);
 		m_sendLists.clear();
+		notifyReady = m_sendLists.consumeReadyNotify();
+	}
+
+	if (notifyReady)
+	{
+		emit sigSendReady();
+	}
+}
+
+void TcpClientImpl::dropBulkFrames()
+{
+	bool notifyReady = false;
+	{
+		QMutexLocker lock(&m_sendMutex);
+		m_sendLists.clearLane(Lane_Bulk);
+		notifyReady = m_sendLists.consumeReadyNotify();
+	}
+
+	if (notifyReady)
+	{
+		emit sigSendReady();
 	}
 }
 
@@ -156,5 +432,21 @@ void TcpClientImpl::onError(QAbstractSocket::SocketError socketError)
 
 void TcpClientImpl::onStateChanged(QAbstractSocket::SocketState state)
 {
+	if (state == QAbstractSocket::ConnectedState)
+	{
+		//连接建立前入队的数据
+		flushSendQueue();
+	}
+	else if (state == QAbstractSocket::UnconnectedState)
+	{
+		if (m_keepQueue)
+		{
+			dropBulkFrames();
+		}
+		else
+		{
+			clearSendQueue();
+		}
+	}
 	emit sigSocketState(state);
 }
@@ -1,19 +1,37 @@
 ﻿#pragma once
 #include <QtCore/QtCore>
 #include <QtNetwork/QtNetwork>
+#include "SendLaneQueue.h"
+#include "EpollTransport.h"
 
 class TcpClientImpl;
 
+/**  传输实现  **/
+enum ETransportBackend
+{
+	Transport_Qt = 0,		//QTcpSocket + QThread事件循环（全平台）
+	Transport_Epoll			//非阻塞socket + epoll + writev（仅Linux）
+};
+
+//选择传输实现的环境变量，取值 qt / epoll
+#define TRANSPORT_BACKEND_ENV "PRINT_SDK_TRANSPORT"
+
 /** 
 *  @author      
 *  @class       TcpClient 
 *  @brief       tcp客户端操作类 
 */
-class TcpClient : public QObject
+class TcpClient : public QObject, public EpollTransportCallBack
 {
 	Q_OBJECT
 public:
-	TcpClient(QObject* parent = 0);
+	/** 
+	*  @brief       构造，socket I/O在IoThreadPool分配的共享线程中进行
+	*  @param[in]    backend: 传输实现，当前平台不支持时退回Transport_Qt  metrics: 收发统计写入的注册表（每个设备会话一个）
+	*  @param[out]   
+	*  @return                    
+	*/
+	TcpClient(QObject* parent = 0, ETransportBackend backend = defaultBackend(), MetricsRegistry* metrics = MetricsRegistry::global());
 
 	~TcpClient();
 
@@ -50,27 +68,107 @@ public:
 	bool isConnected();
 
 	/** 
-	*  @brief       发送数据 
+	*  @brief       发送数据（可在任意线程调用，数据进入发送队列后由socket线程按可写事件发送）
+	*  @param[in]    data: 完整报文  lane: 发送通道，控制通道优先于运动通道优先于批量数据
+	*  @param[out]   
+	*  @return       true=已入队, false=发送队列超过高水位，调用方需等待sigSendReady后重试
+	*/
+	bool sendData(QByteArray data, ESendLane lane = Lane_Motion);
+
+	/** 
+	*  @brief       设置发送队列高/低水位（字节）
+	*  @param[in]    highWater: 超过后sendData返回false  lowWater: 回落到该值以下时发出sigSendReady
+	*  @param[out]   
+	*  @return                    
+	*/
+	void setSendWaterMark(qint64 highWater, qint64 lowWater);
+
+	/** 
+	*  @brief       发送队列中尚未写入socket的字节数
+	*  @param[in]    
+	*  @param[out]   
+	*  @return                    
+	*/
+	qint64 pendingBytes() const;
+
+	/** 
+	*  @brief       获取发送通道的排队深度和等待时间统计
 	*  @param[in]    
 	*  @param[out]   
 	*  @return                    
 	*/
-	void sendData(QByteArray data);
+	SendLaneStats laneStats(ESendLane lane) const;
+
+	/** 
+	*  @brief       断开后是否保留发送队列，用于自动重连：保留的数据在重新连接后按原顺序发送；
+	*               批量通道（图像帧）不保留，由上层重传窗口重发
+	*  @param[in]    bKeep: false=断开时丢弃待发送数据（默认）
+	*  @param[out]   
+	*  @return                    
+	*/
+	void setKeepQueueOnDisconnect(bool bKeep);
+
+	//实际使用的传输实现
+	ETransportBackend backend() const { return m_backend; }
+
+	/** 
+	*  @brief       开始抓取socket原始收发数据（格式见WireCapture）
+	*  @param[in]    filePath: 输出文件路径
+	*  @param[out]   
+	*  @return       false=文件无法创建
+	*/
+	bool startCapture(const QString& filePath);
+
+	//结束抓包
+	void stopCapture();
+
+	bool isCapturing() const { return m_capture.isOpen(); }
+
+	/** 
+	*  @brief       默认传输实现：读取环境变量TRANSPORT_BACKEND_ENV，未设置时为Transport_Qt
+	*  @param[in]    
+	*  @param[out]   
+	*  @return                    
+	*/
+	static ETransportBackend defaultBackend();
 
 
 signals:
 	//新的数据到来信号
 	void sigNewData(QByteArray msg);
 
+	//发送队列从高水位回落，可以继续发送
+	void sigSendReady();
+
+	//socket写出数据（发送队列已被取走一部分，分批生产数据的一方可继续入队）
+	void sigBytesWritten(qint64 bytes);
+
 	//错误信号
 	void sigError(QAbstractSocket::SocketError socketError);
 
 	//连接信号变化
 	void sigSocketStateChanged(QAbstractSocket::SocketState state);
 
+	//连接建立，在socket线程中、新连接的数据到来之前发出（与sigNewData同线程，需DirectConnection）
+	void sigConnectionOpened();
+
+protected:
+	//EpollTransport回调（epoll线程），转为与Qt实现相同的信号
+	virtual void onTransportData(const QByteArray& data);
+	virtual void onTransportState(QAbstractSocket::SocketState state);
+	virtual void onTransportError(QAbstractSocket::SocketError socketError);
+	virtual void onTransportBytesWritten(qint64 bytes);
+	virtual void onTransportSendReady();
+
 private:
+	ETransportBackend m_backend;
 	QThread* m_workThread;
 	TcpClientImpl* m_impl;
+	EpollTransport* m_epoll;
+	//socket线程中记录收发数据
+	WireCapture m_capture;
+	//按命令类型+命令字统计已入队发送的帧（frames.tx）
+	KeyedMetrics* m_txFrames;
 };
 
 
@@ -83,32 +181,63 @@ class TcpClientImpl : public QObject
 {
 	Q_OBJECT
 public:
-	TcpClientImpl(QObject* parent = nullptr);
+	TcpClientImpl(MetricsRegistry* metrics = MetricsRegistry::global(), QObject* parent = nullptr);
 	~TcpClientImpl();
 
-	void sendData(QByteArray data);
+	//线程安全，可在任意线程调用
+	bool sendData(QByteArray data, ESendLane lane);
 	void setIpPort(QString strIp, ushort port);
+	void setSendWaterMark(qint64 highWater, qint64 lowWater);
+	qint64 pendingBytes() const;
+	SendLaneStats laneStats(ESendLane lane) const;
+
+	//设置抓包对象，须在移入工作线程前调用
+	void setCapture(WireCapture* capture) { m_capture = capture; }
 
 
 signals:
 	void sigNewData(QByteArray msg);
 	void sigError(QAbstractSocket::SocketError socketError);
 	void sigSocketState(QAbstractSocket::SocketState state);
+	void sigSendReady();
+	void sigBytesWritten(qint64 bytes);
 
 public slots:
 	bool isConnected();
 	void onConnect();
 	void onDisconnect();
 	void onReadData();
-	void onTimeout();
+	void onFlush();
+	void onSetKeepQueue(bool bKeep);
+	void onBytesWritten(qint64 bytes);
 	void onError(QAbstractSocket::SocketError socketError);
 	void onStateChanged(QAbstractSocket::SocketState state);
 
+private:
+	/** 
+	*  @brief       按通道优先级发送队列数据，小包合并为一次write
+	*  @param[in]    
+	*  @param[out]   
+	*  @return                    
+	*/
+	void flushSendQueue();
+
+	void clearSendQueue();
+
+	//断线保留队列时丢弃图像帧，由上层重传窗口在重连后按序重发
+	void dropBulkFrames();
+
 private:
 	QTcpSocket* m_tcpsocket;
-	QList<QByteArray> m_sendLists;
-	QMutex m_sendMutex;
-	QTimer* m_timer;
+	SendLaneQueue m_sendLists;
+	mutable QMutex m_sendMutex;
+	//已投递onFlush但尚未执行
+	bool m_flushQueued = false;
+	//断开后保留发送队列（只在socket线程访问）
+	bool m_keepQueue = false;
+	//合并发送缓存，复用内存
+	QByteArray m_coalesceBuf;
+	WireCapture* m_capture = nullptr;
 	ushort m_port;
 	QString m_destinationIp;
 };
\ No newline at end of file
@@ -1,17 +1,15 @@
 ﻿
 #include "motionControlSDK.h"
 #include "SDKManager.h"
+#include "SDKSessionManager.h"
 #include "ProtocolPrint.h"
 
 #include <QDebug>
 #include <QString>
-#include <QMutex>
-#include <QMutexLocker>
 #include <QMetaObject>
+#include <QMetaMethod>
 #include "CLogManager.h"
-
-#include <spdlog/spdlog.h>
-#include <spdlog/sinks/basic_file_sink.h>
+#include "CLogSpdlogSink.h"
 
 /**
  * @class motionControlSDK::Private
@@ -28,6 +26,8 @@ class motionControlSDK::Private
 public:
 	explicit Private(motionControlSDK* q)
 		: q_ptr(q)
+		, session(SDKManager::instance())
+		, ownsSession(false)
 		, initialized(false)
 		, connectedState(false)
 		, port(0)
@@ -39,55 +39,57 @@ public:
 	}
 
 	motionControlSDK* q_ptr;
+	SDKManager* session;                            ///< 默认构造时为默认会话
+	bool ownsSession;                               ///< 会话由本对象创建并销毁
 	bool initialized;
 	bool connectedState;
 	QString ip;
 	quint16 port;
 
-	// 静态回调函数（桥接C回调到Qt信号）
-	static void sdkEventCallback(const SdkEvent* event);
+	// 静态回调函数（桥接C回调到Qt信号），userData为本会话的Private
+	static void sdkEventCallback(SdkSessionHandle session, const SdkEvent* event, void* userData);
 
-	// 全局实例管理（用于C回调中访问Qt对象）
-	static motionControlSDK* s_instance;
-	static QMutex s_mutex;
+	// 按报文类信号的连接情况更新事件订阅掩码
+	void updateEventMask();
 };
 
-// 静态成员初始化
-motionControlSDK* motionControlSDK::Private::s_instance = nullptr;
-QMutex motionControlSDK::Private::s_mutex;
-
 
 motionControlSDK::motionControlSDK(QObject *parent)
 	: QObject(parent)
 	, d(new Private(this))
 {
-	QMutexLocker locker(&Private::s_mutex);
-	Private::s_instance = this;
-
-	std::shared_ptr<spdlog::logger> my_logger = spdlog::basic_logger_mt("spdlog", "spdlog_motion_moudle.txt");
-	// 设置日志格式. 参数含义: [日志标识符] [日期] [日志级别] [线程号] [数据]
-	my_logger->set_pattern("[%n][%Y-%m-%d %H:%M:%S.%e] [%l] [%t] %v");
-	my_logger->set_level(spdlog::level::debug);
-	spdlog::flush_every(std::chrono::seconds(5)); // 定期刷新日志缓冲区
+	// spdlog调用点与LOG_*宏写入同一个日志后端
+	CLogSpdlogSink::install();
+}
 
-	my_logger->trace("Welcome to trace spdlog!");
-	my_logger->debug("Welcome to debug spdlog!");
-	my_logger->info("Welcome to info spdlog!");
-	my_logger->error("Welcome to error spdlog!");
+motionControlSDK::motionControlSDK(const QString& sessionName, QObject *parent /*= nullptr*/)
+	: QObject(parent)
+	, d(new Private(this))
+{
+	CLogSpdlogSink::install();
 
+	SDKManager* session = SDKSessionManager::instance()->createSession(sessionName);
+	if (!session)
+	{
+		// 重名时自动命名，不影响已有会话
+		session = SDKSessionManager::instance()->createSession(QString());
+		LOG_WARN(QString(u8"motion_moudle_sdk session %1 exists, use %2").arg(sessionName).arg(session->name()));
+	}
+	d->session = session;
+	d->ownsSession = true;
 }
 
 motionControlSDK::~motionControlSDK()
 {
 	MC_Release();
 
-	QMutexLocker locker(&Private::s_mutex);
-	if (Private::s_instance == this) 
+	if (d->ownsSession)
 	{
-		Private::s_instance = nullptr;
+		SDKSessionManager::instance()->destroySession(d->session);
 	}
 
 	delete d;
+	d = nullptr;
 }
 
 bool motionControlSDK::MC_Init(const QString& logDir)
@@ -104,7 +106,7 @@ bool motionControlSDK::MC_Init(const QString& logDir)
 	// 初始化SDK
 	// 注意：如果SDK独立运行（不在Qt应用程序中），需要创建QCoreApplication
 	// 这里假设调用者会管理Qt事件循环
-	bool ret = SDKManager::instance()->init("./");
+	bool ret = d->session->init("./");
 
 	if (!ret) 
 	{
@@ -117,10 +119,10 @@ bool motionControlSDK::MC_Init(const QString& logDir)
 
 	// 注册事件回调函数（桥接C回调到Qt信号）
 	//RegisterEventCallback(&Private::sdkEventCallback);
-	QMutexLocker lock(&g_callbackMutex);
-	g_sdkCallback = &Private::sdkEventCallback;
+	d->session->setSessionEventCallback(&Private::sdkEventCallback, d, SDK_EVENT_MASK_DEFAULT);
 
 	d->initialized = true;
+	d->updateEventMask();
 	//emit MC_SigInfoMsg(tr("SDK初始化成功"));
 
 	qDebug() << "motionControlSDK initialized successfully";
@@ -140,8 +142,9 @@ void motionControlSDK::MC_Release()
 		MC_DisconnectDev();
 	}
 
-	// 释放底层SDK
-	SDKManager::instance()->release();
+	// 释放底层SDK，返回后不会再有本会话的回调
+	d->session->setSessionEventCallback(nullptr, nullptr, 0);
+	d->session->release();
 
 
 	d->initialized = false;
@@ -176,7 +179,7 @@ bool motionControlSDK::MC_Connect2Dev(const QString& ip, quint16 port)
 	}
 
 	// 调用C接口连接设备
-	int ret = SDKManager::instance()->connectByTCP(ip, port);
+	int ret = d->session->connectByTCP(ip, port);
 	if (ret != 0) 
 	{
 		QString errMsg = tr("连接失败，错误码：%1").arg(ret);
@@ -203,14 +206,15 @@ void motionControlSDK::MC_DisconnectDev()
 		return;
 	}
 
-	if (!d->connectedState) 
+	// 重连中也可断开，结束重连
+	if (!d->connectedState && !d->session->isReconnecting()) 
 	{
 		//emit MC_SigInfoMsg(tr("设备未连接"));
 		return;
 	}
 
 	// 调用C接口断开连接
-	SDKManager::instance()->disconnect();
+	d->session->disconnect();
 
 	emit MC_SigInfoMsg(tr("正在断开连接..."));
 }
@@ -221,6 +225,11 @@ bool motionControlSDK::MC_IsConnected() const
 	return d->connectedState;
 }
 
+void motionControlSDK::MC_SetAutoReconnect(bool enable, int minDelayMs /*= 500*/, int maxDelayMs /*= 30000*/)
+{
+	d->session->setAutoReconnect(enable, minDelayMs, maxDelayMs);
+}
+
 QString motionControlSDK::MC_GetDevIp() const
 {
 	return d->ip;
@@ -233,7 +242,7 @@ quint16 motionControlSDK::MC_GetDevPort() const
 
 void motionControlSDK::refreshConnectionStatus()
 {
-	bool connected = SDKManager::instance()->isConnected();
+	bool connected = d->session->isConnected();
 	if (d->connectedState != connected) 
 	{
 		d->connectedState = connected;
@@ -263,7 +272,7 @@ bool motionControlSDK::MC_GoHome()
 
 	// 所有轴回原点
 	// axisFlag = 7 表示 X(1) + Y(2) + Z(4) = 全部轴 
-	int ret = SDKManager::instance()->resetAxis(7);
+	int ret = d->session->resetAxis(7);
 	if (ret != 0) 
 	{
 		emit MC_SigErrOccurred(-1, QString(u8"go_home_cmd_failed"));
@@ -284,7 +293,7 @@ bool motionControlSDK::MC_moveXAxis(const MoveAxisPos& targetPos)
 	}
 
 	// 调用SDKManager的X轴移动
-	int result = SDKManager::instance()->move2AbsXAxis(targetPos);
+	int result = d->session->move2AbsXAxis(targetPos);
 	return (result == 0);
 }
 
@@ -297,7 +306,7 @@ bool motionControlSDK::MC_moveYAxis(const MoveAxisPos& targetPos)
 	}
 
 	// 调用SDKManager的Y轴移动
-	int result = SDKManager::instance()->move2AbsYAxis(targetPos);
+	int result = d->session->move2AbsYAxis(targetPos);
 	return (result == 0);
 }
 
@@ -310,7 +319,7 @@ bool motionControlSDK::MC_moveZAxis(const MoveAxisPos& targetPos)
 	}
 
 	// 调用SDKManager的Z轴移动
-	int result = SDKManager::instance()->move2AbsZAxis(targetPos);
+	int result = d->session->move2AbsZAxis(targetPos);
 	return (result == 0);
 }
 
@@ -327,15 +336,15 @@ bool motionControlSDK::MC_move2RelSingleAxisPos(double dx, double dy, double dz)
 	// 调用SDKManager的相对移动
 	if (dx != 0)
 	{
-		ret |= SDKManager::instance()->move2RelXAxis(dx);
+		ret |= d->session->move2RelXAxis(dx);
 	}
 	if (dy != 0)
 	{
-		ret |= SDKManager::instance()->move2RelXAxis(dy);
+		ret |= d->session->move2RelXAxis(dy);
 	}
 	if (dz != 0)
 	{
-		ret |= SDKManager::instance()->move2RelXAxis(dz);
+		ret |= d->session->move2RelXAxis(dz);
 	}
 	if (ret != 0)
 	{
@@ -359,15 +368,15 @@ bool motionControlSDK::MC_move2AbsSingleAxisPos(const MoveAxisPos& targetPos)
 	// 调用SDKManager的绝对移动
 	if (targetPos.xPos != 0)
 	{
-		ret |= SDKManager::instance()->move2AbsXAxis(targetPos);
+		ret |= d->session->move2AbsXAxis(targetPos);
 	}
 	if (targetPos.yPos != 0)
 	{
-		ret |= SDKManager::instance()->move2AbsYAxis(targetPos);
+		ret |= d->session->move2AbsYAxis(targetPos);
 	}
 	if (targetPos.zPos != 0)
 	{
-		ret |= SDKManager::instance()->move2AbsZAxis(targetPos);
+		ret |= d->session->move2AbsZAxis(targetPos);
 	}
 	if (ret != 0)
 	{
@@ -397,15 +406,15 @@ bool motionControlSDK::MC_move2RelAxisPos(double dx, double dy, double dz)
 	// 调用SDKManager的相对移动
 	if (dx != 0)
 	{
-		ret |= SDKManager::instance()->move2RelXAxis(dx);
+		ret |= d->session->move2RelXAxis(dx);
 	}
 	if (dy != 0)
 	{
-		ret |= SDKManager::instance()->move2RelXAxis(dy);
+		ret |= d->session->move2RelXAxis(dy);
 	}
 	if (dz != 0)
 	{
-		ret |= SDKManager::instance()->move2RelXAxis(dz);
+		ret |= d->session->move2RelXAxis(dz);
 	}
 	if (ret != 0)
 	{
@@ -435,7 +444,7 @@ bool motionControlSDK::MC_move2AbsAxisPos(const MoveAxisPos& targetPos)
 	stream << targetPos.yPos;
 	stream << targetPos.zPos;
 
-	int result = SDKManager::instance()->move2AbsPosition(data);
+	int result = d->session->move2AbsPosition(data);
 	return (result == 0);
 }
 
@@ -455,7 +464,7 @@ bool motionControlSDK::MC_move2AbsAxisPos(const QByteArray& positionData)
 	}
 
 	// 调用SDKManager的3轴同时移动
-	int result = SDKManager::instance()->move2AbsPosition(positionData);
+	int result = d->session->move2AbsPosition(positionData);
 	return (result == 0);
 }
 
@@ -464,13 +473,13 @@ bool motionControlSDK::MC_move2AbsAxisPos(const QByteArray& positionData)
 
 bool motionControlSDK::MC_SendData(int cmdType, const QByteArray& data)
 {
-	SDKManager::instance()->sendCommand(cmdType, data);
+	d->session->sendCommand(cmdType, data);
 	return true;
 }
 
 // ======================= 打印控制 ====================
 
-bool motionControlSDK::MC_loadPrintData(const QString& filePath)
+bool motionControlSDK::MC_loadPrintData(const QString& filePath, ImageTransferMode mode /*= IMAGE_TRANSFER_RAW*/)
 {
 	if (!MC_IsConnected())
 	{
@@ -484,7 +493,7 @@ bool motionControlSDK::MC_loadPrintData(const QString& filePath)
 		return false;
 	}
 
-	int ret = SDKManager::instance()->loadImageData(filePath.toUtf8().constData());
+	int ret = d->session->loadImageData(filePath, mode);
 	if (ret != 0) 
 	{
 		emit MC_SigErrOccurred(ret, tr(u8"加载打印数据失败"));
@@ -503,7 +512,7 @@ bool motionControlSDK::MC_StartPrint()
 		return false;
 	}
 
-	int ret = SDKManager::instance()->startPrint();
+	int ret = d->session->startPrint();
 	if (ret != 0) 
 	{
 		emit MC_SigErrOccurred(ret, tr("start_print_cmd_failed"));
@@ -522,7 +531,7 @@ bool motionControlSDK::MC_PausePrint()
 		return false;
 	}
 
-	int ret = SDKManager::instance()->pausePrint();
+	int ret = d->session->pausePrint();
 	if (ret != 0) 
 	{
 		emit MC_SigErrOccurred(ret, tr(u8"暂停打印命令失败"));
@@ -541,7 +550,7 @@ bool motionControlSDK::MC_ResumePrint()
 		return false;
 	}
 
-	int ret = SDKManager::instance()->resumePrint();
+	int ret = d->session->resumePrint();
 	if (ret != 0) 
 	{
 		emit MC_SigErrOccurred(ret, tr(u8"恢复打印命令失败"));
@@ -560,7 +569,7 @@ bool motionControlSDK::MC_StopPrint()
 		return false;
 	}
 
-	int ret = SDKManager::instance()->stopPrint();
+	int ret = d->session->stopPrint();
 	if (ret != 0) 
 	{
 		emit MC_SigErrOccurred(ret, tr(u8"停止打印命令失败"));
@@ -578,36 +587,79 @@ bool motionControlSDK::MC_CleanPrint()
 
 void motionControlSDK::MC_SendCmd(int operCmd, const QByteArray& arrData)
 {
-	SDKManager::instance()->sendCommand(operCmd, arrData);
+	d->session->sendCommand(operCmd, arrData);
 }
 
-// ==================== 回调函数（桥接C回调到Qt信号）====================
+quint64 motionControlSDK::MC_SendCmdAsync(int funCode, const QByteArray& data, CommandReplyCallback callback, int timeoutMs /*= 3000*/)
+{
+	return d->session->sendCommandAsync(funCode, data, std::move(callback), timeoutMs);
+}
 
-void motionControlSDK::Private::sdkEventCallback(const SdkEvent* event)
+QFuture<CommandReply> motionControlSDK::MC_SendCmdFuture(int funCode, const QByteArray& data /*= QByteArray()*/, int timeoutMs /*= 3000*/)
 {
-	if (!event) 
-	{
-		return;
-	}
+	return d->session->sendCommandFuture(funCode, data, timeoutMs);
+}
+
+QJsonObject motionControlSDK::MC_GetMetrics() const
+{
+	return d->session->metricsSnapshot();
+}
+
+void motionControlSDK::MC_ResetMetrics()
+{
+	d->session->resetMetrics();
+}
+
+void motionControlSDK::MC_StartTrace()
+{
+	d->session->startTrace();
+}
+
+bool motionControlSDK::MC_StopTrace(const QString& filePath)
+{
+	return d->session->stopTrace(filePath);
+}
+
+bool motionControlSDK::MC_StartCapture(const QString& filePath)
+{
+	return d->session->startCapture(filePath);
+}
 
-	QMutexLocker locker(&s_mutex);
+void motionControlSDK::MC_StopCapture()
+{
+	d->session->stopCapture();
+}
 
-	if (!s_instance) 
+// ==================== 回调函数（桥接C回调到Qt信号）====================
+
+void motionControlSDK::Private::sdkEventCallback(SdkSessionHandle session, const SdkEvent* event, void* userData)
+{
+	Q_UNUSED(session);
+	if (!event || !userData) 
 	{
 		return;
 	}
 
+	// 回调注销时会等待正在执行的回调返回，这里q_ptr有效
+	motionControlSDK* q = static_cast<Private*>(userData)->q_ptr;
+
 	// 将C回调转换为Qt信号
 	// 使用QMetaObject::invokeMethod确保信号在正确的线程中发射（线程安全）
 	QString message = QString::fromUtf8(event->message);
 	SdkEventType type = event->type;
+	// 报文原始字节只在回调期间有效，投递前拷贝
+	QByteArray data;
+	if (event->data && event->dataLen > 0)
+	{
+		data = QByteArray(reinterpret_cast<const char*>(event->data), event->dataLen);
+	}
 	int code = event->code;
 	double v1 = event->value1;
 	double v2 = event->value2;
 	double v3 = event->value3;
 
 	// 使用Qt::QueuedConnection确保在主线程中执行
-	QMetaObject::invokeMethod(s_instance, [=]() 
+	QMetaObject::invokeMethod(q, [=]() 
 	{
 		switch (type) 
 		{
@@ -617,25 +669,25 @@ void motionControlSDK::Private::sdkEventCallback(const SdkEvent* event)
 			if (message.contains("connected", Qt::CaseInsensitive) &&
 				message.contains("dev", Qt::CaseInsensitive)) 
 			{
-				s_instance->d->connectedState = true;
-				emit s_instance->connected();
-				emit s_instance->MC_SigConnectedChanged(true);
+				q->d->connectedState = true;
+				emit q->connected();
+				emit q->MC_SigConnectedChanged(true);
 				LOG_INFO(QString("motion_moudle sdk_connected_dev"));
 			}
 			else if (message.contains("disconnected", Qt::CaseInsensitive)) 
 			{
-				s_instance->d->connectedState = false;
-				emit s_instance->MC_SigDisconnected();
-				emit s_instance->MC_SigConnectedChanged(false);
+				q->d->connectedState = false;
+				emit q->MC_SigDisconnected();
+				emit q->MC_SigConnectedChanged(false);
 				LOG_INFO(QString("motion_moudle sdk_disconnected_dev"));
 			}
-			emit s_instance->MC_SigInfoMsg(message);
+			emit q->MC_SigInfoMsg(message);
 			break;
 		}
 
 		case EVENT_TYPE_ERROR: 
 		{
-			emit s_instance->MC_SigErrOccurred(code, message);
+			emit q->MC_SigErrOccurred(code, message);
 			qWarning() << "SDK Error:" << code << message;
 			break;
 		}
@@ -646,10 +698,10 @@ void motionControlSDK::Private::sdkEventCallback(const SdkEvent* event)
 			int currentLayer = static_cast<int>(v2);
 			int totalLayers = static_cast<int>(v3);
 
-			emit s_instance->MC_SigPrintProgUpdated(progress, currentLayer, totalLayers);
+			emit q->MC_SigPrintProgUpdated(progress, currentLayer, totalLayers);
 
 			QString statusMsg = QString(u8"打印进度: %1% (%2/%3层)").arg(progress).arg(currentLayer).arg(totalLayers);
-			emit s_instance->MC_SigPrintStatusChanged(statusMsg);
+			emit q->MC_SigPrintStatusChanged(statusMsg);
 
 			qDebug() << "Print progress:" << progress << "%"
 				<< currentLayer << "/" << totalLayers;
@@ -658,11 +710,11 @@ void motionControlSDK::Private::sdkEventCallback(const SdkEvent* event)
 
 		case EVENT_TYPE_MOVE_STATUS: 
 		{
-			emit s_instance->MC_SigMoveStatusChanged(message);
+			emit q->MC_SigMoveStatusChanged(message);
 
 			// 如果有坐标信息，发送位置更新
 			if (v1 != 0 || v2 != 0 || v3 != 0) {
-				emit s_instance->MC_SigPosChanged(v1, v2, v3);
+				emit q->MC_SigPosChanged(v1, v2, v3);
 				qDebug() << "Position:" << v1 << v2 << v3;
 			}
 			break;
@@ -670,20 +722,27 @@ void motionControlSDK::Private::sdkEventCallback(const SdkEvent* event)
 
 		case EVENT_TYPE_LOG: 
 		{
-			emit s_instance->MC_SigLogMsg(message);
+			emit q->MC_SigLogMsg(message);
 			// qDebug() << "SDK Log:" << message;  // 可选：打印到调试输出
 			break;
 		}
 		case EVENT_TYPE_SEND_MSG:
 		{
-			emit s_instance->MC_SigSend2DevCmdMsg(message);
-			LOG_INFO(QString("motion_moudle sdk_send_hex_msg: %1").arg(message));
+			emit q->MC_SigSend2DevRawMsg(data);
+			// 16进制文本只为仍连接旧信号的使用方生成
+			if (q->isSignalConnected(QMetaMethod::fromSignal(&motionControlSDK::MC_SigSend2DevCmdMsg)))
+			{
+				emit q->MC_SigSend2DevCmdMsg(QString::fromLatin1(data.toHex().toUpper()));
+			}
 			break;
 		}
 		case EVENT_TYPE_RECV_MSG:
 		{
-			emit s_instance->MC_SigRecv2DevCmdMsg(message);
-			LOG_INFO(QString("motion_moudle sdk_recv_hex_msg: %1").arg(message));
+			emit q->MC_SigRecv2DevRawMsg(data);
+			if (q->isSignalConnected(QMetaMethod::fromSignal(&motionControlSDK::MC_SigRecv2DevCmdMsg)))
+			{
+				emit q->MC_SigRecv2DevCmdMsg(QString::fromLatin1(data.toHex().toUpper()));
+			}
 			break;
 		}
 		default: 
@@ -694,3 +753,51 @@ void motionControlSDK::Private::sdkEventCallback(const SdkEvent* event)
 		}
 	}, Qt::QueuedConnection);
 }
+
+void motionControlSDK::Private::updateEventMask()
+{
+	// 回调由MC_Init注册，注册前不改动掩码
+	if (!initialized)
+	{
+		return;
+	}
+
+	quint32 mask = SDK_EVENT_MASK_DEFAULT;
+	if (q_ptr->isSignalConnected(QMetaMethod::fromSignal(&motionControlSDK::MC_SigSend2DevCmdMsg)) ||
+		q_ptr->isSignalConnected(QMetaMethod::fromSignal(&motionControlSDK::MC_SigSend2DevRawMsg)))
+	{
+		mask |= SDK_EVENT_MASK(EVENT_TYPE_SEND_MSG);
+	}
+	if (q_ptr->isSignalConnected(QMetaMethod::fromSignal(&motionControlSDK::MC_SigRecv2DevCmdMsg)) ||
+		q_ptr->isSignalConnected(QMetaMethod::fromSignal(&motionControlSDK::MC_SigRecv2DevRawMsg)))
+	{
+		mask |= SDK_EVENT_MASK(EVENT_TYPE_RECV_MSG);
+	}
+	session->setEventMask(mask);
+}
+
+void motionControlSDK::connectNotify(const QMetaMethod& signal)
+{
+	if (d && (signal == QMetaMethod::fromSignal(&motionControlSDK::MC_SigSend2DevCmdMsg) ||
+		signal == QMetaMethod::fromSignal(&motionControlSDK::MC_SigSend2DevRawMsg) ||
+		signal == QMetaMethod::fromSignal(&motionControlSDK::MC_SigRecv2DevCmdMsg) ||
+		signal == QMetaMethod::fromSignal(&motionControlSDK::MC_SigRecv2DevRawMsg)))
+	{
+		d->updateEventMask();
+	}
+	QObject::connectNotify(signal);
+}
+
+void motionControlSDK::disconnectNotify(const QMetaMethod& signal)
+{
+	// 断开全部连接时signal为无效方法
+	if (d && (!signal.isValid() ||
+		signal == QMetaMethod::fromSignal(&motionControlSDK::MC_SigSend2DevCmdMsg) ||
+		signal == QMetaMethod::fromSignal(&motionControlSDK::MC_SigSend2DevRawMsg) ||
+		signal == QMetaMethod::fromSignal(&motionControlSDK::MC_SigRecv2DevCmdMsg) ||
+		signal == QMetaMethod::fromSignal(&motionControlSDK::MC_SigRecv2DevRawMsg)))
+	{
+		d->updateEventMask();
+	}
+	QObject::disconnectNotify(signal);
+}
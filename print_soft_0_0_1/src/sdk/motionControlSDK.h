@@ -1,40 +1,21 @@
 ﻿#pragma once
 
 #include "motioncontrolsdk_global.h"
+#include "motioncontrolsdk_event.h"
+#include <QFuture>
+#include <QJsonObject>
+#include <functional>
 #define DATA_LEN_12 12
 
-// --- 事件回调定义 ---
 /**
- * @brief SDK事件类型枚举
+ * @brief 图像数据传输方式
  */
-typedef enum 
+typedef enum
 {
-	EVENT_TYPE_GENERAL,     // 普通信息事件 (如: "Connected", "Disconnected")
-	EVENT_TYPE_ERROR,       // 错误事件
-	EVENT_TYPE_PRINT_STATUS,// 打印状态更新 (如: 进度, 层数)
-	EVENT_TYPE_MOVE_STATUS, // 运动状态更新 (如: "Moving", "Idle")
-	EVENT_TYPE_LOG,          // 内部日志事件
-	EVENT_TYPE_SEND_MSG,
-	EVENT_TYPE_RECV_MSG
-} SdkEventType;
-
-/**
- * @brief SDK事件结构体
- */
-typedef struct 
-{
-	SdkEventType type;      // 事件类型
-	int code;               // 状态/错误码
-	const char* message;    // 事件消息
-	double value1;          // 附加数据1 (例如: 打印进度, X坐标)
-	double value2;          // 附加数据2 (例如: 当前层, Y坐标)
-	double value3;          // 附加数据3 (例如: 总层数, Z坐标)
-} SdkEvent;
-
-/**
- * @brief 回调函数指针类型
- */
-typedef void(*SdkEventCallback)(const SdkEvent* event);
+	IMAGE_TRANSFER_RAW = 0,		// 直接发送原始文件字节（默认）
+	IMAGE_TRANSFER_DECODED,		// 解码一次后发送像素数据
+	IMAGE_TRANSFER_HEX			// 旧方式：文件内容转16进制文本后发送，数据量翻倍
+} ImageTransferMode;
 
 
 struct MOTIONCONTROLSDK_EXPORT MoveAxisPos
@@ -80,6 +61,26 @@ struct MOTIONCONTROLSDK_EXPORT PackParam
 Q_DECLARE_METATYPE(PackParam)
 
 
+/**
+ * @brief 命令应答结果（异步命令接口使用）
+ */
+struct MOTIONCONTROLSDK_EXPORT CommandReply
+{
+	int cmdType = 0;		// 命令类型
+	int funCode = 0;		// 命令字
+	bool ok = false;		// true=下位机成功应答(0xAACC)
+	bool timedOut = false;	// 超时未收到应答
+	QString error;			// 失败原因（超时、断线、发送队列满、下位机拒绝）
+	QByteArray data;		// 应答数据区
+};
+Q_DECLARE_METATYPE(CommandReply)
+
+/**
+ * @brief 命令应答回调，在SDK所在线程调用
+ */
+typedef std::function<void(const CommandReply&)> CommandReplyCallback;
+
+
 class MOTIONCONTROLSDK_EXPORT motionControlSDK : public QObject
 {
 	Q_OBJECT
@@ -97,6 +98,14 @@ public:
 	 */
 	explicit motionControlSDK(QObject *parent = nullptr);
 
+	/**
+	 * @brief 构造独立设备会话，用于同一进程控制多台设备
+	 * @param sessionName 会话名，与其他会话重名或为空时自动命名
+	 * @param parent 父对象（Qt对象树管理）
+	 * @note 各会话有独立的连接、队列和运行指标，socket I/O共用少量线程（见IoThreadPool）
+	 */
+	motionControlSDK(const QString& sessionName, QObject *parent = nullptr);
+
 	/**
 	 * @brief 析构函数
 	 * @note 自动释放SDK资源
@@ -149,6 +158,17 @@ public:
 	 */
 	bool MC_IsConnected() const;
 
+	/**
+	 * @brief 设置断线自动重连（默认开启）
+	 * @param enable 是否自动重连
+	 * @param minDelayMs 首次重连延时（毫秒），之后按带抖动的指数退避增长
+	 * @param maxDelayMs 最大重连延时（毫秒）
+	 * @note 尚未写入socket的命令保留，重连后按原顺序发送；图像传输从最早未确认的帧继续。
+	 *       断线前已发出的命令不重发，其应答回调/MC_SendCmdFuture按超时失败，需要时由调用方重新下发。
+	 *       重连过程通过MC_SigInfoMsg通知（reconnecting/reconnected），重连成功后MC_SigConnectedChanged(true)
+	 */
+	void MC_SetAutoReconnect(bool enable, int minDelayMs = 500, int maxDelayMs = 30000);
+
 	/**
 	 * @brief 获取设备IP
 	 * @return IP地址字符串
@@ -279,9 +299,10 @@ public:
 	/**
 	 * @brief 加载打印数据
 	 * @param filePath 图像文件路径（支持JPG/PNG/BMP）
+	 * @param mode 传输方式，默认直接发送原始文件字节
 	 * @return true=成功, false=失败
 	 */
-	bool MC_loadPrintData(const QString& filePath);
+	bool MC_loadPrintData(const QString& filePath, ImageTransferMode mode = IMAGE_TRANSFER_RAW);
 
 	/**
 	 * @brief 开始打印
@@ -325,6 +346,62 @@ public:
 	 */
 	void MC_SendCmd(int operCmd, const QByteArray& arrData);
 
+	// ==================== 异步命令 ====================
+
+	/**
+	 * @brief 发送命令并在应答、超时或失败时回调，可连续发送多条命令而无需等待
+	 * @param funCode 命令字
+	 * @param data 数据区
+	 * @param callback 完成回调
+	 * @param timeoutMs 应答超时时间（毫秒）
+	 * @return 请求id，0表示未能发送（回调已以失败结果调用）
+	 */
+	quint64 MC_SendCmdAsync(int funCode, const QByteArray& data, CommandReplyCallback callback, int timeoutMs = 3000);
+
+	/**
+	 * @brief 发送命令，返回在应答、超时或失败时完成的QFuture
+	 * @param funCode 命令字
+	 * @param data 数据区
+	 * @param timeoutMs 应答超时时间（毫秒）
+	 * @return 应答结果
+	 */
+	QFuture<CommandReply> MC_SendCmdFuture(int funCode, const QByteArray& data = QByteArray(), int timeoutMs = 3000);
+
+	/**
+	 * @brief 获取运行指标快照
+	 * @return JSON对象：counters/gauges/histograms（微秒）/keyed（按命令类型+命令字统计的帧数、字节数和往返时间）
+	 */
+	QJsonObject MC_GetMetrics() const;
+
+	/**
+	 * @brief 清零运行指标
+	 */
+	void MC_ResetMetrics();
+
+	/**
+	 * @brief 开始记录命令流水线时间线（入队、写出、收到数据、帧解码、应答处理）
+	 */
+	void MC_StartTrace();
+
+	/**
+	 * @brief 停止记录并导出为Chrome trace-event JSON，可用chrome://tracing或Perfetto打开
+	 * @param filePath 输出文件路径，为空时只停止不导出
+	 * @return true=成功
+	 */
+	bool MC_StopTrace(const QString& filePath);
+
+	/**
+	 * @brief 开始抓取socket原始收发数据（带单调时间戳的二进制文件），可用wire_replay工具离线回放
+	 * @param filePath 输出文件路径
+	 * @return true=成功，false=SDK未初始化或文件无法创建
+	 */
+	bool MC_StartCapture(const QString& filePath);
+
+	/**
+	 * @brief 结束抓包
+	 */
+	void MC_StopCapture();
+
 public slots:
 	/**
 	 * @brief 槽函数：刷新连接状态
@@ -395,6 +472,19 @@ signals:
 	 */
 	void MC_SigRecv2DevCmdMsg(const QString& message);
 
+	/**
+	 * @brief 下发至设备的原始报文（由使用方自行格式化）
+	 * @param data 完整报文字节
+	 * @note 报文类信号只在有连接时才由SDK生成
+	 */
+	void MC_SigSend2DevRawMsg(const QByteArray& data);
+
+	/**
+	 * @brief 设备返回的原始报文（由使用方自行格式化）
+	 * @param data 接收到的字节
+	 */
+	void MC_SigRecv2DevRawMsg(const QByteArray& data);
+
 
 	// ==================== 打印相关信号 ====================
 
@@ -428,6 +518,13 @@ signals:
 	 */
 	void MC_SigPosChanged(double x, double y, double z);
 
+protected:
+	/**
+	 * @brief 报文类信号连接/断开时更新SDK事件订阅掩码
+	 */
+	void connectNotify(const QMetaMethod& signal) override;
+	void disconnectNotify(const QMetaMethod& signal) override;
+
 private:
 	// Pimpl模式：隐藏实现细节，保持ABI稳定性
 	class Private;
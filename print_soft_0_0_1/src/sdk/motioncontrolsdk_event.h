@@ -0,0 +1,60 @@
+﻿#pragma once
+
+// SDK事件回调定义，只使用C类型，供Qt接口(motionControlSDK.h)和C接口(PrintDeviceSDK_API.h)共用
+
+// --- 事件回调定义 ---
+/**
+ * @brief SDK事件类型枚举
+ */
+typedef enum 
+{
+	EVENT_TYPE_GENERAL,     // 普通信息事件 (如: "Connected", "Disconnected")
+	EVENT_TYPE_ERROR,       // 错误事件
+	EVENT_TYPE_PRINT_STATUS,// 打印状态更新 (如: 进度, 层数)
+	EVENT_TYPE_MOVE_STATUS, // 运动状态更新 (如: "Moving", "Idle")
+	EVENT_TYPE_LOG,          // 内部日志事件
+	EVENT_TYPE_SEND_MSG,    // 下发至设备的报文，原始字节见data/dataLen
+	EVENT_TYPE_RECV_MSG     // 设备返回的报文，原始字节见data/dataLen
+} SdkEventType;
+
+/**
+ * @brief 事件订阅掩码
+ * 未订阅的事件类型在SDK内部直接跳过，不构造事件内容。
+ * 报文事件(SEND_MSG/RECV_MSG)每帧触发一次，默认不订阅。
+ */
+#define SDK_EVENT_MASK(type)		(1u << (type))
+#define SDK_EVENT_MASK_ALL			0xFFFFFFFFu
+#define SDK_EVENT_MASK_TRAFFIC		(SDK_EVENT_MASK(EVENT_TYPE_SEND_MSG) | SDK_EVENT_MASK(EVENT_TYPE_RECV_MSG))
+#define SDK_EVENT_MASK_DEFAULT		(SDK_EVENT_MASK_ALL & ~SDK_EVENT_MASK_TRAFFIC)
+
+/**
+ * @brief SDK事件结构体
+ */
+typedef struct 
+{
+	SdkEventType type;      // 事件类型
+	int code;               // 状态/错误码
+	const char* message;    // 事件消息
+	double value1;          // 附加数据1 (例如: 打印进度, X坐标)
+	double value2;          // 附加数据2 (例如: 当前层, Y坐标)
+	double value3;          // 附加数据3 (例如: 总层数, Z坐标)
+	const unsigned char* data;	// 原始报文字节（仅SEND_MSG/RECV_MSG，其他事件为NULL），只在回调期间有效
+	int dataLen;            // 原始报文长度
+} SdkEvent;
+
+/**
+ * @brief 回调函数指针类型
+ */
+typedef void(*SdkEventCallback)(const SdkEvent* event);
+
+/**
+ * @brief 设备会话句柄（多设备时每台设备一个会话，NULL表示默认会话）
+ */
+typedef struct SdkSession* SdkSessionHandle;
+
+/**
+ * @brief 带会话句柄的回调函数指针类型
+ * @param session 产生事件的会话
+ * @param userData 注册回调时传入的用户数据
+ */
+typedef void(*SdkSessionEventCallback)(SdkSessionHandle session, const SdkEvent* event, void* userData);
@@ -0,0 +1,173 @@
+﻿#include "FrameDecoder.h"
+
+//包头 2字节
+#define Req_Package_Head 0xAABB
+#define Resp_Package_Head_Succ 0xAACC
+#define Resp_Package_Head_Err 0xAADD
+
+//帧头长度：包头 + 命令类型 + 命令字 + 长度
+#define FRAME_HEADER_SIZE 8
+//帧固定开销：帧头 + crc16
+#define FRAME_OVERHEAD 10
+//数据区最大长度，超过则认为是误判的包头
+#define FRAME_MAX_PAYLOAD 4096
+//环形缓冲区初始容量
+#define RING_INIT_SIZE (16*1024)
+
+
+FrameDecoder::FrameDecoder(int maxPayload /*= 0*/)
+	:m_maxPayload(maxPayload > 0 ? maxPayload : FRAME_MAX_PAYLOAD)
+{
+	m_ring.resize(RING_INIT_SIZE);
+	m_mask = RING_INIT_SIZE - 1;
+}
+
+void FrameDecoder::setFrameHandler(FrameHandler handler)
+{
+	m_handler = handler;
+}
+
+int FrameDecoder::feed(const char* data, int len)
+{
+	//新数据写入环形缓冲区（最多分两段拷贝）
+	if (len > 0)
+	{
+		reserve(len);
+		const quint64 capacity = m_mask + 1;
+		const int offset = static_cast<int>(m_writePos & m_mask);
+		const int first = static_cast<int>(qMin<quint64>(len, capacity - offset));
+		memcpy(m_ring.data() + offset, data, first);
+		if (len > first)
+		{
+			memcpy(m_ring.data(), data + first, len - first);
+		}
+		m_writePos += len;
+	}
+
+	int frames = 0;
+	while (true)
+	{
+		const quint64 avail = m_writePos - m_readPos;
+
+		if (m_state == State_Head)
+		{
+			if (avail < 2)
+			{
+				break;
+			}
+
+			ushort head = (at(m_readPos + 1) << 8) | at(m_readPos);
+			if (head == Req_Package_Head || head == Resp_Package_Head_Succ || head == Resp_Package_Head_Err)
+			{
+				m_frameHead = head;
+				m_state = State_Header;
+			}
+			else
+			{
+				//脏数据，逐字节丢弃直到对齐包头
+				consume(1);
+				m_discardedBytes++;
+			}
+		}
+		else if (m_state == State_Header)
+		{
+			if (avail < FRAME_HEADER_SIZE)
+			{
+				break;
+			}
+
+			// 长度字段 (小端字节序)
+			int payload = (at(m_readPos + 7) << 8) | at(m_readPos + 6);
+			if (payload > m_maxPayload)
+			{
+				//长度非法，当前包头为误判，跳过一个字节重新找包头
+				consume(1);
+				m_discardedBytes++;
+				m_state = State_Head;
+				continue;
+			}
+
+			m_frameLen = payload + FRAME_OVERHEAD;
+			m_state = State_Body;
+		}
+		else
+		{
+			if (avail < static_cast<quint64>(m_frameLen))
+			{
+				break;
+			}
+
+			//帧在缓冲区中连续时直接引用，跨越尾部时才线性化
+			const quint64 capacity = m_mask + 1;
+			const int offset = static_cast<int>(m_readPos & m_mask);
+			const uchar* frame = nullptr;
+			if (offset + m_frameLen <= static_cast<int>(capacity))
+			{
+				frame = reinterpret_cast<const uchar*>(m_ring.constData()) + offset;
+			}
+			else
+			{
+				const int first = static_cast<int>(capacity) - offset;
+				m_scratch.resize(m_frameLen);
+				memcpy(m_scratch.data(), m_ring.constData() + offset, first);
+				memcpy(m_scratch.data() + first, m_ring.constData(), m_frameLen - first);
+				frame = reinterpret_cast<const uchar*>(m_scratch.constData());
+			}
+
+			FrameView view = { frame, m_frameLen, m_frameHead };
+			//只移动读游标，帧数据在下一次feed之前不会被覆盖
+			consume(m_frameLen);
+			m_state = State_Head;
+			frames++;
+
+			if (m_handler)
+			{
+				m_handler(view);
+			}
+		}
+	}
+
+	return frames;
+}
+
+void FrameDecoder::reset()
+{
+	m_readPos = 0;
+	m_writePos = 0;
+	m_state = State_Head;
+	m_frameLen = 0;
+}
+
+void FrameDecoder::reserve(int extra)
+{
+	const quint64 used = m_writePos - m_readPos;
+	const quint64 capacity = m_mask + 1;
+	if (used + extra <= capacity)
+	{
+		return;
+	}
+
+	quint64 newCapacity = capacity;
+	while (newCapacity < used + extra)
+	{
+		newCapacity <<= 1;
+	}
+
+	//扩容时把未处理数据线性拷贝到新缓冲区头部
+	QByteArray ring;
+	ring.resize(static_cast<int>(newCapacity));
+	const int offset = static_cast<int>(m_readPos & m_mask);
+	const int first = static_cast<int>(qMin<quint64>(used, capacity - offset));
+	memcpy(ring.data(), m_ring.constData() + offset, first);
+	memcpy(ring.data() + first, m_ring.constData(), used - first);
+
+	m_ring = ring;
+	m_mask = newCapacity - 1;
+	m_readPos = 0;
+	m_writePos = used;
+}
+
+void FrameDecoder::consume(int len)
+{
+	m_readPos += len;
+}
@@ -0,0 +1,83 @@
+﻿#pragma once
+#include <QtCore/QtCore>
+#include <functional>
+
+/**  解码出的完整帧视图，指针只在回调期间有效  **/
+struct FrameView
+{
+	const uchar* data;		//帧起始地址（包头第一个字节）
+	int size;				//帧总长度 = 数据区长度 + 10
+	ushort head;			//包头类型 0xAABB/0xAACC/0xAADD
+};
+
+/**
+*  @author
+*  @class       FrameDecoder
+*  @brief       基于长度字段的流式帧解码器
+*
+*  帧格式：包头(2) + 命令类型(2) + 命令字(2) + 长度(2, 小端) + 数据区(长度) + crc16(2)
+*  接收数据写入环形缓冲区，按 找包头 -> 读帧头 -> 读帧体 的状态机推进，
+*  每个字节只检查一次；数据区内出现的包头字节不会影响分帧。
+*/
+class FrameDecoder
+{
+public:
+	typedef std::function<void(const FrameView&)> FrameHandler;
+
+	explicit FrameDecoder(int maxPayload = 0);
+
+	/**
+	*  @brief       设置完整帧回调
+	*  @param[in]
+	*  @param[out]
+	*  @return
+	*/
+	void setFrameHandler(FrameHandler handler);
+
+	/**
+	*  @brief       追加接收数据并分发其中所有完整帧
+	*  @param[in]    data: 接收数据  len: 长度
+	*  @param[out]
+	*  @return       本次解出的帧数
+	*/
+	int feed(const char* data, int len);
+
+	/**
+	*  @brief       清空缓冲区和解码状态（断线重连时调用）
+	*  @param[in]
+	*  @param[out]
+	*  @return
+	*/
+	void reset();
+
+	//因找不到包头或长度非法而丢弃的字节数
+	quint64 discardedBytes() const { return m_discardedBytes; }
+
+	//缓冲区中尚未组成完整帧的字节数
+	int bufferedBytes() const { return static_cast<int>(m_writePos - m_readPos); }
+
+private:
+	enum State
+	{
+		State_Head,			//寻找包头
+		State_Header,		//等待完整帧头（8字节）
+		State_Body			//等待完整帧体
+	};
+
+	uchar at(quint64 pos) const { return static_cast<uchar>(m_ring.constData()[pos & m_mask]); }
+	void reserve(int extra);
+	void consume(int len);
+
+private:
+	QByteArray m_ring;			//环形缓冲区，容量为2的幂
+	quint64 m_mask = 0;
+	quint64 m_readPos = 0;		//读游标（单调递增）
+	quint64 m_writePos = 0;		//写游标（单调递增）
+	QByteArray m_scratch;		//帧跨越环形缓冲区尾部时的线性化缓存
+	State m_state = State_Head;
+	ushort m_frameHead = 0;
+	int m_frameLen = 0;
+	int m_maxPayload;
+	quint64 m_discardedBytes = 0;
+	FrameHandler m_handler;
+};
@@ -0,0 +1,116 @@
+﻿#include "ImagePacketizer.h"
+#include "Crc16.h"
+#include "PrintSource.h"
+
+
+ImagePacketizer::ImagePacketizer(int poolFrames /*= IMG_PACKET_POOL_FRAMES*/)
+{
+	m_pool.resize(qMax(1, poolFrames));
+	for (QByteArray& buf : m_pool)
+	{
+		buf.resize(IMG_FRAME_SIZE);
+	}
+}
+
+void ImagePacketizer::begin(PrintSource* source, quint16 w, quint16 h, quint8 imgType)
+{
+	m_source = source;
+	m_width = w;
+	m_height = h;
+	m_imgType = imgType;
+	m_packetIndex = 0;
+	m_bytesConsumed = 0;
+	m_error = false;
+	m_atEnd = (source == nullptr) || source->atEnd();
+}
+
+bool ImagePacketizer::next(QByteArray& frame, quint32* seq /*= nullptr*/)
+{
+	if (m_atEnd)
+	{
+		return false;
+	}
+
+	QByteArray* buf = acquire();
+	if (!buf)
+	{
+		return false;
+	}
+
+	uchar* p = reinterpret_cast<uchar*>(buf->data());
+	ProtocolPrint::FillSendDatagramHead(p, ProtocolPrint::PrintCommCmd, ProtocolPrint::Print_PeriodData, IMG_PACKET_PAYLOAD_SIZE);
+
+	//数据直接读入帧内，不足1006字节时补0
+	uchar* data = p + 8 + IMG_PACKET_HEAD_SIZE;
+	qint64 readLen = m_source->read(reinterpret_cast<char*>(data), IMG_PACKET_DATA_SIZE);
+	if (readLen <= 0)
+	{
+		m_error = (readLen < 0);
+		m_atEnd = true;
+		return false;
+	}
+	if (readLen < IMG_PACKET_DATA_SIZE)
+	{
+		memset(data + readLen, 0, IMG_PACKET_DATA_SIZE - readLen);
+	}
+
+	uchar* head = p + 8;
+	qToLittleEndian<quint32>(static_cast<quint32>(m_packetIndex), head);
+	qToLittleEndian<quint16>(m_width, head + 4);
+	qToLittleEndian<quint16>(m_height, head + 6);
+	head[8] = m_imgType;
+	qToLittleEndian<quint16>(static_cast<quint16>(readLen), head + 9);
+
+	ushort crc = Crc16::compute(p, 8 + IMG_PACKET_PAYLOAD_SIZE);
+	ProtocolPrint::FillSendDatagramCrc(p, IMG_PACKET_PAYLOAD_SIZE, crc);
+
+	if (seq)
+	{
+		*seq = static_cast<quint32>(m_packetIndex);
+	}
+	m_packetIndex++;
+	m_bytesConsumed += readLen;
+	m_atEnd = m_source->atEnd();
+
+	frame = *buf;
+	return true;
+}
+
+void ImagePacketizer::reset()
+{
+	m_source = nullptr;
+	m_atEnd = true;
+}
+
+int ImagePacketizer::freeFrames() const
+{
+	int count = 0;
+	for (const QByteArray& buf : m_pool)
+	{
+		if (buf.isDetached())
+		{
+			count++;
+		}
+	}
+	return count;
+}
+
+int ImagePacketizer::packetCount(qint64 totalBytes)
+{
+	return static_cast<int>((totalBytes + IMG_PACKET_DATA_SIZE - 1) / IMG_PACKET_DATA_SIZE);
+}
+
+QByteArray* ImagePacketizer::acquire()
+{
+	//按顺序轮询，发送队列先进先出，最早发出的帧最先被释放
+	for (int i = 0; i < m_pool.size(); i++)
+	{
+		QByteArray& buf = m_pool[m_poolCursor];
+		m_poolCursor = (m_poolCursor + 1) % m_pool.size();
+		if (buf.isDetached())
+		{
+			return &buf;
+		}
+	}
+	return nullptr;
+}
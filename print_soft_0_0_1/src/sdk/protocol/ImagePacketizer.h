@@ -0,0 +1,79 @@
+﻿#pragma once
+#include <QtCore/QtCore>
+#include "ProtocolPrint.h"
+
+//图像报文：序号(4) + 宽(2) + 高(2) + 类型(1) + 有效长度(2) + 数据(1006)，多字节字段均为小端
+//序号从0开始逐帧递增，下位机以此确认/否认单帧，用于选择性重发
+#define IMG_PACKET_HEAD_SIZE 11
+#define IMG_PACKET_DATA_SIZE 1006
+#define IMG_PACKET_PAYLOAD_SIZE (IMG_PACKET_HEAD_SIZE + IMG_PACKET_DATA_SIZE)
+//完整帧长度 = 帧头(8) + 图像报文 + crc(2)
+#define IMG_FRAME_SIZE (IMG_PACKET_PAYLOAD_SIZE + 10)
+//默认缓冲池帧数，决定在途图像数据的内存上限
+#define IMG_PACKET_POOL_FRAMES 256
+
+class PrintSource;
+
+/**
+*  @author
+*  @class       ImagePacketizer
+*  @brief       流式图像分包器
+*
+*  从数据源游标按需读取1006字节（映射文件时直接从映射内存拷入），组成完整帧写入复用的缓冲池，不一次性生成全部分包。
+*  缓冲池中的帧被发送队列引用期间不会被复用，全部被占用时next()返回false，
+*  待发送队列取走数据（引用释放）后再继续，因此内存占用只与缓冲池大小有关，与任务大小无关。
+*/
+class ImagePacketizer
+{
+public:
+	explicit ImagePacketizer(int poolFrames = IMG_PACKET_POOL_FRAMES);
+
+	/**
+	*  @brief       开始一次分包任务
+	*  @param[in]    source: 数据源（分包期间由调用方保持有效）  w/h: 图像宽高  imgType: 图像类型
+	*  @param[out]
+	*  @return
+	*/
+	void begin(PrintSource* source, quint16 w, quint16 h, quint8 imgType);
+
+	/**
+	*  @brief       生成下一帧
+	*  @param[in]
+	*  @param[out]   frame: 指向缓冲池中的帧（共享引用，不拷贝）  seq: 帧序号
+	*  @return       false=已结束或缓冲池暂无空闲帧
+	*/
+	bool next(QByteArray& frame, quint32* seq = nullptr);
+
+	//数据源已读完
+	bool atEnd() const { return m_atEnd; }
+
+	//读取数据源出错
+	bool hasError() const { return m_error; }
+
+	//结束任务，释放数据源引用（缓冲池保留复用）
+	void reset();
+
+	int packetIndex() const { return m_packetIndex; }
+	qint64 bytesConsumed() const { return m_bytesConsumed; }
+
+	//缓冲池中当前空闲的帧数
+	int freeFrames() const;
+
+	//给定数据量所需的分包数
+	static int packetCount(qint64 totalBytes);
+
+private:
+	QByteArray* acquire();
+
+private:
+	QVector<QByteArray> m_pool;
+	int m_poolCursor = 0;
+	PrintSource* m_source = nullptr;
+	quint16 m_width = 0;
+	quint16 m_height = 0;
+	quint8 m_imgType = 0;
+	int m_packetIndex = 0;
+	qint64 m_bytesConsumed = 0;
+	bool m_atEnd = true;
+	bool m_error = false;
+};
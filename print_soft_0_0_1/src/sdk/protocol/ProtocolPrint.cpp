@@ -5,6 +5,8 @@
 #include <QDataStream>
 #include <QtEndian>
 #include "utils.h"
+#include "Crc16.h"
+#include "TraceRecorder.h"
 #include <spdlog/spdlog.h>
 
 
@@ -30,11 +32,30 @@
 #define DATAGRAM_MIN_SIZE 10
 
 
-ProtocolPrint::ProtocolPrint(QObject* parent /*= 0*/)
+ProtocolPrint::ProtocolPrint(QObject* parent /*= 0*/, MetricsRegistry* metrics /*= MetricsRegistry::global()*/)
 	:QObject(parent)
 {
 	qRegisterMetaType<DataFieldInfo1>("DataFieldInfo1");
-
+	qRegisterMetaType<ProtocolResultBatch>("ProtocolResultBatch");
+
+	m_rxFrames = &metrics->keyed("frames.rx");
+	m_rxBytes = &metrics->counter("protocol.rx_bytes");
+	m_crcErrors = &metrics->counter("protocol.crc_errors");
+	m_respCrcErrors = &metrics->counter("protocol.resp_crc_errors");
+	m_lengthErrors = &metrics->counter("protocol.length_errors");
+	m_discardedBytes = &metrics->counter("protocol.discarded_bytes");
+	m_rejected = &metrics->counter("protocol.rejected");
+	m_naks = &metrics->counter("protocol.naks");
+
+	//解码出的帧直接以视图形式分发，不拷贝
+	m_decoder.setFrameHandler([this](const FrameView& frame) {
+		int cmdType = (frame.data[3] << 8) | frame.data[2];
+		int funCode = (frame.data[5] << 8) | frame.data[4];
+		m_rxFrames->addFrame(cmdType, funCode, frame.size);
+		TRACE_INSTANT("frame_decoded", "cmd_type", cmdType, "fun_code", funCode);
+		QByteArray datagram = QByteArray::fromRawData(reinterpret_cast<const char*>(frame.data), frame.size);
+		ParsePackageData(datagram, static_cast<PackageHeadType>(frame.head));
+	});
 }
 
 
@@ -43,8 +64,7 @@ void ProtocolPrint::HandleRecvDatagramData(QByteArray recvdata)
 {
 	//判断当前recv是req还是resp
 	//分逻辑处理3个不同类型的报文数据
-	QString str = recvdata.toHex(' ');
-	LOG_INFO(QString(u8"接收数据: %1").arg(str));
+	LOG_DEBUG(QString(u8"接收数据: %1").arg(QString(recvdata.toHex(' '))));
 
 	//新数据加入缓冲区
 	m_recvBuf.append(recvdata);
@@ -78,112 +98,50 @@ void ProtocolPrint::HandleRecvDatagramData(QByteArray recvdata)
 	{
 		ParsePackageData(datagram);
 	}
+	FlushResults();
+}
+
+void ProtocolPrint::resetDecoder()
+{
+	m_decoder.reset();
 }
 
 void ProtocolPrint::HandleRecvDatagramData1(QByteArray recvdata)
 {
 	//判断当前recv是req还是resp
 	//分逻辑处理3个不同类型的报文数据
-	QString str = recvdata.toHex(' ');
-	LOG_INFO(QString(u8"motion_moudle_sdk print_protocol_moudle cur_recv_data: %1").arg(str));
+	LOG_DEBUG(QString(u8"motion_moudle_sdk print_protocol_moudle cur_recv_data: %1").arg(QString(recvdata.toHex(' '))));
 	//std::shared_ptr<spdlog::logger> mylogger = spdlog::get("spdlog");
 	//mylogger->info(QString(u8"motion_moudle_sdk print_protocol_moudle cur_recv_data: %1").arg(str));
 
-	//新数据加入缓冲区
-	m_recvBuf.append(recvdata);
-
-	if (m_recvBuf.size() < DATAGRAM_MIN_SIZE)
+	//按长度字段流式分帧，完整帧通过m_decoder的回调进入ParsePackageData
+	TRACE_SCOPE("decode", "bytes", recvdata.size());
+	m_rxBytes->add(static_cast<quint64>(recvdata.size()));
+	m_decoder.feed(recvdata.constData(), recvdata.size());
+	if (m_decoder.discardedBytes() != m_lastDiscarded)
 	{
-		return;
+		m_discardedBytes->add(m_decoder.discardedBytes() - m_lastDiscarded);
+		m_lastDiscarded = m_decoder.discardedBytes();
 	}
+	FlushResults();
+}
 
-	// 存储所有包头的起始索引（包头占2字节，索引为第一个字节位置）
-	// --------第一步：遍历缓冲区，收集所有合法包头的位置和类型
-	struct HeadInfo
-	{
-		int pos;                // 包头起始位置（第一个字节的索引）
-		PackageHeadType type;   // 包头类型
-	};
-	QList<HeadInfo> headList;   // 存储所有合法包头的信息
-
-	// 遍历范围：0 ~ size-2（避免pos+1越界）
-	for (int i = 0; i < m_recvBuf.size() - 1; i++)
-	{
-		PackageHeadType headType = static_cast<PackageHeadType>(HandleCheckPackageHead(m_recvBuf, i));
-		if (headType != 0)
-		{ // 匹配到合法包头
-			headList.append({ i, headType });
-			// 跳过下一个字节（包头占2字节，避免重复匹配，比如AABB的第二个字节不会被误判）
-			i++;
-		}
-	}
+void ProtocolPrint::AddResult(const ProtocolResult& result)
+{
+	m_results.append(result);
+}
 
-	// 未找到任何合法包头，返回（可选清空脏数据）
-	if (headList.isEmpty())
+void ProtocolPrint::FlushResults()
+{
+	if (m_results.isEmpty())
 	{
-		// m_recvBuf.clear(); // 按需启用：清空无合法包头的无效数据
 		return;
 	}
 
-	// --------第二步：清理第一个包头前的脏数据
-	int firstHeadPos = headList.first().pos;
-	if (firstHeadPos > 0)
-	{
-		m_recvBuf.remove(0, firstHeadPos); // 移除前置脏数据
-		// 修正所有包头的位置（缓冲区已裁剪）
-		for (auto& head : headList)
-		{
-			head.pos -= firstHeadPos;
-		}
-	}
-	int bufSize = m_recvBuf.size(); // 更新缓冲区长度
-
-	  // --------第三步：分割完整数据包
-	QList<QPair<QByteArray, PackageHeadType>> packageList; // 数据包 + 对应包头类型
-	for (int i = 0; i < headList.size(); i++)
-	{
-		const HeadInfo& currHead = headList.at(i);
-		// 下一个包头的位置（最后一个包头则取缓冲区末尾）
-		int nextHeadPos = (i + 1 < headList.size()) ? headList.at(i + 1).pos : bufSize;
-		int packageLen = nextHeadPos - currHead.pos;
-
-		// 检查包长度是否满足最小要求，不足则保留在缓冲区
-		if (packageLen >= 10) 
-		{
-			QByteArray packageData = m_recvBuf.mid(currHead.pos, packageLen);
-			packageList.append({ packageData, currHead.type });
-		}
-		else 
-		{
-			break; // 最后一个包不完整，停止遍历
-		}
-	}
-
-	// --------第四步：更新缓冲区，保留未处理的剩余数据
-	int lastProcessedPos = 0;
-	if (!packageList.isEmpty()) 
-	{
-		// 最后一个完整包的结束位置
-		const HeadInfo& lastHead = headList.at(packageList.size() - 1);
-		int lastPackageLen = packageList.last().first.size();
-		lastProcessedPos = lastHead.pos + lastPackageLen;
-	}
-	// 保留未处理的数据（最后一个不完整包头及后续）
-	m_recvBuf = (lastProcessedPos < bufSize) ? m_recvBuf.mid(lastProcessedPos) : QByteArray();
-
-
-	// --------第五步：解析所有完整数据包（可传递包头类型）
-	for (auto& packageItem : packageList)
-	{
-		QByteArray& datagram = packageItem.first;
-		PackageHeadType headType = packageItem.second;
-
-		// 可根据包头类型做不同处理，示例：
-		LOG_INFO(QString(u8"解析包头类型: 0x%1 数据包长度: %2")
-			.arg(QString::number(headType, 16).toUpper())
-			.arg(datagram.size()));
-		ParsePackageData(datagram, headType); // 如果需要，可修改Parse函数接收headType参数：Parse(datagram, headType)
-	}
+	//交出整批结果，下次接收重新分配
+	ProtocolResultBatch batch;
+	batch.swap(m_results);
+	emit SigResultBatch(batch);
 }
 
 int ProtocolPrint::HandleCheckPackageHead(const QByteArray& data, int pos)
@@ -242,12 +200,8 @@ void ProtocolPrint::ParseReqPackageData(QByteArray& datagram, PackageHeadType ty
 		return;
 	}
 
-	//数据转变成uchar类型的缓存
-	const int size = 512;
-	uchar recvBuf[size];
-	memset(recvBuf, 0, size);
-	int templen = datagram.size() > size ? size : datagram.size();
-	memcpy(&recvBuf[0], datagram, templen);
+	//直接引用帧数据，不拷贝
+	const uchar* recvBuf = reinterpret_cast<const uchar*>(datagram.constData());
 
 	//比较包头
 	if (!(recvBuf[0] == LO_OF_SHORT(Req_Package_Head) && (recvBuf[1] == HI_OF_SHORT(Req_Package_Head))))
@@ -257,10 +211,12 @@ void ProtocolPrint::ParseReqPackageData(QByteArray& datagram, PackageHeadType ty
 	}
 
 	//判断crc校验
-	if (!Utils::GetInstance().CheckCRC(recvBuf, recvLength - 10))
+	if (!Utils::GetInstance().CheckCRC(recvBuf, recvLength))
 	{
 		LOG_INFO(QString(u8"motion_moudle_sdk print_protocol_moudle cur_recv_req_package_crc校验错误"));
-		LOG_INFO(QString(u8"crc校验错误次数统计：%1").arg(++m_crcErrorNum));
+		++m_crcErrorNum;
+		m_crcErrors->add();
+		LOGB_INFO(u8"crc校验错误次数统计：%1", m_crcErrorNum);
 #ifdef TurnOnCRC
 		return;
 #endif 
@@ -280,6 +236,7 @@ void ProtocolPrint::ParseReqPackageData(QByteArray& datagram, PackageHeadType ty
 	lenByte = (recvBuf[7] << 8) | recvBuf[6];
 	if (lenByte != recvLength - 10)
 	{
+		m_lengthErrors->add();
 		//LOG_INFO(QString(u8"motion_moudle_sdk print_protocol_moudle cur_recv_req_package_数据区长度字段错误"));
 		return;
 	}
@@ -317,6 +274,19 @@ void ProtocolPrint::ParseReqPackageData(QByteArray& datagram, PackageHeadType ty
 // type设置默认数据类型
 void ProtocolPrint::ParseRespPackageData(QByteArray& datagram, PackageHeadType type)
 {
+	//判断应答crc校验：与请求包一致，默认只统计；定义TurnOnCRC时丢弃，由请求超时或图像重传窗口处理
+	if (datagram.length() >= DATAGRAM_MIN_SIZE &&
+		!Utils::GetInstance().CheckCRC(reinterpret_cast<const uchar*>(datagram.constData()), datagram.length()))
+	{
+		++m_crcErrorNum;
+		m_crcErrors->add();
+		m_respCrcErrors->add();
+		LOGB_INFO(u8"应答crc校验错误，次数统计：%1", m_crcErrorNum);
+#ifdef TurnOnCRC
+		return;
+#endif 
+	}
+
 	if (type == Head_AACC)
 	{
 		// 读取命令数据类型，获取数据信息
@@ -326,13 +296,10 @@ void ProtocolPrint::ParseRespPackageData(QByteArray& datagram, PackageHeadType t
 
 		int recvLength = datagram.length();
 		PackParam packData;
+		memset(&packData, 0, sizeof(packData));
 
-		//数据转变成uchar类型的缓存
-		const int size = 512;
-		uchar recvBuf[size];
-		memset(recvBuf, 0, size);
-		int templen = datagram.size() > size ? size : datagram.size();
-		memcpy(&recvBuf[0], datagram, templen);
+		//直接引用帧数据，不拷贝
+		const uchar* recvBuf = reinterpret_cast<const uchar*>(datagram.constData());
 
 		//-------------正确的包，开始解析-------------------//
 		// 包头 (小端字节序)
@@ -354,40 +321,98 @@ void ProtocolPrint::ParseRespPackageData(QByteArray& datagram, PackageHeadType t
 		packData.dataLen = dataLen;
 		if (dataLen != datagram.length() - 10)
 		{
+			m_lengthErrors->add();
 			LOG_INFO(QString(u8"motion_moudle_sdk cur_recv_resp_package_数据区长度有误，数据长度与真实长度不同"));
 			return;
 		}
+
+		//打印数据确认：数据区为已连续收到的最大帧序号
+		if (operType == PrintCommCmd && code == Print_PeriodData)
+		{
+			if (dataLen >= 4)
+			{
+				ProtocolResult ack;
+				ack.kind = ProtocolResult::Res_PrintDataAck;
+				ack.seq = qFromLittleEndian<quint32>(&recvBuf[8]);
+				ack.ok = true;
+				AddResult(ack);
+			}
+			return;
+		}
+
+		ProtocolResult result;
+		result.kind = ProtocolResult::Res_CmdResult;
+		result.cmdType = operType;
+		result.funCode = code;
+		result.ok = true;
+		result.data = QByteArray(reinterpret_cast<const char*>(&recvBuf[8]), dataLen);
+		AddResult(result);
+
 		if(dataLen == 0)
 		{
-			LOG_INFO(QString(u8"motion_moudle_sdk cur_recv_resp_package_数据区长度为0，数据命令:%1").arg(QString::number(code, 16)));
+			LOG_DEBUG(QString(u8"motion_moudle_sdk cur_recv_resp_package_数据区长度为0，数据命令:%1").arg(QString::number(code, 16)));
 			return;
 		}
 
 		// 拼成一个结构体，进行后续逻辑处理
 
 		int copyLen = (dataLen < DATA_LEN_12) ? dataLen : DATA_LEN_12;
-		memcpy(&packData.data, &recvBuf[8], dataLen);
+		memcpy(&packData.data, &recvBuf[8], copyLen);
 
 		MoveAxisPos posData;
 		// 数据区使用小端字节序解析
 		posData.xPos = (packData.data[3] << 24) | (packData.data[2] << 16) | (packData.data[1] << 8) | packData.data[0];
 		posData.yPos = (packData.data[7] << 24) | (packData.data[6] << 16) | (packData.data[5] << 8) | packData.data[4];
 		posData.zPos = (packData.data[11] << 24) | (packData.data[10] << 16) | (packData.data[9] << 8) | packData.data[8];
-		LOG_INFO(QString(u8"motion_moudle_sdk cur_recv_resp_package_各轴数据 _X轴数据：%1, _Y轴数据：%2, _Z轴数据：%3")
-			.arg(posData.xPos)
-			.arg(posData.yPos)
-			.arg(posData.zPos));
+		LOGB_DEBUG(u8"motion_moudle_sdk cur_recv_resp_package_各轴数据 _X轴数据：%1, _Y轴数据：%2, _Z轴数据：%3",
+			posData.xPos, posData.yPos, posData.zPos);
 
 		// req处理逻辑
 		emit SigHandleFunOper(operType, code);
-		emit SigHandleFunOper1(packData);
-		emit SigHandleFunOper2(code, posData);
+
+		ProtocolResult axis;
+		axis.kind = ProtocolResult::Res_AxisData;
+		axis.cmdType = operType;
+		axis.funCode = code;
+		axis.packParam = packData;
+		axis.axisPos = posData;
+		AddResult(axis);
 
 	}
 	else if (type == Head_AADD)
 	{
+		//打印数据否认：数据区为出错的帧序号，只重发该帧
+		const uchar* recvBuf = reinterpret_cast<const uchar*>(datagram.constData());
+		ushort operType = (recvBuf[3] << 8) | recvBuf[2];
+		ushort code = (recvBuf[5] << 8) | recvBuf[4];
+		ushort dataLen = (recvBuf[7] << 8) | recvBuf[6];
+		if (operType == PrintCommCmd && code == Print_PeriodData && dataLen >= 4 && datagram.size() >= DATAGRAM_MIN_SIZE + 4)
+		{
+			ProtocolResult nak;
+			nak.kind = ProtocolResult::Res_PrintDataAck;
+			nak.seq = qFromLittleEndian<quint32>(&recvBuf[8]);
+			nak.ok = false;
+			AddResult(nak);
+			m_naks->add();
+			return;
+		}
+
 		//emit SigPackFailRetransport(datagram, type);
-		emit SigPackFailRetransport(datagram);
+		m_rejected->add();
+		int failedLen = qMin<int>(dataLen, datagram.size() - DATAGRAM_MIN_SIZE);
+		ProtocolResult result;
+		result.kind = ProtocolResult::Res_CmdResult;
+		result.cmdType = operType;
+		result.funCode = code;
+		result.ok = false;
+		result.data = QByteArray(reinterpret_cast<const char*>(&recvBuf[8]), qMax(0, failedLen));
+		AddResult(result);
+
+		//datagram是解码缓冲区的视图，发出前转为独立数据
+		ProtocolResult failed;
+		failed.kind = ProtocolResult::Res_CmdFailed;
+		failed.data = QByteArray(datagram.constData(), datagram.size());
+		AddResult(failed);
 	}
 
 }
@@ -400,11 +425,28 @@ void ProtocolPrint::ParseRespPackageData(QByteArray& datagram, PackageHeadType t
 
 QByteArray ProtocolPrint::GetSendDatagram(ECmdType cmdType, FunCode cmd, QByteArray data)
 {
-	const int size = 1024;
-	uchar sendBuf[size];
-	memset(sendBuf, 0, size);
+	//包头+命令类型+命令+数据区长度+CRC，直接在输出缓冲区中组包
+	ushort length = data.size();
+	QByteArray senddata;
+	senddata.resize(length + DATAGRAM_MIN_SIZE);
+	uchar* sendBuf = reinterpret_cast<uchar*>(senddata.data());
+
+	FillSendDatagramHead(sendBuf, cmdType, cmd, length);
+
+	//校验：先累加帧头，再在拷贝数据区的同时累加数据区
+	ushort crc = Crc16::update(Crc16::InitValue, sendBuf, 8);
+	if (length > 0)
+	{
+		memcpy(&sendBuf[8], data.constData(), length);
+		crc = Crc16::update(crc, &sendBuf[8], length);
+	}
+	FillSendDatagramCrc(sendBuf, length, crc);
+
+	return senddata;
+}
 
-	//包头+命令类型+命令+数据区长度+CRC
+void ProtocolPrint::FillSendDatagramHead(uchar* sendBuf, ECmdType cmdType, FunCode cmd, ushort length)
+{
 	//包头
 	sendBuf[0] = LO_OF_SHORT(Req_Package_Head);
 	sendBuf[1] = HI_OF_SHORT(Req_Package_Head);
@@ -419,38 +461,22 @@ QByteArray ProtocolPrint::GetSendDatagram(ECmdType cmdType, FunCode cmd, QByteAr
 
 	//长度字
 	// 数据区长度
-	ushort length = data.size();
 	sendBuf[6] = LO_OF_SHORT(length);
 	sendBuf[7] = HI_OF_SHORT(length);
-	
-	//数据内容
-	if (data.size() > 0)
-	{
-		memcpy(&sendBuf[8], data.data(), data.size());
-	}
-
-	//校验
-	ushort crc = Utils::GetInstance().MakeCRCCheck(sendBuf, length + 8);
-	sendBuf[length + 8] = HI_OF_SHORT(crc);
-	sendBuf[length + 9] = LO_OF_SHORT(crc);
-
-	QByteArray senddata;
-	senddata.resize(length + 8 + 2);
-	memcpy(senddata.data(), sendBuf, length + 8 + 2);
-	return senddata;
 }
 
-QList<QByteArray> ProtocolPrint::GetSendImgDatagram(quint16 w, quint16 h, quint8 Imgtype, const QByteArray &hexData)
+void ProtocolPrint::FillSendDatagramCrc(uchar* sendBuf, ushort length, ushort crc)
 {
-	QList<QByteArray> packets;
-	return packets;
+	sendBuf[length + 8] = HI_OF_SHORT(crc);
+	sendBuf[length + 9] = LO_OF_SHORT(crc);
 }
 
 QByteArray ProtocolPrint::GetRespDatagram(FunCode code, QByteArray data /*= QByteArray()*/)
 {
-	const int size = 100;
-	uchar sendBuf[size];
-	memset(sendBuf, 0, size);
+	ushort length = data.size();
+	QByteArray senddata;
+	senddata.resize(length + DATAGRAM_MIN_SIZE);
+	uchar* sendBuf = reinterpret_cast<uchar*>(senddata.data());
 
 	//包头
 	sendBuf[0] = LO_OF_SHORT(Resp_Package_Head_Succ);
@@ -466,47 +492,42 @@ QByteArray ProtocolPrint::GetRespDatagram(FunCode code, QByteArray data /*= QByt
 	sendBuf[5] = HI_OF_SHORT(code);
 
 	//长度字 数据区长度
-	ushort length = data.size();
 	sendBuf[6] = LO_OF_SHORT(length);
 	sendBuf[7] = HI_OF_SHORT(length);
 
-	//数据内容
-	if (data.size() > 0)
+	//数据内容，拷贝时累加crc
+	ushort crc = Crc16::update(Crc16::InitValue, sendBuf, 8);
+	if (length > 0)
 	{
-		memcpy(&sendBuf[8], data.data(), 102);
+		memcpy(&sendBuf[8], data.constData(), length);
+		crc = Crc16::update(crc, &sendBuf[8], length);
 	}
 
-	//CRC
-	ushort crc = Utils::GetInstance().MakeCRCCheck(sendBuf, length+8);
-	sendBuf[length] = LO_OF_SHORT(crc);
-	sendBuf[length + 1] = HI_OF_SHORT(crc);
-
-	//包头
-	//sendBuf[length + 2] = HI_OF_SHORT(Package_Tail);
-	//sendBuf[length + 3] = LO_OF_SHORT(Package_Tail);
+	//CRC 与请求包一致，先高字节再低字节（接收端CheckCRC按此顺序校验）
+	sendBuf[length + 8] = HI_OF_SHORT(crc);
+	sendBuf[length + 9] = LO_OF_SHORT(crc);
 
-	QByteArray senddata;
-	senddata.resize(length + 2);
-	memcpy(senddata.data(), sendBuf, length + 8 + 2);
 	return senddata;
 }
 
 
 
 
-void ProtocolPrint::HandlePeriodData(uchar* data, ushort length)
+void ProtocolPrint::HandlePeriodData(const uchar* data, ushort length)
 {
 	return;
 }
 
 
 
-void ProtocolPrint::HandleResponseData(ushort code, uchar* data, ushort length, QByteArray arr)
+void ProtocolPrint::HandleResponseData(ushort code, const uchar* data, ushort length, QByteArray arr)
 {
 	//如果是心跳包
 	if (code == ProtocolPrint::Get_Breath)
 	{
-		emit SigHeartBeat();
+		ProtocolResult heartBeat;
+		heartBeat.kind = ProtocolResult::Res_HeartBeat;
+		AddResult(heartBeat);
 		//return;
 	}
 	//Note: 回复包处理逻辑缓存
@@ -551,7 +572,12 @@ void ProtocolPrint::HandleResponseData(ushort code, uchar* data, ushort length,
 	//	//break;
 	//	//}
 	//}
-	emit SigCmdReply(code, 0, arr);
+	//arr可能是解码缓冲区的视图，发出前转为独立数据
+	ProtocolResult reply;
+	reply.kind = ProtocolResult::Res_CmdReply;
+	reply.funCode = code;
+	reply.data = QByteArray(arr.constData(), arr.size());
+	AddResult(reply);
 }
 
 static QString getErrString(uchar code)
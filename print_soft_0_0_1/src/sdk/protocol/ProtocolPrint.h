@@ -1,6 +1,8 @@
 ﻿#pragma once
 #include <QtCore/QtCore>
 #include "communicate/TcpClient.h"
+#include "FrameDecoder.h"
+#include "MetricsRegistry.h"
 
 
 // 导入事件类型定义
@@ -11,6 +13,32 @@
 class DataFieldInfo1;
 //class DataFieldInfo1;
 
+/**  协议线程解码出的结果，按接收批次一次性投递到应用线程  **/
+struct ProtocolResult
+{
+	enum Kind
+	{
+		Res_HeartBeat = 0,		//心跳应答
+		Res_CmdReply,			//0xAABB回复包：funCode, data=完整报文
+		Res_CmdResult,			//命令应答（0xAACC成功/0xAADD失败）：cmdType, funCode, ok, data=数据区
+		Res_PrintDataAck,		//打印数据帧确认(ok=true，seq及之前的帧已全部收到)/否认(ok=false，seq帧需重发)
+		Res_CmdFailed,			//0xAADD失败回复：data=完整报文
+		Res_AxisData			//0xAACC携带坐标的应答：funCode, packParam, axisPos
+	};
+
+	Kind kind = Res_HeartBeat;
+	int cmdType = 0;
+	int funCode = 0;
+	bool ok = false;
+	quint32 seq = 0;
+	QByteArray data;			//独立数据，不引用解码缓冲区
+	PackParam packParam = {};
+	MoveAxisPos axisPos;
+};
+
+typedef QVector<ProtocolResult> ProtocolResultBatch;
+Q_DECLARE_METATYPE(ProtocolResultBatch)
+
 ////Coordinates
 //struct MoveAxisPos
 //{
@@ -44,7 +72,8 @@ class ProtocolPrint : public QObject
 {
 	Q_OBJECT
 public:
-	ProtocolPrint(QObject* parent = 0);
+	//metrics: 解码统计写入的注册表（每个设备会话一个）
+	ProtocolPrint(QObject* parent = 0, MetricsRegistry* metrics = MetricsRegistry::global());
 
 
 	/**  命令组功能码  **/
@@ -109,7 +138,7 @@ public:
 		// 打印通讯
 		// Y轴移动pass举例，Z轴移动的层数数据
 		Print_AxisMovePos = 0xF000,
-		Print_PeriodData = 0xF0001,
+		Print_PeriodData = 0xF001,		//图像数据分包
 		Print_End = 0xFFFF
 
 
@@ -189,8 +218,27 @@ public:
 		*  @return
 		*/
 		void HandleRecvDatagramData(QByteArray datagram);
+
+		/**
+		*  @brief       处理接收报文（流式解码，按长度字段分帧）
+		*  @param[in]    datagram: socket读到的任意长度数据片段
+		*  @param[out]
+		*  @return
+		*
+		*  在socket线程中调用；本次数据解码出的全部结果在返回前通过SigResultBatch一次发出
+		*/
 		void HandleRecvDatagramData1(QByteArray datagram);
 
+		/**
+		*  @brief       丢弃上一连接残留的半帧，重新从包头开始解码
+		*  @param[in]
+		*  @param[out]
+		*  @return
+		*
+		*  在socket线程中、新连接的数据到来之前调用
+		*/
+		void resetDecoder();
+
 		/**
 		*  @brief       解析报文数据
 		*  @param[in]   datagram:报文数据
@@ -227,13 +275,20 @@ public slots:
 
 
 	/**
-	*  @brief       根据图形数据组成图形数据包
-	*  @param[in]
-	*  @param[out]
+	*  @brief       填写请求包帧头（包头+命令类型+命令字+数据区长度，共8字节）
+	*  @param[in]    length: 数据区长度
+	*  @param[out]   sendBuf: 帧起始地址
 	*  @return
 	*/
-	//static QByteArray GetSendImgDatagram(FunCode code, QByteArray data = QByteArray());
-	static QList<QByteArray> GetSendImgDatagram(quint16 w, quint16 h, quint8 Imgtype, const QByteArray &hexData);
+	static void FillSendDatagramHead(uchar* sendBuf, ECmdType cmdType, FunCode cmd, ushort length);
+
+	/**
+	*  @brief       在数据区之后写入crc（先高字节再低字节）
+	*  @param[in]    length: 数据区长度  crc: 帧头+数据区的校验值
+	*  @param[out]   sendBuf: 帧起始地址
+	*  @return
+	*/
+	static void FillSendDatagramCrc(uchar* sendBuf, ushort length, ushort crc);
 
 
 
@@ -257,10 +312,8 @@ public slots:
 
 signals:
 	//--------------------------解析完数据发送相关信号-----------------------------//
-	//心跳信号
-	void SigHeartBeat();
-
-	void SigCmdReply(int cmd, uchar errCode, QByteArray arr = QByteArray());
+	// 一次接收数据中解码出的全部结果（在接收线程发出，跨线程连接时整批排队一次）
+	void SigResultBatch(const ProtocolResultBatch& results);
 
 	//数据集信号
 	void sigDataInfo(DataFieldInfo1);
@@ -268,13 +321,8 @@ signals:
 	//设备运动参数 SpeedRotatePara
 	void sigSpeedRotatePara();
 
-	// 接收报文数据显示错误，进入重发模式
-	void SigPackFailRetransport(QByteArray& arr);
-
 	//
 	void SigHandleFunOper(int codeType, int command);
-	void SigHandleFunOper1(const PackParam& data);
-	void SigHandleFunOper2(int cmdType, const MoveAxisPos& data);
 
 	void SigResData();
 
@@ -282,6 +330,12 @@ private:
 
 	int HandleCheckPackageHead(const QByteArray& data, int pos);
 
+	//追加一条解码结果
+	void AddResult(const ProtocolResult& result);
+
+	//把本次接收解码出的结果整批发出
+	void FlushResults();
+
 
 	/** 
 	*  @brief       处理下位机周期发送过来的数据 
@@ -289,7 +343,7 @@ private:
 	*  @param[out]   
 	*  @return                    
 	*/
-	void HandlePeriodData(uchar* data, ushort length);
+	void HandlePeriodData(const uchar* data, ushort length);
 
 	/** 
 	*  @brief       处理下位机回复包
@@ -297,17 +351,32 @@ private:
 	*  @param[out]   
 	*  @return                    
 	*/ 
-	void HandleResponseData(ushort code, uchar* data, ushort length, QByteArray arr = QByteArray());
+	void HandleResponseData(ushort code, const uchar* data, ushort length, QByteArray arr = QByteArray());
 
 
 private:
 
-	//接受数据待处理缓存
+	//接受数据待处理缓存（HandleRecvDatagramData使用）
 	QByteArray m_recvBuf;
+	//流式帧解码器（HandleRecvDatagramData1使用）
+	FrameDecoder m_decoder;
+	//本次接收尚未发出的解码结果
+	ProtocolResultBatch m_results;
 	//crc校验错误次数
 	int m_crcErrorNum = 0;
 	//下位机返回错误码次数
 	int m_codeErrorNum = 0;
+
+	//指标（注册表中的对象，地址不变）
+	KeyedMetrics* m_rxFrames;			//frames.rx 按命令类型+命令字统计的接收帧
+	MetricCounter* m_rxBytes;			//protocol.rx_bytes
+	MetricCounter* m_crcErrors;			//protocol.crc_errors
+	MetricCounter* m_respCrcErrors;		//protocol.resp_crc_errors 应答帧校验失败（定义TurnOnCRC时丢弃）
+	MetricCounter* m_lengthErrors;		//protocol.length_errors
+	MetricCounter* m_discardedBytes;	//protocol.discarded_bytes 分帧时丢弃的字节
+	MetricCounter* m_rejected;			//protocol.rejected 0xAADD失败回复
+	MetricCounter* m_naks;				//protocol.naks 打印数据否认
+	quint64 m_lastDiscarded = 0;
 };
 
 /** 
@@ -0,0 +1,116 @@
+﻿#include "RetransmitWindow.h"
+
+
+RetransmitWindow::RetransmitWindow(int windowFrames /*= RETRANS_WINDOW_FRAMES*/, int timeoutMs /*= RETRANS_TIMEOUT_MS*/, int maxRetries /*= RETRANS_MAX_RETRIES*/)
+	:m_windowFrames(qMax(1, windowFrames))
+	,m_timeoutMs(timeoutMs)
+	,m_maxRetries(maxRetries)
+{
+
+}
+
+void RetransmitWindow::reset(quint32 firstSeq /*= 0*/)
+{
+	m_entries.clear();
+	m_baseSeq = firstSeq;
+	m_exhausted = false;
+	m_retransmitCount = 0;
+}
+
+void RetransmitWindow::onSent(quint32 seq, const QByteArray& frame, qint64 nowMs)
+{
+	Q_ASSERT(seq == m_baseSeq + static_cast<quint32>(m_entries.size()));
+	m_entries.push_back({ frame, nowMs, 0, false, false });
+}
+
+int RetransmitWindow::onAck(quint32 seq)
+{
+	//序号回绕时按差值比较
+	quint32 offset = seq - m_baseSeq;
+	if (offset >= m_entries.size())
+	{
+		return 0;
+	}
+
+	int count = static_cast<int>(offset) + 1;
+	m_entries.erase(m_entries.begin(), m_entries.begin() + count);
+	m_baseSeq += count;
+	return count;
+}
+
+bool RetransmitWindow::onNak(quint32 seq)
+{
+	quint32 offset = seq - m_baseSeq;
+	if (offset >= m_entries.size())
+	{
+		return false;
+	}
+	m_entries[offset].nak = true;
+	return true;
+}
+
+int RetransmitWindow::requeueAll(qint64* bytes /*= nullptr*/)
+{
+	qint64 total = 0;
+	for (Entry& entry : m_entries)
+	{
+		entry.nak = true;
+		entry.resume = true;
+		total += entry.frame.size();
+	}
+	if (bytes)
+	{
+		*bytes = total;
+	}
+	return static_cast<int>(m_entries.size());
+}
+
+QList<QByteArray> RetransmitWindow::peekDue(qint64 nowMs, QList<quint32>* seqs /*= nullptr*/)
+{
+	QList<QByteArray> frames;
+	for (size_t i = 0; i < m_entries.size(); i++)
+	{
+		const Entry& entry = m_entries[i];
+		if (!entry.nak && nowMs - entry.sentMs < m_timeoutMs)
+		{
+			continue;
+		}
+
+		//断线补发不是链路错误，不受重发次数限制
+		if (!entry.resume && entry.retries >= m_maxRetries)
+		{
+			m_exhausted = true;
+			continue;
+		}
+
+		frames.append(entry.frame);
+		if (seqs)
+		{
+			seqs->append(m_baseSeq + static_cast<quint32>(i));
+		}
+	}
+	return frames;
+}
+
+bool RetransmitWindow::commitRetry(quint32 seq, qint64 nowMs)
+{
+	quint32 offset = seq - m_baseSeq;
+	if (offset >= m_entries.size())
+	{
+		return false;
+	}
+
+	Entry& entry = m_entries[offset];
+	if (entry.resume)
+	{
+		entry.resume = false;
+	}
+	else
+	{
+		entry.retries++;
+		m_retransmitCount++;
+	}
+	entry.nak = false;
+	entry.sentMs = nowMs;
+	return true;
+}
@@ -0,0 +1,113 @@
+﻿#pragma once
+#include <QtCore/QtCore>
+#include <deque>
+
+//窗口内最多未确认帧数
+#define RETRANS_WINDOW_FRAMES 128
+//未确认帧超时重发时间（毫秒）
+#define RETRANS_TIMEOUT_MS 2000
+//单帧最大重发次数，超过后任务失败
+#define RETRANS_MAX_RETRIES 5
+
+/**
+*  @author
+*  @class       RetransmitWindow
+*  @brief       批量数据的滑动窗口重发缓存
+*
+*  按序号保存已发送但未确认的帧（共享引用，不拷贝）。下位机以累计确认回复已连续收到的最大序号，
+*  对校验失败的帧回复否认；只有被否认或超时未确认的帧会被重发，单帧出错不影响其他帧。
+*  非线程安全，在SDK主线程使用。
+*/
+class RetransmitWindow
+{
+public:
+	explicit RetransmitWindow(int windowFrames = RETRANS_WINDOW_FRAMES, int timeoutMs = RETRANS_TIMEOUT_MS, int maxRetries = RETRANS_MAX_RETRIES);
+
+	//开始新的传输，序号从firstSeq开始
+	void reset(quint32 firstSeq = 0);
+
+	//窗口未满，可以发送新帧
+	bool canSend() const { return static_cast<int>(m_entries.size()) < m_windowFrames; }
+
+	bool isEmpty() const { return m_entries.empty(); }
+
+	int inFlight() const { return static_cast<int>(m_entries.size()); }
+
+	/**
+	*  @brief       记录新发送的帧，序号必须连续
+	*  @param[in]    seq: 帧序号  frame: 完整帧  nowMs: 当前时间
+	*  @param[out]
+	*  @return
+	*/
+	void onSent(quint32 seq, const QByteArray& frame, qint64 nowMs);
+
+	/**
+	*  @brief       累计确认：seq及之前的帧全部出窗
+	*  @param[in]
+	*  @param[out]
+	*  @return       出窗的帧数
+	*/
+	int onAck(quint32 seq);
+
+	/**
+	*  @brief       否认：标记该帧需要立即重发
+	*  @param[in]
+	*  @param[out]
+	*  @return       false=序号不在窗口内（已确认或无效）
+	*/
+	bool onNak(quint32 seq);
+
+	/**
+	*  @brief       断线重连后标记窗口内所有未确认帧立即重发，这次重发不计入重发次数
+	*  @param[in]
+	*  @param[out]   bytes: 需要重发的总字节数
+	*  @return       需要重发的帧数
+	*/
+	int requeueAll(qint64* bytes = nullptr);
+
+	/**
+	*  @brief       查看需要重发的帧（被否认或已超时），不改变重发状态
+	*  @param[in]    nowMs: 当前时间
+	*  @param[out]   seqs: 需要重发的序号，按序号升序
+	*  @return       需要重发的帧，与seqs一一对应
+	*
+	*  超过最大重发次数的帧不返回并置exhausted。帧交给发送队列成功后须调用commitRetry，
+	*  入队被拒绝的帧保持待重发状态，不消耗重发次数。
+	*/
+	QList<QByteArray> peekDue(qint64 nowMs, QList<quint32>* seqs = nullptr);
+
+	/**
+	*  @brief       记录peekDue返回的帧已重发：消耗一次重发次数（断线补发除外）并重新计时
+	*  @param[in]    seq: 帧序号  nowMs: 当前时间
+	*  @param[out]
+	*  @return       false=序号不在窗口内
+	*/
+	bool commitRetry(quint32 seq, qint64 nowMs);
+
+	//有帧超过最大重发次数
+	bool exhausted() const { return m_exhausted; }
+
+	//累计重发帧数（只计成功交给发送队列的）
+	quint64 retransmitCount() const { return m_retransmitCount; }
+
+	//窗口起始（最早未确认）序号
+	quint32 baseSeq() const { return m_baseSeq; }
+
+private:
+	struct Entry
+	{
+		QByteArray frame;
+		qint64 sentMs;
+		int retries;
+		bool nak;
+		bool resume;		//断线前已发出，重连后补发
+	};
+
+	std::deque<Entry> m_entries;		//m_entries[i]的序号为m_baseSeq + i
+	quint32 m_baseSeq = 0;
+	int m_windowFrames;
+	int m_timeoutMs;
+	int m_maxRetries;
+	bool m_exhausted = false;
+	quint64 m_retransmitCount = 0;
+};
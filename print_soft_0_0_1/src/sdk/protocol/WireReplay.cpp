@@ -0,0 +1,91 @@
+﻿#include "WireReplay.h"
+#include <chrono>
+#include <thread>
+
+#define FNV_OFFSET_BASIS 2166136261u
+#define FNV_PRIME 16777619u
+
+namespace
+{
+	quint32 fnv1a(quint32 hash, const void* data, size_t len)
+	{
+		const uchar* p = static_cast<const uchar*>(data);
+		for (size_t i = 0; i < len; i++)
+		{
+			hash = (hash ^ p[i]) * FNV_PRIME;
+		}
+		return hash;
+	}
+
+	quint32 fnv1aValue(quint32 hash, qint64 value)
+	{
+		uchar buf[8];
+		qToLittleEndian(value, buf);
+		return fnv1a(hash, buf, sizeof(buf));
+	}
+}
+
+quint32 WireReplay::digest(quint32 seed, const ProtocolResultBatch& results)
+{
+	quint32 hash = seed;
+	for (const ProtocolResult& result : results)
+	{
+		hash = fnv1aValue(hash, result.kind);
+		hash = fnv1aValue(hash, result.cmdType);
+		hash = fnv1aValue(hash, result.funCode);
+		hash = fnv1aValue(hash, result.ok);
+		hash = fnv1aValue(hash, result.seq);
+		hash = fnv1aValue(hash, result.data.size());
+		hash = fnv1a(hash, result.data.constData(), static_cast<size_t>(result.data.size()));
+		hash = fnv1aValue(hash, result.axisPos.xPos);
+		hash = fnv1aValue(hash, result.axisPos.yPos);
+		hash = fnv1aValue(hash, result.axisPos.zPos);
+	}
+	return hash;
+}
+
+bool WireReplay::run(WireCaptureReader& reader, ProtocolPrint& protocol, EReplaySpeed speed, WireReplayStats& stats)
+{
+	stats = WireReplayStats();
+	stats.digest = FNV_OFFSET_BASIS;
+
+	//结果在HandleRecvDatagramData1返回前发出，直连时在本线程同步汇总
+	QMetaObject::Connection conn = QObject::connect(&protocol, &ProtocolPrint::SigResultBatch,
+		[&stats](const ProtocolResultBatch& results) {
+			stats.batches++;
+			stats.results += results.size();
+			stats.digest = digest(stats.digest, results);
+		});
+
+	const auto start = std::chrono::steady_clock::now();
+	bool firstChunk = true;
+	quint64 firstOffsetNs = 0;
+	WireChunk chunk;
+	while (reader.next(chunk))
+	{
+		if (chunk.direction != Wire_Inbound)
+		{
+			continue;
+		}
+		if (firstChunk)
+		{
+			firstOffsetNs = chunk.offsetNs;
+			firstChunk = false;
+		}
+		stats.capturedNs = chunk.offsetNs - firstOffsetNs;
+
+		if (speed == Replay_Original)
+		{
+			std::this_thread::sleep_until(start + std::chrono::nanoseconds(stats.capturedNs));
+		}
+
+		stats.chunks++;
+		stats.bytes += chunk.data.size();
+		protocol.HandleRecvDatagramData1(chunk.data);
+	}
+
+	stats.elapsedNs = static_cast<quint64>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now() - start).count());
+	QObject::disconnect(conn);
+	return reader.errorString().isEmpty();
+}
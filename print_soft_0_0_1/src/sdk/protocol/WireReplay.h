@@ -0,0 +1,46 @@
+﻿#pragma once
+#include <QtCore/QtCore>
+#include "WireCapture.h"
+#include "ProtocolPrint.h"
+
+/**  回放速度  **/
+enum EReplaySpeed
+{
+	Replay_Original = 0,	//按抓包时的时间间隔送入
+	Replay_Max				//不等待，尽快送入（解析/分发基准测试）
+};
+
+/**  一次回放的统计  **/
+struct WireReplayStats
+{
+	quint64 chunks = 0;			//送入的接收数据段数
+	quint64 bytes = 0;			//送入的字节数
+	quint64 results = 0;		//解析出的结果数
+	quint64 batches = 0;		//SigResultBatch次数
+	quint64 capturedNs = 0;		//抓包中第一段到最后一段接收数据的时间跨度
+	quint64 elapsedNs = 0;		//回放耗时
+	quint32 digest = 0;			//全部结果的摘要，同一抓包文件每次回放应一致
+};
+
+/**
+*  @author
+*  @class       WireReplay
+*  @brief       把抓包文件中的接收数据按原始节奏或最大速度送入ProtocolPrint，统计解析结果
+*
+*  在调用线程中同步执行，ProtocolPrint的结果批次以直连方式在回放线程中汇总为摘要，
+*  可作为可重复的解析/分发基准，也可把抓包文件和摘要作为回归样本。发送方向的数据只用于计时，不送入解析。
+*/
+class WireReplay
+{
+public:
+	/**
+	*  @brief       回放抓包
+	*  @param[in]    reader: 已打开的抓包文件（从第一条记录开始读取）  protocol: 解析对象  speed: 回放速度
+	*  @param[out]   stats: 回放统计
+	*  @return       false=抓包文件损坏（已送入的部分仍计入统计，原因见reader.errorString()）
+	*/
+	static bool run(WireCaptureReader& reader, ProtocolPrint& protocol, EReplaySpeed speed, WireReplayStats& stats);
+
+	//结果摘要（FNV-1a），覆盖结果类型、命令类型、命令字、成功标志、序号、数据区和坐标
+	static quint32 digest(quint32 seed, const ProtocolResultBatch& results);
+};
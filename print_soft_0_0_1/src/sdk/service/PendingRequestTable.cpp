@@ -0,0 +1,222 @@
+﻿#include "PendingRequestTable.h"
+#include "TraceRecorder.h"
+
+
+PendingRequestTable::PendingRequestTable(QObject* parent /*= 0*/, MetricsRegistry* metrics /*= MetricsRegistry::global()*/)
+	:QObject(parent)
+{
+	qRegisterMetaType<CommandReply>("CommandReply");
+	m_clock.start();
+	m_checkTimer.setInterval(PENDING_CHECK_INTERVAL_MS);
+	connect(&m_checkTimer, &QTimer::timeout, this, &PendingRequestTable::onCheckDeadline);
+
+	m_rtt = &metrics->histogram("command.rtt");
+	m_rttByCode = &metrics->keyed("command.rtt_by_code");
+	m_timeouts = &metrics->counter("command.timeouts");
+	m_failed = &metrics->counter("command.failed");
+	m_rejected = &metrics->counter("command.rejected");
+	m_pendingGauge = &metrics->gauge("command.pending");
+}
+
+PendingRequestTable::~PendingRequestTable()
+{
+	failAll(QStringLiteral("released"));
+}
+
+quint64 PendingRequestTable::add(int cmdType, int funCode, int timeoutMs, CommandReplyCallback callback, quint32 seq /*= PENDING_NO_SEQ*/)
+{
+	Entry entry;
+	entry.callback = std::move(callback);
+	entry.hasFuture = false;
+	return insert(cmdType, funCode, timeoutMs, std::move(entry), seq);
+}
+
+QFuture<CommandReply> PendingRequestTable::addFuture(int cmdType, int funCode, int timeoutMs, quint64* id /*= nullptr*/, quint32 seq /*= PENDING_NO_SEQ*/)
+{
+	Entry entry;
+	entry.hasFuture = true;
+	entry.future.reportStarted();
+	QFuture<CommandReply> future = entry.future.future();
+
+	quint64 newId = insert(cmdType, funCode, timeoutMs, std::move(entry), seq);
+	if (id)
+	{
+		*id = newId;
+	}
+	return future;
+}
+
+quint64 PendingRequestTable::insert(int cmdType, int funCode, int timeoutMs, Entry entry, quint32 seq)
+{
+	entry.id = m_nextId++;
+	entry.sentNs = m_clock.nsecsElapsed();
+	entry.deadlineMs = entry.sentNs / 1000000 + timeoutMs;
+	quint64 id = entry.id;
+
+	TRACE_ASYNC_BEGIN("command", id, "cmd_type", cmdType, "fun_code", funCode);
+	m_pending[makeKey(cmdType, funCode, seq)].enqueue(std::move(entry));
+	m_count++;
+	m_pendingGauge->set(m_count);
+	if (!m_checkTimer.isActive())
+	{
+		m_checkTimer.start();
+	}
+	return id;
+}
+
+bool PendingRequestTable::complete(int cmdType, int funCode, bool ok, const QByteArray& data, quint32 seq /*= PENDING_NO_SEQ*/)
+{
+	auto it = m_pending.find(makeKey(cmdType, funCode, seq));
+	if (it == m_pending.end() || it->isEmpty())
+	{
+		return false;
+	}
+
+	Entry entry = it->dequeue();
+	if (it->isEmpty())
+	{
+		m_pending.erase(it);
+	}
+	m_count--;
+	m_pendingGauge->set(m_count);
+
+	quint64 rttNs = static_cast<quint64>(m_clock.nsecsElapsed() - entry.sentNs);
+	m_rtt->record(rttNs);
+	m_rttByCode->recordLatency(cmdType, funCode, rttNs);
+
+	CommandReply reply;
+	reply.cmdType = cmdType;
+	reply.funCode = funCode;
+	reply.ok = ok;
+	reply.data = data;
+	if (!ok)
+	{
+		reply.error = QStringLiteral("rejected by device");
+		m_rejected->add();
+	}
+	finish(entry, reply);
+	return true;
+}
+
+bool PendingRequestTable::fail(quint64 id, const QString& error)
+{
+	for (auto it = m_pending.begin(); it != m_pending.end(); ++it)
+	{
+		QQueue<Entry>& queue = it.value();
+		for (int i = 0; i < queue.size(); i++)
+		{
+			if (queue[i].id != id)
+			{
+				continue;
+			}
+
+			Entry entry = queue.takeAt(i);
+			quint64 key = it.key();
+			if (queue.isEmpty())
+			{
+				m_pending.erase(it);
+			}
+			m_count--;
+			m_pendingGauge->set(m_count);
+			m_failed->add();
+
+			CommandReply reply;
+			reply.cmdType = static_cast<int>(key >> 48);
+			reply.funCode = static_cast<int>((key >> 32) & 0xFFFF);
+			reply.error = error;
+			finish(entry, reply);
+			return true;
+		}
+	}
+	return false;
+}
+
+void PendingRequestTable::failAll(const QString& error)
+{
+	//先取出再回调，回调中可以安全地登记新请求
+	QHash<quint64, QQueue<Entry>> pending;
+	pending.swap(m_pending);
+	m_count = 0;
+	m_pendingGauge->set(0);
+	m_checkTimer.stop();
+
+	for (auto it = pending.begin(); it != pending.end(); ++it)
+	{
+		for (Entry& entry : it.value())
+		{
+			CommandReply reply;
+			reply.cmdType = static_cast<int>(it.key() >> 48);
+			reply.funCode = static_cast<int>((it.key() >> 32) & 0xFFFF);
+			reply.error = error;
+			m_failed->add();
+			finish(entry, reply);
+		}
+	}
+}
+
+void PendingRequestTable::onCheckDeadline()
+{
+	qint64 nowMs = m_clock.elapsed();
+
+	QList<QPair<quint64, Entry>> expired;
+	for (auto it = m_pending.begin(); it != m_pending.end();)
+	{
+		QQueue<Entry>& queue = it.value();
+		for (int i = 0; i < queue.size();)
+		{
+			if (queue[i].deadlineMs <= nowMs)
+			{
+				expired.append(qMakePair(it.key(), queue.takeAt(i)));
+				m_count--;
+			}
+			else
+			{
+				i++;
+			}
+		}
+		if (queue.isEmpty())
+		{
+			it = m_pending.erase(it);
+		}
+		else
+		{
+			++it;
+		}
+	}
+
+	if (m_count == 0)
+	{
+		m_checkTimer.stop();
+	}
+	m_pendingGauge->set(m_count);
+
+	for (auto& item : expired)
+	{
+		CommandReply reply;
+		reply.cmdType = static_cast<int>(item.first >> 48);
+		reply.funCode = static_cast<int>((item.first >> 32) & 0xFFFF);
+		reply.timedOut = true;
+		reply.error = QStringLiteral("timeout");
+		m_timeouts->add();
+		finish(item.second, reply);
+	}
+}
+
+quint64 PendingRequestTable::makeKey(int cmdType, int funCode, quint32 seq)
+{
+	return (static_cast<quint64>(cmdType & 0xFFFF) << 48) | (static_cast<quint64>(funCode & 0xFFFF) << 32) | seq;
+}
+
+void PendingRequestTable::finish(Entry& entry, const CommandReply& reply)
+{
+	TRACE_ASYNC_END("command", entry.id);
+	if (entry.hasFuture)
+	{
+		entry.future.reportResult(reply);
+		entry.future.reportFinished();
+	}
+	if (entry.callback)
+	{
+		entry.callback(reply);
+	}
+}
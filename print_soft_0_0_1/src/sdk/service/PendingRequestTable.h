@@ -0,0 +1,100 @@
+﻿#pragma once
+#include <QtCore/QtCore>
+#include <QFutureInterface>
+#include "motionControlSDK.h"
+#include "MetricsRegistry.h"
+
+//请求无序号时使用的序号值
+#define PENDING_NO_SEQ 0xFFFFFFFFu
+//超时检查间隔（毫秒）
+#define PENDING_CHECK_INTERVAL_MS 50
+
+/**
+*  @author
+*  @class       PendingRequestTable
+*  @brief       请求/应答关联表
+*
+*  以 命令类型+命令字（+序号）为键记录已发出、尚未应答的请求，每项带截止时间和完成回调/QFuture。
+*  同一键的多条请求按发送顺序与应答一一匹配（下位机按序应答）；有序号时按序号精确匹配。
+*  超时的请求以timedOut结果完成，之后迟到的应答会匹配到同键的下一条请求，需要精确匹配时应使用序号。
+*  应答往返时间记入command.rtt（总体）和command.rtt_by_code（按命令类型+命令字）。
+*  非线程安全，在SDK主线程使用。
+*/
+class PendingRequestTable : public QObject
+{
+	Q_OBJECT
+public:
+	//metrics: 往返时间等统计写入的注册表（每个设备会话一个）
+	PendingRequestTable(QObject* parent = 0, MetricsRegistry* metrics = MetricsRegistry::global());
+	~PendingRequestTable();
+
+	/**
+	*  @brief       登记一条请求
+	*  @param[in]    cmdType/funCode: 请求的命令类型和命令字  timeoutMs: 超时时间  callback: 完成回调  seq: 序号
+	*  @param[out]
+	*  @return       请求id
+	*/
+	quint64 add(int cmdType, int funCode, int timeoutMs, CommandReplyCallback callback, quint32 seq = PENDING_NO_SEQ);
+
+	/**
+	*  @brief       登记一条请求，以QFuture返回结果
+	*  @param[in]
+	*  @param[out]   id: 请求id
+	*  @return
+	*/
+	QFuture<CommandReply> addFuture(int cmdType, int funCode, int timeoutMs, quint64* id = nullptr, quint32 seq = PENDING_NO_SEQ);
+
+	/**
+	*  @brief       收到应答，完成最早的匹配请求
+	*  @param[in]
+	*  @param[out]
+	*  @return       false=没有匹配的请求
+	*/
+	bool complete(int cmdType, int funCode, bool ok, const QByteArray& data, quint32 seq = PENDING_NO_SEQ);
+
+	/**
+	*  @brief       以失败结果结束指定请求（未发出等）
+	*  @param[in]
+	*  @param[out]
+	*  @return
+	*/
+	bool fail(quint64 id, const QString& error);
+
+	//以失败结果结束所有请求（断线、释放）
+	void failAll(const QString& error);
+
+	int size() const { return m_count; }
+
+private slots:
+	void onCheckDeadline();
+
+private:
+	struct Entry
+	{
+		quint64 id;
+		qint64 deadlineMs;
+		qint64 sentNs;
+		CommandReplyCallback callback;
+		QFutureInterface<CommandReply> future;
+		bool hasFuture;
+	};
+
+	static quint64 makeKey(int cmdType, int funCode, quint32 seq);
+	static void finish(Entry& entry, const CommandReply& reply);
+	quint64 insert(int cmdType, int funCode, int timeoutMs, Entry entry, quint32 seq);
+
+private:
+	QHash<quint64, QQueue<Entry>> m_pending;
+	QElapsedTimer m_clock;
+	QTimer m_checkTimer;
+	quint64 m_nextId = 1;
+	int m_count = 0;
+
+	//指标（注册表中的对象，地址不变）
+	LatencyHistogram* m_rtt;
+	KeyedMetrics* m_rttByCode;
+	MetricCounter* m_timeouts;
+	MetricCounter* m_failed;
+	MetricCounter* m_rejected;
+	MetricGauge* m_pendingGauge;
+};
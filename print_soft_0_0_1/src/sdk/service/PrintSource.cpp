@@ -0,0 +1,194 @@
+﻿#include "PrintSource.h"
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+
+std::unique_ptr<PrintSource> PrintSource::openFile(const QString& filePath, QString* errorString /*= nullptr*/)
+{
+	std::unique_ptr<MappedPrintSource> mapped(new MappedPrintSource);
+	if (mapped->open(filePath))
+	{
+		return std::move(mapped);
+	}
+
+	QFile* file = new QFile(filePath);
+	if (!file->open(QIODevice::ReadOnly))
+	{
+		if (errorString)
+		{
+			*errorString = file->errorString();
+		}
+		delete file;
+		return nullptr;
+	}
+	return std::unique_ptr<PrintSource>(new DevicePrintSource(file));
+}
+
+std::unique_ptr<PrintSource> PrintSource::fromData(const QByteArray& data)
+{
+	QBuffer* buffer = new QBuffer;
+	buffer->setData(data);
+	buffer->open(QIODevice::ReadOnly);
+	return std::unique_ptr<PrintSource>(new DevicePrintSource(buffer));
+}
+
+
+MappedPrintSource::MappedPrintSource()
+{
+
+}
+
+MappedPrintSource::~MappedPrintSource()
+{
+	unmapWindow(m_cur);
+	unmapWindow(m_next);
+}
+
+bool MappedPrintSource::open(const QString& filePath)
+{
+	m_file.setFileName(filePath);
+	if (!m_file.open(QIODevice::ReadOnly))
+	{
+		return false;
+	}
+
+	m_size = m_file.size();
+	m_pos = 0;
+	m_prefetchedTo = 0;
+
+	//空文件无需映射
+	if (m_size == 0)
+	{
+		return true;
+	}
+
+	if (!mapWindow(m_cur, 0))
+	{
+		m_file.close();
+		return false;
+	}
+	prefetch();
+	return true;
+}
+
+qint64 MappedPrintSource::read(char* dst, qint64 maxLen)
+{
+	qint64 total = 0;
+	while (maxLen > 0 && m_pos < m_size)
+	{
+		if (!m_cur.contains(m_pos))
+		{
+			//进入下一窗口，释放已发送完的窗口
+			unmapWindow(m_cur);
+			if (m_next.contains(m_pos))
+			{
+				m_cur = m_next;
+				m_next = MapWindow();
+			}
+			else if (!mapWindow(m_cur, m_pos))
+			{
+				return total > 0 ? total : -1;
+			}
+		}
+
+		qint64 len = qMin(maxLen, m_cur.offset + m_cur.length - m_pos);
+		memcpy(dst, m_cur.base + (m_pos - m_cur.offset), static_cast<size_t>(len));
+		dst += len;
+		maxLen -= len;
+		m_pos += len;
+		total += len;
+	}
+
+	prefetch();
+	return total;
+}
+
+bool MappedPrintSource::mapWindow(MapWindow& window, qint64 offset)
+{
+	offset -= offset % PRINT_SOURCE_MAP_ALIGN;
+	qint64 length = qMin<qint64>(PRINT_SOURCE_MAP_WINDOW, m_size - offset);
+	uchar* base = m_file.map(offset, length);
+	if (!base)
+	{
+		return false;
+	}
+
+	window.base = base;
+	window.offset = offset;
+	window.length = length;
+	return true;
+}
+
+void MappedPrintSource::unmapWindow(MapWindow& window)
+{
+	if (window.base)
+	{
+		m_file.unmap(window.base);
+	}
+	window = MapWindow();
+}
+
+void MappedPrintSource::prefetch()
+{
+	qint64 target = qMin(m_pos + PRINT_SOURCE_PREFETCH, m_size);
+	if (target <= m_prefetchedTo)
+	{
+		return;
+	}
+
+	//预读范围超出当前窗口时提前映射下一窗口
+	qint64 curEnd = m_cur.offset + m_cur.length;
+	if (m_cur.base && target > curEnd && !m_next.base && curEnd < m_size)
+	{
+		mapWindow(m_next, curEnd);
+	}
+
+	qint64 from = qMax(m_prefetchedTo, m_pos);
+	const MapWindow* windows[] = { &m_cur, &m_next };
+	for (const MapWindow* window : windows)
+	{
+		if (!window->base)
+		{
+			continue;
+		}
+		qint64 begin = qMax(from, window->offset);
+		qint64 end = qMin(target, window->offset + window->length);
+		if (begin < end)
+		{
+			adviseWillNeed(window->base + (begin - window->offset), end - begin);
+		}
+	}
+	m_prefetchedTo = target;
+}
+
+void MappedPrintSource::adviseWillNeed(uchar* addr, qint64 length)
+{
+#ifdef Q_OS_WIN
+	//PrefetchVirtualMemory 仅 Windows 8 及以上提供，运行时查找
+	typedef struct { PVOID VirtualAddress; SIZE_T NumberOfBytes; } RangeEntry;
+	typedef BOOL(WINAPI* PrefetchFunc)(HANDLE, ULONG_PTR, RangeEntry*, ULONG);
+	static PrefetchFunc prefetchFunc = reinterpret_cast<PrefetchFunc>(
+		GetProcAddress(GetModuleHandleW(L"kernel32.dll"), "PrefetchVirtualMemory"));
+	if (prefetchFunc)
+	{
+		RangeEntry entry = { addr, static_cast<SIZE_T>(length) };
+		prefetchFunc(GetCurrentProcess(), 1, &entry, 0);
+	}
+#else
+	//madvise要求起始地址页对齐
+	const quintptr pageMask = 4096 - 1;
+	quintptr start = reinterpret_cast<quintptr>(addr) & ~pageMask;
+	madvise(reinterpret_cast<void*>(start), static_cast<size_t>(reinterpret_cast<quintptr>(addr) + length - start), MADV_WILLNEED);
+#endif
+}
+
+
+DevicePrintSource::DevicePrintSource(QIODevice* device)
+	:m_device(device)
+{
+
+}
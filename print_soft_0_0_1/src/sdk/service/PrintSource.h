@@ -0,0 +1,119 @@
+﻿#pragma once
+#include <QtCore/QtCore>
+#include <memory>
+
+//映射窗口大小，同一时刻最多映射当前窗口和预取窗口
+#define PRINT_SOURCE_MAP_WINDOW (64*1024*1024)
+//映射偏移对齐（windows分配粒度64KB，同时满足页对齐）
+#define PRINT_SOURCE_MAP_ALIGN (64*1024)
+//在发送游标之前预读的字节数
+#define PRINT_SOURCE_PREFETCH (8*1024*1024)
+
+/**
+*  @author
+*  @class       PrintSource
+*  @brief       打印数据源：按游标顺序读取，供分包器直接读入帧缓冲
+*/
+class PrintSource
+{
+public:
+	virtual ~PrintSource() {}
+
+	//数据总长度
+	virtual qint64 size() const = 0;
+
+	//当前读取位置
+	virtual qint64 pos() const = 0;
+
+	/**
+	*  @brief       从当前位置读取数据并前移游标
+	*  @param[in]    maxLen: 最多读取的字节数
+	*  @param[out]   dst: 目标地址
+	*  @return       实际读取的字节数，-1表示出错
+	*/
+	virtual qint64 read(char* dst, qint64 maxLen) = 0;
+
+	bool atEnd() const { return pos() >= size(); }
+
+	/**
+	*  @brief       打开文件数据源，优先内存映射，映射失败（如网络路径）时退回按块读取
+	*  @param[in]    filePath: 文件路径
+	*  @param[out]   errorString: 失败原因
+	*  @return       失败返回nullptr
+	*/
+	static std::unique_ptr<PrintSource> openFile(const QString& filePath, QString* errorString = nullptr);
+
+	/**
+	*  @brief       内存数据源（数据由QByteArray共享持有，fromRawData时调用方需保证底层内存有效）
+	*  @param[in]
+	*  @param[out]
+	*  @return
+	*/
+	static std::unique_ptr<PrintSource> fromData(const QByteArray& data);
+};
+
+
+/**
+*  @author
+*  @class       MappedPrintSource
+*  @brief       基于QFile::map的分窗口映射数据源
+*
+*  只映射游标附近的窗口：游标接近窗口尾部时提前映射下一窗口并提示系统预读，
+*  游标进入下一窗口后解除上一窗口的映射，已发送的数据不再占用内存，
+*  因此多GB的文件也只占用约两个窗口的地址空间和常驻内存。
+*/
+class MappedPrintSource : public PrintSource
+{
+public:
+	MappedPrintSource();
+	~MappedPrintSource();
+
+	bool open(const QString& filePath);
+	QString errorString() const { return m_file.errorString(); }
+
+	qint64 size() const override { return m_size; }
+	qint64 pos() const override { return m_pos; }
+	qint64 read(char* dst, qint64 maxLen) override;
+
+private:
+	struct MapWindow
+	{
+		uchar* base = nullptr;
+		qint64 offset = 0;
+		qint64 length = 0;
+
+		bool contains(qint64 pos) const { return base && pos >= offset && pos < offset + length; }
+	};
+
+	bool mapWindow(MapWindow& window, qint64 offset);
+	void unmapWindow(MapWindow& window);
+	void prefetch();
+	static void adviseWillNeed(uchar* addr, qint64 length);
+
+private:
+	QFile m_file;
+	qint64 m_size = 0;
+	qint64 m_pos = 0;
+	MapWindow m_cur;				//游标所在窗口
+	MapWindow m_next;				//预取的下一窗口
+	qint64 m_prefetchedTo = 0;		//已提示预读到的位置
+};
+
+
+/**
+*  @author
+*  @class       DevicePrintSource
+*  @brief       基于QIODevice的数据源（无法映射的文件、内存缓冲）
+*/
+class DevicePrintSource : public PrintSource
+{
+public:
+	explicit DevicePrintSource(QIODevice* device);
+
+	qint64 size() const override { return m_device->size(); }
+	qint64 pos() const override { return m_device->pos(); }
+	qint64 read(char* dst, qint64 maxLen) override { return m_device->read(dst, maxLen); }
+
+private:
+	std::unique_ptr<QIODevice> m_device;
+};
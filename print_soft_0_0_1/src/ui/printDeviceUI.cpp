@@ -82,24 +82,23 @@ void PrintDeviceUI::Init()
 
 	connect(m_motionSDK, &motionControlSDK::MC_SigLogMsg, this, [this](const QString& msg)
 	{
+		// SDK日志已由同一日志后端写入文件，这里只显示
 		QString logStr = QString("motion_SDK_moudle, 当前打印日志msg: %1").arg(msg);
 		emit SigAddShowOperCmd(logStr, "", ShowEditType::ESET_RecvComm);
-
-		LOG_INFO(logStr);
 	});
 
 
-	connect(m_motionSDK, &motionControlSDK::MC_SigSend2DevCmdMsg, this, [this](const QString& msg)
+	connect(m_motionSDK, &motionControlSDK::MC_SigSend2DevRawMsg, this, [this](const QByteArray& data)
 	{
-		QString logStr = QString("motion_SDK_moudle, 下发设备msg: %1").arg(msg);
+		QString logStr = QString("motion_SDK_moudle, 下发设备msg: %1").arg(QString::fromLatin1(data.toHex().toUpper()));
 		emit SigAddShowOperCmd(logStr, "", ShowEditType::ESET_Sendomm);
 
 		LOG_INFO(logStr);
 	});
 
-	connect(m_motionSDK, &motionControlSDK::MC_SigRecv2DevCmdMsg, this, [this](const QString& msg)
+	connect(m_motionSDK, &motionControlSDK::MC_SigRecv2DevRawMsg, this, [this](const QByteArray& data)
 	{
-		QString logStr = QString("motion_SDK_moudle, 接收设备msg: %1").arg(msg);
+		QString logStr = QString("motion_SDK_moudle, 接收设备msg: %1").arg(QString::fromLatin1(data.toHex().toUpper()));
 		emit SigAddShowOperCmd(logStr, "", ShowEditType::ESET_RecvComm);
 
 		LOG_INFO(logStr);
@@ -0,0 +1,94 @@
+﻿#include "DeviceSimulator.h"
+#include "SimSession.h"
+#include <cstdio>
+
+DeviceSimulator::DeviceSimulator(const SimConfig& config, QObject* parent /*= nullptr*/)
+	:QObject(parent)
+	, m_config(config)
+	, m_server(new QTcpServer(this))
+	, m_statsTimer(new QTimer(this))
+{
+	connect(m_server, &QTcpServer::newConnection, this, &DeviceSimulator::onNewConnection);
+	connect(m_statsTimer, &QTimer::timeout, this, &DeviceSimulator::printStats);
+}
+
+DeviceSimulator::~DeviceSimulator()
+{
+}
+
+bool DeviceSimulator::start()
+{
+	if (!m_server->listen(QHostAddress::Any, m_config.port))
+	{
+		return false;
+	}
+	m_statsClock.start();
+	return true;
+}
+
+quint16 DeviceSimulator::port() const
+{
+	return m_server->serverPort();
+}
+
+QString DeviceSimulator::errorString() const
+{
+	return m_server->errorString();
+}
+
+void DeviceSimulator::setStatsInterval(int intervalMs)
+{
+	if (intervalMs > 0)
+	{
+		m_statsTimer->start(intervalMs);
+	}
+	else
+	{
+		m_statsTimer->stop();
+	}
+}
+
+void DeviceSimulator::onNewConnection()
+{
+	while (QTcpSocket* socket = m_server->nextPendingConnection())
+	{
+		//每个连接使用不同的随机序列，同一种子下结果可复现
+		SimSession* session = new SimSession(socket, m_config, &m_stats, m_config.seed + m_sessionCount++, this);
+		connect(session, &SimSession::sigClosed, this, &DeviceSimulator::onSessionClosed);
+		m_sessions.append(session);
+		printf("client connected: %s\n", qPrintable(session->peerName()));
+		fflush(stdout);
+	}
+}
+
+void DeviceSimulator::onSessionClosed(SimSession* session)
+{
+	printf("client disconnected: %s\n", qPrintable(session->peerName()));
+	fflush(stdout);
+	m_sessions.removeOne(session);
+	session->deleteLater();
+}
+
+void DeviceSimulator::printStats()
+{
+	double sec = qMax<qint64>(1, m_statsClock.restart()) / 1000.0;
+	const SimStats& cur = m_stats;
+	const SimStats& last = m_lastStats;
+
+	printf("clients=%d rx=%.2f MB/s image=%.2f MB/s frames/s=%.0f cmds=%llu img=%llu ack=%llu nak=%llu crc=%llu dup=%llu ooo=%llu bad=%llu moves=%llu\n",
+		m_sessions.size(),
+		(cur.rxBytes - last.rxBytes) / sec / (1024.0 * 1024.0),
+		(cur.imageBytes - last.imageBytes) / sec / (1024.0 * 1024.0),
+		(cur.rxFrames - last.rxFrames) / sec,
+		static_cast<unsigned long long>(cur.commands),
+		static_cast<unsigned long long>(cur.imageFrames),
+		static_cast<unsigned long long>(cur.acks),
+		static_cast<unsigned long long>(cur.naks),
+		static_cast<unsigned long long>(cur.crcErrors),
+		static_cast<unsigned long long>(cur.duplicates),
+		static_cast<unsigned long long>(cur.outOfOrder),
+		static_cast<unsigned long long>(cur.badFrames),
+		static_cast<unsigned long long>(cur.moves));
+	fflush(stdout);
+	m_lastStats = m_stats;
+}
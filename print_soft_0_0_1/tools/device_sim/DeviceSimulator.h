@@ -0,0 +1,62 @@
+﻿#pragma once
+#include <QtCore/QtCore>
+#include <QtNetwork/QTcpServer>
+#include "SimConfig.h"
+
+class SimSession;
+
+/**
+*  @author
+*  @class       DeviceSimulator
+*  @brief       下位机回环模拟器：监听端口，每个连接一个SimSession，统计所有连接的收发
+*
+*  只依赖Qt事件循环，可以作为独立进程运行，也可以放到测试程序的工作线程中。
+*/
+class DeviceSimulator : public QObject
+{
+	Q_OBJECT
+
+public:
+	explicit DeviceSimulator(const SimConfig& config, QObject* parent = nullptr);
+	~DeviceSimulator();
+
+	/**
+	*  @brief       开始监听（config.port为0时由系统分配端口）
+	*  @param[in]
+	*  @param[out]
+	*  @return       false=端口被占用等
+	*/
+	bool start();
+
+	//实际监听端口
+	quint16 port() const;
+
+	QString errorString() const;
+
+	const SimStats& stats() const { return m_stats; }
+
+	/**
+	*  @brief       每隔intervalMs打印一次吞吐和计数，0为关闭
+	*  @param[in]
+	*  @param[out]
+	*  @return
+	*/
+	void setStatsInterval(int intervalMs);
+
+	void printStats();
+
+private slots:
+	void onNewConnection();
+	void onSessionClosed(SimSession* session);
+
+private:
+	SimConfig m_config;
+	SimStats m_stats;
+	QTcpServer* m_server;
+	QTimer* m_statsTimer;
+	QList<SimSession*> m_sessions;
+	quint32 m_sessionCount = 0;
+
+	QElapsedTimer m_statsClock;
+	SimStats m_lastStats;
+};
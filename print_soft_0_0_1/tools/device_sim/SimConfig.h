@@ -0,0 +1,54 @@
+﻿#pragma once
+#include <QtCore/QtCore>
+
+//默认监听端口，与下位机一致
+#define SIM_DEFAULT_PORT 5555
+//默认轴速度（微米/秒）
+#define SIM_DEFAULT_AXIS_SPEED 50000
+//点动命令不带距离时的默认步长（微米）
+#define SIM_DEFAULT_JOG_STEP 1000
+//图像数据每收到多少帧回一次累计确认
+#define SIM_DEFAULT_ACK_EVERY 16
+//收到的帧不足一批时，空闲多久后补发累计确认（毫秒）
+#define SIM_IDLE_ACK_MS 2
+//乱序时响应额外推迟的时间（毫秒）
+#define SIM_DEFAULT_REORDER_DELAY_MS 5
+//允许缓存的乱序图像帧数，超过则丢弃等待重发
+#define SIM_OOO_WINDOW 1024
+
+/**  模拟器参数，各连接共用  **/
+struct SimConfig
+{
+	quint16 port = SIM_DEFAULT_PORT;
+	int latencyMs = 0;						//响应固定延迟
+	int jitterMs = 0;						//响应随机附加延迟上限
+	qint64 bandwidth = 0;					//上位机->下位机带宽上限（字节/秒），0为不限
+	double reorderRate = 0;					//响应被推迟从而与后续响应乱序的概率
+	int reorderDelayMs = SIM_DEFAULT_REORDER_DELAY_MS;
+	double rxCrcErrorRate = 0;				//收到的帧按crc错误处理的概率
+	double txCrcErrorRate = 0;				//发出的响应crc被破坏的概率
+	int axisSpeed = SIM_DEFAULT_AXIS_SPEED;	//各轴运动速度（微米/秒）
+	int ackEvery = SIM_DEFAULT_ACK_EVERY;
+	bool ackOnComplete = false;				//运动命令在运动完成后才应答（默认收到即应答）
+	quint32 seed = 1;
+	bool verbose = false;					//逐帧打印收发
+};
+
+/**  运行统计，所有连接累加  **/
+struct SimStats
+{
+	quint64 rxBytes = 0;
+	quint64 rxFrames = 0;
+	quint64 commands = 0;			//非图像数据的请求帧
+	quint64 imageFrames = 0;		//按序接收的图像帧
+	quint64 imageBytes = 0;			//图像帧中的有效数据字节
+	quint64 duplicates = 0;			//重复的图像帧
+	quint64 outOfOrder = 0;			//先于缺失帧到达的图像帧
+	quint64 crcErrors = 0;			//crc错误（含注入）
+	quint64 badFrames = 0;			//包头/命令类型不合法
+	quint64 acks = 0;				//图像累计确认
+	quint64 naks = 0;				//图像否认
+	quint64 txFrames = 0;
+	quint64 txBytes = 0;
+	quint64 moves = 0;				//运动命令
+};
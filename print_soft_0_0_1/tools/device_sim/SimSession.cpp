@@ -0,0 +1,514 @@
+﻿#include "SimSession.h"
+#include "Crc16.h"
+#include <cstdio>
+
+//包头
+#define SIM_HEAD_REQ 0xAABB
+#define SIM_HEAD_SUCC 0xAACC
+#define SIM_HEAD_ERR 0xAADD
+//帧固定开销：包头 + 命令类型 + 命令字 + 长度 + crc16
+#define SIM_FRAME_OVERHEAD 10
+//单次最多读取的字节数
+#define SIM_READ_CHUNK (64 * 1024)
+//令牌桶容量（毫秒的带宽）
+#define SIM_BUCKET_MS 10
+
+namespace
+{
+	//与ProtocolPrint::ECmdType一致
+	enum SimCmdType
+	{
+		Sim_SetParamCmd = 0x0001,
+		Sim_GetCmd = 0x0010,
+		Sim_CtrlCmd = 0x0011,
+		Sim_PrintCommCmd = 0x00F0
+	};
+
+	//与ProtocolPrint::FunCode一致
+	enum SimFunCode
+	{
+		Sim_SetParam_Begin = 0x1000,
+		Sim_SetParam_End = 0x1FFF,
+		Sim_Get_AxisPos = 0x2000,
+		Sim_Get_Breath = 0x2010,
+		Sim_Get_End = 0x2FFF,
+		Sim_Ctrl_StartPrint = 0x3000,
+		Sim_Ctrl_PausePrint = 0x3001,
+		Sim_Ctrl_ContinuePrint = 0x3002,
+		Sim_Ctrl_StopPrint = 0x3003,
+		Sim_Ctrl_ResetPos = 0x3004,
+		Sim_Ctrl_XAxisLMove = 0x3101,
+		Sim_Ctrl_ZAxisRMove = 0x3106,
+		Sim_Ctrl_AxisAbsMove = 0x3107,
+		Sim_Ctrl_AxisRelMove = 0x3108,
+		Sim_Ctrl_End = 0xEFFF,
+		Sim_Print_AxisMovePos = 0xF000,
+		Sim_Print_PeriodData = 0xF001
+	};
+
+	//命令字对应的命令类型，与上位机组包规则一致；0表示不支持的命令字
+	ushort cmdTypeOfCode(ushort code)
+	{
+		if (code >= Sim_SetParam_Begin && code <= Sim_SetParam_End)
+		{
+			return Sim_SetParamCmd;
+		}
+		if (code == Sim_Get_AxisPos || code == Sim_Get_Breath)
+		{
+			return Sim_GetCmd;
+		}
+		if ((code >= Sim_Ctrl_StartPrint && code <= Sim_Ctrl_ResetPos)
+			|| (code >= Sim_Ctrl_XAxisLMove && code <= Sim_Ctrl_AxisRelMove))
+		{
+			return Sim_CtrlCmd;
+		}
+		if (code == Sim_Print_AxisMovePos || code == Sim_Print_PeriodData)
+		{
+			return Sim_PrintCommCmd;
+		}
+		return 0;
+	}
+
+	qint32 readInt32(const uchar* p)
+	{
+		return static_cast<qint32>(qFromLittleEndian<quint32>(p));
+	}
+}
+
+SimAxisModel::SimAxisModel(int speed)
+	:m_speed(qMax(1, speed))
+{
+}
+
+qint64 SimAxisModel::moveTo(qint64 nowMs, const qint64 target[3])
+{
+	qint64 from[3];
+	position(nowMs, from);
+
+	qint64 maxDist = 0;
+	for (int i = 0; i < 3; i++)
+	{
+		m_from[i] = from[i];
+		m_to[i] = target[i];
+		maxDist = qMax(maxDist, qAbs(m_to[i] - m_from[i]));
+	}
+	m_startMs = nowMs;
+	m_endMs = nowMs + maxDist * 1000 / m_speed;
+	return m_endMs;
+}
+
+void SimAxisModel::position(qint64 nowMs, qint64 pos[3]) const
+{
+	for (int i = 0; i < 3; i++)
+	{
+		if (nowMs >= m_endMs)
+		{
+			pos[i] = m_to[i];
+			continue;
+		}
+		//各轴同速，距离短的轴先到位
+		qint64 travelled = (nowMs - m_startMs) * m_speed / 1000;
+		qint64 dist = m_to[i] - m_from[i];
+		if (qAbs(dist) <= travelled)
+		{
+			pos[i] = m_to[i];
+		}
+		else
+		{
+			pos[i] = m_from[i] + (dist > 0 ? travelled : -travelled);
+		}
+	}
+}
+
+SimSession::SimSession(QTcpSocket* socket, const SimConfig& config, SimStats* stats, quint32 seed, QObject* parent /*= nullptr*/)
+	:QObject(parent)
+	, m_socket(socket)
+	, m_config(config)
+	, m_stats(stats)
+	, m_timer(new QTimer(this))
+	, m_rng(seed)
+	, m_axis(config.axisSpeed)
+{
+	m_socket->setParent(this);
+	m_socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+	//限速时不让Qt把数据全部读进用户态，未读数据留在内核缓冲区形成反压
+	if (m_config.bandwidth > 0)
+	{
+		m_socket->setReadBufferSize(SIM_READ_CHUNK);
+	}
+	m_peer = QString("%1:%2").arg(m_socket->peerAddress().toString()).arg(m_socket->peerPort());
+	m_clock.start();
+	m_readBuf.resize(SIM_READ_CHUNK);
+
+	m_decoder.setFrameHandler([this](const FrameView& frame) {
+		handleFrame(frame);
+	});
+
+	m_timer->setTimerType(Qt::PreciseTimer);
+	m_timer->setInterval(1);
+	connect(m_timer, &QTimer::timeout, this, &SimSession::onTick);
+	connect(m_socket, &QTcpSocket::readyRead, this, &SimSession::onReadyRead);
+	connect(m_socket, &QTcpSocket::disconnected, this, &SimSession::onDisconnected);
+}
+
+SimSession::~SimSession()
+{
+}
+
+bool SimSession::chance(double rate)
+{
+	if (rate <= 0)
+	{
+		return false;
+	}
+	return std::uniform_real_distribution<double>(0.0, 1.0)(m_rng) < rate;
+}
+
+void SimSession::onReadyRead()
+{
+	for (;;)
+	{
+		qint64 want = SIM_READ_CHUNK;
+		if (m_config.bandwidth > 0)
+		{
+			qint64 nowMs = m_clock.elapsed();
+			double capacity = qMax<double>(m_config.bandwidth * SIM_BUCKET_MS / 1000.0, SIM_FRAME_OVERHEAD);
+			m_tokens = qMin(capacity, m_tokens + (nowMs - m_lastRefillMs) * m_config.bandwidth / 1000.0);
+			m_lastRefillMs = nowMs;
+			want = qMin<qint64>(want, static_cast<qint64>(m_tokens));
+			if (want <= 0)
+			{
+				//令牌用完，等定时器补充后再读
+				m_throttled = true;
+				break;
+			}
+		}
+
+		qint64 got = m_socket->read(m_readBuf.data(), want);
+		if (got <= 0)
+		{
+			m_throttled = false;
+			break;
+		}
+		m_tokens -= got;
+		m_stats->rxBytes += got;
+		m_decoder.feed(m_readBuf.constData(), static_cast<int>(got));
+	}
+
+	flushImageAck();
+	flushOutbox();
+	scheduleTimer();
+}
+
+void SimSession::onDisconnected()
+{
+	m_timer->stop();
+	emit sigClosed(this);
+}
+
+void SimSession::onTick()
+{
+	if (m_throttled)
+	{
+		onReadyRead();
+		return;
+	}
+	flushImageAck();
+	flushOutbox();
+	scheduleTimer();
+}
+
+void SimSession::scheduleTimer()
+{
+	bool pending = m_throttled || m_ackDueMs >= 0 || !m_outbox.empty();
+	if (pending && !m_timer->isActive())
+	{
+		m_timer->start();
+	}
+	else if (!pending && m_timer->isActive())
+	{
+		m_timer->stop();
+	}
+}
+
+void SimSession::handleFrame(const FrameView& frame)
+{
+	m_stats->rxFrames++;
+	const uchar* d = frame.data;
+	int len = frame.size - SIM_FRAME_OVERHEAD;
+
+	if (frame.head != SIM_HEAD_REQ)
+	{
+		m_stats->badFrames++;
+		return;
+	}
+
+	//上位机组包时命令类型/命令字高字节在前
+	ushort cmdType = static_cast<ushort>((d[2] << 8) | d[3]);
+	ushort code = static_cast<ushort>((d[4] << 8) | d[5]);
+	const uchar* payload = d + 8;
+
+	if (m_config.verbose)
+	{
+		printf("[%s] rx cmdType=0x%04X code=0x%04X len=%d\n", qPrintable(m_peer), cmdType, code, len);
+	}
+
+	ushort crc = Crc16::compute(d, frame.size - 2);
+	ushort wireCrc = static_cast<ushort>((d[frame.size - 2] << 8) | d[frame.size - 1]);
+	if (crc != wireCrc || chance(m_config.rxCrcErrorRate))
+	{
+		m_stats->crcErrors++;
+		if (code == Sim_Print_PeriodData && len >= 4)
+		{
+			//图像帧只否认该帧，上位机只重发这一帧
+			m_stats->naks++;
+			reply(SIM_HEAD_ERR, cmdType, code, QByteArray(reinterpret_cast<const char*>(payload), 4));
+		}
+		else
+		{
+			reply(SIM_HEAD_ERR, cmdType, code);
+		}
+		return;
+	}
+
+	ushort expectType = cmdTypeOfCode(code);
+	if (expectType == 0 || expectType != cmdType)
+	{
+		m_stats->badFrames++;
+		reply(SIM_HEAD_ERR, cmdType, code);
+		return;
+	}
+
+	if (code == Sim_Print_PeriodData)
+	{
+		handleImageFrame(payload, len);
+		return;
+	}
+
+	m_stats->commands++;
+	switch (code)
+	{
+	case Sim_Get_AxisPos:
+	{
+		qint64 pos[3];
+		m_axis.position(m_clock.elapsed(), pos);
+		QByteArray data(12, Qt::Uninitialized);
+		uchar* p = reinterpret_cast<uchar*>(data.data());
+		for (int i = 0; i < 3; i++)
+		{
+			qToLittleEndian<quint32>(static_cast<quint32>(pos[i]), p + i * 4);
+		}
+		reply(SIM_HEAD_SUCC, cmdType, code, data);
+		break;
+	}
+	case Sim_Ctrl_StartPrint:
+	case Sim_Ctrl_StopPrint:
+		//新的打印任务，图像帧序号从0开始
+		m_nextSeq = 0;
+		m_outOfOrder.clear();
+		m_unacked = 0;
+		m_ackDueMs = -1;
+		reply(SIM_HEAD_SUCC, cmdType, code);
+		break;
+	default:
+		if (code == Sim_Ctrl_ResetPos || (code >= Sim_Ctrl_XAxisLMove && code <= Sim_Ctrl_AxisRelMove))
+		{
+			handleMove(cmdType, code, payload, len);
+		}
+		else
+		{
+			//设置参数、心跳、暂停/继续、打印位置：直接应答成功
+			reply(SIM_HEAD_SUCC, cmdType, code);
+		}
+		break;
+	}
+}
+
+void SimSession::handleMove(ushort cmdType, ushort code, const uchar* payload, int len)
+{
+	qint64 nowMs = m_clock.elapsed();
+	qint64 target[3];
+	m_axis.position(nowMs, target);
+
+	if (code == Sim_Ctrl_ResetPos)
+	{
+		//回原点
+		target[0] = target[1] = target[2] = 0;
+	}
+	else if (code == Sim_Ctrl_AxisAbsMove || code == Sim_Ctrl_AxisRelMove)
+	{
+		if (len < 12)
+		{
+			reply(SIM_HEAD_ERR, cmdType, code);
+			return;
+		}
+		for (int i = 0; i < 3; i++)
+		{
+			qint64 value = readInt32(payload + i * 4);
+			target[i] = (code == Sim_Ctrl_AxisAbsMove) ? value : target[i] + value;
+		}
+	}
+	else
+	{
+		//点动：0x3101/0x3102为X轴负/正向，依次为Y、Z；数据区带12字节位置时取该轴的距离
+		int axis = (code - Sim_Ctrl_XAxisLMove) / 2;
+		bool positive = ((code - Sim_Ctrl_XAxisLMove) % 2) == 1;
+		qint64 step = SIM_DEFAULT_JOG_STEP;
+		if (len >= 12)
+		{
+			step = qAbs<qint64>(readInt32(payload + axis * 4));
+		}
+		target[axis] += positive ? step : -step;
+	}
+
+	m_stats->moves++;
+	qint64 endMs = m_axis.moveTo(nowMs, target);
+	reply(SIM_HEAD_SUCC, cmdType, code, QByteArray(), m_config.ackOnComplete ? endMs - nowMs : 0);
+}
+
+void SimSession::handleImageFrame(const uchar* payload, int len)
+{
+	if (len < 4)
+	{
+		m_stats->badFrames++;
+		reply(SIM_HEAD_ERR, Sim_PrintCommCmd, Sim_Print_PeriodData);
+		return;
+	}
+
+	quint32 seq = qFromLittleEndian<quint32>(payload);
+	if (seq == 0 && m_nextSeq != 0)
+	{
+		//上位机开始新的图像任务
+		m_nextSeq = 0;
+		m_outOfOrder.clear();
+		m_unacked = 0;
+	}
+
+	if (seq < m_nextSeq || m_outOfOrder.contains(seq))
+	{
+		//确认丢失或超时重发，重新确认已收到的位置
+		m_stats->duplicates++;
+		if (m_nextSeq > 0)
+		{
+			replyAck(m_nextSeq - 1);
+		}
+		return;
+	}
+
+	if (seq != m_nextSeq)
+	{
+		//前面有帧缺失（被否认），先缓存，等缺失帧重发后一起确认
+		if (seq - m_nextSeq < SIM_OOO_WINDOW)
+		{
+			m_outOfOrder.insert(seq);
+			m_stats->outOfOrder++;
+		}
+		return;
+	}
+
+	//帧内有效数据长度（序号4 + 宽2 + 高2 + 类型1之后的2字节）
+	if (len >= 11)
+	{
+		m_stats->imageBytes += qFromLittleEndian<quint16>(payload + 9);
+	}
+	m_stats->imageFrames++;
+	m_nextSeq++;
+	m_unacked++;
+	while (!m_outOfOrder.isEmpty() && m_outOfOrder.remove(m_nextSeq))
+	{
+		m_nextSeq++;
+		m_unacked++;
+	}
+
+	if (m_ackDueMs < 0)
+	{
+		m_ackDueMs = m_clock.elapsed() + SIM_IDLE_ACK_MS;
+	}
+	flushImageAck();
+}
+
+void SimSession::flushImageAck()
+{
+	if (m_unacked <= 0)
+	{
+		m_ackDueMs = -1;
+		return;
+	}
+	if (m_unacked >= m_config.ackEvery || (m_ackDueMs >= 0 && m_clock.elapsed() >= m_ackDueMs))
+	{
+		replyAck(m_nextSeq - 1);
+		m_unacked = 0;
+		m_ackDueMs = -1;
+	}
+}
+
+void SimSession::replyAck(quint32 seq)
+{
+	m_stats->acks++;
+	QByteArray data(4, Qt::Uninitialized);
+	qToLittleEndian<quint32>(seq, reinterpret_cast<uchar*>(data.data()));
+	reply(SIM_HEAD_SUCC, Sim_PrintCommCmd, Sim_Print_PeriodData, data);
+}
+
+void SimSession::reply(ushort head, ushort cmdType, ushort code, const QByteArray& data /*= QByteArray()*/, qint64 extraDelayMs /*= 0*/)
+{
+	int len = data.size();
+	QByteArray frame(len + SIM_FRAME_OVERHEAD, Qt::Uninitialized);
+	uchar* p = reinterpret_cast<uchar*>(frame.data());
+
+	//响应各字段小端
+	qToLittleEndian<quint16>(head, p);
+	qToLittleEndian<quint16>(cmdType, p + 2);
+	qToLittleEndian<quint16>(code, p + 4);
+	qToLittleEndian<quint16>(static_cast<quint16>(len), p + 6);
+	if (len > 0)
+	{
+		memcpy(p + 8, data.constData(), len);
+	}
+	ushort crc = Crc16::compute(p, len + 8);
+	if (chance(m_config.txCrcErrorRate))
+	{
+		crc ^= 0x0001;
+	}
+	p[len + 8] = static_cast<uchar>(crc >> 8);
+	p[len + 9] = static_cast<uchar>(crc & 0xFF);
+
+	qint64 delay = m_config.latencyMs + extraDelayMs;
+	if (m_config.jitterMs > 0)
+	{
+		delay += std::uniform_int_distribution<int>(0, m_config.jitterMs)(m_rng);
+	}
+	if (chance(m_config.reorderRate))
+	{
+		delay += m_config.reorderDelayMs;
+	}
+	m_outbox.emplace(m_clock.elapsed() + delay, frame);
+}
+
+void SimSession::flushOutbox()
+{
+	if (m_outbox.empty())
+	{
+		return;
+	}
+
+	//到期的响应合并为一次写出
+	qint64 nowMs = m_clock.elapsed();
+	QByteArray out;
+	auto it = m_outbox.begin();
+	while (it != m_outbox.end() && it->first <= nowMs)
+	{
+		out.append(it->second);
+		m_stats->txFrames++;
+		if (m_config.verbose)
+		{
+			printf("[%s] tx %s\n", qPrintable(m_peer), it->second.toHex(' ').constData());
+		}
+		it = m_outbox.erase(it);
+	}
+	if (!out.isEmpty())
+	{
+		m_stats->txBytes += out.size();
+		m_socket->write(out);
+	}
+}
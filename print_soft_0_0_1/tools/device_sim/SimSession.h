@@ -0,0 +1,115 @@
+﻿#pragma once
+#include <QtCore/QtCore>
+#include <QtNetwork/QTcpSocket>
+#include <map>
+#include <random>
+#include "SimConfig.h"
+#include "FrameDecoder.h"
+
+/**
+*  @author
+*  @class       SimAxisModel
+*  @brief       三轴匀速运动模型：各轴同时以相同速度走向目标，按时间插值当前位置
+*/
+class SimAxisModel
+{
+public:
+	explicit SimAxisModel(int speed);
+
+	/**
+	*  @brief       从当前位置开始运动到目标位置（打断尚未完成的运动）
+	*  @param[in]    nowMs: 当前时间  target: 目标位置（微米）
+	*  @param[out]
+	*  @return       运动完成时刻
+	*/
+	qint64 moveTo(qint64 nowMs, const qint64 target[3]);
+
+	//nowMs时刻的位置（微米）
+	void position(qint64 nowMs, qint64 pos[3]) const;
+
+	bool isMoving(qint64 nowMs) const { return nowMs < m_endMs; }
+
+private:
+	int m_speed;
+	qint64 m_startMs = 0;
+	qint64 m_endMs = 0;
+	qint64 m_from[3] = { 0, 0, 0 };
+	qint64 m_to[3] = { 0, 0, 0 };
+};
+
+/**
+*  @author
+*  @class       SimSession
+*  @brief       一个上位机连接：解析AABB请求，按FunCode生成AACC/AADD响应
+*
+*  请求的命令类型/命令字按上位机组包方式（高字节在前）解析，
+*  响应按上位机解析方式（小端）填写；crc16高字节在前。
+*  响应先进入按到期时间排序的发件箱，由定时器统一写出，用于模拟延迟和乱序；
+*  带宽限制通过控制读取速度实现，超出部分留在内核缓冲区，由TCP流控反压到上位机。
+*/
+class SimSession : public QObject
+{
+	Q_OBJECT
+
+public:
+	SimSession(QTcpSocket* socket, const SimConfig& config, SimStats* stats, quint32 seed, QObject* parent = nullptr);
+	~SimSession();
+
+	QString peerName() const { return m_peer; }
+
+signals:
+	void sigClosed(SimSession* session);
+
+private slots:
+	void onReadyRead();
+	void onDisconnected();
+	void onTick();
+
+private:
+	void handleFrame(const FrameView& frame);
+	void handleImageFrame(const uchar* payload, int len);
+	void handleMove(ushort cmdType, ushort code, const uchar* payload, int len);
+
+	//按概率抽样
+	bool chance(double rate);
+
+	/**
+	*  @brief       组一帧响应并放入发件箱
+	*  @param[in]    head: 0xAACC/0xAADD  extraDelayMs: 在正常延迟之外的附加延迟
+	*  @param[out]
+	*  @return
+	*/
+	void reply(ushort head, ushort cmdType, ushort code, const QByteArray& data = QByteArray(), qint64 extraDelayMs = 0);
+	void replyAck(quint32 seq);
+
+	void flushOutbox();
+	//攒够一批或空闲到期时发出图像累计确认
+	void flushImageAck();
+	void scheduleTimer();
+
+private:
+	QTcpSocket* m_socket;
+	const SimConfig& m_config;
+	SimStats* m_stats;
+	QString m_peer;
+	FrameDecoder m_decoder;
+	QElapsedTimer m_clock;
+	QTimer* m_timer;
+	std::mt19937 m_rng;
+
+	std::multimap<qint64, QByteArray> m_outbox;		//到期时间 -> 响应帧，同一时刻按放入顺序
+	QByteArray m_readBuf;
+
+	//带宽限制令牌桶
+	double m_tokens = 0;
+	qint64 m_lastRefillMs = 0;
+	bool m_throttled = false;
+
+	//图像接收状态
+	quint32 m_nextSeq = 0;				//下一个期望的帧序号
+	QSet<quint32> m_outOfOrder;			//已收到但尚不连续的帧
+	int m_unacked = 0;					//已连续收到但未确认的帧数
+	qint64 m_ackDueMs = -1;				//空闲确认到期时间，-1表示无待确认
+
+	SimAxisModel m_axis;
+};
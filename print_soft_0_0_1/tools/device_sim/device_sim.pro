@@ -0,0 +1,53 @@
+#-------------------------------------------------
+# 下位机回环模拟器（控制台程序），性能测试和长时间运行测试时代替真实设备
+# 用法: device_sim [--port 5555] [--latency ms] [--bandwidth KiB/s] [--reorder p] [--crc-error p] ...
+#-------------------------------------------------
+
+QT += core network
+QT -= gui
+
+TARGET = device_sim
+TEMPLATE = app
+CONFIG += console c++17
+CONFIG -= app_bundle
+
+SDK_SRC = $$PWD/../../src/sdk
+
+# 帧解码和crc直接复用SDK源文件
+# 包含路径
+INCLUDEPATH += $$PWD \
+               $$SDK_SRC/comm \
+               $$SDK_SRC/protocol
+
+# 头文件
+HEADERS += \
+    SimConfig.h \
+    SimSession.h \
+    DeviceSimulator.h \
+    $$SDK_SRC/comm/Crc16.h \
+    $$SDK_SRC/protocol/FrameDecoder.h
+
+# 源文件
+SOURCES += \
+    main.cpp \
+    SimSession.cpp \
+    DeviceSimulator.cpp \
+    $$SDK_SRC/comm/Crc16.cpp \
+    $$SDK_SRC/protocol/FrameDecoder.cpp
+
+# 输出目录
+CONFIG(release, debug|release) {
+    DESTDIR = $$PWD/bin/release
+    OBJECTS_DIR = $$PWD/build/release/obj
+    MOC_DIR = $$PWD/build/release/moc
+}
+
+CONFIG(debug, debug|release) {
+    DESTDIR = $$PWD/bin/debug
+    OBJECTS_DIR = $$PWD/build/debug/obj
+    MOC_DIR = $$PWD/build/debug/moc
+}
+
+win32 {
+    QMAKE_CXXFLAGS += /utf-8
+}
@@ -0,0 +1,70 @@
+﻿/**
+ * @file main.cpp
+ * @brief 下位机回环模拟器入口
+ * @details 在本机模拟树莓派运动控制器，上位机连接 127.0.0.1:5555 即可，不需要真实设备。
+ *          用法示例: device_sim --latency 2 --jitter 1 --bandwidth 4096 --crc-error 0.001 --stats 1
+ */
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <cstdio>
+#include "DeviceSimulator.h"
+
+int main(int argc, char *argv[])
+{
+	QCoreApplication app(argc, argv);
+	QCoreApplication::setApplicationName("device_sim");
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription("Loopback simulator of the print motion controller (ProtocolPrint framing)");
+	parser.addHelpOption();
+
+	QCommandLineOption portOpt("port", "Listen port (0 = any free port).", "port", QString::number(SIM_DEFAULT_PORT));
+	QCommandLineOption latencyOpt("latency", "Fixed response latency in ms.", "ms", "0");
+	QCommandLineOption jitterOpt("jitter", "Extra random response latency in ms (0..n).", "ms", "0");
+	QCommandLineOption bandwidthOpt("bandwidth", "Host-to-device bandwidth limit in KiB/s (0 = unlimited).", "KiB/s", "0");
+	QCommandLineOption reorderOpt("reorder", "Probability that a response is held back and overtaken by later ones.", "rate", "0");
+	QCommandLineOption reorderDelayOpt("reorder-delay", "How long a reordered response is held back, in ms.", "ms", QString::number(SIM_DEFAULT_REORDER_DELAY_MS));
+	QCommandLineOption crcOpt("crc-error", "Probability that a received frame is treated as a CRC error (NAK/AADD).", "rate", "0");
+	QCommandLineOption txCrcOpt("tx-crc-error", "Probability that a response is sent with a corrupted CRC.", "rate", "0");
+	QCommandLineOption speedOpt("axis-speed", "Axis speed in um/s.", "um/s", QString::number(SIM_DEFAULT_AXIS_SPEED));
+	QCommandLineOption ackEveryOpt("ack-every", "Acknowledge image data every n in-order frames.", "n", QString::number(SIM_DEFAULT_ACK_EVERY));
+	QCommandLineOption ackCompleteOpt("ack-on-complete", "Acknowledge move commands when the motion completes instead of on receipt.");
+	QCommandLineOption seedOpt("seed", "Random seed for jitter/reorder/error injection.", "seed", "1");
+	QCommandLineOption statsOpt("stats", "Print throughput and counters every n seconds (0 = off).", "s", "0");
+	QCommandLineOption verboseOpt("verbose", "Print every received request and sent response.");
+	parser.addOptions({ portOpt, latencyOpt, jitterOpt, bandwidthOpt, reorderOpt, reorderDelayOpt, crcOpt, txCrcOpt,
+		speedOpt, ackEveryOpt, ackCompleteOpt, seedOpt, statsOpt, verboseOpt });
+	parser.process(app);
+
+	SimConfig config;
+	config.port = static_cast<quint16>(parser.value(portOpt).toUInt());
+	config.latencyMs = qMax(0, parser.value(latencyOpt).toInt());
+	config.jitterMs = qMax(0, parser.value(jitterOpt).toInt());
+	config.bandwidth = qMax<qint64>(0, parser.value(bandwidthOpt).toLongLong()) * 1024;
+	config.reorderRate = parser.value(reorderOpt).toDouble();
+	config.reorderDelayMs = qMax(0, parser.value(reorderDelayOpt).toInt());
+	config.rxCrcErrorRate = parser.value(crcOpt).toDouble();
+	config.txCrcErrorRate = parser.value(txCrcOpt).toDouble();
+	config.axisSpeed = qMax(1, parser.value(speedOpt).toInt());
+	config.ackEvery = qMax(1, parser.value(ackEveryOpt).toInt());
+	config.ackOnComplete = parser.isSet(ackCompleteOpt);
+	config.seed = parser.value(seedOpt).toUInt();
+	config.verbose = parser.isSet(verboseOpt);
+
+	DeviceSimulator simulator(config);
+	if (!simulator.start())
+	{
+		fprintf(stderr, "cannot listen on port %u: %s\n", config.port, qPrintable(simulator.errorString()));
+		return 1;
+	}
+	simulator.setStatsInterval(parser.value(statsOpt).toInt() * 1000);
+
+	printf("device_sim listening on port %u (latency %d+%d ms, bandwidth %s, reorder %.4f, crc error %.4f/%.4f)\n",
+		simulator.port(), config.latencyMs, config.jitterMs,
+		config.bandwidth > 0 ? qPrintable(QString("%1 KiB/s").arg(config.bandwidth / 1024)) : "unlimited",
+		config.reorderRate, config.rxCrcErrorRate, config.txCrcErrorRate);
+	fflush(stdout);
+
+	return app.exec();
+}
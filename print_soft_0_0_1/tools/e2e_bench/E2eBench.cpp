@@ -0,0 +1,664 @@
+﻿#include "E2eBench.h"
+#include "DeviceSimulator.h"
+#include "motionControlSDK.h"
+#include "PrintDeviceSDK_API.h"
+#include "ProtocolPrint.h"
+#include "FrameDecoder.h"
+#include <deque>
+#include <cstdio>
+
+//测试文件写入块大小
+#define E2E_FILE_CHUNK (1024 * 1024)
+
+namespace
+{
+	typedef std::function<void(int, int&, QByteArray&)> MakeCommand;
+
+	/**
+	*  @brief       运行事件循环直到done为真或超时
+	*  @param[in]
+	*  @param[out]
+	*  @return       done
+	*/
+	bool waitFor(QEventLoop& loop, const bool& done, int timeoutMs)
+	{
+		if (done)
+		{
+			return true;
+		}
+		QTimer timer;
+		timer.setSingleShot(true);
+		QObject::connect(&timer, &QTimer::timeout, &loop, &QEventLoop::quit);
+		timer.start(timeoutMs);
+		loop.exec();
+		return done;
+	}
+
+	//三轴位置数据区（各4字节小端，微米）
+	QByteArray positionData(qint32 x, qint32 y, qint32 z)
+	{
+		QByteArray data(12, Qt::Uninitialized);
+		uchar* p = reinterpret_cast<uchar*>(data.data());
+		qToLittleEndian<qint32>(x, p);
+		qToLittleEndian<qint32>(y, p + 4);
+		qToLittleEndian<qint32>(z, p + 8);
+		return data;
+	}
+
+	double perSecond(double count, qint64 ns)
+	{
+		return ns > 0 ? count * 1e9 / ns : 0;
+	}
+
+	/**
+	*  @author
+	*  @class       CommandStream
+	*  @brief       经MC_SendCmdAsync发送一串命令，在途数不超过window，应答回调中补发
+	*
+	*  回调持有本对象的shared_ptr，场景超时返回后迟到的应答不会访问已释放的状态。
+	*/
+	class CommandStream : public std::enable_shared_from_this<CommandStream>
+	{
+	public:
+		CommandStream(motionControlSDK& sdk, int count, int window, MakeCommand makeCmd)
+			:m_sdk(sdk)
+			, m_count(count)
+			, m_window(qMax(1, window))
+			, m_makeCmd(std::move(makeCmd))
+		{
+			m_latency.reserve(count);
+		}
+
+		void start()
+		{
+			m_clock.start();
+			pump();
+		}
+
+		//场景结束（含超时），之后的应答只计数不再发送
+		void stop()
+		{
+			if (!isDone())
+			{
+				m_elapsedNs = m_clock.nsecsElapsed();
+			}
+			m_stopped = true;
+			onDone = nullptr;
+		}
+
+		bool isDone() const { return m_completed >= m_count; }
+
+		QJsonObject toJson(const QString& name) const
+		{
+			QJsonObject obj;
+			obj["name"] = name;
+			obj["api"] = "qt";
+			obj["commands"] = m_completed;
+			obj["failed"] = m_failed;
+			obj["window"] = m_window;
+			obj["elapsed_ms"] = m_elapsedNs / 1e6;
+			obj["commands_per_sec"] = perSecond(m_completed, m_elapsedNs);
+			obj["latency_us"] = m_latency.toJson();
+			if (!isDone())
+			{
+				obj["error"] = QString("timeout after %1/%2 replies").arg(m_completed).arg(m_count);
+			}
+			return obj;
+		}
+
+		std::function<void()> onDone;
+
+	private:
+		void pump()
+		{
+			//发送失败时回调在MC_SendCmdAsync内同步调用，不重入
+			if (m_pumping || m_stopped)
+			{
+				return;
+			}
+			m_pumping = true;
+			std::shared_ptr<CommandStream> self = shared_from_this();
+			while (m_sent < m_count && m_sent - m_completed < m_window)
+			{
+				int funCode = 0;
+				QByteArray data;
+				m_makeCmd(m_sent, funCode, data);
+				qint64 t0 = m_clock.nsecsElapsed();
+				m_sent++;
+				m_sdk.MC_SendCmdAsync(funCode, data, [self, t0](const CommandReply& reply) {
+					self->onReply(reply, t0);
+				}, E2E_REPLY_TIMEOUT_MS);
+			}
+			m_pumping = false;
+		}
+
+		void onReply(const CommandReply& reply, qint64 t0)
+		{
+			if (m_stopped)
+			{
+				return;
+			}
+			m_completed++;
+			if (reply.ok)
+			{
+				m_latency.add(m_clock.nsecsElapsed() - t0);
+			}
+			else
+			{
+				m_failed++;
+			}
+
+			if (isDone())
+			{
+				m_elapsedNs = m_clock.nsecsElapsed();
+				if (onDone)
+				{
+					onDone();
+				}
+				return;
+			}
+			pump();
+		}
+
+	private:
+		motionControlSDK& m_sdk;
+		int m_count;
+		int m_window;
+		MakeCommand m_makeCmd;
+		LatencyRecorder m_latency;
+		QElapsedTimer m_clock;
+		qint64 m_elapsedNs = 0;
+		int m_sent = 0;
+		int m_completed = 0;
+		int m_failed = 0;
+		bool m_pumping = false;
+		bool m_stopped = false;
+	};
+
+	/**  C接口场景状态：应答在socket线程的报文事件中匹配  **/
+	struct CApiState
+	{
+		QMutex mutex;
+		std::deque<qint64> inflight;		//已发送未应答命令的发送时刻，设备按序应答
+		LatencyRecorder latency;
+		QElapsedTimer clock;
+		FrameDecoder decoder;
+		int completed = 0;
+		int failed = 0;
+		bool connected = false;
+		QObject* context = nullptr;			//应用线程中的接收对象
+		std::function<void()> wake;			//在应用线程中继续发送
+	};
+
+	CApiState* s_capi = nullptr;
+
+	void capiEventCallback(const SdkEvent* event)
+	{
+		CApiState* state = s_capi;
+		if (!state)
+		{
+			return;
+		}
+
+		if (event->type == EVENT_TYPE_RECV_MSG)
+		{
+			QMutexLocker locker(&state->mutex);
+			state->decoder.feed(reinterpret_cast<const char*>(event->data), event->dataLen);
+		}
+		else if (event->type == EVENT_TYPE_GENERAL && event->message && strstr(event->message, "connected_2_dev"))
+		{
+			QMutexLocker locker(&state->mutex);
+			state->connected = true;
+		}
+		else
+		{
+			return;
+		}
+		QMetaObject::invokeMethod(state->context, state->wake, Qt::QueuedConnection);
+	}
+}
+
+QStringList E2eBench::allScenarios()
+{
+	return QStringList() << "jog_storm" << "abs_move_seq" << "image_upload" << "mixed" << "capi_jog";
+}
+
+E2eBench::E2eBench(const E2eOptions& options)
+	:m_opt(options)
+{
+}
+
+E2eBench::~E2eBench()
+{
+	stopSimulator();
+}
+
+bool E2eBench::startSimulator()
+{
+	m_simThread = new QThread();
+	m_simThread->setObjectName("device_sim");
+	m_sim = new DeviceSimulator(m_opt.sim);
+	m_sim->moveToThread(m_simThread);
+	QObject::connect(m_simThread, &QThread::finished, m_sim, &QObject::deleteLater);
+	m_simThread->start();
+
+	bool ok = false;
+	quint16 port = 0;
+	DeviceSimulator* sim = m_sim;
+	QMetaObject::invokeMethod(sim, [sim, &ok, &port]() {
+		ok = sim->start();
+		port = sim->port();
+	}, Qt::BlockingQueuedConnection);
+	if (!ok)
+	{
+		fprintf(stderr, "simulator cannot listen: %s\n", qPrintable(m_sim->errorString()));
+		stopSimulator();
+		return false;
+	}
+
+	m_host = "127.0.0.1";
+	m_port = port;
+	return true;
+}
+
+void E2eBench::stopSimulator()
+{
+	if (!m_simThread)
+	{
+		return;
+	}
+	m_simThread->quit();
+	m_simThread->wait();
+	delete m_simThread;
+	m_simThread = nullptr;
+	m_sim = nullptr;
+}
+
+QJsonObject E2eBench::simulatorJson() const
+{
+	SimStats stats;
+	DeviceSimulator* sim = m_sim;
+	QMetaObject::invokeMethod(sim, [sim, &stats]() {
+		stats = sim->stats();
+	}, Qt::BlockingQueuedConnection);
+
+	const SimConfig& cfg = m_opt.sim;
+	QJsonObject obj;
+	obj["latency_ms"] = cfg.latencyMs;
+	obj["jitter_ms"] = cfg.jitterMs;
+	obj["bandwidth"] = cfg.bandwidth;
+	obj["reorder_rate"] = cfg.reorderRate;
+	obj["crc_error_rate"] = cfg.rxCrcErrorRate;
+	obj["axis_speed"] = cfg.axisSpeed;
+	obj["ack_every"] = cfg.ackEvery;
+	obj["ack_on_complete"] = cfg.ackOnComplete;
+	obj["rx_frames"] = static_cast<qint64>(stats.rxFrames);
+	obj["rx_bytes"] = static_cast<qint64>(stats.rxBytes);
+	obj["image_frames"] = static_cast<qint64>(stats.imageFrames);
+	obj["acks"] = static_cast<qint64>(stats.acks);
+	obj["naks"] = static_cast<qint64>(stats.naks);
+	obj["duplicates"] = static_cast<qint64>(stats.duplicates);
+	obj["crc_errors"] = static_cast<qint64>(stats.crcErrors);
+	return obj;
+}
+
+QJsonObject E2eBench::run()
+{
+	if (m_opt.host.isEmpty())
+	{
+		if (!startSimulator())
+		{
+			return QJsonObject();
+		}
+	}
+	else
+	{
+		m_host = m_opt.host;
+		m_port = m_opt.port;
+	}
+
+	QJsonObject result;
+	result["benchmark"] = "e2e_bench";
+	result["transport"] = (TcpClient::defaultBackend() == Transport_Epoll) ? "epoll" : "qt";
+	result["device"] = m_sim ? QString("bundled") : QString("%1:%2").arg(m_host).arg(m_port);
+	result["timestamp"] = QDateTime::currentDateTime().toString(Qt::ISODate);
+
+	QJsonArray scenarios;
+	QStringList qtScenarios = m_opt.scenarios;
+	qtScenarios.removeAll("capi_jog");
+	if (!qtScenarios.isEmpty())
+	{
+		motionControlSDK sdk;
+		if (!connectSdk(sdk))
+		{
+			QJsonObject failed;
+			failed["name"] = "connect";
+			failed["error"] = QString("cannot connect to %1:%2").arg(m_host).arg(m_port);
+			scenarios.append(failed);
+		}
+		else
+		{
+			for (const QString& name : qtScenarios)
+			{
+				fprintf(stderr, "running %s...\n", qPrintable(name));
+				if (name == "jog_storm")
+				{
+					//X轴左右交替点动10微米
+					scenarios.append(runCommands(sdk, name, m_opt.jogCount, m_opt.window, [](int i, int& funCode, QByteArray& data) {
+						funCode = (i % 2) ? ProtocolPrint::Ctrl_XAxisLMove : ProtocolPrint::Ctrl_XAxisRMove;
+						data = positionData(10, 0, 0);
+					}));
+				}
+				else if (name == "abs_move_seq")
+				{
+					//在三轴10mm立方体的8个顶点之间依次移动，逐条等待应答
+					scenarios.append(runCommands(sdk, name, m_opt.moveCount, 1, [](int i, int& funCode, QByteArray& data) {
+						funCode = ProtocolPrint::Ctrl_AxisAbsMove;
+						int corner = i % 8;
+						data = positionData((corner & 1) ? 10000 : 0, (corner & 2) ? 10000 : 0, (corner & 4) ? 10000 : 0);
+					}));
+				}
+				else if (name == "image_upload")
+				{
+					scenarios.append(runImageUpload(sdk, name, m_opt.imageMB, 0));
+				}
+				else if (name == "mixed")
+				{
+					scenarios.append(runImageUpload(sdk, name, m_opt.mixedMB, m_opt.mixedCommands));
+				}
+			}
+		}
+	}
+
+	if (m_opt.scenarios.contains("capi_jog"))
+	{
+		fprintf(stderr, "running capi_jog...\n");
+		scenarios.append(runCApiJog());
+	}
+	result["scenarios"] = scenarios;
+
+	if (m_sim)
+	{
+		result["simulator"] = simulatorJson();
+		stopSimulator();
+	}
+	return result;
+}
+
+bool E2eBench::connectSdk(motionControlSDK& sdk)
+{
+	if (!sdk.MC_Init())
+	{
+		return false;
+	}
+
+	bool done = false;
+	QEventLoop loop;
+	QObject::connect(&sdk, &motionControlSDK::connected, &loop, [&]() {
+		done = true;
+		loop.quit();
+	});
+	if (!sdk.MC_Connect2Dev(m_host, m_port))
+	{
+		return false;
+	}
+	return waitFor(loop, done, E2E_CONNECT_TIMEOUT_MS);
+}
+
+QJsonObject E2eBench::runCommands(motionControlSDK& sdk, const QString& name, int count, int window,
+	std::function<void(int, int&, QByteArray&)> makeCmd)
+{
+	bool done = false;
+	QEventLoop loop;
+	auto stream = std::make_shared<CommandStream>(sdk, count, window, std::move(makeCmd));
+	stream->onDone = [&]() {
+		done = true;
+		loop.quit();
+	};
+	stream->start();
+	waitFor(loop, done, m_opt.timeoutS * 1000);
+	stream->stop();
+	return stream->toJson(name);
+}
+
+QJsonObject E2eBench::runImageUpload(motionControlSDK& sdk, const QString& name, int megabytes, int commands)
+{
+	QJsonObject obj;
+	obj["name"] = name;
+	obj["api"] = "qt";
+
+	QString path = imageFile(megabytes);
+	if (path.isEmpty())
+	{
+		obj["error"] = "cannot create test image file";
+		return obj;
+	}
+
+	bool imageDone = false;
+	bool imageOk = false;
+	QString imageMessage;
+	qint64 imageNs = 0;
+	bool done = false;
+	QElapsedTimer clock;
+	std::shared_ptr<CommandStream> stream;
+	QEventLoop loop;
+
+	auto checkDone = [&]() {
+		if (imageDone && (!stream || stream->isDone()))
+		{
+			done = true;
+			loop.quit();
+		}
+	};
+
+	//SDK以事件报告图像任务结束：成功为"Image data sent..."，失败为"Image transfer aborted..."
+	QObject::connect(&sdk, &motionControlSDK::MC_SigInfoMsg, &loop, [&](const QString& message) {
+		if (!imageDone && message.startsWith("Image data sent"))
+		{
+			imageNs = clock.nsecsElapsed();
+			imageDone = true;
+			imageOk = true;
+			imageMessage = message;
+			checkDone();
+		}
+	});
+	QObject::connect(&sdk, &motionControlSDK::MC_SigErrOccurred, &loop, [&](int, const QString& message) {
+		if (!imageDone && message.startsWith("Image transfer"))
+		{
+			imageNs = clock.nsecsElapsed();
+			imageDone = true;
+			imageMessage = message;
+			checkDone();
+		}
+	});
+
+	clock.start();
+	if (!sdk.MC_loadPrintData(path, IMAGE_TRANSFER_RAW))
+	{
+		obj["error"] = "MC_loadPrintData failed";
+		return obj;
+	}
+
+	if (commands > 0)
+	{
+		//图像上传期间逐条发送点动，测控制命令在大数据量下的往返延迟
+		stream = std::make_shared<CommandStream>(sdk, commands, 1, [](int i, int& funCode, QByteArray& data) {
+			funCode = (i % 2) ? ProtocolPrint::Ctrl_YAxisLMove : ProtocolPrint::Ctrl_YAxisRMove;
+			data = positionData(0, 10, 0);
+		});
+		stream->onDone = checkDone;
+		stream->start();
+	}
+
+	waitFor(loop, done, m_opt.timeoutS * 1000);
+	if (!imageDone)
+	{
+		imageNs = clock.nsecsElapsed();
+		imageMessage = "timeout";
+	}
+
+	qint64 bytes = static_cast<qint64>(megabytes) * 1024 * 1024;
+	obj["ok"] = imageOk;
+	obj["bytes"] = bytes;
+	obj["elapsed_ms"] = imageNs / 1e6;
+	obj["mb_per_sec"] = imageOk ? perSecond(bytes / (1024.0 * 1024.0), imageNs) : 0.0;
+	obj["message"] = imageMessage;
+	if (stream)
+	{
+		stream->stop();
+		obj["control"] = stream->toJson("control");
+	}
+	if (!imageOk)
+	{
+		obj["error"] = imageMessage;
+	}
+	return obj;
+}
+
+QJsonObject E2eBench::runCApiJog()
+{
+	QJsonObject obj;
+	obj["name"] = "capi_jog";
+	obj["api"] = "c";
+
+	if (InitSDK("./") != 0)
+	{
+		obj["error"] = "InitSDK failed";
+		return obj;
+	}
+
+	int count = m_opt.capiCount;
+	int window = qMax(1, m_opt.window);
+	int sent = 0;
+	bool connectedSeen = false;
+	bool done = false;
+	bool pumping = false;
+	CApiState state;
+	QEventLoop loop;
+	state.latency.reserve(count);
+	state.context = &loop;
+	state.decoder.setFrameHandler([&state](const FrameView& frame) {
+		//只匹配点动命令的应答，忽略心跳等其他报文
+		ushort code = static_cast<ushort>((frame.data[5] << 8) | frame.data[4]);
+		if (code != ProtocolPrint::Ctrl_XAxisLMove && code != ProtocolPrint::Ctrl_XAxisRMove)
+		{
+			return;
+		}
+		if (state.inflight.empty())
+		{
+			return;
+		}
+		qint64 t0 = state.inflight.front();
+		state.inflight.pop_front();
+		state.completed++;
+		if (frame.head == 0xAACC)
+		{
+			state.latency.add(state.clock.nsecsElapsed() - t0);
+		}
+		else
+		{
+			state.failed++;
+		}
+	});
+	state.wake = [&]() {
+		if (pumping)
+		{
+			return;
+		}
+		pumping = true;
+		QMutexLocker locker(&state.mutex);
+		if (!connectedSeen)
+		{
+			if (!state.connected)
+			{
+				pumping = false;
+				return;
+			}
+			//连接建立后开始计时并发送
+			connectedSeen = true;
+			state.clock.start();
+		}
+		while (sent < count && sent - state.completed < window)
+		{
+			state.inflight.push_back(state.clock.nsecsElapsed());
+			sent++;
+			locker.unlock();
+			int ret = MoveBy((sent % 2) ? 0.01 : -0.01, 0, 0, 0);
+			locker.relock();
+			if (ret != 0)
+			{
+				state.inflight.pop_back();
+				state.completed++;
+				state.failed++;
+			}
+		}
+		if (state.completed >= count)
+		{
+			done = true;
+			loop.quit();
+		}
+		pumping = false;
+	};
+
+	s_capi = &state;
+	RegisterEventCallbackEx(&capiEventCallback, SDK_EVENT_MASK_DEFAULT | SDK_EVENT_MASK(EVENT_TYPE_RECV_MSG));
+	ConnectByTCP(m_host.toUtf8().constData(), m_port);
+
+	bool finished = waitFor(loop, done, m_opt.timeoutS * 1000);
+	qint64 elapsedNs = state.clock.isValid() ? state.clock.nsecsElapsed() : 0;
+
+	//注销回调：RegisterEventCallbackEx与回调共用同一把锁，返回后不会再有回调访问state
+	RegisterEventCallbackEx(nullptr, 0);
+	s_capi = nullptr;
+	Disconnect();
+	ReleaseSDK();
+
+	QMutexLocker locker(&state.mutex);
+	obj["commands"] = state.completed;
+	obj["failed"] = state.failed;
+	obj["window"] = window;
+	obj["elapsed_ms"] = elapsedNs / 1e6;
+	obj["commands_per_sec"] = perSecond(state.completed, elapsedNs);
+	obj["latency_us"] = state.latency.toJson();
+	if (!finished)
+	{
+		obj["error"] = connectedSeen ? QString("timeout after %1/%2 replies").arg(state.completed).arg(count)
+			: QString("cannot connect to %1:%2").arg(m_host).arg(m_port);
+	}
+	return obj;
+}
+
+QString E2eBench::imageFile(int megabytes)
+{
+	if (m_imageFile && m_imageFileMB == megabytes)
+	{
+		return m_imageFile->fileName();
+	}
+
+	m_imageFile.reset(new QTemporaryFile(QDir::tempPath() + "/e2e_bench_XXXXXX.raw"));
+	if (!m_imageFile->open())
+	{
+		m_imageFile.reset();
+		return QString();
+	}
+
+	//伪随机内容，避免下位机/链路上的任何压缩影响结果
+	QByteArray chunk(E2E_FILE_CHUNK, Qt::Uninitialized);
+	quint32 seed = 0x12345678;
+	for (int i = 0; i < chunk.size(); i++)
+	{
+		seed = seed * 1103515245 + 12345;
+		chunk[i] = static_cast<char>(seed >> 16);
+	}
+	for (int i = 0; i < megabytes; i++)
+	{
+		if (m_imageFile->write(chunk) != chunk.size())
+		{
+			m_imageFile.reset();
+			return QString();
+		}
+	}
+	m_imageFile->close();
+	m_imageFileMB = megabytes;
+	return m_imageFile->fileName();
+}
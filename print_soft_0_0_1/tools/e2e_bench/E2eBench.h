@@ -0,0 +1,102 @@
+﻿#pragma once
+#include <QtCore/QtCore>
+#include <functional>
+#include <memory>
+#include "SimConfig.h"
+#include "LatencyRecorder.h"
+
+class motionControlSDK;
+class DeviceSimulator;
+
+//各场景默认规模
+#define E2E_DEFAULT_JOG_COUNT 20000
+#define E2E_DEFAULT_WINDOW 64
+#define E2E_DEFAULT_MOVE_COUNT 2000
+#define E2E_DEFAULT_IMAGE_MB 100
+#define E2E_DEFAULT_MIXED_MB 20
+#define E2E_DEFAULT_MIXED_COMMANDS 2000
+#define E2E_DEFAULT_CAPI_COUNT 5000
+//单个场景的超时（秒）
+#define E2E_DEFAULT_TIMEOUT_S 300
+//连接超时（毫秒）
+#define E2E_CONNECT_TIMEOUT_MS 5000
+//单条命令应答超时（毫秒）
+#define E2E_REPLY_TIMEOUT_MS 5000
+
+/**  基准参数  **/
+struct E2eOptions
+{
+	QString host;					//为空时使用内置模拟器
+	quint16 port = 0;
+	SimConfig sim;					//内置模拟器参数
+	QStringList scenarios;
+	int jogCount = E2E_DEFAULT_JOG_COUNT;
+	int window = E2E_DEFAULT_WINDOW;		//流水线场景在途命令数上限
+	int moveCount = E2E_DEFAULT_MOVE_COUNT;
+	int imageMB = E2E_DEFAULT_IMAGE_MB;
+	int mixedMB = E2E_DEFAULT_MIXED_MB;
+	int mixedCommands = E2E_DEFAULT_MIXED_COMMANDS;
+	int capiCount = E2E_DEFAULT_CAPI_COUNT;
+	int timeoutS = E2E_DEFAULT_TIMEOUT_S;
+};
+
+/**
+*  @author
+*  @class       E2eBench
+*  @brief       端到端基准：经motionControlSDK/C接口连接回环设备，测命令往返延迟分位数和吞吐
+*
+*  场景：
+*    jog_storm     点动命令流水线发送（在途上限window），测命令/秒和往返延迟
+*    abs_move_seq  三轴绝对运动逐条发送，等上一条应答后再发下一条
+*    image_upload  RAW图像上传，测MB/s（全部帧被确认为止）
+*    mixed         图像上传同时逐条发送控制命令，测大数据量下控制命令的延迟
+*    capi_jog      经C接口(MoveBy)发送点动，按RECV_MSG报文事件匹配应答
+*  默认在工作线程中启动内置模拟器（device_sim同一实现），也可指定外部设备。
+*/
+class E2eBench
+{
+public:
+	static QStringList allScenarios();
+
+	explicit E2eBench(const E2eOptions& options);
+	~E2eBench();
+
+	/**
+	*  @brief       运行选中的场景
+	*  @param[in]
+	*  @param[out]
+	*  @return       JSON结果（含环境、各场景结果）；模拟器启动失败时返回空对象
+	*/
+	QJsonObject run();
+
+private:
+	bool startSimulator();
+	void stopSimulator();
+	QJsonObject simulatorJson() const;
+
+	bool connectSdk(motionControlSDK& sdk);
+
+	/**
+	*  @brief       以最多window条在途的方式发送count条命令，应答回调中记录往返耗时
+	*  @param[in]    makeCmd: 生成第i条命令的命令字和数据区
+	*  @param[out]
+	*  @return
+	*/
+	QJsonObject runCommands(motionControlSDK& sdk, const QString& name, int count, int window,
+		std::function<void(int, int&, QByteArray&)> makeCmd);
+
+	QJsonObject runImageUpload(motionControlSDK& sdk, const QString& name, int megabytes, int commands);
+	QJsonObject runCApiJog();
+
+	//创建指定大小的RAW测试文件（复用同一文件）
+	QString imageFile(int megabytes);
+
+private:
+	E2eOptions m_opt;
+	QThread* m_simThread = nullptr;
+	DeviceSimulator* m_sim = nullptr;
+	QString m_host;
+	quint16 m_port = 0;
+	std::unique_ptr<QTemporaryFile> m_imageFile;
+	int m_imageFileMB = 0;
+};
@@ -0,0 +1,60 @@
+﻿#pragma once
+#include <QtCore/QtCore>
+#include <algorithm>
+#include <cmath>
+
+/**
+*  @author
+*  @class       LatencyRecorder
+*  @brief       记录每次往返耗时（纳秒），结束后排序求分位数
+*/
+class LatencyRecorder
+{
+public:
+	void reserve(int count) { m_samples.reserve(count); }
+
+	void add(qint64 ns) { m_samples.append(ns); }
+
+	int count() const { return m_samples.size(); }
+
+	/**
+	*  @brief       输出 count/mean/p50/p99/p999/max，单位微秒
+	*  @param[in]
+	*  @param[out]
+	*  @return
+	*/
+	QJsonObject toJson() const
+	{
+		QJsonObject obj;
+		obj["count"] = m_samples.size();
+		if (m_samples.isEmpty())
+		{
+			return obj;
+		}
+
+		QVector<qint64> sorted = m_samples;
+		std::sort(sorted.begin(), sorted.end());
+		double sum = 0;
+		for (qint64 ns : sorted)
+		{
+			sum += ns;
+		}
+		obj["mean"] = sum / sorted.size() / 1000.0;
+		obj["p50"] = percentile(sorted, 0.50) / 1000.0;
+		obj["p99"] = percentile(sorted, 0.99) / 1000.0;
+		obj["p999"] = percentile(sorted, 0.999) / 1000.0;
+		obj["max"] = sorted.last() / 1000.0;
+		return obj;
+	}
+
+private:
+	//最近秩法
+	static qint64 percentile(const QVector<qint64>& sorted, double q)
+	{
+		int rank = static_cast<int>(std::ceil(q * sorted.size()));
+		return sorted.at(qBound(0, rank - 1, sorted.size() - 1));
+	}
+
+private:
+	QVector<qint64> m_samples;
+};
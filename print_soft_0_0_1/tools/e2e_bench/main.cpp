@@ -0,0 +1,112 @@
+﻿/**
+ * @file main.cpp
+ * @brief 端到端吞吐/延迟基准入口
+ * @details 用法: e2e_bench [--scenarios jog_storm,image_upload,...] [--device ip:port] [--output result.json]
+ *          默认在进程内启动回环模拟器；结果为JSON（延迟单位微秒），输出到标准输出或--output指定的文件。
+ */
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QFile>
+#include <QJsonDocument>
+#include <cstdio>
+#include "E2eBench.h"
+
+int main(int argc, char *argv[])
+{
+	QCoreApplication app(argc, argv);
+	QCoreApplication::setApplicationName("e2e_bench");
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription("End-to-end throughput/latency benchmark of motionControlSDK against a loopback device");
+	parser.addHelpOption();
+
+	QCommandLineOption scenariosOpt("scenarios", "Comma separated scenarios: " + E2eBench::allScenarios().join(',') + ".", "list",
+		E2eBench::allScenarios().join(','));
+	QCommandLineOption deviceOpt("device", "Use an external device/simulator at ip:port instead of the bundled simulator.", "ip:port");
+	QCommandLineOption outputOpt("output", "Write the JSON result to a file instead of stdout.", "file");
+	QCommandLineOption jogOpt("jog-count", "Commands in jog_storm.", "n", QString::number(E2E_DEFAULT_JOG_COUNT));
+	QCommandLineOption windowOpt("window", "Max commands in flight for jog_storm/capi_jog.", "n", QString::number(E2E_DEFAULT_WINDOW));
+	QCommandLineOption movesOpt("moves", "Moves in abs_move_seq.", "n", QString::number(E2E_DEFAULT_MOVE_COUNT));
+	QCommandLineOption imageOpt("image-mb", "Image size for image_upload in MiB.", "MiB", QString::number(E2E_DEFAULT_IMAGE_MB));
+	QCommandLineOption mixedMbOpt("mixed-mb", "Image size for mixed in MiB.", "MiB", QString::number(E2E_DEFAULT_MIXED_MB));
+	QCommandLineOption mixedCmdOpt("mixed-commands", "Control commands sent during the mixed upload.", "n", QString::number(E2E_DEFAULT_MIXED_COMMANDS));
+	QCommandLineOption capiOpt("capi-count", "Commands in capi_jog.", "n", QString::number(E2E_DEFAULT_CAPI_COUNT));
+	QCommandLineOption timeoutOpt("timeout", "Per-scenario timeout in seconds.", "s", QString::number(E2E_DEFAULT_TIMEOUT_S));
+	QCommandLineOption latencyOpt("sim-latency", "Bundled simulator: response latency in ms.", "ms", "0");
+	QCommandLineOption jitterOpt("sim-jitter", "Bundled simulator: response jitter in ms.", "ms", "0");
+	QCommandLineOption bandwidthOpt("sim-bandwidth", "Bundled simulator: bandwidth limit in KiB/s (0 = unlimited).", "KiB/s", "0");
+	QCommandLineOption reorderOpt("sim-reorder", "Bundled simulator: response reorder probability.", "rate", "0");
+	QCommandLineOption crcOpt("sim-crc-error", "Bundled simulator: received frame CRC error probability.", "rate", "0");
+	QCommandLineOption ackCompleteOpt("sim-ack-on-complete", "Bundled simulator: acknowledge moves when the motion completes.");
+	parser.addOptions({ scenariosOpt, deviceOpt, outputOpt, jogOpt, windowOpt, movesOpt, imageOpt, mixedMbOpt, mixedCmdOpt, capiOpt,
+		timeoutOpt, latencyOpt, jitterOpt, bandwidthOpt, reorderOpt, crcOpt, ackCompleteOpt });
+	parser.process(app);
+
+	E2eOptions opt;
+	opt.scenarios = parser.value(scenariosOpt).split(',', QString::SkipEmptyParts);
+	for (const QString& name : opt.scenarios)
+	{
+		if (!E2eBench::allScenarios().contains(name))
+		{
+			fprintf(stderr, "unknown scenario %s, available: %s\n", qPrintable(name), qPrintable(E2eBench::allScenarios().join(' ')));
+			return 1;
+		}
+	}
+	if (parser.isSet(deviceOpt))
+	{
+		QStringList parts = parser.value(deviceOpt).split(':');
+		opt.host = parts.value(0);
+		opt.port = static_cast<quint16>(parts.value(1, "5555").toUInt());
+	}
+	opt.jogCount = parser.value(jogOpt).toInt();
+	opt.window = parser.value(windowOpt).toInt();
+	opt.moveCount = parser.value(movesOpt).toInt();
+	opt.imageMB = parser.value(imageOpt).toInt();
+	opt.mixedMB = parser.value(mixedMbOpt).toInt();
+	opt.mixedCommands = parser.value(mixedCmdOpt).toInt();
+	opt.capiCount = parser.value(capiOpt).toInt();
+	opt.timeoutS = qMax(1, parser.value(timeoutOpt).toInt());
+
+	//内置模拟器使用系统分配的端口
+	opt.sim.port = 0;
+	opt.sim.latencyMs = qMax(0, parser.value(latencyOpt).toInt());
+	opt.sim.jitterMs = qMax(0, parser.value(jitterOpt).toInt());
+	opt.sim.bandwidth = qMax<qint64>(0, parser.value(bandwidthOpt).toLongLong()) * 1024;
+	opt.sim.reorderRate = parser.value(reorderOpt).toDouble();
+	opt.sim.rxCrcErrorRate = parser.value(crcOpt).toDouble();
+	opt.sim.ackOnComplete = parser.isSet(ackCompleteOpt);
+
+	E2eBench bench(opt);
+	QJsonObject result = bench.run();
+	if (result.isEmpty())
+	{
+		return 1;
+	}
+
+	QByteArray json = QJsonDocument(result).toJson(QJsonDocument::Indented);
+	if (parser.isSet(outputOpt))
+	{
+		QFile file(parser.value(outputOpt));
+		if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+		{
+			fprintf(stderr, "cannot create %s\n", qPrintable(parser.value(outputOpt)));
+			return 1;
+		}
+		file.write(json);
+	}
+	else
+	{
+		fwrite(json.constData(), 1, json.size(), stdout);
+	}
+
+	//任一场景出错时返回非0，便于脚本判断
+	for (const QJsonValue& scenario : result["scenarios"].toArray())
+	{
+		if (scenario.toObject().contains("error"))
+		{
+			return 2;
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,47 @@
+#-------------------------------------------------
+# 二进制日志(.blog)离线解码工具（控制台程序）
+# 用法: log_decoder <file.blog> [输出文件]   不指定输出文件时输出到标准输出
+#-------------------------------------------------
+
+QT += core
+QT -= gui
+
+TARGET = log_decoder
+TEMPLATE = app
+CONFIG += console c++17
+CONFIG -= app_bundle
+
+SDK_SRC = $$PWD/../../src/sdk
+
+# 直接编译SDK源文件，不经过DLL导入/导出
+DEFINES += BUILD_STATIC
+
+# 包含路径
+INCLUDEPATH += $$SDK_SRC \
+               $$SDK_SRC/comm
+
+# 头文件
+HEADERS += \
+    $$SDK_SRC/comm/BinaryLog.h
+
+# 源文件
+SOURCES += \
+    main.cpp \
+    $$SDK_SRC/comm/BinaryLog.cpp
+
+# 输出目录
+CONFIG(release, debug|release) {
+    DESTDIR = $$PWD/bin/release
+    OBJECTS_DIR = $$PWD/build/release/obj
+    MOC_DIR = $$PWD/build/release/moc
+}
+
+CONFIG(debug, debug|release) {
+    DESTDIR = $$PWD/bin/debug
+    OBJECTS_DIR = $$PWD/build/debug/obj
+    MOC_DIR = $$PWD/build/debug/moc
+}
+
+win32 {
+    QMAKE_CXXFLAGS += /utf-8
+}
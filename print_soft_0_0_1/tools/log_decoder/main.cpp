@@ -0,0 +1,86 @@
+﻿/**
+ * @file main.cpp
+ * @brief 二进制日志离线解码工具
+ * @details 用法: log_decoder <file.blog|file.blog.qz> [输出文件]
+ *          输出格式与CLogManager文本日志一致：[时间][线程][等级][文件-行号]:内容
+ */
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QTextStream>
+#include <cstdio>
+#include "BinaryLog.h"
+
+int main(int argc, char *argv[])
+{
+	QCoreApplication app(argc, argv);
+
+	QStringList args = app.arguments();
+	if (args.size() < 2)
+	{
+		fprintf(stderr, "usage: log_decoder <file.blog|file.blog.qz> [output.txt]\n");
+		return 1;
+	}
+
+	QFile input(args.at(1));
+	if (!input.open(QIODevice::ReadOnly))
+	{
+		fprintf(stderr, "cannot open %s\n", qPrintable(args.at(1)));
+		return 1;
+	}
+
+	//轮转后压缩的日志段为qCompress格式
+	QByteArray data = input.readAll();
+	if (args.at(1).endsWith(".qz"))
+	{
+		data = qUncompress(data);
+	}
+
+	BinaryLogReader reader;
+	if (!reader.open(data))
+	{
+		fprintf(stderr, "%s: %s\n", qPrintable(args.at(1)), qPrintable(reader.errorString()));
+		return 1;
+	}
+
+	QFile output;
+	if (args.size() >= 3)
+	{
+		output.setFileName(args.at(2));
+		if (!output.open(QIODevice::WriteOnly | QIODevice::Text))
+		{
+			fprintf(stderr, "cannot create %s\n", qPrintable(args.at(2)));
+			return 1;
+		}
+	}
+	else
+	{
+		output.open(stdout, QIODevice::WriteOnly | QIODevice::Text);
+	}
+
+	QTextStream out(&output);
+	out.setCodec("UTF-8");
+
+	BinLogEntry entry;
+	quint64 count = 0;
+	while (reader.next(entry))
+	{
+		out << QString("[%1][%2][%3][%4-%5]:%6\n")
+			.arg(QDateTime::fromMSecsSinceEpoch(entry.epochMs).toString("yyyy-MM-dd hh:mm:ss zzz"))
+			.arg(entry.thread)
+			.arg(entry.level)
+			.arg(entry.file)
+			.arg(entry.line)
+			.arg(entry.text);
+		++count;
+	}
+	out.flush();
+
+	//文件尾部可能因进程异常退出而不完整，已解出的记录仍然有效
+	if (!reader.errorString().isEmpty())
+	{
+		fprintf(stderr, "stopped after %llu records: %s\n", static_cast<unsigned long long>(count), qPrintable(reader.errorString()));
+		return 2;
+	}
+	return 0;
+}
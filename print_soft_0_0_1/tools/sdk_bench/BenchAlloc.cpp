@@ -0,0 +1,107 @@
+﻿#include "BenchCommon.h"
+#include <cstdlib>
+#include <new>
+#if defined(_MSC_VER) && defined(_DEBUG)
+#include <crtdbg.h>
+#endif
+
+//只统计当前线程，日志线程等后台线程的分配不计入被测操作
+static thread_local quint64 t_allocCount = 0;
+
+quint64 benchAllocCount()
+{
+	return t_allocCount;
+}
+
+#if defined(__GLIBC__)
+
+//拦截malloc系列函数，转发到glibc内部实现；operator new最终也走malloc，不再单独替换
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_calloc(size_t count, size_t size);
+extern "C" void* __libc_realloc(void* ptr, size_t size);
+
+extern "C" void* malloc(size_t size)
+{
+	++t_allocCount;
+	return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t count, size_t size)
+{
+	++t_allocCount;
+	return __libc_calloc(count, size);
+}
+
+extern "C" void* realloc(void* ptr, size_t size)
+{
+	++t_allocCount;
+	return __libc_realloc(ptr, size);
+}
+
+const char* benchAllocScope()
+{
+	return "malloc/calloc/realloc";
+}
+
+#elif defined(_MSC_VER) && defined(_DEBUG)
+
+//debug CRT的分配钩子可看到malloc和operator new
+static int benchAllocHook(int allocType, void*, size_t, int, long, const unsigned char*, int)
+{
+	if (allocType == _HOOK_ALLOC || allocType == _HOOK_REALLOC)
+	{
+		++t_allocCount;
+	}
+	return TRUE;
+}
+
+static const _CRT_ALLOC_HOOK s_prevHook = _CrtSetAllocHook(benchAllocHook);
+
+const char* benchAllocScope()
+{
+	return "CRT heap (debug hook)";
+}
+
+#else
+
+void* operator new(size_t size)
+{
+	++t_allocCount;
+	if (void* p = std::malloc(size ? size : 1))
+	{
+		return p;
+	}
+	throw std::bad_alloc();
+}
+
+void* operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept
+{
+	std::free(ptr);
+}
+
+const char* benchAllocScope()
+{
+	return "operator new only (Qt containers not counted, use a debug or glibc build)";
+}
+
+#endif
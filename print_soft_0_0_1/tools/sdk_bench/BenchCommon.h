@@ -0,0 +1,147 @@
+﻿#pragma once
+#include <QtCore/QtCore>
+#include <cstdio>
+
+/**  单项基准结果  **/
+struct BenchResult
+{
+	QString name;
+	qint64 bytesPerOp = 0;		//每次调用处理的字节数，0表示不统计吞吐
+	qint64 framesPerOp = 1;		//每次调用处理的帧数（一次喂入多帧的流式解码等场景大于1）
+	qint64 iterations = 0;		//最优一轮的迭代次数
+	double nsPerOp = 0;			//每次调用耗时（纳秒，取多轮最小值）
+	double allocsPerOp = 0;		//每次调用的堆分配次数（BenchAlloc.cpp统计，单独一轮测得）
+
+	double mbPerSec() const
+	{
+		return (bytesPerOp > 0 && nsPerOp > 0) ? (bytesPerOp * 1000.0 / nsPerOp) : 0;
+	}
+
+	double nsPerFrame() const { return nsPerOp / qMax<qint64>(1, framesPerOp); }
+	double allocsPerFrame() const { return allocsPerOp / qMax<qint64>(1, framesPerOp); }
+};
+
+//防止被测表达式被优化掉
+extern volatile quint64 g_benchSink;
+
+//每轮最短运行时间（毫秒）与轮数
+#define BENCH_MIN_ROUND_MS 200
+#define BENCH_ROUNDS 5
+//统计分配次数的一轮最多迭代次数
+#define BENCH_ALLOC_ITERATIONS 10000
+
+/**
+*  @brief       当前线程累计的堆分配次数（含realloc）
+*  @param[in]
+*  @param[out]
+*  @return
+*
+*  glibc下拦截malloc/calloc/realloc，可统计到Qt容器的分配；MSVC debug下使用_CrtSetAllocHook；
+*  其他情况只能替换全局operator new，QByteArray/QString等直接走malloc的分配统计不到，见benchAllocScope
+*/
+quint64 benchAllocCount();
+
+//分配统计覆盖范围说明，输出在结果表头
+const char* benchAllocScope();
+
+/**
+*  @brief       运行一个基准：先标定迭代次数使单轮不少于BENCH_MIN_ROUND_MS，再取多轮中最快的一轮
+*  @param[in]    name: 名称  bytesPerOp: 每次处理字节数  op: 被测操作，返回值累加到g_benchSink
+*  @param[out]
+*  @return
+*/
+template <typename Op>
+BenchResult runBench(const QString& name, qint64 bytesPerOp, Op op)
+{
+	QElapsedTimer timer;
+	qint64 iterations = 1;
+	for (;;)
+	{
+		timer.start();
+		for (qint64 i = 0; i < iterations; i++)
+		{
+			g_benchSink += op();
+		}
+		if (timer.elapsed() >= BENCH_MIN_ROUND_MS / 10 || iterations >= (Q_INT64_C(1) << 40))
+		{
+			break;
+		}
+		iterations *= 2;
+	}
+	iterations = qMax<qint64>(1, iterations * BENCH_MIN_ROUND_MS / qMax<qint64>(1, timer.elapsed()));
+
+	BenchResult result;
+	result.name = name;
+	result.bytesPerOp = bytesPerOp;
+	result.iterations = iterations;
+	result.nsPerOp = -1;
+	for (int round = 0; round < BENCH_ROUNDS; round++)
+	{
+		timer.start();
+		for (qint64 i = 0; i < iterations; i++)
+		{
+			g_benchSink += op();
+		}
+		double ns = static_cast<double>(timer.nsecsElapsed()) / iterations;
+		if (result.nsPerOp < 0 || ns < result.nsPerOp)
+		{
+			result.nsPerOp = ns;
+		}
+	}
+
+	//分配次数单独统计一轮，计数本身不计入耗时
+	qint64 allocIterations = qMin<qint64>(iterations, BENCH_ALLOC_ITERATIONS);
+	quint64 allocs = benchAllocCount();
+	for (qint64 i = 0; i < allocIterations; i++)
+	{
+		g_benchSink += op();
+	}
+	result.allocsPerOp = static_cast<double>(benchAllocCount() - allocs) / allocIterations;
+	return result;
+}
+
+/**
+*  @brief       打印一行结果
+*  @param[in]
+*  @param[out]
+*  @return
+*/
+inline void printBenchResult(const BenchResult& result)
+{
+	if (result.bytesPerOp > 0)
+	{
+		printf("  %-40s %12.1f ns/op %10.1f MB/s\n", qPrintable(result.name), result.nsPerOp, result.mbPerSec());
+	}
+	else
+	{
+		printf("  %-40s %12.1f ns/op\n", qPrintable(result.name), result.nsPerOp);
+	}
+	fflush(stdout);
+}
+
+/**
+*  @brief       按帧打印一行结果：ns/frame、allocs/frame，有字节数时附带吞吐
+*  @param[in]
+*  @param[out]
+*  @return
+*/
+inline void printFrameBenchResult(const BenchResult& result)
+{
+	if (result.bytesPerOp > 0)
+	{
+		printf("  %-48s %10.1f ns/frame %7.2f allocs/frame %9.1f MB/s\n", qPrintable(result.name),
+			result.nsPerFrame(), result.allocsPerFrame(), result.mbPerSec());
+	}
+	else
+	{
+		printf("  %-48s %10.1f ns/frame %7.2f allocs/frame\n", qPrintable(result.name),
+			result.nsPerFrame(), result.allocsPerFrame());
+	}
+	fflush(stdout);
+}
+
+/**  各套件入口  **/
+void runCrcBench();
+void runLogBench();
+void runProtocolBench();
+void runPositionBench();
@@ -0,0 +1,45 @@
+﻿#include "BenchCommon.h"
+#include "Crc16.h"
+#include "utils.h"
+
+//对比slice-by-8与原逐字节双表实现在不同长度下的耗时
+void runCrcBench()
+{
+	const int sizes[] = { 10, 1024, 64 * 1024 };
+
+	QByteArray buf(64 * 1024, Qt::Uninitialized);
+	quint32 seed = 0x12345678;
+	for (int i = 0; i < buf.size(); i++)
+	{
+		seed = seed * 1103515245 + 12345;
+		buf[i] = static_cast<char>(seed >> 16);
+	}
+	const uchar* data = reinterpret_cast<const uchar*>(buf.constData());
+
+	Utils& utils = Utils::GetInstance();
+	for (int size : sizes)
+	{
+		if (utils.MakeCRCCheckBytewise(data, size) != Crc16::compute(data, size))
+		{
+			printf("  crc mismatch at size %d\n", size);
+			return;
+		}
+
+		BenchResult legacy = runBench(QString("bytewise  %1 B").arg(size), size, [&]() {
+			return utils.MakeCRCCheckBytewise(data, size);
+		});
+		BenchResult slice8 = runBench(QString("slice-by-8 %1 B").arg(size), size, [&]() {
+			return Crc16::compute(data, size);
+		});
+		printBenchResult(legacy);
+		printBenchResult(slice8);
+		printf("  %-40s %12.2fx\n", "speedup", legacy.nsPerOp / slice8.nsPerOp);
+	}
+
+	//分段增量计算（模拟组包时先帧头后数据区）
+	BenchResult incremental = runBench(QString("incremental 8 B + 1014 B"), 1022, [&]() {
+		quint16 crc = Crc16::update(Crc16::InitValue, data, 8);
+		return Crc16::update(crc, data + 8, 1014);
+	});
+	printBenchResult(incremental);
+}
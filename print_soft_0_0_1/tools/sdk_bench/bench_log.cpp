@@ -0,0 +1,97 @@
+﻿#include "BenchCommon.h"
+#include "CLogManager.h"
+
+//对比被过滤的日志语句与实际写出日志的单次开销
+void runLogBench()
+{
+	const QByteArray frame = QByteArray::fromHex("BBAA110031070C0000000000000000000000000000");
+	quint32 position = 123456;
+
+	//与SDKMotion.cpp中positionToByteArray相同的日志语句
+	auto buildMessage = [&]() {
+		return QString(u8"%1轴 位置数据: %2 μm (%3 mm) %4")
+			.arg('X')
+			.arg(position)
+			.arg(static_cast<double>(position) / 1000.0, 0, 'f', 3)
+			.arg(QString(frame.toHex(' ').toUpper()));
+	};
+
+	//旧宏的代价：无论等级如何都先构造参数
+	BenchResult eager = runBench(QString("eager format (old macro)"), 0, [&]() {
+		return static_cast<quint64>(buildMessage().size());
+	});
+
+	//运行期过滤：等级判断在参数求值之前
+	CLogManager::setLogLevel(ELogWarning);
+	BenchResult runtimeOff = runBench(QString("LOG_AT_LEVEL debug, level=warn"), 0, [&]() {
+		LOG_AT_LEVEL(ELogDebug, buildMessage());
+		return static_cast<quint64>(position);
+	});
+
+	//编译期移除
+	BenchResult compiledOut = runBench(QString("LOG_DISCARD (compiled out)"), 0, [&]() {
+		LOG_DISCARD(buildMessage());
+		return static_cast<quint64>(position);
+	});
+
+	//实际写出：格式化 + 入队，日志线程在后台批量写文件
+	QString logDir = QDir::tempPath() + "/sdk_bench_";
+	CLogManager::getInstance()->startLog(logDir);
+	CLogManager::setLogLevel(ELogDebug);
+	BenchResult enabled = runBench(QString("LOG_AT_LEVEL debug, level=debug"), 0, [&]() {
+		LOG_AT_LEVEL(ELogDebug, buildMessage());
+		return static_cast<quint64>(position);
+	});
+	quint64 dropped = CLogManager::getInstance()->droppedCount();
+	CLogManager::getInstance()->stopLog();
+
+	//延迟格式化：只记录格式id、时间戳和参数原始值
+	CLogManager::getInstance()->setBinaryMode(true);
+	CLogManager::getInstance()->startLog(logDir);
+	BenchResult binary = runBench(QString("LOGB_DEBUG, binary mode"), 0, [&]() {
+		LOGB_DEBUG(u8"%1轴 位置数据: %2 μm", 'X', position);
+		return static_cast<quint64>(position);
+	});
+	dropped = CLogManager::getInstance()->droppedCount() - dropped;
+	CLogManager::getInstance()->stopLog();
+	CLogManager::getInstance()->setBinaryMode(false);
+
+	printBenchResult(eager);
+	printBenchResult(runtimeOff);
+	printBenchResult(compiledOut);
+	printBenchResult(enabled);
+	printBenchResult(binary);
+	printf("  %-40s %12llu\n", "records dropped (queue full)", static_cast<unsigned long long>(dropped));
+
+	//每行落盘字节数：文本行 vs 二进制记录
+	const int lines = 1000;
+	LogData_t logData;
+	logData.strModule = "SDKMotion.cpp-41";
+	logData.thread = QThread::currentThreadId();
+	logData.level = ELogDebug;
+	logData.strLog = QString(u8"%1轴 位置数据: %2 μm").arg('X').arg(position);
+	qint64 textBytes = QString("[%1][%2][%3][%4]:%5\n")
+		.arg(logData.dt.toString("yyyy-MM-dd hh:mm:ss zzz"))
+		.arg((unsigned long long)logData.thread)
+		.arg(logData.level)
+		.arg(logData.strModule)
+		.arg(logData.strLog).toUtf8().size();
+
+	static const quint16 s_benchFmtId = BinaryLog::registerSite(ELogDebug, __FILE__, __LINE__, u8"%1轴 位置数据: %2 μm");
+	BinaryLogWriter writer;
+	QByteArray encoded = writer.begin(QDateTime::currentMSecsSinceEpoch(), BinaryLog::nowNs());
+	int headerBytes = encoded.size();
+	for (int i = 0; i < lines; i++)
+	{
+		BinLogRecord rec;
+		rec.fmtId = s_benchFmtId;
+		rec.argCount = 0;
+		rec.tsNs = BinaryLog::nowNs();
+		rec.thread = static_cast<quint64>(reinterpret_cast<quintptr>(QThread::currentThreadId()));
+		BinaryLog::pack(rec, 'X', position + i);
+		writer.append(encoded, rec);
+	}
+	double binBytes = static_cast<double>(encoded.size() - headerBytes) / lines;
+	printf("  %-40s %12lld B/line\n", "text line", static_cast<long long>(textBytes));
+	printf("  %-40s %12.1f B/line\n", "binary record", binBytes);
+}
@@ -0,0 +1,42 @@
+﻿#include "BenchCommon.h"
+#include "SDKManager.h"
+#include "CLogManager.h"
+
+//SDKMotion.cpp中基于QDataStream的坐标编码，与直接按小端写入预分配缓冲区对比
+void runPositionBench()
+{
+	CLogManager::setLogLevel(ELogWarning);
+	printf("  allocation counting: %s\n", benchAllocScope());
+
+	const MoveAxisPos pos(100000, 200000, 30000);
+	quint32 position = 123456;
+
+	BenchResult single = runBench(QString("positionToByteArray (QDataStream) 4 B"), 4, [&]() {
+		return static_cast<quint64>(SDKManager::positionToByteArray(position, 'X').size());
+	});
+	BenchResult full = runBench(QString("fullPositionToByteArray (QDataStream) 12 B"), 12, [&]() {
+		return static_cast<quint64>(SDKManager::fullPositionToByteArray(pos).size());
+	});
+
+	//参考实现：一次分配后直接写入
+	auto encodeDirect = [](const MoveAxisPos& p) {
+		QByteArray data(12, Qt::Uninitialized);
+		uchar* buf = reinterpret_cast<uchar*>(data.data());
+		qToLittleEndian<quint32>(p.xPos, buf);
+		qToLittleEndian<quint32>(p.yPos, buf + 4);
+		qToLittleEndian<quint32>(p.zPos, buf + 8);
+		return data;
+	};
+	if (encodeDirect(pos) != SDKManager::fullPositionToByteArray(pos))
+	{
+		printf("  position encoding mismatch\n");
+		return;
+	}
+	BenchResult direct = runBench(QString("qToLittleEndian 12 B (reference)"), 12, [&]() {
+		return static_cast<quint64>(encodeDirect(pos).size());
+	});
+
+	printFrameBenchResult(single);
+	printFrameBenchResult(full);
+	printFrameBenchResult(direct);
+}
@@ -0,0 +1,160 @@
+﻿#include "BenchCommon.h"
+#include "ProtocolPrint.h"
+#include "ImagePacketizer.h"
+#include "CLogManager.h"
+#include "Crc16.h"
+#include "utils.h"
+
+namespace
+{
+	//流式解码场景中一段接收数据包含的帧数，以及碎片化接收时每次到达的字节数
+	const int kStreamFrames = 64;
+	const int kFragmentSize = 7;
+	//直接调用ParseRespPackageData时每批帧数，批末通过空接收把结果发出（与一次接收解出多帧的路径一致）
+	const int kParseBatch = 16;
+
+	//组一帧下位机回复包（各字段小端，crc先高字节后低字节）
+	QByteArray makeRespFrame(ushort head, ushort cmdType, ushort code, const QByteArray& payload)
+	{
+		QByteArray frame(payload.size() + 10, Qt::Uninitialized);
+		uchar* p = reinterpret_cast<uchar*>(frame.data());
+		qToLittleEndian<quint16>(head, p);
+		qToLittleEndian<quint16>(cmdType, p + 2);
+		qToLittleEndian<quint16>(code, p + 4);
+		qToLittleEndian<quint16>(static_cast<quint16>(payload.size()), p + 6);
+		memcpy(p + 8, payload.constData(), payload.size());
+		ushort crc = Crc16::compute(p, payload.size() + 8);
+		p[payload.size() + 8] = static_cast<uchar>(crc >> 8);
+		p[payload.size() + 9] = static_cast<uchar>(crc & 0xFF);
+		return frame;
+	}
+
+	QByteArray seqPayload(quint32 seq)
+	{
+		QByteArray data(4, Qt::Uninitialized);
+		qToLittleEndian<quint32>(seq, reinterpret_cast<uchar*>(data.data()));
+		return data;
+	}
+
+	QByteArray axisPayload(quint32 x, quint32 y, quint32 z)
+	{
+		QByteArray data(12, Qt::Uninitialized);
+		uchar* p = reinterpret_cast<uchar*>(data.data());
+		qToLittleEndian<quint32>(x, p);
+		qToLittleEndian<quint32>(y, p + 4);
+		qToLittleEndian<quint32>(z, p + 8);
+		return data;
+	}
+
+	QByteArray pseudoRandom(int size)
+	{
+		QByteArray buf(size, Qt::Uninitialized);
+		quint32 seed = 0x12345678;
+		for (int i = 0; i < buf.size(); i++)
+		{
+			seed = seed * 1103515245 + 12345;
+			buf[i] = static_cast<char>(seed >> 16);
+		}
+		return buf;
+	}
+}
+
+//协议层每帧热路径：组包、校验、解析、流式分帧
+void runProtocolBench()
+{
+	//按release默认等级过滤日志，只测协议本身的开销
+	CLogManager::setLogLevel(ELogWarning);
+	printf("  allocation counting: %s\n", benchAllocScope());
+
+	const QByteArray axisData = axisPayload(100000, 200000, 30000);
+	const QByteArray imageData = pseudoRandom(IMG_PACKET_PAYLOAD_SIZE);
+
+	//-------------组包-------------
+	BenchResult sendCtrl = runBench(QString("GetSendDatagram ctrl 12 B"), axisData.size() + 10, [&]() {
+		return static_cast<quint64>(ProtocolPrint::GetSendDatagram(ProtocolPrint::CtrlCmd, ProtocolPrint::Ctrl_AxisAbsMove, axisData).size());
+	});
+	BenchResult sendImage = runBench(QString("GetSendDatagram image %1 B").arg(imageData.size()), imageData.size() + 10, [&]() {
+		return static_cast<quint64>(ProtocolPrint::GetSendDatagram(ProtocolPrint::PrintCommCmd, ProtocolPrint::Print_PeriodData, imageData).size());
+	});
+	BenchResult respCtrl = runBench(QString("GetRespDatagram 12 B"), axisData.size() + 10, [&]() {
+		return static_cast<quint64>(ProtocolPrint::GetRespDatagram(ProtocolPrint::Get_AxisPos, axisData).size());
+	});
+
+	//-------------校验（CheckCRC对每个请求帧调用）-------------
+	const QByteArray ctrlFrame = ProtocolPrint::GetSendDatagram(ProtocolPrint::CtrlCmd, ProtocolPrint::Ctrl_AxisAbsMove, axisData);
+	const QByteArray imageFrame = ProtocolPrint::GetSendDatagram(ProtocolPrint::PrintCommCmd, ProtocolPrint::Print_PeriodData, imageData);
+	Utils& utils = Utils::GetInstance();
+	BenchResult crcCtrl = runBench(QString("Utils::MakeCRCCheck %1 B").arg(ctrlFrame.size() - 2), ctrlFrame.size() - 2, [&]() {
+		return utils.MakeCRCCheck(reinterpret_cast<const uchar*>(ctrlFrame.constData()), ctrlFrame.size() - 2);
+	});
+	BenchResult crcImage = runBench(QString("Utils::MakeCRCCheck %1 B").arg(imageFrame.size() - 2), imageFrame.size() - 2, [&]() {
+		return utils.MakeCRCCheck(reinterpret_cast<const uchar*>(imageFrame.constData()), imageFrame.size() - 2);
+	});
+
+	//-------------单帧解析-------------
+	ProtocolPrint proto;
+	QByteArray reqFrame = ctrlFrame;
+	BenchResult parseReq = runBench(QString("ParseReqPackageData AABB 12 B"), reqFrame.size(), [&]() {
+		proto.ParseReqPackageData(reqFrame, ProtocolPrint::Head_AABB);
+		return static_cast<quint64>(reqFrame.size());
+	});
+
+	QByteArray ackFrame = makeRespFrame(ProtocolPrint::Head_AACC, ProtocolPrint::PrintCommCmd, ProtocolPrint::Print_PeriodData, seqPayload(4096));
+	QByteArray axisFrame = makeRespFrame(ProtocolPrint::Head_AACC, ProtocolPrint::GetCmd, ProtocolPrint::Get_AxisPos, axisData);
+	QByteArray nakFrame = makeRespFrame(ProtocolPrint::Head_AADD, ProtocolPrint::PrintCommCmd, ProtocolPrint::Print_PeriodData, seqPayload(4096));
+	auto parseResp = [&](const QString& name, QByteArray& frame, ProtocolPrint::PackageHeadType type) {
+		BenchResult result = runBench(name, frame.size() * kParseBatch, [&]() {
+			for (int i = 0; i < kParseBatch; i++)
+			{
+				proto.ParseRespPackageData(frame, type);
+			}
+			proto.HandleRecvDatagramData1(QByteArray());
+			return static_cast<quint64>(frame.size());
+		});
+		result.framesPerOp = kParseBatch;
+		return result;
+	};
+	BenchResult parseAck = parseResp(QString("ParseRespPackageData AACC ack"), ackFrame, ProtocolPrint::Head_AACC);
+	BenchResult parseAxis = parseResp(QString("ParseRespPackageData AACC axis 12 B"), axisFrame, ProtocolPrint::Head_AACC);
+	BenchResult parseNak = parseResp(QString("ParseRespPackageData AADD nak"), nakFrame, ProtocolPrint::Head_AADD);
+
+	//-------------流式分帧：同一段回复流一次到达与碎片化到达-------------
+	//打印过程中的典型回复流：每4帧中3帧为图像确认、1帧为坐标应答
+	QByteArray stream;
+	for (int i = 0; i < kStreamFrames; i++)
+	{
+		stream += (i % 4 == 3) ? axisFrame : makeRespFrame(ProtocolPrint::Head_AACC, ProtocolPrint::PrintCommCmd,
+			ProtocolPrint::Print_PeriodData, seqPayload(static_cast<quint32>(i)));
+	}
+	QVector<QByteArray> fragments;
+	for (int pos = 0; pos < stream.size(); pos += kFragmentSize)
+	{
+		fragments.append(QByteArray::fromRawData(stream.constData() + pos, qMin(kFragmentSize, stream.size() - pos)));
+	}
+
+	BenchResult coalesced = runBench(QString("HandleRecvDatagramData1 coalesced x%1").arg(kStreamFrames), stream.size(), [&]() {
+		proto.HandleRecvDatagramData1(stream);
+		return static_cast<quint64>(stream.size());
+	});
+	coalesced.framesPerOp = kStreamFrames;
+	BenchResult fragmented = runBench(QString("HandleRecvDatagramData1 fragmented %1 B").arg(kFragmentSize), stream.size(), [&]() {
+		for (const QByteArray& fragment : fragments)
+		{
+			proto.HandleRecvDatagramData1(fragment);
+		}
+		return static_cast<quint64>(fragments.size());
+	});
+	fragmented.framesPerOp = kStreamFrames;
+
+	printFrameBenchResult(sendCtrl);
+	printFrameBenchResult(sendImage);
+	printFrameBenchResult(respCtrl);
+	printFrameBenchResult(crcCtrl);
+	printFrameBenchResult(crcImage);
+	printFrameBenchResult(parseReq);
+	printFrameBenchResult(parseAck);
+	printFrameBenchResult(parseAxis);
+	printFrameBenchResult(parseNak);
+	printFrameBenchResult(coalesced);
+	printFrameBenchResult(fragmented);
+}
@@ -0,0 +1,57 @@
+﻿/**
+ * @file main.cpp
+ * @brief SDK 性能基准测试入口
+ * @details 用法: sdk_bench [套件名...]，不带参数时依次运行全部套件
+ */
+
+#include <QCoreApplication>
+#include "BenchCommon.h"
+
+volatile quint64 g_benchSink = 0;
+
+namespace
+{
+	struct BenchSuite
+	{
+		const char* name;
+		void (*run)();
+	};
+
+	const BenchSuite s_suites[] =
+	{
+		{ "crc", runCrcBench },
+		{ "log", runLogBench },
+		{ "protocol", runProtocolBench },
+		{ "position", runPositionBench },
+	};
+}
+
+int main(int argc, char *argv[])
+{
+	QCoreApplication app(argc, argv);
+
+	QStringList selected = app.arguments().mid(1);
+	int ran = 0;
+	for (const BenchSuite& suite : s_suites)
+	{
+		if (!selected.isEmpty() && !selected.contains(QString::fromLatin1(suite.name)))
+		{
+			continue;
+		}
+		printf("[%s]\n", suite.name);
+		suite.run();
+		ran++;
+	}
+
+	if (ran == 0)
+	{
+		printf("unknown suite, available:");
+		for (const BenchSuite& suite : s_suites)
+		{
+			printf(" %s", suite.name);
+		}
+		printf("\n");
+		return 1;
+	}
+	return 0;
+}
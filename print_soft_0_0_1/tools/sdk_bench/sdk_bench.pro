@@ -0,0 +1,109 @@
+#-------------------------------------------------
+# SDK 性能基准测试（控制台程序，直接编译SDK源文件）
+# 套件: crc log protocol position，protocol/position按帧输出ns/frame与allocs/frame
+# 用法: sdk_bench [套件名...]   不带参数时运行全部套件
+#-------------------------------------------------
+
+QT += core gui network concurrent
+
+TARGET = sdk_bench
+TEMPLATE = app
+CONFIG += console c++17
+CONFIG -= app_bundle
+
+SDK_SRC = $$PWD/../../src/sdk
+
+# 直接编译SDK源文件，不经过DLL导入/导出
+DEFINES += BUILD_STATIC
+
+# 包含路径
+INCLUDEPATH += $$PWD \
+               $$SDK_SRC \
+               $$SDK_SRC/comm \
+               $$SDK_SRC/communicate \
+               $$SDK_SRC/protocol \
+               $$SDK_SRC/service \
+               $$PWD/../../ext/inc
+
+# 头文件
+HEADERS += \
+    BenchCommon.h \
+    $$SDK_SRC/motionControlSDK.h \
+    $$SDK_SRC/motioncontrolsdk_global.h \
+    $$SDK_SRC/motioncontrolsdk_event.h \
+    $$SDK_SRC/SDKManager.h \
+    $$SDK_SRC/SDKSessionManager.h \
+    $$SDK_SRC/comm/Crc16.h \
+    $$SDK_SRC/comm/utils.h \
+    $$SDK_SRC/comm/CLogManager.h \
+    $$SDK_SRC/comm/CLogThread.h \
+    $$SDK_SRC/comm/CLogSpdlogSink.h \
+    $$SDK_SRC/comm/MpscRingBuffer.h \
+    $$SDK_SRC/comm/BinaryLog.h \
+    $$SDK_SRC/comm/MetricsRegistry.h \
+    $$SDK_SRC/comm/TraceRecorder.h \
+    $$SDK_SRC/comm/WireCapture.h \
+    $$SDK_SRC/communicate/TcpClient.h \
+    $$SDK_SRC/communicate/SendLaneQueue.h \
+    $$SDK_SRC/communicate/EpollTransport.h \
+    $$SDK_SRC/communicate/IoThreadPool.h \
+    $$SDK_SRC/protocol/ProtocolPrint.h \
+    $$SDK_SRC/protocol/FrameDecoder.h \
+    $$SDK_SRC/protocol/ImagePacketizer.h \
+    $$SDK_SRC/protocol/RetransmitWindow.h \
+    $$SDK_SRC/service/PendingRequestTable.h \
+    $$SDK_SRC/service/PrintSource.h
+
+# 源文件
+SOURCES += \
+    main.cpp \
+    BenchAlloc.cpp \
+    bench_crc.cpp \
+    bench_log.cpp \
+    bench_protocol.cpp \
+    bench_position.cpp \
+    $$SDK_SRC/motionControlSDK.cpp \
+    $$SDK_SRC/SDKManager.cpp \
+    $$SDK_SRC/SDKSessionManager.cpp \
+    $$SDK_SRC/SDKManager_Position.cpp \
+    $$SDK_SRC/SDKCallback.cpp \
+    $$SDK_SRC/SDKConnection.cpp \
+    $$SDK_SRC/SDKMotion.cpp \
+    $$SDK_SRC/SDKPackParam.cpp \
+    $$SDK_SRC/SDKPrint.cpp \
+    $$SDK_SRC/SDKPrintParam.cpp \
+    $$SDK_SRC/comm/Crc16.cpp \
+    $$SDK_SRC/comm/utils.cpp \
+    $$SDK_SRC/comm/CLogManager.cpp \
+    $$SDK_SRC/comm/CLogThread.cpp \
+    $$SDK_SRC/comm/BinaryLog.cpp \
+    $$SDK_SRC/comm/MetricsRegistry.cpp \
+    $$SDK_SRC/comm/TraceRecorder.cpp \
+    $$SDK_SRC/comm/WireCapture.cpp \
+    $$SDK_SRC/communicate/TcpClient.cpp \
+    $$SDK_SRC/communicate/SendLaneQueue.cpp \
+    $$SDK_SRC/communicate/EpollTransport.cpp \
+    $$SDK_SRC/communicate/IoThreadPool.cpp \
+    $$SDK_SRC/protocol/ProtocolPrint.cpp \
+    $$SDK_SRC/protocol/FrameDecoder.cpp \
+    $$SDK_SRC/protocol/ImagePacketizer.cpp \
+    $$SDK_SRC/protocol/RetransmitWindow.cpp \
+    $$SDK_SRC/service/PendingRequestTable.cpp \
+    $$SDK_SRC/service/PrintSource.cpp
+
+# 输出目录
+CONFIG(release, debug|release) {
+    DESTDIR = $$PWD/bin/release
+    OBJECTS_DIR = $$PWD/build/release/obj
+    MOC_DIR = $$PWD/build/release/moc
+}
+
+CONFIG(debug, debug|release) {
+    DESTDIR = $$PWD/bin/debug
+    OBJECTS_DIR = $$PWD/build/debug/obj
+    MOC_DIR = $$PWD/build/debug/moc
+}
+
+win32 {
+    QMAKE_CXXFLAGS += /utf-8
+}
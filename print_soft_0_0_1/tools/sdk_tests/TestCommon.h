@@ -0,0 +1,21 @@
+﻿#pragma once
+#include <QtCore/QtCore>
+#include <cstdio>
+
+//当前用例中失败的检查数
+extern int g_testFailures;
+
+//检查失败时输出位置和表达式，继续执行后续检查
+#define TEST_CHECK(expr) \
+	do \
+	{ \
+		if (!(expr)) \
+		{ \
+			printf("  FAILED %s:%d: %s\n", __FILE__, __LINE__, #expr); \
+			g_testFailures++; \
+		} \
+	} while (0)
+
+//RetransmitWindow用例
+void testRetransmitBackpressure();
+void testRetransmitLimit();
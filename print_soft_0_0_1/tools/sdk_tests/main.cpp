@@ -0,0 +1,58 @@
+﻿/**
+ * @file main.cpp
+ * @brief SDK 单元检查入口
+ * @details 用法: sdk_tests [用例名...]，不带参数时依次运行全部用例；有失败的检查时返回1
+ */
+
+#include <QCoreApplication>
+#include "TestCommon.h"
+
+int g_testFailures = 0;
+
+namespace
+{
+	struct TestCase
+	{
+		const char* name;
+		void (*run)();
+	};
+
+	const TestCase s_cases[] =
+	{
+		{ "retransmit_backpressure", testRetransmitBackpressure },
+		{ "retransmit_limit", testRetransmitLimit },
+	};
+}
+
+int main(int argc, char *argv[])
+{
+	QCoreApplication app(argc, argv);
+
+	QStringList selected = app.arguments().mid(1);
+	int ran = 0;
+	int failed = 0;
+	for (const TestCase& test : s_cases)
+	{
+		if (!selected.isEmpty() && !selected.contains(QString::fromLatin1(test.name)))
+		{
+			continue;
+		}
+		g_testFailures = 0;
+		test.run();
+		printf("[%s] %s\n", g_testFailures == 0 ? "PASS" : "FAIL", test.name);
+		failed += g_testFailures == 0 ? 0 : 1;
+		ran++;
+	}
+
+	if (ran == 0)
+	{
+		printf("unknown test, available:");
+		for (const TestCase& test : s_cases)
+		{
+			printf(" %s", test.name);
+		}
+		printf("\n");
+		return 1;
+	}
+	return failed == 0 ? 0 : 1;
+}
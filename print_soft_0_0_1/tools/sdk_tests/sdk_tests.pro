@@ -0,0 +1,54 @@
+#-------------------------------------------------
+# SDK 单元检查（控制台程序，直接编译被测的SDK源文件）
+# 用法: sdk_tests [用例名...]   不带参数时运行全部用例，有失败时返回1
+#-------------------------------------------------
+
+QT += core
+QT -= gui
+
+TARGET = sdk_tests
+TEMPLATE = app
+CONFIG += console c++17
+CONFIG -= app_bundle
+
+SDK_SRC = $$PWD/../../src/sdk
+
+# 直接编译SDK源文件，不经过DLL导入/导出
+DEFINES += BUILD_STATIC
+
+# 包含路径
+INCLUDEPATH += $$PWD \
+               $$SDK_SRC \
+               $$SDK_SRC/comm \
+               $$SDK_SRC/communicate \
+               $$SDK_SRC/protocol
+
+# 头文件
+HEADERS += \
+    TestCommon.h \
+    $$SDK_SRC/comm/MetricsRegistry.h \
+    $$SDK_SRC/communicate/SendLaneQueue.h \
+    $$SDK_SRC/protocol/RetransmitWindow.h
+
+# 源文件
+SOURCES += \
+    main.cpp \
+    test_retransmit.cpp \
+    $$SDK_SRC/comm/MetricsRegistry.cpp \
+    $$SDK_SRC/communicate/SendLaneQueue.cpp \
+    $$SDK_SRC/protocol/RetransmitWindow.cpp
+
+# 输出目录
+CONFIG(release, debug|release) {
+    DESTDIR = $$PWD/bin/release
+    OBJECTS_DIR = $$PWD/build/release/obj
+}
+
+CONFIG(debug, debug|release) {
+    DESTDIR = $$PWD/bin/debug
+    OBJECTS_DIR = $$PWD/build/debug/obj
+}
+
+win32 {
+    QMAKE_CXXFLAGS += /utf-8
+}
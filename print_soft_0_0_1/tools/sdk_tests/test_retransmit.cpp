@@ -0,0 +1,113 @@
+﻿/**
+ * @file test_retransmit.cpp
+ * @brief 图像帧重传窗口与批量发送通道背压的配合
+ */
+
+#include "TestCommon.h"
+#include "RetransmitWindow.h"
+#include "SendLaneQueue.h"
+#include "MetricsRegistry.h"
+
+namespace
+{
+	//与SDKManager::onPumpImagePackets相同的重发流程：入队成功后才记为已重发
+	int resendDue(RetransmitWindow& window, SendLaneQueue& queue, qint64 nowMs)
+	{
+		QList<quint32> seqs;
+		QList<QByteArray> frames = window.peekDue(nowMs, &seqs);
+		int sent = 0;
+		for (int i = 0; i < frames.size(); i++)
+		{
+			if (!queue.enqueue(frames[i], Lane_Bulk))
+			{
+				break;
+			}
+			window.commitRetry(seqs[i], nowMs);
+			sent++;
+		}
+		return sent;
+	}
+
+	//取空发送队列，相当于socket写出
+	void drain(SendLaneQueue& queue)
+	{
+		QVector<QByteArray> frames;
+		while (queue.takeFrames(frames, 64, 1 << 20, true) > 0)
+		{
+			frames.clear();
+		}
+	}
+}
+
+void testRetransmitBackpressure()
+{
+	MetricsRegistry metrics;
+	SendLaneQueue queue(&metrics);
+	queue.setWaterMark(1024, 512);
+
+	RetransmitWindow window(4, 100, RETRANS_MAX_RETRIES);
+	window.reset(0);
+
+	const QByteArray frame(600, 'x');
+	TEST_CHECK(queue.enqueue(frame, Lane_Bulk));
+	window.onSent(0, frame, 0);
+
+	//下位机否认，批量通道一直满：重发入队被拒绝的次数远超重发次数上限
+	qint64 nowMs = 0;
+	const int rejected = RETRANS_MAX_RETRIES * 3;
+	for (int i = 0; i < rejected; i++)
+	{
+		nowMs += 10;
+		window.onNak(0);
+		TEST_CHECK(resendDue(window, queue, nowMs) == 0);
+	}
+	TEST_CHECK(!window.exhausted());
+	TEST_CHECK(window.retransmitCount() == 0);
+
+	//通道回落后该帧仍然待重发，且只计一次重发
+	drain(queue);
+	TEST_CHECK(resendDue(window, queue, nowMs) == 1);
+	TEST_CHECK(window.retransmitCount() == 1);
+	TEST_CHECK(!window.exhausted());
+
+	//已重发的帧重新计时，超时前不再返回
+	QList<quint32> seqs;
+	TEST_CHECK(window.peekDue(nowMs + 50, &seqs).isEmpty());
+}
+
+void testRetransmitLimit()
+{
+	MetricsRegistry metrics;
+	SendLaneQueue queue(&metrics);
+
+	RetransmitWindow window(4, 100, RETRANS_MAX_RETRIES);
+	window.reset(0);
+
+	const QByteArray frame(64, 'x');
+	window.onSent(0, frame, 0);
+
+	//每次重发都成功入队时，第RETRANS_MAX_RETRIES次之后任务失败
+	qint64 nowMs = 0;
+	for (int i = 0; i < RETRANS_MAX_RETRIES; i++)
+	{
+		nowMs += 10;
+		window.onNak(0);
+		TEST_CHECK(resendDue(window, queue, nowMs) == 1);
+		drain(queue);
+	}
+	TEST_CHECK(!window.exhausted());
+	TEST_CHECK(window.retransmitCount() == RETRANS_MAX_RETRIES);
+
+	window.onNak(0);
+	TEST_CHECK(resendDue(window, queue, nowMs + 10) == 0);
+	TEST_CHECK(window.exhausted());
+
+	//断线补发不消耗重发次数
+	RetransmitWindow resumed(4, 100, 0);
+	resumed.reset(0);
+	resumed.onSent(0, frame, 0);
+	resumed.requeueAll();
+	TEST_CHECK(resendDue(resumed, queue, 10) == 1);
+	TEST_CHECK(!resumed.exhausted());
+	TEST_CHECK(resumed.retransmitCount() == 0);
+}